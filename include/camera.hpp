@@ -5,6 +5,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <cmath>
+
 // Defines several possible options for camera movement. Used as abstraction to stay away from window-system specific input methods
 enum Camera_Movement {
     FORWARD,
@@ -42,6 +44,8 @@ public:
     float MovementSpeed;
     float MouseSensitivity;
     float Zoom;
+    // world-space velocity, smoothed over a few frames; see TrackVelocity
+    glm::vec3 Velocity = glm::vec3(0.0f);
 
     // 构造函数 with vectors
     Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f), float yaw = YAW, float pitch = PITCH) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM)
@@ -109,6 +113,19 @@ public:
         updateCameraVectors();
     }
 
+    // updates Velocity from the movement since the last call; call once per frame, after input
+    void TrackVelocity(float deltaTime)
+    {
+        if (deltaTime > 0.0f && hasLastPosition)
+        {
+            // about a quarter second of smoothing, so one frame's jump does not swing prefetching around
+            const float blend = 1.0f - std::exp(-deltaTime / 0.25f);
+            Velocity += ((Position - lastPosition) / deltaTime - Velocity) * blend;
+        }
+        lastPosition = Position;
+        hasLastPosition = true;
+    }
+
     // 处理来自鼠标滚轮事件的输入。只需要垂直滚轮轴的输入
     void ProcessMouseScroll(float yoffset)
     {
@@ -120,6 +137,9 @@ public:
     }
 
 private:
+    glm::vec3 lastPosition = glm::vec3(0.0f);
+    bool hasLastPosition = false;
+
     // calculates the front vector from the Camera's (updated) Euler Angles
     void updateCameraVectors()
     {
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
 #include <memory> 
 #include <vector>
 
@@ -7,14 +11,71 @@
 #include "model.hpp"
 #include "mesh.hpp"
 #include "skybox.hpp"
+#include "bake/lightmap_baker.hpp"
+#include "bake/lightmap_uv.hpp"
+#include "bake/probe_baker.hpp"
+#include "effects/water.hpp"
+#include "render/frustum.hpp"
+#include "render/lightmap.hpp"
+#include "render/meshlet.hpp"
+#include "render/occlusion_queries.hpp"
+#include "render/probe_grid.hpp"
+#include "scene/camera_path.hpp"
+#include "scene/city_loader.hpp"
+#include "scene/city_generator.hpp"
+#include "scene/gpu_driven_renderer.hpp"
+#include "scene/hlod.hpp"
+#include "scene/skyline.hpp"
+#include "scene/static_batcher.hpp"
+#include "scene/street_props.hpp"
+#include "scene/world_streamer.hpp"
 
 class CityScene
 {
 public:
+    // Returns after the quick setup; the city model and the sky image keep
+    // loading in the background (see updateLoading)
     bool init();
+    // Once per frame, before update(): uploads what the loader finished
+    // within its budget, so meshes appear progressively with placeholder
+    // textures. Once everything is in, the lightmap, impostors and probe
+    // bake follow, one step per frame.
+    void updateLoading();
+    bool isLoading() const { return loadStage != LoadStage::Done; }
+    // After every swap; the first call records the time to the first frame
+    void notifyFramePresented();
+    struct LoadStats
+    {
+        float firstFrameMs = 0.0f; // init to the first presented frame
+        float totalMs = 0.0f;      // init to fully loaded, 0 while loading
+        bool framePresented = false;
+    };
+    const LoadStats &getLoadStats() const { return loadStats; }
+    const CityLoader::Stats &getLoaderStats() const { return cityLoader.stats(); }
+    CityLoadSettings &getLoadSettings() { return loadSettings; }
+    // 0-1, and what is being done
+    float loadProgress() const;
+    const char *loadStageName() const;
     void update(float dt, float timeSeconds);
+    // Uploads finished lightmap (and caches it) and probe bakes; call every frame, paused or not
+    void updateBakes();
     void renderScene(Shader &shader, const glm::mat4 &view, const glm::mat4 &projection) const;
+    // Same as renderScene, but skips nodes whose world bounds fall outside
+    // `cullFrustum` (e.g. the mirrored reflection frustum). Returns draws issued.
+    int renderSceneCulled(Shader &shader, const glm::mat4 &view, const glm::mat4 &projection,
+                          const Frustum &cullFrustum) const;
+    int drawableCount() const;
+    // Duplicate meshes merged into instances when the city model was imported
+    const ModelImportStats &getCityImportStats() const { return cityModel->importStats; }
+    // Depth-only pass with the same geometry and transforms as renderScene
+    void renderDepth(Shader &depthShader, const glm::mat4 &view, const glm::mat4 &projection) const;
+    // Glowing lamp heads of the street props visible in the last renderScene(Culled)
+    void renderEmissive(Shader &lampShader, const glm::mat4 &view, const glm::mat4 &projection) const;
     void renderSkybox(Shader &skyboxShader, const glm::mat4 &view, const glm::mat4 &projection) const;
+    // Impostor skyline around the city, one instanced draw
+    void renderSkyline(const glm::mat4 &view, const glm::mat4 &projection) const;
+    // Its program, for the fog uniforms (as the skybox and water shaders get them)
+    Shader *getSkylineShader() const { return skyline.program(); }
     void shutdown();
 
     // Moonlight arc angle (0-180 degrees, 0=horizon east, 90=zenith, 180=horizon west)
@@ -25,6 +86,9 @@ public:
     glm::vec3 getMoonPosition() const;
     glm::vec3 getMoonDirection() const;
     
+    // Moonlight diffuse color (already scaled by intensity)
+    glm::vec3 getMoonColor() const { return glm::vec3(0.15f, 0.15f, 0.3f) * moonIntensity; }
+
     // Get moonlight intensity
     float getMoonIntensity() const { return moonIntensity; }
     void setMoonIntensity(float intensity) { moonIntensity = intensity; }
@@ -37,8 +101,16 @@ public:
     bool isStreetLampEnabled(int index) const { return (index >= 0 && index < 8) ? streetLampEnabled[index] : false; }
     void setStreetLampEnabled(int index, bool enabled) { if (index >= 0 && index < 8) streetLampEnabled[index] = enabled; }
     void setAllStreetLampsEnabled(bool enabled) { for (int i = 0; i < 8; i++) streetLampEnabled[i] = enabled; }
+    glm::vec3 getStreetLampColor() const { return streetLampColor; }
+    // Point-light falloff 1 / (1 + linear d + quadratic d^2), ~50 unit range
+    static constexpr float kStreetLampLinear = 0.09f;
+    static constexpr float kStreetLampQuadratic = 0.032f;
+    // World-space lamp positions, also used to attach particle emitters
+    const std::array<glm::vec3, 8> &getStreetLampPositions() const { return streetLampPositions; }
     
-    // Flashlight controls
+    // Flashlight controls (cone half angles in degrees)
+    static constexpr float kFlashlightInnerAngle = 20.0f;
+    static constexpr float kFlashlightOuterAngle = 35.0f;
     bool isFlashlightOn() const { return flashlightOn; }
     void setFlashlightOn(bool on) { flashlightOn = on; }
     void toggleFlashlight() { flashlightOn = !flashlightOn; }
@@ -51,10 +123,275 @@ public:
     glm::vec3 getFlashlightPosition() const { return flashlightPosition; }
     glm::vec3 getFlashlightDirection() const { return flashlightDirection; }
 
+    // Exposure / gamma applied by the post-processing pass
+    SkyboxSettings &getSkyboxSettings() { return skyboxSettings; }
+
+    // Canal and road puddles, all on one plane so a single planar reflection serves them
+    static constexpr float kWaterLevel = 0.02f;
+    const std::vector<WaterBody> &getWaterBodies() const { return waterBodies; }
+    WaterSettings &getWaterSettings() { return waterSettings; }
+
+    // Baked street-lamp and sky lighting for the ground and city meshes. The
+    // lightmap UVs are generated at init; the bake is cached next to the model
+    // and rebaked in the background when the cache is missing or stale.
+    LightmapSettings &getLightmapSettings() { return lightmapSettings; }
+    const LightmapAtlasInfo &getLightmapAtlas() const { return lightmapAtlas; }
+    const Lightmap &getLightmap() const { return lightmap; }
+    const LightmapBaker &getLightmapBaker() const { return lightmapBaker; }
+    // Re-unwraps first if the atlas settings changed; false if a bake is running
+    bool startLightmapBake();
+
+    // Instanced street furniture from resource/props/placements.txt; the
+    // street lamp positions follow the lamp instances placed there
+    StreetPropSettings &getStreetPropSettings() { return streetProps->settings; }
+    const StreetProps::Stats &getStreetPropStats() const { return streetProps->stats(); }
+
+    // City geometry merged per (grid chunk, material) into pre-transformed
+    // ranges of one buffer; replaces the per-mesh draws while enabled.
+    // Rebuilt after the lightmap unwrap and whenever a city node moves.
+    StaticBatchSettings &getStaticBatchSettings() { return batchSettings; }
+    const StaticBatcher::Stats &getStaticBatchStats() const { return staticBatches.stats(); }
+    void rebuildStaticBatches();
+    // Flies the scripted camera path at several chunk sizes and prints draw
+    // counts against submitted triangles, next to the unbatched meshes
+    bool runStaticBatchReport(const glm::mat4 &projection);
+    const CameraPath &getCameraPath() const { return cameraPath; }
+
+    // Per-frame meshlet culling (frustum, normal cone, projected size) of the
+    // placed city meshes and static batches; instanced groups draw whole
+    MeshletSettings &getMeshletSettings() { return meshletSettings; }
+    // Main pass of the last frame
+    const MeshletCullStats &getMeshletStats() const { return meshletCuller.stats(); }
+    // Flies the camera path and prints the triangles rejected per reason
+    bool runMeshletReport(const glm::mat4 &projection);
+
+    // GL 4.3 GPU-driven path for the city placements: compute culling against
+    // the frustum and last frame's Hi-Z, then one indirect multi-draw per
+    // material. While active it replaces the batches and per-mesh draws of the
+    // main and depth passes; the reflection pass keeps the CPU culling.
+    GpuDrivenSettings &getGpuDrivenSettings() { return gpuDrivenSettings; }
+    bool isGpuDrivenSupported() const { return gpuDriven.ready(); }
+    const GpuDrivenRenderer::Stats &getGpuDrivenStats() const { return gpuDriven.stats(); }
+    const GpuDrivenRenderer::CullStats &getGpuCullStats() const { return gpuDriven.cullStats(); }
+    // Max-depth pyramid of the frame's opaque depth, for the next frame's cull
+    void updateGpuOcclusion(const RenderTarget &scene, int renderWidth, int renderHeight, const glm::mat4 &view,
+                            const glm::mat4 &projection);
+
+    // GL 3.3 hardware occlusion queries for the main camera when the
+    // GPU-driven path is off: per static batch chunk, or per placement and
+    // instance group, bounding boxes are tested and hidden objects drawn
+    // under conditional rendering; results carry over between frames
+    OcclusionQuerySettings &getOcclusionQuerySettings() { return occlusionSettings; }
+    const OcclusionQueries::Stats &getOcclusionQueryStats() const { return occlusionQueries.stats(); }
+
+    // Hierarchical LOD over the static batch chunks: 2x2 blocks of chunks
+    // merged into simplified, palette-textured proxies that replace them once
+    // their error projects below a pixel tolerance. Built with the batches;
+    // used on the batched path when the GPU-driven path is off.
+    HlodSettings &getHlodSettings() { return hlodSettings; }
+    const HlodTree::Stats &getHlodStats() const { return hlod.stats(); }
+    const HlodTree::SelectionStats &getHlodSelection() const { return hlod.selectionStats(); }
+    void rebuildHlod();
+
+    // Octahedral impostors of the tallest city meshes: baked from a
+    // hemi-octahedral grid of views into an albedo and a normal/depth atlas,
+    // cached next to the model (rebaked at load when stale, or ahead of time
+    // by the --bake-impostors cooker) and scattered as a skyline ring beyond
+    // the city
+    ImpostorSettings &getImpostorSettings() { return impostorSettings; }
+    const Skyline::Stats &getSkylineStats() const { return skyline.stats(); }
+    // Bakes with the current settings, rewrites the cache and re-places the ring
+    bool rebakeImpostors() { return updateImpostors(true); }
+    void placeSkyline();
+    // Headless cooker: loads only the city model, bakes and writes the cache
+    bool cookImpostors();
+    // Headless, no GL: the CPU side of the city import (read, convert, merge,
+    // meshlets, the meshes kept as a load keeps them), timed, with the peak
+    // resident memory of the process. One reader per run: the peak is process-wide.
+    static bool benchmarkImport(const ModelImportOptions &options);
+
+    // Procedural district for scale tests: the imported city tiled over an
+    // N x N block grid, or its tallest meshes permuted over lots, with roads
+    // and street lamps between the blocks, all from a seed. Culling, LOD,
+    // batching and instancing then run over the generated placements; the
+    // lightmap and probe bakes stay with the authored city and the lightmap
+    // is off while a district is applied.
+    struct DistrictStats
+    {
+        int blocks = 0; // 0 = the authored city
+        int placements = 0;
+        int nodes = 0;
+        int lamps = 0;
+        int streamedTiles = 0;     // blocks left to the world streamer
+        std::size_t triangles = 0; // over all placements and streamed tiles
+        float generateMs = 0.0f;   // layout, nodes, instance streams and batches
+    };
+    CityGeneratorSettings &getDistrictSettings() { return districtSettings; }
+    const DistrictStats &getDistrictStats() const { return districtStats; }
+    // Applies the settings, or restores the authored city when they are disabled
+    void regenerateDistrict();
+
+    // With streaming on, a district's generated blocks are not placed in the
+    // city but streamed in as tiles around the camera (applied on regenerate)
+    WorldStreamingSettings &getStreamingSettings() { return streamingSettings; }
+    const WorldStreamer::Stats &getStreamingStats() const { return worldStreamer.stats(); }
+    // Once per frame, before rendering
+    void updateStreaming(const glm::vec3 &cameraPosition, const glm::vec3 &cameraVelocity);
+
+    // Per-frame culling for the main camera (GPU cull, HLOD selection,
+    // occlusion query results); call once before renderDepth/renderScene
+    void prepareFrame(const glm::mat4 &view, const glm::mat4 &projection);
+
+    // Irradiance probes over the scene bounds, baked in the background at
+    // startup (sky from the skybox image); ambient for everything the
+    // lightmap does not cover
+    ProbeGridSettings &getProbeSettings() { return probeSettings; }
+    const ProbeGrid &getProbeGrid() const { return probeGrid; }
+    const ProbeBaker &getProbeBaker() const { return probeBaker; }
+    bool startProbeBake();
+    // Bakes at several spacings and prints the time per density
+    bool startProbeBenchmark();
+
 private:
+    void setLightingUniforms(Shader &shader, const glm::mat4 &view, const glm::mat4 &projection) const;
+    // Main camera of a pass, for the occlusion queries
+    struct OcclusionView
+    {
+        glm::mat4 viewProjection{1.0f};
+        glm::vec3 cameraPosition{0.0f};
+    };
+    // cameraView: the pass draws the main camera, whose commands the GPU-driven cull already wrote
+    int drawGeometry(Shader &shader, const Frustum *cullFrustum = nullptr, MeshletCuller *meshlets = nullptr,
+                     const OcclusionView *occlusion = nullptr, bool cameraView = false) const;
+    // Per node: its subtree bounds and all its ancestors' intersect the frustum
+    std::vector<std::uint8_t> visibleSubtrees(const Frustum &frustum) const;
+    // City objects in the view frustum through the occlusion queries
+    int drawOccluded(Shader &shader, MeshletCuller *meshlets, const OcclusionView &occlusion) const;
+    bool hlodActive() const
+    {
+        return hlodSettings.enabled && hlod.ready() && batchSettings.enabled && !staticBatches.empty() &&
+               !gpuDrivenActive();
+    }
+    bool occlusionQueriesActive() const
+    {
+        return occlusionSettings.enabled && !gpuDrivenActive() && cityModel && cityReady();
+    }
+    // Query objects: batch chunks, or single placements then instance groups
+    int occlusionObjectCount() const;
+    glm::mat4 groundModelMatrix() const;
+    static glm::mat4 cityModelMatrix(); // local transform of the city's root node
+    void uploadCityInstances();
+    bool gpuDrivenActive() const { return gpuDrivenSettings.enabled && gpuDriven.ready(); }
+    void rebuildGpuDriven();
+    // Ground plane, then every city mesh placed once, with their model matrices
+    std::vector<Mesh *> staticMeshes(std::vector<glm::mat4> *modelMatrices = nullptr) const;
+    // City meshes merged from duplicates, with all their placements
+    std::vector<LightmapInstancedMesh> instancedMeshes() const;
+    // Every city placement, with its lightmap block for the batcher
+    std::vector<StaticBatchSource> staticBatchSources() const;
+    void unwrapLightmap();
+    LightmapBakeInput buildLightmapInput() const;
+    static std::filesystem::path lightmapCachePath();
+    static std::filesystem::path cityModelPath();
+    static std::filesystem::path skyImagePath();
+    // Synchronous, for the impostor cooker
+    void loadCityModel();
+    // The imported city as authored, once it is complete
+    void recordAuthoredCity();
+    // Instance groups and draw counts from the current placements
+    void indexCityPlacements();
+    // By height at their first authored placement, at most `count`
+    std::vector<int> tallestCityMeshes(int count) const;
+    // Tallest distinct city meshes, oriented as first placed
+    std::vector<ImpostorSource> impostorSources() const;
+    // Loads the cached atlas (or bakes it when stale or asked to) and places the ring
+    bool updateImpostors(bool rebake);
+    static std::filesystem::path impostorCachePath();
+    static std::filesystem::path tileCachePath();
+    ProbeBakeInput buildProbeInput() const;
+
+    // Progressive load: the loader's uploads, then the steps that need the whole city
+    enum class LoadStage
+    {
+        Streaming,
+        Unwrap,
+        Lightmap,
+        Impostors,
+        Probes,
+        Done,
+    };
+    // Placements are indexed, instanced and unwrapped
+    bool cityReady() const { return loadStage > LoadStage::Unwrap; }
+    LoadStage loadStage = LoadStage::Done;
+    CityLoadSettings loadSettings;
+    CityLoader cityLoader;
+    std::chrono::steady_clock::time_point loadStart;
+    LoadStats loadStats;
+
     std::unique_ptr<Model> cityModel;  // CITY glTF model
     std::unique_ptr<Mesh> groundPlane; // Ground plane mesh
     std::unique_ptr<Skybox> skybox;
+    std::unique_ptr<StreetProps> streetProps;
+    SkyboxSettings skyboxSettings;
+    WaterSettings waterSettings;
+
+    // World bounds for culling: the city's nodes carry their own (cityModel->nodes)
+    Aabb groundBounds;
+    glm::vec2 groundCenter{0.0f}; // xz; the ground follows a generated district
+    float groundScale = 1.0f;
+
+    // The imported city as loaded; generated districts append nodes after it
+    std::vector<std::vector<Model::Placement>> authoredPlacements;
+    std::size_t authoredNodeCount = 0;
+    Aabb authoredBounds;
+    CityGeneratorSettings districtSettings;
+    DistrictStats districtStats;
+    bool districtApplied = false;
+    Aabb districtFootprint; // blocks and outer roads of the applied district
+    WorldStreamingSettings streamingSettings;
+    WorldStreamer worldStreamer;
+    std::vector<int> cityInstanceGroup; // per city mesh: index into lightmapInstances, -1 if placed once
+    std::vector<Aabb> instancedBounds;  // per instance group, over all its placements
+    int cityDrawables = 0;              // draws without culling: ground, single placements, instance groups
+
+    StaticBatchSettings batchSettings;
+    StaticBatcher staticBatches;
+    CameraPath cameraPath;
+
+    MeshletSettings meshletSettings;
+    mutable MeshletCuller meshletCuller; // scratch for the depth and main passes
+
+    GpuDrivenSettings gpuDrivenSettings;
+    GpuDrivenRenderer gpuDriven; // stays empty without GL 4.3
+
+    HlodSettings hlodSettings;
+    HlodTree hlod; // over the current static batches
+
+    ImpostorSettings impostorSettings;
+    Skyline skyline;
+
+    OcclusionQuerySettings occlusionSettings;
+    mutable OcclusionQueries occlusionQueries; // decisions shared by the depth and main passes
+    bool occlusionBatched = false;             // object ids are batch chunks
+
+    LightmapSettings lightmapSettings;
+    LightmapAtlasInfo lightmapAtlas;
+    std::vector<LightmapInstancedMesh> lightmapInstances; // with their atlas blocks from the last unwrap
+    float unwrappedTexelsPerUnit = 0.0f; // request the current UVs were packed for
+    Lightmap lightmap;
+    LightmapBaker lightmapBaker;
+
+    ProbeGridSettings probeSettings;
+    ProbeGrid probeGrid;
+    ProbeBaker probeBaker;
+
+    std::vector<WaterBody> waterBodies = {
+        {glm::vec2(0.0f, -22.0f), glm::vec2(30.0f, 2.0f), 0.0f},  // canal across the far end of the main road
+        {glm::vec2(2.5f, 9.0f), glm::vec2(1.6f, 0.9f), 0.4f},     // puddles on the road
+        {glm::vec2(-3.0f, -2.0f), glm::vec2(1.2f, 1.8f), 0.4f},
+        {glm::vec2(1.0f, -11.0f), glm::vec2(2.2f, 1.2f), 0.4f},
+        {glm::vec2(-1.5f, 13.0f), glm::vec2(0.9f, 0.7f), 0.5f},
+    };
 
     float spin = 0.0f;
     
@@ -63,8 +400,21 @@ private:
     float moonOrbitRadius = 100.0f; // Distance from scene center
     float moonIntensity = 1.0f;    // Light intensity multiplier
     
+    // Street lamps along the main road; replaced by the lamp props' light positions
+    std::array<glm::vec3, 8> streetLampPositions = {{
+        glm::vec3(-8.0f, 3.5f, 15.0f),
+        glm::vec3(-8.0f, 3.5f, 5.0f),
+        glm::vec3(-8.0f, 3.5f, -5.0f),
+        glm::vec3(-8.0f, 3.5f, -15.0f),
+        glm::vec3(8.0f, 3.5f, 15.0f),
+        glm::vec3(8.0f, 3.5f, 5.0f),
+        glm::vec3(8.0f, 3.5f, -5.0f),
+        glm::vec3(8.0f, 3.5f, -15.0f),
+    }};
+
     // Street lamp on/off states (8 lamps)
     bool streetLampEnabled[8] = {true, true, true, true, true, true, true, true};
+    glm::vec3 streetLampColor = glm::vec3(1.0f, 0.7f, 0.3f);  // Warm orange (diffuse)
     
     // Flashlight parameters
     bool flashlightOn = false;
@@ -6,11 +6,20 @@
 #include <string>
 
 #include "shader.hpp"
+#include "render/meshlet.hpp"
 
 struct Vertex {
     glm::vec3 Position;
     glm::vec3 Normal;
     glm::vec2 TexCoords;
+    glm::vec2 LightmapUV{0.0f}; // second UV set, written by the lightmap chart packer
+};
+
+// Static per-instance stream, read by shader.vert/depth.vert at locations 4-9
+struct InstanceData {
+    glm::mat4 model;
+    glm::vec4 color{1.0f};                          // rgb tints the albedo
+    glm::vec4 lightmapScaleOffset{1.0f, 1.0f, 0.0f, 0.0f}; // atlas UV = LightmapUV * xy + zw
 };
 
 struct Texture {
@@ -19,17 +28,39 @@ struct Texture {
     std::string path;
 };
 
+// Binds a texture set to units 0.. and points the material samplers at them
+void bindMeshTextures(Shader &shader, const std::vector<Texture> &textures);
+// Same textures in the same order, so one draw can serve both
+bool sameMaterial(const std::vector<Texture> &a, const std::vector<Texture> &b);
+
 class Mesh {
 public:
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
     std::vector<Texture> textures;
     unsigned int VAO;
+    // Object-space bounds of the vertices, used for culling
+    glm::vec3 boundsMin{0.0f};
+    glm::vec3 boundsMax{0.0f};
+    // Clusters over `indices`, built at import for per-frame culling
+    MeshletSet meshlets;
 
     Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures);
     void Draw(Shader &shader);
+    // Same textures as Draw; per-instance attributes must already be set up on the VAO
+    void DrawInstanced(Shader &shader, GLsizei instanceCount);
+    // Same textures as Draw; only the given index ranges, in one glMultiDrawElements
+    void DrawRanges(Shader &shader, const MeshletDrawList &ranges);
+    // Uploads the instance stream (replacing any previous one); draw it with DrawInstanced(shader, instanceCount())
+    void setInstances(const std::vector<InstanceData> &instances);
+    GLsizei instanceCount() const { return instances; }
+    // Re-uploads vertices and indices after they were rewritten on the CPU
+    void refreshBuffers();
 
 private:
     unsigned int VBO, EBO;
+    unsigned int instanceVBO = 0;
+    GLsizei instances = 0;
     void setupMesh();
+    void bindTextures(Shader &shader);
 };
@@ -6,25 +6,145 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <cstddef>
 #include <string>
 #include <vector>
 #include "mesh.hpp"
 #include "shader.hpp"
+#include "scene/transform_hierarchy.hpp"
+
+// What the duplicate-mesh merge saved at import, and where the import's time went
+struct ModelImportStats
+{
+    int placements = 0;       // node references to meshes, i.e. draw calls without instancing
+    int sourceMeshes = 0;     // distinct meshes in the file
+    int uniqueMeshes = 0;     // GPU meshes after merging identical geometry
+    int instancedMeshes = 0;  // GPU meshes placed more than once
+    std::size_t savedBytes = 0; // vertex and index memory of the merged copies
+    int meshlets = 0;         // over the GPU meshes
+    bool nativeGltf = false;  // read by GltfDocument rather than Assimp
+    int threads = 1;          // converting, hashing and building meshlets
+    float readMs = 0.0f;      // file to scene: Assimp's ReadFile, or the glTF parse and buffer mapping
+    float wallMs = 0.0f;      // the whole import, read to the last mesh handed over
+    // Summed over the threads, from the per-mesh times
+    float convertMs = 0.0f;   // scene to vertex and index arrays
+    float hashMs = 0.0f;
+    float meshletMs = 0.0f;
+
+    struct MeshTiming
+    {
+        int vertices = 0;
+        int triangles = 0;
+        float convertMs = 0.0f;
+        float hashMs = 0.0f;   // anchor, content hash and the comparison with earlier meshes
+        float meshletMs = 0.0f; // with the copy handed to the sink; 0 for merged duplicates
+    };
+    std::vector<MeshTiming> meshTimings; // per source mesh, in file order
+};
+
+struct ModelImportOptions
+{
+    bool nativeGltf = true;   // glTF through GltfDocument (Assimp when it declines the file)
+    unsigned int threads = 0; // per-mesh work; 0 = one per hardware thread
+};
+
+// A texture a mesh samples, as named by the file (relative to its directory),
+// before it has a GL name
+struct TextureRequest
+{
+    std::string type; // sampler prefix, e.g. "texture_diffuse"
+    std::string path; // or a solid color key (see solidColorKey), for a material factor without a map
+};
+
+struct ImportedMesh;
+class ModelImportSink;
 
 class Model 
 {
 public:
     std::vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
     std::vector<Mesh> meshes;
+    // The file's node tree, below a root node (kRootNode) that places the whole model
+    static constexpr int kRootNode = 0;
+    TransformHierarchy nodes;
+    // Where a mesh is drawn: under a node, shifted by the translation that
+    // merged a duplicate (meshes whose vertex and index data match up to a
+    // translation share one GPU mesh)
+    struct Placement
+    {
+        int node;
+        glm::vec3 offset{0.0f};
+    };
+    std::vector<std::vector<Placement>> placements; // per mesh
+    ModelImportStats importStats;
     std::string directory;
     bool gammaCorrection;
 
     Model(std::string path, bool gamma = false);
+    // Empty, for a progressive load: the node tree, then meshes and placements
+    // as an import delivers them (GL thread)
+    explicit Model(bool gamma) : gammaCorrection(gamma) {}
+    void setNodes(TransformHierarchy tree, std::string fileDirectory);
+    // Uploads the mesh with the given textures; returns its index
+    int addMesh(ImportedMesh &&mesh, std::vector<Texture> textures);
+    // More placements of a mesh; their nodes' bounds grow to hold it
+    void addPlacements(int mesh, const std::vector<Placement> &added);
+    // Textures of the requests, loaded on the spot once per path
+    std::vector<Texture> loadTextures(const std::vector<TextureRequest> &requests);
+
+    // CPU side of an import, safe on any thread: reading the file, conversion,
+    // the duplicate merge and meshlets. The sink gets the node tree, then every
+    // GPU mesh as soon as it is ready and the placements of later duplicates,
+    // always in file order. glTF files are read natively (GltfDocument) unless
+    // the options say otherwise or the file uses something only Assimp
+    // handles; everything else goes through Assimp. Meshes are converted,
+    // hashed and split into meshlets on a pool of `options.threads`, a batch
+    // at a time; the merge decisions and the sink calls stay on this thread.
+    static bool importFile(const std::string &path, ModelImportSink &sink, const ModelImportOptions &options = {});
+    // Reference path: one draw per placement with its world matrix
     void Draw(Shader &shader);
+    glm::mat4 placementWorld(const Placement &placement) const;
+    // World bounds of a mesh at one of its placements
+    Aabb placementBounds(unsigned int mesh, const Placement &placement) const;
 
 private:
+    struct MeshPlacement
+    {
+        unsigned int sourceMesh;
+        int node;
+    };
+
     void loadModel(std::string path);
-    void processNode(aiNode *node, const aiScene *scene);
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene);
-    std::vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, std::string typeName);
+    static void processNode(aiNode *node, int parent, TransformHierarchy &tree, std::vector<MeshPlacement> &nodePlacements);
+    static void processMesh(aiMesh *mesh, std::vector<Vertex> &vertices, std::vector<unsigned int> &indices);
+    static std::vector<TextureRequest> meshTextures(aiMesh *mesh, const aiScene *scene);
+    static void materialTextures(aiMaterial *mat, aiTextureType type, const std::string &typeName,
+                                 std::vector<TextureRequest> &requests);
+};
+
+// One GPU mesh of an import, before its upload
+struct ImportedMesh
+{
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    MeshletSet meshlets;
+    std::vector<TextureRequest> textures;
+    std::vector<Model::Placement> placements; // known when it was merged
+};
+
+// Receives an import in order; called on the importing thread
+class ModelImportSink
+{
+public:
+    virtual ~ModelImportSink() = default;
+    // Before any mesh: the file's node tree below Model::kRootNode, and how
+    // many meshes the file references (an upper bound on GPU meshes)
+    virtual void onNodes(TransformHierarchy tree, const std::string &directory, int sourceMeshes) = 0;
+    virtual void onMesh(ImportedMesh mesh) = 0;
+    // Placements of a duplicate merged into an earlier mesh (its index in onMesh order)
+    virtual void onPlacements(int mesh, std::vector<Model::Placement> placements) = 0;
+    virtual void onFinished(const ModelImportStats &stats) = 0;
+    // Polled before every batch of meshes; true ends the import there, without
+    // onFinished, and importFile returns false
+    virtual bool cancelled() const { return false; }
 };
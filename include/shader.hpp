@@ -8,18 +8,29 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <vector>
+
+#include "render/gl43.hpp"
 
 class Shader
 {
 public:
     unsigned int ID{};
 
-    Shader(const char *vertexPath, const char *fragmentPath);
+    // Non-empty feedbackVaryings are captured interleaved by transform feedback
+    Shader(const char *vertexPath, const char *fragmentPath,
+           const std::vector<const char *> &feedbackVaryings = {});
+    // Compute-only program; needs a GL 4.3 context (gl43::available())
+    explicit Shader(const char *computePath);
     void use();
     void setBool(const std::string &name, bool value) const;
     void setInt(const std::string &name, int value) const;
     void setFloat(const std::string &name, float value) const;
     void setMat4(const std::string &name, const glm::mat4 &mat) const;
+    void setVec2(const std::string &name, const glm::vec2 &vec) const
+    {
+        glUniform2f(glGetUniformLocation(ID, name.c_str()), vec.x, vec.y);
+    }
     void setVec3(const std::string &name, const glm::vec3 &vec) const
     {
         glUniform3f(glGetUniformLocation(ID, name.c_str()), vec.x, vec.y, vec.z);
@@ -30,7 +41,8 @@ public:
     }
 };
 
-inline Shader::Shader(const char *vertexPath, const char *fragmentPath)
+inline Shader::Shader(const char *vertexPath, const char *fragmentPath,
+                      const std::vector<const char *> &feedbackVaryings)
 {
     std::string vertexCode;
     std::string fragmentCode;
@@ -88,6 +100,11 @@ inline Shader::Shader(const char *vertexPath, const char *fragmentPath)
     ID = glCreateProgram();
     glAttachShader(ID, vertex);
     glAttachShader(ID, fragment);
+    if (!feedbackVaryings.empty())
+    {
+        glTransformFeedbackVaryings(ID, static_cast<GLsizei>(feedbackVaryings.size()), feedbackVaryings.data(),
+                                    GL_INTERLEAVED_ATTRIBS);
+    }
     glLinkProgram(ID);
     glGetProgramiv(ID, GL_LINK_STATUS, &success);
     if (!success)
@@ -101,6 +118,53 @@ inline Shader::Shader(const char *vertexPath, const char *fragmentPath)
     glDeleteShader(fragment);
 }
 
+inline Shader::Shader(const char *computePath)
+{
+    std::string computeCode;
+    std::ifstream cShaderFile;
+    cShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    try
+    {
+        cShaderFile.open(computePath);
+        std::stringstream cShaderStream;
+        cShaderStream << cShaderFile.rdbuf();
+        cShaderFile.close();
+        computeCode = cShaderStream.str();
+    }
+    catch (std::ifstream::failure &)
+    {
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+    }
+    const char *cShaderCode = computeCode.c_str();
+
+    int success;
+    char infoLog[512];
+
+    unsigned int compute = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(compute, 1, &cShaderCode, nullptr);
+    glCompileShader(compute);
+    glGetShaderiv(compute, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(compute, 512, nullptr, infoLog);
+        std::cout << "ERROR::SHADER::COMPUTE::COMPILATION_FAILED\n"
+                  << infoLog << std::endl;
+    }
+
+    ID = glCreateProgram();
+    glAttachShader(ID, compute);
+    glLinkProgram(ID);
+    glGetProgramiv(ID, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glGetProgramInfoLog(ID, 512, nullptr, infoLog);
+        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n"
+                  << infoLog << std::endl;
+    }
+
+    glDeleteShader(compute);
+}
+
 inline void Shader::use() { glUseProgram(ID); }
 inline void Shader::setBool(const std::string &name, bool value) const
 {
@@ -4,15 +4,22 @@
 #include <glm/glm.hpp>
 #include <filesystem>
 #include "shader.hpp"
+#include "texture.hpp"
 
 class Skybox
 {
 public:
     bool init(const std::filesystem::path &texturePath);
+    // Geometry and a flat night-blue texture, for a sky image decoded elsewhere
+    void initPlaceholder();
+    // Replaces the texture content (GL thread)
+    void setTexture(const DecodedImage &image);
     void draw(Shader &shader, const glm::mat4 &view, const glm::mat4 &projection) const;
     void shutdown();
 
 private:
+    void createGeometry();
+
     unsigned int VAO = 0;
     unsigned int VBO = 0;
     unsigned int textureId = 0;
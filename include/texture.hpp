@@ -1,7 +1,41 @@
 #pragma once
 
 #include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
 
-unsigned int loadTexture2D(const std::filesystem::path &path);
-unsigned int createTextureFromData(int width, int height, const unsigned char *data);
+// An image decoded on the CPU, not yet uploaded; decoding is safe on any thread
+struct DecodedImage
+{
+    struct Free
+    {
+        void operator()(unsigned char *pixels) const;
+    };
+
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::unique_ptr<unsigned char[], Free> pixels; // 8 bits per channel, null on failure
+
+    bool valid() const { return pixels != nullptr; }
+};
+
+// flip: bottom row first, as OpenGL expects for mesh textures
+DecodedImage decodeImage(const std::filesystem::path &path, bool flip);
+
+// srgb: decode color data to linear on sampling (needed by the linear HDR pipeline)
+unsigned int loadTexture2D(const std::filesystem::path &path, bool srgb = false);
+unsigned int createTextureFromData(int width, int height, const unsigned char *data, bool srgb = false);
+// A texture path standing for a 1x1 texture of one linear RGBA color
+// ("#rrggbbaa"), so constant material factors share the texture cache
+std::string solidColorKey(const unsigned char rgba[4]);
+bool parseSolidColorKey(const std::string &key, unsigned char rgba[4]);
 unsigned int loadSkyboxTexture(const std::filesystem::path &path);
+// Respecify an existing texture name with a decoded image, so every holder of
+// the name (e.g. of a placeholder) sees the new content; GL thread only
+void uploadTexture2D(unsigned int texture, const DecodedImage &image, bool srgb);
+void uploadSkyboxTexture(unsigned int texture, const DecodedImage &image);
+// CPU copy of an 8-bit sRGB image as linear RGB floats (3 per pixel, top row
+// first); empty on failure. Used by the bakers, not uploaded.
+std::vector<float> loadImageLinear(const std::filesystem::path &path, int &width, int &height);
@@ -0,0 +1,59 @@
+#version 330 core
+// Dual-filter downsample: 4 bilinear taps on the half-texel diagonals plus
+// the center (13 source texels for 5 fetches). The first level also applies
+// the soft-knee threshold and a Karis average against lamp fireflies.
+in vec2 TexCoords;
+out vec3 FragColor;
+
+uniform sampler2D sourceTexture;
+uniform vec2 sourceTexelSize;
+uniform vec2 uvScale;      // used sub-rect of the source (HDR scene at dynamic resolution)
+uniform bool prefilter;
+uniform float threshold;
+uniform float knee;
+
+vec3 SampleSource(vec2 uv)
+{
+    vec2 halfTexel = 0.5 * sourceTexelSize;
+    return texture(sourceTexture, clamp(uv * uvScale, halfTexel, uvScale - halfTexel)).rgb;
+}
+
+float Luminance(vec3 c)
+{
+    return dot(c, vec3(0.2126, 0.7152, 0.0722));
+}
+
+vec3 Threshold(vec3 c)
+{
+    float brightness = max(c.r, max(c.g, c.b));
+    float soft = clamp(brightness - threshold + knee, 0.0, 2.0 * knee);
+    soft = soft * soft / (4.0 * knee + 1e-4);
+    float contribution = max(soft, brightness - threshold) / max(brightness, 1e-4);
+    return c * contribution;
+}
+
+void main()
+{
+    vec2 offset = sourceTexelSize / uvScale;
+    vec3 center = SampleSource(TexCoords);
+    vec3 a = SampleSource(TexCoords + vec2(-offset.x, -offset.y));
+    vec3 b = SampleSource(TexCoords + vec2(offset.x, -offset.y));
+    vec3 c = SampleSource(TexCoords + vec2(-offset.x, offset.y));
+    vec3 d = SampleSource(TexCoords + vec2(offset.x, offset.y));
+
+    if (prefilter)
+    {
+        // Karis average: weight each tap by 1 / (1 + luma) so single very
+        // bright texels cannot dominate and flicker
+        float wc = 4.0 / (1.0 + Luminance(center));
+        float wa = 1.0 / (1.0 + Luminance(a));
+        float wb = 1.0 / (1.0 + Luminance(b));
+        float wcc = 1.0 / (1.0 + Luminance(c));
+        float wd = 1.0 / (1.0 + Luminance(d));
+        vec3 sum = center * wc + a * wa + b * wb + c * wcc + d * wd;
+        FragColor = Threshold(sum / (wc + wa + wb + wcc + wd));
+        return;
+    }
+
+    FragColor = (center * 4.0 + a + b + c + d) * 0.125;
+}
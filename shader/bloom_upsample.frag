@@ -0,0 +1,23 @@
+#version 330 core
+// Dual-filter upsample: 8-tap tent around the destination pixel. Written
+// with additive blending onto the next larger level of the chain.
+in vec2 TexCoords;
+out vec3 FragColor;
+
+uniform sampler2D sourceTexture;
+uniform vec2 sourceTexelSize;
+uniform float radius;
+
+void main()
+{
+    vec2 o = sourceTexelSize * radius;
+    vec3 sum = texture(sourceTexture, TexCoords + vec2(-2.0 * o.x, 0.0)).rgb;
+    sum += texture(sourceTexture, TexCoords + vec2(2.0 * o.x, 0.0)).rgb;
+    sum += texture(sourceTexture, TexCoords + vec2(0.0, -2.0 * o.y)).rgb;
+    sum += texture(sourceTexture, TexCoords + vec2(0.0, 2.0 * o.y)).rgb;
+    sum += texture(sourceTexture, TexCoords + vec2(-o.x, o.y)).rgb * 2.0;
+    sum += texture(sourceTexture, TexCoords + vec2(o.x, o.y)).rgb * 2.0;
+    sum += texture(sourceTexture, TexCoords + vec2(-o.x, -o.y)).rgb * 2.0;
+    sum += texture(sourceTexture, TexCoords + vec2(o.x, -o.y)).rgb * 2.0;
+    FragColor = sum / 12.0;
+}
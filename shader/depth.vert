@@ -0,0 +1,17 @@
+#version 330 core
+// Depth-only prepass; must produce bit-identical depth to shader.vert
+layout (location = 0) in vec3 aPos;
+layout (location = 4) in mat4 aInstanceModel;
+
+uniform bool instanced;
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+invariant gl_Position;
+
+void main()
+{
+	mat4 world = instanced ? aInstanceModel : model;
+	gl_Position = projection * view * world * vec4(aPos, 1.0);
+}
@@ -0,0 +1,104 @@
+#version 330 core
+// Injects fog density and in-scattered light into one slice of the froxel
+// volume. One fragment per froxel: cost depends on the froxel count only.
+in vec2 TexCoords;
+out vec4 Scattering;           // rgb = scattered radiance per unit length, a = extinction
+
+#define MAX_LAMPS 8
+
+uniform int slice;
+uniform int sliceCount;
+uniform vec2 depthRange;       // (near, far) view depth covered by the volume
+uniform mat4 invView;
+uniform vec4 projInfo;         // (P[0][0], P[1][1], P[2][0], P[2][1])
+uniform float time;
+
+uniform float density;
+uniform float heightFalloff;
+uniform float baseHeight;
+uniform float noiseAmount;
+uniform vec3 wind;
+uniform vec3 albedo;
+uniform float anisotropy;
+
+uniform vec3 moonDirection;    // direction the moonlight travels
+uniform vec3 moonColor;
+uniform vec3 lampPositions[MAX_LAMPS];
+uniform int lampCount;
+uniform vec3 lampColor;
+uniform vec2 lampCone;         // cos of outer / inner half angle around straight down
+uniform bool flashlightOn;
+uniform vec3 flashlightPosition;
+uniform vec3 flashlightDirection;
+uniform vec2 flashlightCone;   // cos of outer / inner cutoff
+uniform vec3 flashlightColor;
+
+float Hash(vec3 p)
+{
+    p = fract(p * 0.3183099 + 0.1);
+    p *= 17.0;
+    return fract(p.x * p.y * p.z * (p.x + p.y + p.z));
+}
+
+float ValueNoise(vec3 x)
+{
+    vec3 i = floor(x);
+    vec3 f = fract(x);
+    f = f * f * (3.0 - 2.0 * f);
+    return mix(mix(mix(Hash(i + vec3(0, 0, 0)), Hash(i + vec3(1, 0, 0)), f.x),
+                   mix(Hash(i + vec3(0, 1, 0)), Hash(i + vec3(1, 1, 0)), f.x), f.y),
+               mix(mix(Hash(i + vec3(0, 0, 1)), Hash(i + vec3(1, 0, 1)), f.x),
+                   mix(Hash(i + vec3(0, 1, 1)), Hash(i + vec3(1, 1, 1)), f.x), f.y), f.z);
+}
+
+// Henyey-Greenstein phase function; cosTheta between light travel and view-out directions
+float Phase(float cosTheta)
+{
+    float g = anisotropy;
+    float denom = 1.0 + g * g - 2.0 * g * cosTheta;
+    return (1.0 - g * g) / (12.5663706 * denom * sqrt(denom));
+}
+
+float SliceDepth(float z)
+{
+    return depthRange.x * pow(depthRange.y / depthRange.x, z / float(sliceCount));
+}
+
+void main()
+{
+    float viewDepth = SliceDepth(float(slice) + 0.5);
+    vec2 ndc = TexCoords * 2.0 - 1.0;
+    vec3 viewPos = vec3((ndc + projInfo.zw) / projInfo.xy * viewDepth, -viewDepth);
+    vec3 worldPos = (invView * vec4(viewPos, 1.0)).xyz;
+    vec3 toCamera = normalize(invView[3].xyz - worldPos);
+
+    // Ground-hugging fog with drifting wisps
+    float heightFactor = exp(-heightFalloff * max(worldPos.y - baseHeight, 0.0));
+    float wisps = mix(1.0, ValueNoise(worldPos * 0.15 + wind * time) * 2.0, noiseAmount);
+    float sigma = density * heightFactor * max(wisps, 0.0);
+
+    vec3 light = moonColor * Phase(dot(moonDirection, toCamera));
+
+    for (int i = 0; i < lampCount; ++i)
+    {
+        vec3 fromLamp = worldPos - lampPositions[i];
+        float distance = length(fromLamp);
+        vec3 travel = fromLamp / max(distance, 1e-4);
+        // Street lamp heads shine down: visible cones instead of glowing spheres
+        float cone = mix(0.1, 1.0, smoothstep(lampCone.x, lampCone.y, -travel.y));
+        float attenuation = 1.0 / (1.0 + 0.09 * distance + 0.032 * distance * distance);
+        light += lampColor * cone * attenuation * Phase(dot(travel, toCamera));
+    }
+
+    if (flashlightOn)
+    {
+        vec3 fromLight = worldPos - flashlightPosition;
+        float distance = length(fromLight);
+        vec3 travel = fromLight / max(distance, 1e-4);
+        float cone = smoothstep(flashlightCone.x, flashlightCone.y, dot(travel, flashlightDirection));
+        float attenuation = 1.0 / (1.0 + 0.07 * distance + 0.017 * distance * distance);
+        light += flashlightColor * cone * attenuation * Phase(dot(travel, toCamera));
+    }
+
+    Scattering = vec4(albedo * sigma * light, sigma);
+}
@@ -0,0 +1,43 @@
+#version 330 core
+// Front-to-back integration of the froxel volume, one slice per pass. The
+// running (radiance, transmittance) sum is carried between passes in a 2D
+// ping-pong texture, so the whole volume costs one fetch per froxel.
+in vec2 TexCoords;
+layout(location = 0) out vec4 Integrated;  // written to the current slice of the 3D result
+layout(location = 1) out vec4 Running;     // carried to the next slice
+
+uniform sampler3D scattering;
+uniform sampler2D previous;
+uniform int slice;
+uniform int sliceCount;
+uniform vec2 depthRange;
+uniform vec4 projInfo;
+
+float SliceDepth(float z)
+{
+    return depthRange.x * pow(depthRange.y / depthRange.x, z / float(sliceCount));
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    vec4 scatter = texelFetch(scattering, ivec3(texel, slice), 0);
+    vec4 accumulated = slice == 0 ? vec4(0.0, 0.0, 0.0, 1.0) : texelFetch(previous, texel, 0);
+
+    // Slice length along the view ray (the first slice starts at the camera)
+    vec2 ndc = TexCoords * 2.0 - 1.0;
+    float rayScale = length(vec3((ndc + projInfo.zw) / projInfo.xy, 1.0));
+    float start = slice == 0 ? 0.0 : SliceDepth(float(slice));
+    float thickness = (SliceDepth(float(slice) + 1.0) - start) * rayScale;
+
+    // Energy-conserving integration of constant scattering over the slice
+    float extinction = max(scatter.a, 1e-6);
+    float transmittance = exp(-extinction * thickness);
+    vec3 inScattered = scatter.rgb * (1.0 - transmittance) / extinction;
+
+    accumulated.rgb += accumulated.a * inScattered;
+    accumulated.a *= transmittance;
+
+    Integrated = accumulated;
+    Running = accumulated;
+}
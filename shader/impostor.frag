@@ -0,0 +1,118 @@
+#version 330 core
+// Octahedral impostor: per view, the ray meets the view's plane, steps once
+// to the baked depth there (parallax), and samples albedo and normal; the
+// views blend by weight and the first view's hit becomes the depth
+out vec4 FragColor;
+
+in vec3 RayOrigin;
+in vec3 RayTarget;
+flat in vec2 Frame0;
+flat in vec2 Frame1;
+flat in vec2 Frame2;
+flat in vec3 FrameWeights;
+flat in float Radius;
+flat in float Layer;
+flat in vec3 Center;
+flat in float Yaw;
+flat in float Scale;
+
+uniform sampler2DArray albedoAtlas;
+uniform sampler2DArray normalDepthAtlas;
+uniform int frames;
+uniform float tileInset; // half a texel of a view, in view UVs
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 moonDirection;
+uniform vec3 moonColor;
+uniform vec3 ambientColor;
+
+// Froxel volumetric fog, same lookup as shader.frag
+uniform bool fogEnabled;
+uniform sampler3D fogVolume;
+uniform vec2 fogViewport;
+uniform vec2 fogDepthRange;
+
+vec3 ApplyFog(vec3 color, float viewDepth)
+{
+    float slices = float(textureSize(fogVolume, 0).z);
+    float z = log(max(viewDepth, fogDepthRange.x) / fogDepthRange.x) / log(fogDepthRange.y / fogDepthRange.x);
+    vec4 fog = texture(fogVolume, vec3(gl_FragCoord.xy / fogViewport, z - 0.5 / slices));
+    return color * fog.a + fog.rgb;
+}
+
+vec3 frameDirection(vec2 frame)
+{
+    vec2 p = frame / float(frames - 1) * 2.0 - 1.0;
+    float x = (p.x + p.y) * 0.5;
+    float z = (p.x - p.y) * 0.5;
+    return normalize(vec3(x, 1.0 - abs(x) - abs(z), z));
+}
+
+// Atlas coordinates of a building-space point in a view; false outside the view
+bool frameCoord(vec2 frame, vec3 point, vec3 right, vec3 up, out vec3 coord)
+{
+    vec2 uv = vec2(dot(point, right), dot(point, up)) / (2.0 * Radius) + 0.5;
+    coord = vec3((frame + clamp(uv, vec2(tileInset), vec2(1.0 - tileInset))) / float(frames), Layer);
+    return all(greaterThanEqual(uv, vec2(0.0))) && all(lessThanEqual(uv, vec2(1.0)));
+}
+
+vec4 sampleFrame(vec2 frame, vec3 origin, vec3 direction, out vec3 normal, out vec3 hit)
+{
+    normal = vec3(0.0, 1.0, 0.0);
+    hit = vec3(0.0);
+    vec3 n = frameDirection(frame);
+    // Same basis as the bake's lookAt
+    vec3 upHint = abs(n.y) > 0.999 ? vec3(0.0, 0.0, -1.0) : vec3(0.0, 1.0, 0.0);
+    vec3 right = normalize(cross(upHint, n));
+    vec3 up = cross(n, right);
+    float facing = min(dot(direction, n), -1e-4);
+
+    // Through the view's plane, then to the baked surface height above it
+    vec3 coord;
+    hit = origin + direction * (-dot(origin, n) / facing);
+    if (!frameCoord(frame, hit, right, up, coord))
+        return vec4(0.0);
+    float height = Radius * (1.0 - 2.0 * texture(normalDepthAtlas, coord).a);
+    hit = origin + direction * ((height - dot(origin, n)) / facing);
+    if (!frameCoord(frame, hit, right, up, coord))
+        return vec4(0.0);
+
+    vec4 normalDepth = texture(normalDepthAtlas, coord);
+    normal = normalDepth.xyz * 2.0 - 1.0;
+    return texture(albedoAtlas, coord);
+}
+
+vec3 rotateY(vec3 v, float angle)
+{
+    float c = cos(angle);
+    float s = sin(angle);
+    return vec3(c * v.x + s * v.z, v.y, -s * v.x + c * v.z);
+}
+
+void main()
+{
+    vec3 direction = RayTarget - RayOrigin;
+    vec3 normal0, normal1, normal2;
+    vec3 hit0, hit1, hit2;
+    vec4 albedo0 = sampleFrame(Frame0, RayOrigin, direction, normal0, hit0);
+    vec4 albedo1 = sampleFrame(Frame1, RayOrigin, direction, normal1, hit1);
+    vec4 albedo2 = sampleFrame(Frame2, RayOrigin, direction, normal2, hit2);
+
+    vec3 w = FrameWeights * vec3(albedo0.a, albedo1.a, albedo2.a);
+    float coverage = w.x + w.y + w.z;
+    if (coverage < 0.5 * (FrameWeights.x + FrameWeights.y + FrameWeights.z))
+        discard;
+    vec3 albedo = (albedo0.rgb * w.x + albedo1.rgb * w.y + albedo2.rgb * w.z) / coverage;
+    vec3 normal = normalize(rotateY(normal0 * w.x + normal1 * w.y + normal2 * w.z, Yaw));
+
+    // Depth of the strongest view's surface point, so impostors intersect properly
+    vec3 hit = w.x >= w.y && w.x >= w.z ? hit0 : (w.y >= w.z ? hit1 : hit2);
+    vec4 viewPosition = view * vec4(Center + rotateY(hit, Yaw) * Scale, 1.0);
+    vec4 clip = projection * viewPosition;
+    gl_FragDepth = clamp(clip.z / clip.w * 0.5 + 0.5, 0.0, 1.0);
+
+    vec3 lit = albedo * (ambientColor + moonColor * max(dot(normal, -moonDirection), 0.0));
+    if (fogEnabled)
+        lit = ApplyFog(lit, -viewPosition.z);
+    FragColor = vec4(lit, 1.0);
+}
@@ -0,0 +1,81 @@
+#version 330 core
+// Octahedral impostor: one camera-facing quad over the building's bounding
+// sphere. The three baked views around the direction to the camera are picked
+// here (the same for the whole quad); rays go to the fragment shader in the
+// bake's building space.
+layout (location = 0) in vec2 aCorner;       // -1..1
+layout (location = 1) in vec4 aPositionYaw;  // base on the ground, yaw in radians
+layout (location = 2) in vec4 aScaleLayer;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 viewPos;
+uniform int frames;
+uniform vec2 spheres[16]; // per layer: radius, height of the center above the base
+
+out vec3 RayOrigin; // camera
+out vec3 RayTarget; // this corner
+flat out vec2 Frame0;
+flat out vec2 Frame1;
+flat out vec2 Frame2;
+flat out vec3 FrameWeights;
+flat out float Radius;
+flat out float Layer;
+flat out vec3 Center;
+flat out float Yaw;
+flat out float Scale;
+
+vec3 rotateY(vec3 v, float angle)
+{
+    float c = cos(angle);
+    float s = sin(angle);
+    return vec3(c * v.x + s * v.z, v.y, -s * v.x + c * v.z);
+}
+
+void main()
+{
+    int layer = int(aScaleLayer.y + 0.5);
+    Scale = aScaleLayer.x;
+    Yaw = aPositionYaw.w;
+    Radius = spheres[layer].x;
+    Layer = float(layer);
+    Center = aPositionYaw.xyz + vec3(0.0, spheres[layer].y * Scale, 0.0);
+
+    // Under perspective the sphere's outline is wider than its radius
+    vec3 toCamera = viewPos - Center;
+    float distance = max(length(toCamera), 1e-3);
+    vec3 facing = toCamera / distance;
+    float worldRadius = Radius * Scale;
+    float spread = worldRadius / sqrt(max(1.0 - (worldRadius * worldRadius) / (distance * distance), 0.05));
+    vec3 right = cross(vec3(0.0, 1.0, 0.0), facing);
+    right = dot(right, right) > 1e-6 ? normalize(right) : vec3(1.0, 0.0, 0.0);
+    vec3 up = cross(facing, right);
+    vec3 corner = Center + (right * aCorner.x + up * aCorner.y) * spread;
+
+    RayOrigin = rotateY(toCamera, -Yaw) / Scale;
+    RayTarget = rotateY(corner - Center, -Yaw) / Scale;
+
+    // Hemi-octahedral grid position of the view direction, clamped to the upper half
+    vec3 d = normalize(RayOrigin);
+    d.y = max(d.y, 0.0);
+    d /= abs(d.x) + abs(d.y) + abs(d.z);
+    vec2 grid = (vec2(d.x + d.z, d.x - d.z) * 0.5 + 0.5) * float(frames - 1);
+    vec2 base = min(floor(grid), vec2(float(frames - 2)));
+    vec2 f = grid - base;
+    if (f.x + f.y < 1.0)
+    {
+        Frame0 = base;
+        Frame1 = base + vec2(1.0, 0.0);
+        Frame2 = base + vec2(0.0, 1.0);
+        FrameWeights = vec3(1.0 - f.x - f.y, f.x, f.y);
+    }
+    else
+    {
+        Frame0 = base + vec2(1.0, 1.0);
+        Frame1 = base + vec2(1.0, 0.0);
+        Frame2 = base + vec2(0.0, 1.0);
+        FrameWeights = vec3(f.x + f.y - 1.0, 1.0 - f.y, 1.0 - f.x);
+    }
+
+    gl_Position = projection * view * vec4(corner, 1.0);
+}
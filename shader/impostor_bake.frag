@@ -0,0 +1,21 @@
+#version 330 core
+// Impostor bake: albedo with coverage, and the building-space normal with
+// the view depth (linear under the orthographic projection)
+layout (location = 0) out vec4 Albedo;
+layout (location = 1) out vec4 NormalDepth;
+
+struct Material {
+    sampler2D diffuse;
+};
+
+in vec3 Normal;
+in vec2 TexCoords;
+
+uniform Material material;
+
+void main()
+{
+    vec3 normal = normalize(gl_FrontFacing ? Normal : -Normal);
+    Albedo = vec4(texture(material.diffuse, TexCoords).rgb, 1.0);
+    NormalDepth = vec4(normal * 0.5 + 0.5, gl_FragCoord.z);
+}
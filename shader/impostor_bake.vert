@@ -0,0 +1,20 @@
+#version 330 core
+// Impostor bake: a building seen through one orthographic view frame
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+uniform mat4 model;        // into building space, centered on the bounding sphere
+uniform mat4 normalMatrix;
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec3 Normal;
+out vec2 TexCoords;
+
+void main()
+{
+    Normal = mat3(normalMatrix) * aNormal;
+    TexCoords = aTexCoords;
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
+}
@@ -1,7 +1,9 @@
 #version 330 core
 out vec4 FragColor;
 
+in float Emission;
+
 uniform vec3 lightColor;
 void main() {
-    FragColor = vec4(lightColor, 1.0);
+    FragColor = vec4(lightColor * Emission, 1.0);
 }
\ No newline at end of file
@@ -1,10 +1,22 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
+layout (location = 4) in mat4 aInstanceModel;
+layout (location = 8) in vec4 aInstanceColor;
 
+uniform bool instanced;
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+
+out float Emission;
+
+// Lamp heads are drawn after the depth prepass with GL_LEQUAL
+invariant gl_Position;
+
 void main()
 {
-	gl_Position = projection * view * model * vec4(aPos, 1.0);
+	mat4 world = instanced ? aInstanceModel : model;
+	gl_Position = projection * view * world * vec4(aPos, 1.0);
+	// Instance alpha dims lamp heads whose light is switched off
+	Emission = instanced ? aInstanceColor.a : 1.0;
 }
\ No newline at end of file
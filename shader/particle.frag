@@ -0,0 +1,21 @@
+#version 330 core
+in vec2 Corner;
+in float LifeFraction;
+
+out vec4 FragColor;
+
+uniform vec3 color;        // HDR color
+uniform float opacity;
+uniform float additive;    // 1 = pure additive (sparks), 0 = alpha blended (rain, mist)
+
+void main()
+{
+    float r2 = dot(Corner, Corner);
+    if (r2 >= 1.0)
+        discard;
+
+    // Soft round falloff, faded in over the last 20% of life
+    float alpha = (1.0 - r2) * opacity * smoothstep(0.0, 0.2, LifeFraction);
+    // Premultiplied output for glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA)
+    FragColor = vec4(color * alpha, alpha * (1.0 - additive));
+}
@@ -0,0 +1,31 @@
+#version 330 core
+// Camera-facing particle quad, one instance per particle. Corners come from
+// gl_VertexID (4-vertex triangle strip), so only instance data is streamed.
+layout(location = 0) in vec4 aPositionLife;   // world position, seconds remaining
+layout(location = 1) in vec4 aVelocity;       // world velocity, 1 / lifetime
+
+out vec2 Corner;
+out float LifeFraction;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform float size;        // half width in world units
+uniform float stretch;     // extra half length per unit of screen-plane speed
+
+void main()
+{
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+    vec3 center = (view * vec4(aPositionLife.xyz, 1.0)).xyz;
+
+    // Align the quad with the view-space velocity so fast particles (rain)
+    // become streaks; slow ones stay round
+    vec2 motion = (mat3(view) * aVelocity.xyz).xy;
+    float speed = length(motion);
+    vec2 up = speed > 1e-4 ? motion / speed : vec2(0.0, 1.0);
+    vec2 right = vec2(up.y, -up.x);
+    vec2 offset = right * corner.x * size + up * corner.y * (size + stretch * speed);
+
+    gl_Position = projection * vec4(center + vec3(offset, 0.0), 1.0);
+    Corner = corner;
+    LifeFraction = clamp(aPositionLife.w * aVelocity.w, 0.0, 1.0);
+}
@@ -0,0 +1,5 @@
+#version 330 core
+// Never runs: the update pass draws with GL_RASTERIZER_DISCARD
+void main()
+{
+}
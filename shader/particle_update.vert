@@ -0,0 +1,68 @@
+#version 330 core
+// Transform-feedback particle update: integrates every particle and respawns
+// expired ones at a random emitter. Same layout as the instance data drawn by
+// particle.vert, so the output buffer is rendered directly.
+layout(location = 0) in vec4 aPositionLife;
+layout(location = 1) in vec4 aVelocity;
+
+out vec4 outPositionLife;
+out vec4 outVelocity;
+
+#define MAX_EMITTERS 16
+
+uniform float dt;
+uniform vec3 acceleration;
+uniform float damping;
+uniform float groundY;
+uniform bool killAtGround;
+uniform uint seed;
+
+uniform vec3 emitterPositions[MAX_EMITTERS];
+uniform int emitterCount;
+uniform vec3 spawnExtent;
+uniform vec3 baseVelocity;
+uniform vec3 velocityJitter;
+uniform vec2 lifetimeRange;
+
+uint Hash(uint x)
+{
+    x ^= x >> 16u;
+    x *= 0x7feb352du;
+    x ^= x >> 15u;
+    x *= 0x846ca68bu;
+    x ^= x >> 16u;
+    return x;
+}
+
+float Random(inout uint state)
+{
+    state = Hash(state);
+    return float(state) * (1.0 / 4294967296.0);
+}
+
+vec3 RandomSigned3(inout uint state)
+{
+    return vec3(Random(state), Random(state), Random(state)) * 2.0 - 1.0;
+}
+
+void main()
+{
+    vec3 velocity = aVelocity.xyz * damping + acceleration * dt;
+    vec3 position = aPositionLife.xyz + velocity * dt;
+    float life = aPositionLife.w - dt;
+    float invLifetime = aVelocity.w;
+
+    if (life <= 0.0 || (killAtGround && position.y < groundY))
+    {
+        uint state = Hash(uint(gl_VertexID) ^ seed);
+        int emitter = min(int(Random(state) * float(emitterCount)), emitterCount - 1);
+        position = emitterPositions[emitter] + RandomSigned3(state) * spawnExtent;
+        velocity = baseVelocity + RandomSigned3(state) * velocityJitter;
+        float lifetime = mix(lifetimeRange.x, lifetimeRange.y, Random(state));
+        life = lifetime;
+        invLifetime = 1.0 / max(lifetime, 1e-3);
+    }
+
+    outPositionLife = vec4(position, life);
+    outVelocity = vec4(velocity, invLifetime);
+}
@@ -0,0 +1,99 @@
+#version 330 core
+// Fused post-processing: upscale sample + sharpen + bloom composite +
+// exposure + tonemap + gamma + FXAA in one fullscreen pass, so the HDR scene is read once and the
+// backbuffer written once (no chain of full-resolution round trips).
+in vec2 TexCoords;
+out vec4 FragColor;
+
+uniform sampler2D sceneTexture;
+uniform vec2 uvScale;       // used sub-rect of sceneTexture (dynamic resolution)
+uniform vec2 texelSize;     // 1 / sceneTexture size
+uniform sampler2D bloomTexture; // level 0 of the bloom chain, covers the whole output
+uniform float bloomIntensity;   // 0 disables
+
+uniform bool enableTonemap;
+uniform bool enableGamma;
+uniform bool enableFxaa;
+uniform float exposure;
+uniform float gamma;
+uniform float sharpness;    // 0 disables; used after temporal upscaling
+
+#define FXAA_REDUCE_MIN (1.0 / 128.0)
+#define FXAA_REDUCE_MUL (1.0 / 8.0)
+#define FXAA_SPAN_MAX 8.0
+
+vec3 SampleScene(vec2 uv)
+{
+    vec2 halfTexel = 0.5 * texelSize;
+    vec3 color = texture(sceneTexture, clamp(uv * uvScale, halfTexel, uvScale - halfTexel)).rgb;
+    if (bloomIntensity > 0.0)
+        color += texture(bloomTexture, uv).rgb * bloomIntensity;
+    return color;
+}
+
+// Narkowicz's ACES filmic fit
+vec3 ToneMapACES(vec3 x)
+{
+    return clamp((x * (2.51 * x + 0.03)) / (x * (2.43 * x + 0.59) + 0.14), 0.0, 1.0);
+}
+
+vec3 ToDisplay(vec3 hdr)
+{
+    vec3 c = hdr * exposure;
+    c = enableTonemap ? ToneMapACES(c) : clamp(c, 0.0, 1.0);
+    return enableGamma ? pow(c, vec3(1.0 / gamma)) : c;
+}
+
+float Luma(vec3 c)
+{
+    return dot(c, vec3(0.299, 0.587, 0.114));
+}
+
+void main()
+{
+    // Offsets below are in source texels, converted to output uv space
+    vec2 stepUv = texelSize / uvScale;
+
+    vec3 center = SampleScene(TexCoords);
+    if (sharpness > 0.0)
+    {
+        vec3 n = SampleScene(TexCoords + vec2(0.0, stepUv.y));
+        vec3 s = SampleScene(TexCoords - vec2(0.0, stepUv.y));
+        vec3 e = SampleScene(TexCoords + vec2(stepUv.x, 0.0));
+        vec3 w = SampleScene(TexCoords - vec2(stepUv.x, 0.0));
+        vec3 minC = min(center, min(min(n, s), min(e, w)));
+        vec3 maxC = max(center, max(max(n, s), max(e, w)));
+        center = clamp(center + (4.0 * center - n - s - e - w) * (sharpness * 0.25), minC, maxC);
+    }
+    vec3 color = ToDisplay(center);
+
+    if (enableFxaa)
+    {
+        float lumaM = Luma(color);
+        float lumaNW = Luma(ToDisplay(SampleScene(TexCoords + vec2(-1.0, -1.0) * stepUv)));
+        float lumaNE = Luma(ToDisplay(SampleScene(TexCoords + vec2(1.0, -1.0) * stepUv)));
+        float lumaSW = Luma(ToDisplay(SampleScene(TexCoords + vec2(-1.0, 1.0) * stepUv)));
+        float lumaSE = Luma(ToDisplay(SampleScene(TexCoords + vec2(1.0, 1.0) * stepUv)));
+        float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+        float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+
+        // Only pixels on a visible edge pay for the directional taps
+        if (lumaMax - lumaMin > max(0.0312, lumaMax * 0.125))
+        {
+            vec2 dir = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)),
+                            ((lumaNW + lumaSW) - (lumaNE + lumaSE)));
+            float dirReduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * (0.25 * FXAA_REDUCE_MUL), FXAA_REDUCE_MIN);
+            float rcpDirMin = 1.0 / (min(abs(dir.x), abs(dir.y)) + dirReduce);
+            dir = clamp(dir * rcpDirMin, vec2(-FXAA_SPAN_MAX), vec2(FXAA_SPAN_MAX)) * stepUv;
+
+            vec3 rgbA = 0.5 * (ToDisplay(SampleScene(TexCoords + dir * (1.0 / 3.0 - 0.5))) +
+                               ToDisplay(SampleScene(TexCoords + dir * (2.0 / 3.0 - 0.5))));
+            vec3 rgbB = rgbA * 0.5 + 0.25 * (ToDisplay(SampleScene(TexCoords + dir * -0.5)) +
+                                             ToDisplay(SampleScene(TexCoords + dir * 0.5)));
+            float lumaB = Luma(rgbB);
+            color = (lumaB < lumaMin || lumaB > lumaMax) ? rgbA : rgbB;
+        }
+    }
+
+    FragColor = vec4(color, 1.0);
+}
@@ -46,6 +46,9 @@ struct SpotLight {
 in vec3 Normal;
 in vec3 FragPos;
 in vec2 TexCoords;
+in vec2 LightmapUV;
+in float ViewDepth;
+in vec3 Tint;
 
 uniform vec3 viewPos;
 uniform Material material;
@@ -54,32 +57,158 @@ uniform PointLight pointLights[NR_POINT_LIGHTS];
 uniform int numPointLights;
 uniform SpotLight spotLight;
 uniform bool flashlightOn;
+// Mip bias matching the dynamic render resolution to the output resolution
+uniform float textureLodBias;
+
+// Reduced-resolution SSAO, bilaterally upsampled against its linear depth
+uniform bool ssaoEnabled;
+uniform sampler2D ssaoTexture;
+uniform sampler2D ssaoDepth;
+uniform int ssaoDivisor;
+uniform ivec2 ssaoMax;        // last valid texel of the SSAO sub-rect
+
+// Froxel volumetric fog: (in-scattered light, transmittance) integrated from the camera
+uniform bool fogEnabled;
+uniform sampler3D fogVolume;
+uniform vec2 fogViewport;     // render size in pixels
+uniform vec2 fogDepthRange;   // (near, far) view depth of the exponential slices
+
+// Baked street lamps and sky (BC5 array): layers 0-3 hold two lamps each in
+// R and G, layer 4 the sky in R, all stored as sqrt(value / scale)
+uniform bool lightmapEnabled;
+uniform sampler2DArray lightmap;
+uniform vec2 lightmapLampMask[4];   // 1 for lamps that are switched on
+uniform float lightmapLampScale;
+uniform float lightmapSkyScale;
+uniform vec3 lightmapLampColor;     // diffuse color shared by all street lamps
+
+// Irradiance probes: L2 SH per probe as seven RGBA texels, stored as seven
+// slabs of size.y rows stacked along the texture height
+uniform bool probesEnabled;
+uniform sampler3D probeGrid;
+uniform vec3 probeGridOrigin;
+uniform vec3 probeGridInvSpacing;
+uniform vec3 probeGridSize;
+uniform float probeNormalBias;
 
 // Function prototypes
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 albedo, vec3 specularColor, vec3 ambientLight);
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo, vec3 specularColor, float ao);
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo, vec3 specularColor, float ao);
+float SampleAmbientOcclusion();
+float SampleLightmapLamps();
+vec3 SampleProbeIrradiance(vec3 position, vec3 normal);
+vec3 ApplyFog(vec3 color, float viewDepth);
 
 void main()
 {   
     vec3 norm = normalize(Normal);
     vec3 viewDir = normalize(viewPos - FragPos);
+    // Material maps are sampled once and shared by every light
+    vec3 albedo = texture(material.diffuse, TexCoords, textureLodBias).rgb * Tint;
+    vec3 specularColor = texture(material.specular, TexCoords, textureLodBias).rgb;
+    float ao = ssaoEnabled ? SampleAmbientOcclusion() : 1.0;
+    // The moon's ambient term is scaled by the baked sky visibility (with
+    // bounces) where there is a lightmap, else by the probe grid
+    vec3 ambientLight = vec3(1.0);
+    if (lightmapEnabled)
+    {
+        float sky = texture(lightmap, vec3(LightmapUV, 4.0)).r;
+        ambientLight = vec3(sky * sky * lightmapSkyScale);
+    }
+    else if (probesEnabled)
+        ambientLight = SampleProbeIrradiance(FragPos, norm);
     
     // Phase 1: Directional lighting (moonlight/sunlight)
-    vec3 result = CalcDirLight(dirLight, norm, viewDir);
+    vec3 result = CalcDirLight(dirLight, norm, viewDir, albedo, specularColor, ao * ambientLight);
     
-    // Phase 2: Point lights (street lamps)
-    for(int i = 0; i < numPointLights; i++)
-        result += CalcPointLight(pointLights[i], norm, FragPos, viewDir);
+    // Phase 2: Point lights (street lamps), baked diffuse or evaluated per light
+    if (lightmapEnabled)
+        result += lightmapLampColor * albedo * SampleLightmapLamps();
+    else
+        for(int i = 0; i < numPointLights; i++)
+            result += CalcPointLight(pointLights[i], norm, FragPos, viewDir, albedo, specularColor, ao);
     
     // Phase 3: Flashlight (spotlight)
     if (flashlightOn)
-        result += CalcSpotLight(spotLight, norm, FragPos, viewDir);
+        result += CalcSpotLight(spotLight, norm, FragPos, viewDir, albedo, specularColor, ao);
     
+    if (fogEnabled)
+        result = ApplyFog(result, ViewDepth);
+
     FragColor = vec4(result, 1.0);
 }
 
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
+vec3 ApplyFog(vec3 color, float viewDepth)
+{
+    float slices = float(textureSize(fogVolume, 0).z);
+    float z = log(max(viewDepth, fogDepthRange.x) / fogDepthRange.x) / log(fogDepthRange.y / fogDepthRange.x);
+    // Slice k of the volume holds the integral up to its far edge
+    vec4 fog = texture(fogVolume, vec3(gl_FragCoord.xy / fogViewport, z - 0.5 / slices));
+    return color * fog.a + fog.rgb;
+}
+
+float SampleLightmapLamps()
+{
+    float irradiance = 0.0;
+    for (int pair = 0; pair < 4; ++pair)
+    {
+        if (lightmapLampMask[pair] == vec2(0.0))
+            continue;
+        vec2 encoded = texture(lightmap, vec3(LightmapUV, float(pair))).rg;
+        irradiance += dot(encoded * encoded, lightmapLampMask[pair]);
+    }
+    return irradiance * lightmapLampScale;
+}
+
+vec3 SampleProbeIrradiance(vec3 position, vec3 normal)
+{
+    vec3 cell = clamp((position + normal * probeNormalBias - probeGridOrigin) * probeGridInvSpacing,
+                      vec3(0.0), probeGridSize - 1.0);
+    vec2 xz = (cell.xz + 0.5) / probeGridSize.xz;
+    float rows = probeGridSize.y * 7.0;
+    vec4 t[7];
+    for (int k = 0; k < 7; ++k)
+        t[k] = texture(probeGrid, vec3(xz.x, (float(k) * probeGridSize.y + cell.y + 0.5) / rows, xz.y));
+
+    // Cosine-convolved coefficients, same basis order as the CPU baker
+    vec3 n = normal;
+    vec3 irradiance = t[0].rgb * 0.282095
+        + vec3(t[0].a, t[1].rg) * (0.488603 * n.y)
+        + vec3(t[1].ba, t[2].r) * (0.488603 * n.z)
+        + t[2].gba * (0.488603 * n.x)
+        + t[3].rgb * (1.092548 * n.x * n.y)
+        + vec3(t[3].a, t[4].rg) * (1.092548 * n.y * n.z)
+        + vec3(t[4].ba, t[5].r) * (0.315392 * (3.0 * n.z * n.z - 1.0))
+        + t[5].gba * (1.092548 * n.x * n.z)
+        + t[6].rgb * (0.546274 * (n.x * n.x - n.y * n.y));
+    return max(irradiance, vec3(0.0));
+}
+
+float SampleAmbientOcclusion()
+{
+    // Bilinear weights of the 4 nearest low-res texels, each scaled by how
+    // close its depth is to this fragment so AO does not bleed across edges
+    vec2 p = gl_FragCoord.xy / float(ssaoDivisor) - 0.5;
+    ivec2 base = ivec2(floor(p));
+    vec2 f = fract(p);
+    vec4 bilinear = vec4((1.0 - f.x) * (1.0 - f.y), f.x * (1.0 - f.y), (1.0 - f.x) * f.y, f.x * f.y);
+    ivec2 offsets[4] = ivec2[](ivec2(0, 0), ivec2(1, 0), ivec2(0, 1), ivec2(1, 1));
+
+    float sum = 0.0;
+    float weightSum = 0.0;
+    for (int i = 0; i < 4; ++i)
+    {
+        ivec2 t = clamp(base + offsets[i], ivec2(0), ssaoMax);
+        float depth = texelFetch(ssaoDepth, t, 0).r;
+        float w = bilinear[i] / (1e-3 + abs(depth - ViewDepth) / ViewDepth * 10.0);
+        sum += texelFetch(ssaoTexture, t, 0).r * w;
+        weightSum += w;
+    }
+    return sum / max(weightSum, 1e-5);
+}
+
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 albedo, vec3 specularColor, vec3 ambientLight)
 {
     vec3 lightDir = normalize(-light.direction);
     // diffuse shading
@@ -88,13 +217,13 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
     // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
+    vec3 ambient = light.ambient * albedo * ambientLight;
+    vec3 diffuse = light.diffuse * diff * albedo;
+    vec3 specular = light.specular * spec * specularColor;
     return (ambient + diffuse + specular);
 }
 
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo, vec3 specularColor, float ao)
 {
     vec3 lightDir = normalize(light.position - fragPos);
     // diffuse shading
@@ -106,16 +235,16 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float distance = length(light.position - fragPos);
     float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
     // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
+    vec3 ambient = light.ambient * albedo * ao;
+    vec3 diffuse = light.diffuse * diff * albedo;
+    vec3 specular = light.specular * spec * specularColor;
     ambient *= attenuation;
     diffuse *= attenuation;
     specular *= attenuation;
     return (ambient + diffuse + specular);
 }
 
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo, vec3 specularColor, float ao)
 {
     vec3 lightDir = normalize(light.position - fragPos);
     // diffuse shading
@@ -131,9 +260,9 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float epsilon = light.cutOff - light.outerCutOff;
     float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
     // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
+    vec3 ambient = light.ambient * albedo * ao;
+    vec3 diffuse = light.diffuse * diff * albedo;
+    vec3 specular = light.specular * spec * specularColor;
     ambient *= attenuation * intensity;
     diffuse *= attenuation * intensity;
     specular *= attenuation * intensity;
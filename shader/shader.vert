@@ -2,7 +2,14 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in vec2 aLightmapUV;
+// Instanced meshes: per-instance transform, tint and lightmap scale/offset
+// (see InstanceData; street props stream only the first two)
+layout (location = 4) in mat4 aInstanceModel;
+layout (location = 8) in vec4 aInstanceColor;
+layout (location = 9) in vec4 aInstanceLightmap;
 
+uniform bool instanced;
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
@@ -10,11 +17,22 @@ uniform mat4 projection;
 out vec3 Normal;
 out vec3 FragPos;
 out vec2 TexCoords;
+out vec2 LightmapUV;
+out float ViewDepth;
+out vec3 Tint;
+
+// Matches depth.vert exactly so the depth prepass can be reused with GL_LEQUAL
+invariant gl_Position;
+
 void main()
 {
-	gl_Position = projection * view * model * vec4(aPos, 1.0);
-	FragPos = vec3(model * vec4(aPos, 1.0));
+	mat4 world = instanced ? aInstanceModel : model;
+	gl_Position = projection * view * world * vec4(aPos, 1.0);
+	FragPos = vec3(world * vec4(aPos, 1.0));
+	ViewDepth = -(view * vec4(FragPos, 1.0)).z;
 	//最好在CPU端计算逆转置矩阵，然后传递给着色器以提高性能
-	Normal = mat3(transpose(inverse(model))) * aNormal;
+	Normal = mat3(transpose(inverse(world))) * aNormal;
 	TexCoords = aTexCoords;
+	LightmapUV = instanced ? aLightmapUV * aInstanceLightmap.xy + aInstanceLightmap.zw : aLightmapUV;
+	Tint = instanced ? aInstanceColor.rgb : vec3(1.0);
 }
\ No newline at end of file
@@ -5,6 +5,11 @@ out vec4 FragColor;
 
 uniform sampler2D skybox;
 
+// Froxel volumetric fog; the sky takes the full integral through the volume
+uniform bool fogEnabled;
+uniform sampler3D fogVolume;
+uniform vec2 fogViewport;
+
 const vec2 invAtan = vec2(0.1591, 0.3183);
 
 vec2 SampleSphericalMap(vec3 v)
@@ -20,4 +25,9 @@ void main()
 {
     vec2 uv = SampleSphericalMap(normalize(TexCoords));
     FragColor = texture(skybox, uv);
+    if (fogEnabled)
+    {
+        vec4 fog = texture(fogVolume, vec3(gl_FragCoord.xy / fogViewport, 1.0));
+        FragColor.rgb = FragColor.rgb * fog.a + fog.rgb;
+    }
 }
@@ -0,0 +1,69 @@
+#version 330 core
+// Hemisphere SSAO at reduced resolution. View-space positions come from the
+// linear depth buffer and normals are reconstructed from neighboring depths.
+in vec2 TexCoords;
+out float Occlusion;
+
+#define MAX_SAMPLES 32
+
+uniform sampler2D linearDepth;
+uniform vec2 aoSize;           // used SSAO sub-rect in texels
+uniform vec4 projInfo;         // (P[0][0], P[1][1], P[2][0], P[2][1])
+uniform vec3 samples[MAX_SAMPLES];
+uniform int sampleCount;
+uniform float radius;
+uniform float power;
+
+vec3 ViewPosition(vec2 uv, float depth)
+{
+    vec2 ndc = uv * 2.0 - 1.0;
+    return vec3(depth * (ndc + projInfo.zw) / projInfo.xy, -depth);
+}
+
+vec3 ViewPositionAt(ivec2 texel)
+{
+    texel = clamp(texel, ivec2(0), ivec2(aoSize) - 1);
+    vec2 uv = (vec2(texel) + 0.5) / aoSize;
+    return ViewPosition(uv, texelFetch(linearDepth, texel, 0).r);
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    vec3 p = ViewPositionAt(texel);
+
+    // Pick the smaller one-sided difference on each axis so normals stay
+    // correct on depth discontinuities
+    vec3 l = ViewPositionAt(texel - ivec2(1, 0));
+    vec3 r = ViewPositionAt(texel + ivec2(1, 0));
+    vec3 d = ViewPositionAt(texel - ivec2(0, 1));
+    vec3 u = ViewPositionAt(texel + ivec2(0, 1));
+    vec3 dx = (abs(r.z - p.z) < abs(p.z - l.z)) ? r - p : p - l;
+    vec3 dy = (abs(u.z - p.z) < abs(p.z - d.z)) ? u - p : p - d;
+    vec3 normal = normalize(cross(dx, dy));
+
+    // Per-pixel rotation from interleaved gradient noise (no noise texture)
+    float angle = 6.2831853 * fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+    vec3 randomVec = vec3(cos(angle), sin(angle), 0.0);
+    vec3 tangent = normalize(randomVec - normal * dot(randomVec, normal));
+    vec3 bitangent = cross(normal, tangent);
+    mat3 tbn = mat3(tangent, bitangent, normal);
+
+    float occlusion = 0.0;
+    for (int i = 0; i < sampleCount; ++i)
+    {
+        vec3 s = p + tbn * samples[i] * radius;
+
+        // Project the sample back to the SSAO buffer
+        vec2 ndc = (s.xy * projInfo.xy) / -s.z - projInfo.zw;
+        vec2 uv = ndc * 0.5 + 0.5;
+        if (any(lessThan(uv, vec2(0.0))) || any(greaterThan(uv, vec2(1.0))))
+            continue;
+
+        float sceneDepth = texelFetch(linearDepth, ivec2(uv * aoSize), 0).r;
+        float rangeCheck = smoothstep(0.0, 1.0, radius / abs(-p.z - sceneDepth));
+        occlusion += (sceneDepth <= -s.z - 0.02 * radius ? 1.0 : 0.0) * rangeCheck;
+    }
+
+    Occlusion = pow(1.0 - occlusion / float(max(sampleCount, 1)), power);
+}
@@ -0,0 +1,32 @@
+#version 330 core
+// Separable depth-aware (bilateral) blur of the SSAO term at SSAO resolution
+in vec2 TexCoords;
+out float Occlusion;
+
+uniform sampler2D aoTexture;
+uniform sampler2D linearDepth;
+uniform ivec2 direction;       // (1,0) horizontal, (0,1) vertical
+uniform ivec2 aoMax;           // last valid texel of the sub-rect
+uniform float depthSharpness;
+
+void main()
+{
+    const float weights[4] = float[](0.324, 0.232, 0.0855, 0.0205);
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float centerDepth = texelFetch(linearDepth, texel, 0).r;
+
+    float sum = texelFetch(aoTexture, texel, 0).r * weights[0];
+    float weightSum = weights[0];
+    for (int i = 1; i < 4; ++i)
+    {
+        for (int side = -1; side <= 1; side += 2)
+        {
+            ivec2 t = clamp(texel + direction * i * side, ivec2(0), aoMax);
+            float depth = texelFetch(linearDepth, t, 0).r;
+            float w = weights[i] * exp(-abs(depth - centerDepth) * depthSharpness / max(centerDepth, 1e-3));
+            sum += texelFetch(aoTexture, t, 0).r * w;
+            weightSum += w;
+        }
+    }
+    Occlusion = sum / weightSum;
+}
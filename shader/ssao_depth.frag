@@ -0,0 +1,23 @@
+#version 330 core
+// Downsamples the hardware depth buffer into linear view depth at SSAO
+// resolution. Keeps the nearest of each block so thin foreground geometry
+// survives the reduction.
+in vec2 TexCoords;
+out float LinearDepth;
+
+uniform sampler2D depthTexture;
+uniform int divisor;           // 2 = half resolution, 4 = quarter
+uniform ivec2 sourceMax;       // last valid texel of the full-res sub-rect
+uniform vec2 depthParams;      // (projection[2][2], projection[3][2])
+
+void main()
+{
+    ivec2 base = ivec2(gl_FragCoord.xy) * divisor;
+    float depth = 1.0;
+    for (int y = 0; y < divisor; ++y)
+        for (int x = 0; x < divisor; ++x)
+            depth = min(depth, texelFetch(depthTexture, min(base + ivec2(x, y), sourceMax), 0).r);
+
+    float ndcZ = depth * 2.0 - 1.0;
+    LinearDepth = depthParams.y / (ndcZ + depthParams.x);
+}
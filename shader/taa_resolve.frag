@@ -0,0 +1,94 @@
+#version 330 core
+// Temporal upsampling resolve: runs at output resolution, accumulating the
+// jittered low-resolution scene into a full-resolution history buffer.
+in vec2 TexCoords;
+out vec4 FragColor;
+
+uniform sampler2D sceneColor;     // low-res jittered scene (sub-rect of its target)
+uniform sampler2D sceneDepth;
+uniform sampler2D velocityTexture;
+uniform sampler2D historyTexture; // previous resolve at output resolution
+
+uniform vec2 renderSize;          // scene sub-rect size in pixels
+uniform vec2 outputSize;
+uniform vec2 jitter;              // this frame's jitter in render pixels
+uniform bool historyValid;
+uniform float feedbackMin;        // history weight floor when the current sample is far away
+uniform float feedbackMax;
+
+vec3 RGBToYCoCg(vec3 c)
+{
+    return vec3(0.25 * c.r + 0.5 * c.g + 0.25 * c.b,
+                0.5 * c.r - 0.5 * c.b,
+                -0.25 * c.r + 0.5 * c.g - 0.25 * c.b);
+}
+
+vec3 YCoCgToRGB(vec3 c)
+{
+    return vec3(c.x + c.y - c.z, c.x + c.z, c.x - c.y - c.z);
+}
+
+void main()
+{
+    // Output pixel position expressed in (unjittered) render pixels
+    vec2 renderPos = TexCoords * renderSize;
+    // The jitter moves content by +jitter render pixels, so texel t holds the
+    // unjittered position t + 0.5 - jitter and renderPos lies in texel renderPos + jitter
+    ivec2 center = ivec2(floor(renderPos + jitter));
+    ivec2 maxTexel = ivec2(renderSize) - 1;
+
+    vec3 minColor = vec3(1e9);
+    vec3 maxColor = vec3(-1e9);
+    vec3 current = vec3(0.0);
+    float closestDepth = 1.0;
+    ivec2 closestTexel = center;
+    float nearestDist = 1e9;
+
+    for (int y = -1; y <= 1; ++y)
+    {
+        for (int x = -1; x <= 1; ++x)
+        {
+            ivec2 texel = clamp(center + ivec2(x, y), ivec2(0), maxTexel);
+            vec3 c = RGBToYCoCg(texelFetch(sceneColor, texel, 0).rgb);
+            minColor = min(minColor, c);
+            maxColor = max(maxColor, c);
+
+            // Nearest jittered sample reconstructs the current frame's value
+            vec2 samplePos = vec2(texel) + 0.5 - jitter;
+            float dist = dot(samplePos - renderPos, samplePos - renderPos);
+            if (dist < nearestDist)
+            {
+                nearestDist = dist;
+                current = c;
+            }
+
+            // Dilate motion vectors towards the closest surface to keep edges clean
+            float d = texelFetch(sceneDepth, texel, 0).r;
+            if (d < closestDepth)
+            {
+                closestDepth = d;
+                closestTexel = texel;
+            }
+        }
+    }
+
+    vec2 velocity = texelFetch(velocityTexture, closestTexel, 0).rg;
+    vec2 historyUv = TexCoords - velocity;
+
+    if (!historyValid || any(lessThan(historyUv, vec2(0.0))) || any(greaterThan(historyUv, vec2(1.0))))
+    {
+        FragColor = vec4(YCoCgToRGB(current), 1.0);
+        return;
+    }
+
+    vec3 history = RGBToYCoCg(texture(historyTexture, historyUv).rgb);
+    history = clamp(history, minColor, maxColor);
+
+    // Trust the new sample more when it lands close to this output pixel.
+    // Distances are measured in render pixels, so the falloff widens with upscaling.
+    float sampleWeight = exp(-2.29 * nearestDist);
+    float feedback = mix(feedbackMax, feedbackMin, sampleWeight);
+    vec3 result = mix(current, history, feedback);
+
+    FragColor = vec4(YCoCgToRGB(result), 1.0);
+}
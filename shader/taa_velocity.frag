@@ -0,0 +1,25 @@
+#version 330 core
+// Camera-only motion vectors: the city is static, so reprojecting the depth
+// buffer with the previous view-projection covers almost every pixel.
+in vec2 TexCoords;
+out vec2 Velocity;
+
+uniform sampler2D depthTexture;
+uniform vec2 uvScale;          // render size / target size (scene sub-rect)
+uniform mat4 invViewProj;      // current, jittered
+uniform mat4 currViewProj;     // current, unjittered
+uniform mat4 prevViewProj;     // previous, unjittered
+
+void main()
+{
+    float depth = texture(depthTexture, TexCoords * uvScale).r;
+    vec4 clip = vec4(TexCoords * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+    vec4 world = invViewProj * clip;
+    world /= world.w;
+
+    vec4 currClip = currViewProj * world;
+    vec4 prevClip = prevViewProj * world;
+    vec2 currUv = currClip.xy / currClip.w * 0.5 + 0.5;
+    vec2 prevUv = prevClip.xy / prevClip.w * 0.5 + 0.5;
+    Velocity = currUv - prevUv;
+}
@@ -0,0 +1,95 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Rim;
+in vec2 OceanUv;
+in float ViewDepth;
+
+uniform vec3 viewPos;
+uniform float time;
+
+// WaterSettings
+uniform float waveSpeed;      // slope map scroll, tiles per second
+uniform float waveStrength;   // reflection distortion in screen UV
+uniform vec3 deepColor;
+uniform vec3 shallowColor;
+
+uniform sampler2D normalMap;  // tiling wave slopes (d/dx, d/dz) in RG
+uniform float normalTiling;
+
+// FFT ocean slopes (dh/dx, dh/dz) for open water
+uniform bool oceanEnabled;
+uniform sampler2D oceanSlopes;
+
+// Planar reflection, rendered from the mirrored camera into a reduced-size sub-rect
+uniform bool reflectionEnabled;
+uniform sampler2D reflectionTexture;
+uniform vec2 reflectionUvScale;
+uniform vec2 viewportSize;    // scene render size in pixels
+
+uniform vec3 moonDirection;
+uniform vec3 moonColor;
+
+// Froxel volumetric fog, same lookup as shader.frag
+uniform bool fogEnabled;
+uniform sampler3D fogVolume;
+uniform vec2 fogViewport;
+uniform vec2 fogDepthRange;
+
+vec3 ApplyFog(vec3 color, float viewDepth)
+{
+    float slices = float(textureSize(fogVolume, 0).z);
+    float z = log(max(viewDepth, fogDepthRange.x) / fogDepthRange.x) / log(fogDepthRange.y / fogDepthRange.x);
+    vec4 fog = texture(fogVolume, vec3(gl_FragCoord.xy / fogViewport, z - 0.5 / slices));
+    return color * fog.a + fog.rgb;
+}
+
+void main()
+{
+    vec2 slope;
+    vec3 normal;
+    if (oceanEnabled && Rim.z == 0.0)
+    {
+        // Open water: true surface slopes from the FFT ocean
+        slope = texture(oceanSlopes, OceanUv).rg;
+        normal = normalize(vec3(-slope.x, 1.0, -slope.y));
+    }
+    else
+    {
+        // Puddles: two octaves of the slope map scrolling in different directions
+        float phase = time * waveSpeed;
+        vec2 uv = FragPos.xz * normalTiling;
+        slope = texture(normalMap, uv + vec2(phase, 0.0)).rg * 2.0 - 1.0;
+        slope += texture(normalMap, uv * 1.7 + vec2(-0.6, 0.8) * phase).rg * 2.0 - 1.0;
+        slope *= 0.5;
+        normal = normalize(vec3(-slope.x * waveStrength * 20.0, 1.0, -slope.y * waveStrength * 20.0));
+    }
+    vec3 viewDir = normalize(viewPos - FragPos);
+    float cosTheta = max(dot(normal, viewDir), 0.0);
+    // Schlick with F0 = 0.02 (water)
+    float fresnel = 0.02 + 0.98 * pow(1.0 - cosTheta, 5.0);
+
+    // Looking straight down shows the shallow bottom, grazing angles the deep body
+    vec3 body = mix(deepColor, shallowColor, cosTheta);
+    body *= 0.5 + 0.5 * max(dot(normal, -moonDirection), 0.0);
+
+    vec3 reflected = body;
+    if (reflectionEnabled)
+    {
+        vec2 screenUv = clamp(gl_FragCoord.xy / viewportSize + slope * waveStrength, vec2(0.001), vec2(0.999));
+        reflected = texture(reflectionTexture, screenUv * reflectionUvScale).rgb;
+    }
+
+    vec3 halfway = normalize(viewDir - moonDirection);
+    vec3 specular = moonColor * 4.0 * pow(max(dot(normal, halfway), 0.0), 256.0);
+
+    vec3 color = mix(body, reflected, fresnel) + specular;
+    if (fogEnabled)
+        color = ApplyFog(color, ViewDepth);
+
+    // Puddles fade out over their rim, broken up by the waves
+    float rim = max(abs(Rim.x), abs(Rim.y)) + (slope.x + slope.y) * 0.1 * Rim.z;
+    float alpha = Rim.z > 0.0 ? 1.0 - smoothstep(1.0 - Rim.z, 1.0, rim) : 1.0;
+    FragColor = vec4(color, alpha);
+}
@@ -0,0 +1,35 @@
+#version 330 core
+// Water bodies on the shared water plane, already in world space
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aRim;     // xy: position inside the body [-1,1], z: edge softness
+
+uniform mat4 view;
+uniform mat4 projection;
+
+// FFT ocean: (choppy dx, height, choppy dz) per texel of one repeating patch
+uniform bool oceanEnabled;
+uniform sampler2D oceanDisplacement;
+uniform float oceanPatchSize;
+
+out vec3 FragPos;
+out vec3 Rim;
+out vec2 OceanUv;
+out float ViewDepth;
+
+void main()
+{
+    vec3 position = aPos;
+    OceanUv = aPos.xz / oceanPatchSize;
+    if (oceanEnabled && aRim.z == 0.0)
+    {
+        // Pinned at the rim so the water stays inside its body
+        float rim = max(abs(aRim.x), abs(aRim.y));
+        position += textureLod(oceanDisplacement, OceanUv, 0.0).xyz * (1.0 - smoothstep(0.8, 1.0, rim));
+    }
+
+    vec4 viewPosition = view * vec4(position, 1.0);
+    gl_Position = projection * viewPosition;
+    FragPos = position;
+    Rim = aRim;
+    ViewDepth = -viewPosition.z;
+}
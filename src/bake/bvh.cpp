@@ -0,0 +1,382 @@
+#include "bake/bvh.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BVH_USE_SSE 1
+#include <emmintrin.h>
+#else
+#define BVH_USE_SSE 0
+#endif
+
+namespace
+{
+    constexpr int kBinCount = 16;
+    constexpr std::size_t kMaxLeafSize = 8;
+    constexpr int kMaxStackDepth = 64;
+    constexpr float kTriangleEpsilon = 1e-9f;
+
+    // Four float lanes; comparisons return all-ones / all-zero lane masks
+#if BVH_USE_SSE
+    struct F4
+    {
+        __m128 v;
+    };
+    inline F4 splat(float x) { return {_mm_set1_ps(x)}; }
+    inline F4 load(const float *p) { return {_mm_loadu_ps(p)}; }
+    inline void store(float *p, F4 a) { _mm_storeu_ps(p, a.v); }
+    inline F4 operator+(F4 a, F4 b) { return {_mm_add_ps(a.v, b.v)}; }
+    inline F4 operator-(F4 a, F4 b) { return {_mm_sub_ps(a.v, b.v)}; }
+    inline F4 operator*(F4 a, F4 b) { return {_mm_mul_ps(a.v, b.v)}; }
+    inline F4 operator/(F4 a, F4 b) { return {_mm_div_ps(a.v, b.v)}; }
+    inline F4 min(F4 a, F4 b) { return {_mm_min_ps(a.v, b.v)}; }
+    inline F4 max(F4 a, F4 b) { return {_mm_max_ps(a.v, b.v)}; }
+    inline F4 operator<(F4 a, F4 b) { return {_mm_cmplt_ps(a.v, b.v)}; }
+    inline F4 operator<=(F4 a, F4 b) { return {_mm_cmple_ps(a.v, b.v)}; }
+    inline F4 operator>(F4 a, F4 b) { return {_mm_cmpgt_ps(a.v, b.v)}; }
+    inline F4 operator>=(F4 a, F4 b) { return {_mm_cmpge_ps(a.v, b.v)}; }
+    inline F4 operator&(F4 a, F4 b) { return {_mm_and_ps(a.v, b.v)}; }
+    inline F4 abs(F4 a) { return {_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)}; }
+    inline F4 select(F4 mask, F4 a, F4 b) { return {_mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v))}; }
+    inline int laneMask(F4 mask) { return _mm_movemask_ps(mask.v); }
+#else
+    struct F4
+    {
+        float v[4];
+    };
+    template <typename Op>
+    inline F4 lanes(Op op)
+    {
+        F4 r;
+        for (int i = 0; i < 4; i++)
+            r.v[i] = op(i);
+        return r;
+    }
+    inline float maskValue(bool b) { return b ? -std::numeric_limits<float>::quiet_NaN() : 0.0f; }
+    inline bool maskBit(float f) { return std::signbit(f) || std::isnan(f); }
+    inline F4 splat(float x) { return lanes([&](int) { return x; }); }
+    inline F4 load(const float *p) { return lanes([&](int i) { return p[i]; }); }
+    inline void store(float *p, F4 a) { std::copy(a.v, a.v + 4, p); }
+    inline F4 operator+(F4 a, F4 b) { return lanes([&](int i) { return a.v[i] + b.v[i]; }); }
+    inline F4 operator-(F4 a, F4 b) { return lanes([&](int i) { return a.v[i] - b.v[i]; }); }
+    inline F4 operator*(F4 a, F4 b) { return lanes([&](int i) { return a.v[i] * b.v[i]; }); }
+    inline F4 operator/(F4 a, F4 b) { return lanes([&](int i) { return a.v[i] / b.v[i]; }); }
+    inline F4 min(F4 a, F4 b) { return lanes([&](int i) { return std::min(a.v[i], b.v[i]); }); }
+    inline F4 max(F4 a, F4 b) { return lanes([&](int i) { return std::max(a.v[i], b.v[i]); }); }
+    inline F4 operator<(F4 a, F4 b) { return lanes([&](int i) { return maskValue(a.v[i] < b.v[i]); }); }
+    inline F4 operator<=(F4 a, F4 b) { return lanes([&](int i) { return maskValue(a.v[i] <= b.v[i]); }); }
+    inline F4 operator>(F4 a, F4 b) { return lanes([&](int i) { return maskValue(a.v[i] > b.v[i]); }); }
+    inline F4 operator>=(F4 a, F4 b) { return lanes([&](int i) { return maskValue(a.v[i] >= b.v[i]); }); }
+    inline F4 operator&(F4 a, F4 b) { return lanes([&](int i) { return maskValue(maskBit(a.v[i]) && maskBit(b.v[i])); }); }
+    inline F4 abs(F4 a) { return lanes([&](int i) { return std::fabs(a.v[i]); }); }
+    inline F4 select(F4 mask, F4 a, F4 b) { return lanes([&](int i) { return maskBit(mask.v[i]) ? a.v[i] : b.v[i]; }); }
+    inline int laneMask(F4 mask)
+    {
+        int bits = 0;
+        for (int i = 0; i < 4; i++)
+            bits |= maskBit(mask.v[i]) ? (1 << i) : 0;
+        return bits;
+    }
+#endif
+
+    struct BuildBounds
+    {
+        glm::vec3 boundsMin{std::numeric_limits<float>::max()};
+        glm::vec3 boundsMax{-std::numeric_limits<float>::max()};
+
+        void grow(const glm::vec3 &p)
+        {
+            boundsMin = glm::min(boundsMin, p);
+            boundsMax = glm::max(boundsMax, p);
+        }
+        void grow(const BuildBounds &b)
+        {
+            boundsMin = glm::min(boundsMin, b.boundsMin);
+            boundsMax = glm::max(boundsMax, b.boundsMax);
+        }
+        float area() const
+        {
+            const glm::vec3 e = glm::max(boundsMax - boundsMin, glm::vec3(0.0f));
+            return e.x * e.y + e.y * e.z + e.z * e.x;
+        }
+    };
+}
+
+void Bvh::build(const std::vector<glm::vec3> &trianglePositions)
+{
+    const std::size_t count = trianglePositions.size() / 3;
+    nodes.clear();
+    triangles.clear();
+    triangleIds.clear();
+    if (count == 0)
+        return;
+
+    std::vector<BuildBounds> bounds(count);
+    std::vector<glm::vec3> centroids(count);
+    std::vector<std::int32_t> order(count);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        for (int k = 0; k < 3; k++)
+            bounds[i].grow(trianglePositions[i * 3 + k]);
+        centroids[i] = (bounds[i].boundsMin + bounds[i].boundsMax) * 0.5f;
+        order[i] = static_cast<std::int32_t>(i);
+    }
+
+    struct Task
+    {
+        std::uint32_t node;
+        std::size_t begin;
+        std::size_t end;
+    };
+    nodes.reserve(2 * count);
+    nodes.push_back({});
+    std::vector<Task> tasks = {{0, 0, count}};
+
+    while (!tasks.empty())
+    {
+        const Task task = tasks.back();
+        tasks.pop_back();
+
+        BuildBounds nodeBounds;
+        BuildBounds centroidBounds;
+        for (std::size_t i = task.begin; i < task.end; i++)
+        {
+            nodeBounds.grow(bounds[order[i]]);
+            centroidBounds.grow(centroids[order[i]]);
+        }
+        Node &node = nodes[task.node];
+        node.boundsMin = nodeBounds.boundsMin;
+        node.boundsMax = nodeBounds.boundsMax;
+
+        const std::size_t size = task.end - task.begin;
+        const auto makeLeaf = [&]() {
+            node.firstOrLeft = static_cast<std::uint32_t>(task.begin);
+            node.count = static_cast<std::uint16_t>(size);
+            node.axis = 0;
+        };
+        if (size <= 2)
+        {
+            makeLeaf();
+            continue;
+        }
+
+        // Binned SAH over the centroid bounds of every axis
+        float bestCost = std::numeric_limits<float>::max();
+        int bestAxis = -1;
+        int bestSplit = 0;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            const float lo = centroidBounds.boundsMin[axis];
+            const float extent = centroidBounds.boundsMax[axis] - lo;
+            if (extent <= 0.0f)
+                continue;
+            const float binScale = kBinCount / extent;
+
+            std::array<BuildBounds, kBinCount> binBounds;
+            std::array<std::size_t, kBinCount> binCounts{};
+            for (std::size_t i = task.begin; i < task.end; i++)
+            {
+                const int bin = std::min(kBinCount - 1, static_cast<int>((centroids[order[i]][axis] - lo) * binScale));
+                binBounds[bin].grow(bounds[order[i]]);
+                binCounts[bin]++;
+            }
+
+            std::array<float, kBinCount - 1> leftCost{};
+            BuildBounds sweep;
+            std::size_t sweepCount = 0;
+            for (int split = 0; split < kBinCount - 1; split++)
+            {
+                sweep.grow(binBounds[split]);
+                sweepCount += binCounts[split];
+                leftCost[split] = sweep.area() * static_cast<float>(sweepCount);
+            }
+            sweep = BuildBounds{};
+            sweepCount = 0;
+            for (int split = kBinCount - 1; split > 0; split--)
+            {
+                sweep.grow(binBounds[split]);
+                sweepCount += binCounts[split];
+                const float cost = leftCost[split - 1] + sweep.area() * static_cast<float>(sweepCount);
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = split;
+                }
+            }
+        }
+
+        // Leaf cost is one intersection per triangle against one traversal step
+        const float leafCost = static_cast<float>(size) * nodeBounds.area();
+        if ((bestAxis < 0 || bestCost >= leafCost) && size <= kMaxLeafSize)
+        {
+            makeLeaf();
+            continue;
+        }
+
+        std::size_t middle = task.begin + size / 2;
+        int axis = bestAxis;
+        if (bestAxis >= 0)
+        {
+            const float lo = centroidBounds.boundsMin[axis];
+            const float binScale = kBinCount / (centroidBounds.boundsMax[axis] - lo);
+            const auto split = std::partition(order.begin() + task.begin, order.begin() + task.end, [&](std::int32_t id) {
+                return std::min(kBinCount - 1, static_cast<int>((centroids[id][axis] - lo) * binScale)) < bestSplit;
+            });
+            middle = static_cast<std::size_t>(split - order.begin());
+        }
+        else
+        {
+            // All centroids coincide: split the range in half
+            axis = 0;
+        }
+        if (middle == task.begin || middle == task.end)
+            middle = task.begin + size / 2;
+
+        const auto left = static_cast<std::uint32_t>(nodes.size());
+        node.firstOrLeft = left;
+        node.count = 0;
+        node.axis = static_cast<std::uint16_t>(axis);
+        nodes.push_back({});
+        nodes.push_back({});
+        tasks.push_back({left, task.begin, middle});
+        tasks.push_back({left + 1, middle, task.end});
+    }
+
+    triangles.resize(count);
+    triangleIds = order;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        const glm::vec3 *p = &trianglePositions[static_cast<std::size_t>(order[i]) * 3];
+        triangles[i] = {p[0], p[1] - p[0], p[2] - p[0]};
+    }
+}
+
+void Bvh::intersect(const RayPacket4 &packet, PacketHit4 &hit) const
+{
+    traverse<false>(packet, &hit);
+}
+
+int Bvh::occluded(const RayPacket4 &packet) const
+{
+    return traverse<true>(packet, nullptr);
+}
+
+template <bool AnyHit>
+int Bvh::traverse(const RayPacket4 &packet, PacketHit4 *hit) const
+{
+    const F4 ox = load(packet.originX);
+    const F4 oy = load(packet.originY);
+    const F4 oz = load(packet.originZ);
+    const F4 dx = load(packet.directionX);
+    const F4 dy = load(packet.directionY);
+    const F4 dz = load(packet.directionZ);
+    const F4 one = splat(1.0f);
+    const F4 zero = splat(0.0f);
+    const F4 invX = one / dx;
+    const F4 invY = one / dy;
+    const F4 invZ = one / dz;
+
+    F4 closest = load(packet.tMax);
+    const int activeLanes = laneMask(closest > zero);
+    F4 hitU = zero;
+    F4 hitV = zero;
+    std::int32_t hitTriangle[4] = {-1, -1, -1, -1};
+    int hitLanes = 0;
+
+    // Near child first along the packet's mean direction
+    float directionSum[3] = {0.0f, 0.0f, 0.0f};
+    for (int lane = 0; lane < 4; lane++)
+    {
+        directionSum[0] += packet.directionX[lane];
+        directionSum[1] += packet.directionY[lane];
+        directionSum[2] += packet.directionZ[lane];
+    }
+
+    if (activeLanes != 0 && !nodes.empty())
+    {
+        std::uint32_t stack[kMaxStackDepth];
+        int stackSize = 0;
+        stack[stackSize++] = 0;
+        while (stackSize > 0)
+        {
+            const Node &node = nodes[stack[--stackSize]];
+
+            // Slab test for all four rays against the node box
+            const F4 tx0 = (splat(node.boundsMin.x) - ox) * invX;
+            const F4 tx1 = (splat(node.boundsMax.x) - ox) * invX;
+            const F4 ty0 = (splat(node.boundsMin.y) - oy) * invY;
+            const F4 ty1 = (splat(node.boundsMax.y) - oy) * invY;
+            const F4 tz0 = (splat(node.boundsMin.z) - oz) * invZ;
+            const F4 tz1 = (splat(node.boundsMax.z) - oz) * invZ;
+            const F4 tEnter = max(max(min(tx0, tx1), min(ty0, ty1)), max(min(tz0, tz1), zero));
+            const F4 tExit = min(min(max(tx0, tx1), max(ty0, ty1)), min(max(tz0, tz1), closest));
+            if ((laneMask(tEnter <= tExit) & activeLanes & ~(AnyHit ? hitLanes : 0)) == 0)
+                continue;
+
+            if (node.count == 0)
+            {
+                const bool leftFirst = directionSum[node.axis] >= 0.0f;
+                if (stackSize + 2 > kMaxStackDepth)
+                    continue;
+                stack[stackSize++] = leftFirst ? node.firstOrLeft + 1 : node.firstOrLeft;
+                stack[stackSize++] = leftFirst ? node.firstOrLeft : node.firstOrLeft + 1;
+                continue;
+            }
+
+            for (std::uint32_t i = node.firstOrLeft; i < node.firstOrLeft + node.count; i++)
+            {
+                const Triangle &tri = triangles[i];
+                const F4 e1x = splat(tri.edge1.x), e1y = splat(tri.edge1.y), e1z = splat(tri.edge1.z);
+                const F4 e2x = splat(tri.edge2.x), e2y = splat(tri.edge2.y), e2z = splat(tri.edge2.z);
+                const F4 px = dy * e2z - dz * e2y;
+                const F4 py = dz * e2x - dx * e2z;
+                const F4 pz = dx * e2y - dy * e2x;
+                const F4 det = e1x * px + e1y * py + e1z * pz;
+                const F4 invDet = one / det;
+                const F4 sx = ox - splat(tri.v0.x);
+                const F4 sy = oy - splat(tri.v0.y);
+                const F4 sz = oz - splat(tri.v0.z);
+                const F4 u = (sx * px + sy * py + sz * pz) * invDet;
+                const F4 qx = sy * e1z - sz * e1y;
+                const F4 qy = sz * e1x - sx * e1z;
+                const F4 qz = sx * e1y - sy * e1x;
+                const F4 v = (dx * qx + dy * qy + dz * qz) * invDet;
+                const F4 t = (e2x * qx + e2y * qy + e2z * qz) * invDet;
+                const F4 accept = (abs(det) > splat(kTriangleEpsilon)) & (u >= zero) & (v >= zero) & (u + v <= one) &
+                                  (t > zero) & (t < closest);
+                const int lanesHit = laneMask(accept) & activeLanes;
+                if (lanesHit == 0)
+                    continue;
+
+                hitLanes |= lanesHit;
+                if (AnyHit)
+                {
+                    if (hitLanes == activeLanes)
+                        return hitLanes;
+                    continue;
+                }
+                closest = select(accept, t, closest);
+                hitU = select(accept, u, hitU);
+                hitV = select(accept, v, hitV);
+                for (int lane = 0; lane < 4; lane++)
+                {
+                    if (lanesHit & (1 << lane))
+                        hitTriangle[lane] = triangleIds[i];
+                }
+            }
+        }
+    }
+
+    if (!AnyHit)
+    {
+        store(hit->t, closest);
+        store(hit->u, hitU);
+        store(hit->v, hitV);
+        std::copy(hitTriangle, hitTriangle + 4, hit->triangle);
+    }
+    return hitLanes;
+}
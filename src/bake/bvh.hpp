@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Four rays traced together. Lanes whose tMax is <= 0 are inactive.
+struct RayPacket4
+{
+    float originX[4];
+    float originY[4];
+    float originZ[4];
+    float directionX[4];
+    float directionY[4];
+    float directionZ[4];
+    float tMax[4];
+};
+
+struct PacketHit4
+{
+    float t[4];
+    float u[4]; // barycentrics of vertex 1 and 2
+    float v[4];
+    std::int32_t triangle[4]; // -1 = miss
+};
+
+// Bounding volume hierarchy over static triangles, built with binned SAH.
+// Traversal tests four rays per node and per triangle with SSE (scalar lanes
+// otherwise); packets work best when the rays share an origin, as the
+// lightmap baker's shadow and gather rays do. Triangles are two-sided.
+class Bvh
+{
+public:
+    // Three positions per triangle; triangle indices in hits refer to this order
+    void build(const std::vector<glm::vec3> &trianglePositions);
+
+    std::size_t triangleCount() const { return triangles.size(); }
+    std::size_t nodeCount() const { return nodes.size(); }
+
+    // Closest hit per lane within (0, tMax]
+    void intersect(const RayPacket4 &packet, PacketHit4 &hit) const;
+    // Bit i is set when lane i hits anything before its tMax
+    int occluded(const RayPacket4 &packet) const;
+
+private:
+    struct Node
+    {
+        glm::vec3 boundsMin;
+        std::uint32_t firstOrLeft; // first triangle of a leaf, left child of an inner node
+        glm::vec3 boundsMax;
+        std::uint16_t count;       // triangles in a leaf, 0 for inner nodes
+        std::uint16_t axis;        // split axis of an inner node; the right child is left + 1
+    };
+
+    // Moller-Trumbore form, stored in leaf order
+    struct Triangle
+    {
+        glm::vec3 v0;
+        glm::vec3 edge1;
+        glm::vec3 edge2;
+    };
+
+    template <bool AnyHit>
+    int traverse(const RayPacket4 &packet, PacketHit4 *hit) const;
+
+    std::vector<Node> nodes;
+    std::vector<Triangle> triangles;
+    std::vector<std::int32_t> triangleIds; // leaf order -> input index
+};
@@ -0,0 +1,313 @@
+#include "bake/impostor_baker.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <utility>
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "shader.hpp"
+
+namespace
+{
+    constexpr std::uint32_t kCacheMagic = 0x504d4949u; // "IIMP"
+    constexpr std::uint32_t kCacheVersion = 1;
+    constexpr int kDilateIterations = 4;
+    constexpr std::uint8_t kEmptyDepth = 255; // background: as far as the sphere reaches
+
+    std::uint64_t fnv1a(std::uint64_t hash, const void *data, std::size_t bytes)
+    {
+        const auto *p = static_cast<const std::uint8_t *>(data);
+        for (std::size_t i = 0; i < bytes; i++)
+        {
+            hash ^= p[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // Bounding sphere around the oriented mesh bounds: center and radius
+    glm::vec4 orientedSphere(const ImpostorSource &source, float &baseHeight)
+    {
+        glm::vec3 lo(std::numeric_limits<float>::max());
+        glm::vec3 hi(-std::numeric_limits<float>::max());
+        for (int corner = 0; corner < 8; corner++)
+        {
+            const glm::vec3 p((corner & 1) ? source.mesh->boundsMax.x : source.mesh->boundsMin.x,
+                              (corner & 2) ? source.mesh->boundsMax.y : source.mesh->boundsMin.y,
+                              (corner & 4) ? source.mesh->boundsMax.z : source.mesh->boundsMin.z);
+            const glm::vec3 oriented = source.orientation * p;
+            lo = glm::min(lo, oriented);
+            hi = glm::max(hi, oriented);
+        }
+        baseHeight = lo.y;
+        return glm::vec4((lo + hi) * 0.5f, std::max(glm::length(hi - lo) * 0.5f, 1e-3f));
+    }
+
+    // Spreads covered texels' colors (and normals) into empty neighbours of
+    // the same tile, keeping their coverage and depth empty
+    void dilateTile(std::vector<std::uint8_t> &albedo, std::vector<std::uint8_t> &normalDepth, std::size_t layerOffset,
+                    int atlasSize, int tileX, int tileY, int resolution)
+    {
+        std::vector<std::uint8_t> filled(static_cast<std::size_t>(resolution) * resolution);
+        for (int y = 0; y < resolution; y++)
+            for (int x = 0; x < resolution; x++)
+            {
+                const std::size_t texel =
+                    layerOffset + (static_cast<std::size_t>(tileY * resolution + y) * atlasSize + tileX * resolution + x);
+                filled[static_cast<std::size_t>(y) * resolution + x] = albedo[texel * 4 + 3] > 0 ? 1 : 0;
+            }
+
+        std::vector<std::uint8_t> next;
+        for (int iteration = 0; iteration < kDilateIterations; iteration++)
+        {
+            next = filled;
+            for (int y = 0; y < resolution; y++)
+                for (int x = 0; x < resolution; x++)
+                {
+                    if (filled[static_cast<std::size_t>(y) * resolution + x])
+                        continue;
+                    const int neighbours[4][2] = {{x - 1, y}, {x + 1, y}, {x, y - 1}, {x, y + 1}};
+                    for (const auto &n : neighbours)
+                    {
+                        if (n[0] < 0 || n[1] < 0 || n[0] >= resolution || n[1] >= resolution ||
+                            !filled[static_cast<std::size_t>(n[1]) * resolution + n[0]])
+                            continue;
+                        const auto texelOf = [&](int tx, int ty) {
+                            return layerOffset + (static_cast<std::size_t>(tileY * resolution + ty) * atlasSize +
+                                                  tileX * resolution + tx);
+                        };
+                        const std::size_t to = texelOf(x, y);
+                        const std::size_t from = texelOf(n[0], n[1]);
+                        for (int c = 0; c < 3; c++)
+                        {
+                            albedo[to * 4 + c] = albedo[from * 4 + c];
+                            normalDepth[to * 4 + c] = normalDepth[from * 4 + c];
+                        }
+                        next[static_cast<std::size_t>(y) * resolution + x] = 1;
+                        break;
+                    }
+                }
+            filled.swap(next);
+        }
+    }
+}
+
+bool ImpostorAtlasData::save(const std::filesystem::path &path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    const std::int32_t header[3] = {resolution, frames, layers()};
+    const std::uint64_t atlasBytes = albedo.size();
+    file.write(reinterpret_cast<const char *>(&kCacheMagic), sizeof(kCacheMagic));
+    file.write(reinterpret_cast<const char *>(&kCacheVersion), sizeof(kCacheVersion));
+    file.write(reinterpret_cast<const char *>(&key), sizeof(key));
+    file.write(reinterpret_cast<const char *>(header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(spheres.data()),
+               static_cast<std::streamsize>(spheres.size() * sizeof(glm::vec2)));
+    file.write(reinterpret_cast<const char *>(&atlasBytes), sizeof(atlasBytes));
+    file.write(reinterpret_cast<const char *>(albedo.data()), static_cast<std::streamsize>(albedo.size()));
+    file.write(reinterpret_cast<const char *>(normalDepth.data()), static_cast<std::streamsize>(normalDepth.size()));
+    return static_cast<bool>(file);
+}
+
+bool ImpostorAtlasData::load(const std::filesystem::path &path, std::uint64_t expectedKey)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    std::uint32_t magic = 0;
+    std::uint32_t version = 0;
+    std::uint64_t fileKey = 0;
+    std::int32_t header[3] = {0, 0, 0};
+    file.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+    file.read(reinterpret_cast<char *>(&version), sizeof(version));
+    file.read(reinterpret_cast<char *>(&fileKey), sizeof(fileKey));
+    file.read(reinterpret_cast<char *>(header), sizeof(header));
+    if (!file || magic != kCacheMagic || version != kCacheVersion || fileKey != expectedKey || header[0] <= 0 ||
+        header[1] < 2 || header[2] <= 0)
+        return false;
+
+    std::vector<glm::vec2> fileSpheres(static_cast<std::size_t>(header[2]));
+    std::uint64_t atlasBytes = 0;
+    file.read(reinterpret_cast<char *>(fileSpheres.data()),
+              static_cast<std::streamsize>(fileSpheres.size() * sizeof(glm::vec2)));
+    file.read(reinterpret_cast<char *>(&atlasBytes), sizeof(atlasBytes));
+    const std::uint64_t size = static_cast<std::uint64_t>(header[0]) * header[1];
+    if (!file || atlasBytes != size * size * 4u * static_cast<std::uint64_t>(header[2]))
+        return false;
+    std::vector<std::uint8_t> fileAlbedo(atlasBytes);
+    std::vector<std::uint8_t> fileNormalDepth(atlasBytes);
+    file.read(reinterpret_cast<char *>(fileAlbedo.data()), static_cast<std::streamsize>(atlasBytes));
+    file.read(reinterpret_cast<char *>(fileNormalDepth.data()), static_cast<std::streamsize>(atlasBytes));
+    if (!file)
+        return false;
+
+    resolution = header[0];
+    frames = header[1];
+    key = fileKey;
+    spheres = std::move(fileSpheres);
+    albedo = std::move(fileAlbedo);
+    normalDepth = std::move(fileNormalDepth);
+    return true;
+}
+
+std::uint64_t impostorCacheKey(const std::vector<ImpostorSource> &sources, const ImpostorSettings &settings)
+{
+    std::uint64_t hash = 14695981039346656037ull;
+    hash = fnv1a(hash, &kCacheVersion, sizeof(kCacheVersion));
+    hash = fnv1a(hash, &settings.resolution, sizeof(settings.resolution));
+    hash = fnv1a(hash, &settings.frames, sizeof(settings.frames));
+    for (const ImpostorSource &source : sources)
+    {
+        hash = fnv1a(hash, &source.orientation, sizeof(source.orientation));
+        hash = fnv1a(hash, source.mesh->vertices.data(), source.mesh->vertices.size() * sizeof(Vertex));
+        hash = fnv1a(hash, source.mesh->indices.data(), source.mesh->indices.size() * sizeof(unsigned int));
+        for (const Texture &texture : source.mesh->textures)
+            hash = fnv1a(hash, texture.path.data(), texture.path.size());
+    }
+    return hash;
+}
+
+std::size_t impostorBytes(int resolution, int frames)
+{
+    // Two RGBA8 atlases; a full mip chain adds a third
+    const std::size_t size = static_cast<std::size_t>(resolution) * frames;
+    return size * size * 4u * 2u * 4u / 3u;
+}
+
+glm::vec3 impostorFrameDirection(int x, int y, int frames)
+{
+    // Hemi-octahedral decode of the grid point in [-1, 1]^2
+    const glm::vec2 p = glm::vec2(x, y) / static_cast<float>(frames - 1) * 2.0f - 1.0f;
+    const float dx = (p.x + p.y) * 0.5f;
+    const float dz = (p.x - p.y) * 0.5f;
+    return glm::normalize(glm::vec3(dx, 1.0f - std::abs(dx) - std::abs(dz), dz));
+}
+
+bool bakeImpostors(const std::vector<ImpostorSource> &sources, const ImpostorSettings &settings,
+                   const std::filesystem::path &shaderRoot, ImpostorAtlasData &out)
+{
+    if (sources.empty() || settings.resolution <= 0 || settings.frames < 2)
+        return false;
+
+    Shader bakeShader((shaderRoot / "impostor_bake.vert").string().c_str(),
+                      (shaderRoot / "impostor_bake.frag").string().c_str());
+    if (bakeShader.ID == 0)
+        return false;
+
+    const int atlasSize = settings.resolution * settings.frames;
+    GLuint targets[2] = {0, 0};
+    GLuint depth = 0;
+    GLuint fbo = 0;
+    glGenTextures(2, targets);
+    const GLenum formats[2] = {GL_SRGB8_ALPHA8, GL_RGBA8};
+    for (int i = 0; i < 2; i++)
+    {
+        glBindTexture(GL_TEXTURE_2D, targets[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, formats[i], atlasSize, atlasSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glGenRenderbuffers(1, &depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, atlasSize, atlasSize);
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, targets[0], 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, targets[1], 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+    const GLenum drawBuffers[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(2, drawBuffers);
+    const bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+    const std::size_t layerBytes = static_cast<std::size_t>(atlasSize) * atlasSize * 4u;
+    out = ImpostorAtlasData{};
+    out.resolution = settings.resolution;
+    out.frames = settings.frames;
+    out.key = impostorCacheKey(sources, settings);
+    out.albedo.resize(layerBytes * sources.size());
+    out.normalDepth.resize(layerBytes * sources.size());
+
+    if (complete)
+    {
+        // Albedo goes through the sRGB encode, like the source textures came in
+        glEnable(GL_FRAMEBUFFER_SRGB);
+        glEnable(GL_DEPTH_TEST);
+        glDepthFunc(GL_LESS);
+        bakeShader.use();
+        bakeShader.setInt("material.diffuse", 0);
+        for (std::size_t layer = 0; layer < sources.size(); layer++)
+        {
+            const ImpostorSource &source = sources[layer];
+            float baseHeight = 0.0f;
+            const glm::vec4 sphere = orientedSphere(source, baseHeight);
+            const float radius = sphere.w;
+            out.spheres.emplace_back(radius, sphere.y - baseHeight);
+
+            glViewport(0, 0, atlasSize, atlasSize);
+            const GLfloat clearAlbedo[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+            const GLfloat clearNormal[4] = {0.5f, 0.5f, 1.0f, 1.0f};
+            glClearBufferfv(GL_COLOR, 0, clearAlbedo);
+            glClearBufferfv(GL_COLOR, 1, clearNormal);
+            glClear(GL_DEPTH_BUFFER_BIT);
+
+            // Building space: the oriented mesh around its sphere's center
+            const glm::mat4 model =
+                glm::translate(glm::mat4(1.0f), -glm::vec3(sphere)) * glm::mat4(source.orientation);
+            bakeShader.setMat4("model", model);
+            bakeShader.setMat4("normalMatrix", glm::mat4(glm::transpose(glm::inverse(source.orientation))));
+            bakeShader.setMat4("projection", glm::ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * radius));
+            for (int y = 0; y < settings.frames; y++)
+                for (int x = 0; x < settings.frames; x++)
+                {
+                    const glm::vec3 direction = impostorFrameDirection(x, y, settings.frames);
+                    const glm::vec3 up = std::abs(direction.y) > 0.999f ? glm::vec3(0.0f, 0.0f, -1.0f)
+                                                                        : glm::vec3(0.0f, 1.0f, 0.0f);
+                    glViewport(x * settings.resolution, y * settings.resolution, settings.resolution,
+                               settings.resolution);
+                    bakeShader.setMat4("view", glm::lookAt(direction * radius, glm::vec3(0.0f), up));
+                    source.mesh->Draw(bakeShader);
+                }
+
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glReadBuffer(GL_COLOR_ATTACHMENT0);
+            glReadPixels(0, 0, atlasSize, atlasSize, GL_RGBA, GL_UNSIGNED_BYTE, out.albedo.data() + layer * layerBytes);
+            glReadBuffer(GL_COLOR_ATTACHMENT1);
+            glReadPixels(0, 0, atlasSize, atlasSize, GL_RGBA, GL_UNSIGNED_BYTE,
+                         out.normalDepth.data() + layer * layerBytes);
+        }
+        glDisable(GL_FRAMEBUFFER_SRGB);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteRenderbuffers(1, &depth);
+    glDeleteTextures(2, targets);
+    if (!complete)
+    {
+        std::cerr << "Impostor bake framebuffer incomplete" << std::endl;
+        out = ImpostorAtlasData{};
+        return false;
+    }
+
+    for (std::size_t layer = 0; layer < sources.size(); layer++)
+    {
+        for (int y = 0; y < settings.frames; y++)
+            for (int x = 0; x < settings.frames; x++)
+                dilateTile(out.albedo, out.normalDepth, layer * layerBytes / 4u, atlasSize, x, y, settings.resolution);
+    }
+    // Empty texels keep the far depth, whatever the dilation copied into their normals
+    for (std::size_t texel = 0; texel < out.albedo.size() / 4u; texel++)
+    {
+        if (out.albedo[texel * 4 + 3] == 0)
+            out.normalDepth[texel * 4 + 3] = kEmptyDepth;
+    }
+    return true;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+
+struct ImpostorSettings
+{
+    bool enabled = true;
+    int resolution = 64;        // texels per view, per side
+    int frames = 8;             // views per side of the hemi-octahedral grid
+    int buildings = 8;          // tallest distinct city meshes baked
+    int skylineCount = 96;      // impostor instances placed around the city
+    float innerRadius = 70.0f;  // skyline ring, from the city's center
+    float outerRadius = 180.0f;
+    unsigned int seed = 7u;
+};
+
+// A mesh to bake, in its first placement's orientation and scale (no translation)
+struct ImpostorSource
+{
+    Mesh *mesh = nullptr;
+    glm::mat3 orientation{1.0f};
+};
+
+// Baked views, one 2D array layer per source. A layer holds frames x frames
+// tiles of resolution^2 texels; tile (x, y) sees the building from the
+// hemi-octahedral direction at grid point (x, y). Albedo is sRGB with
+// coverage in alpha; the second atlas holds the normal (building space,
+// 0.5 + 0.5 n) and in alpha the depth along the view over the bounding
+// sphere's diameter (0 = nearest).
+struct ImpostorAtlasData
+{
+    int resolution = 0;
+    int frames = 0;
+    std::uint64_t key = 0;
+    std::vector<glm::vec2> spheres; // per layer: bounding radius, height of its center above the base
+    std::vector<std::uint8_t> albedo;
+    std::vector<std::uint8_t> normalDepth;
+
+    int layers() const { return static_cast<int>(spheres.size()); }
+    int atlasSize() const { return resolution * frames; }
+
+    bool save(const std::filesystem::path &path) const;
+    // False when the file is missing, corrupt or was baked from other meshes/settings
+    bool load(const std::filesystem::path &path, std::uint64_t expectedKey);
+};
+
+// Identifies a bake: source geometry, orientations, resolution and frame count
+std::uint64_t impostorCacheKey(const std::vector<ImpostorSource> &sources, const ImpostorSettings &settings);
+
+// GPU memory of one impostor (both atlases with their mips)
+std::size_t impostorBytes(int resolution, int frames);
+
+// Unit direction of a hemi-octahedral grid point, x and y in [0, frames - 1]
+glm::vec3 impostorFrameDirection(int x, int y, int frames);
+
+// Renders every source from each grid direction with an orthographic camera
+// framing its bounding sphere, then reads both atlases back and dilates the
+// colors into the empty texels so mips do not bleed the background in. Needs
+// a current GL 3.3 context (a hidden window is enough); leaves the default
+// framebuffer bound.
+bool bakeImpostors(const std::vector<ImpostorSource> &sources, const ImpostorSettings &settings,
+                   const std::filesystem::path &shaderRoot, ImpostorAtlasData &out);
@@ -0,0 +1,742 @@
+#include "bake/lightmap_baker.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <utility>
+
+#include "bake/bvh.hpp"
+#include "core/job_system.hpp"
+
+namespace
+{
+    constexpr std::uint32_t kCacheMagic = 0x50414d4cu; // "LMAP"
+    constexpr std::uint32_t kCacheVersion = 1;
+    constexpr int kLampCount = LightmapBakeInput::kLampCount;
+    constexpr int kChannels = kLampCount + 1; // lamps, then sky
+    constexpr int kSkyChannel = kLampCount;
+
+    constexpr float kPi = 3.14159265358979f;
+    constexpr float kRayOffset = 2e-3f;        // ray origins are pushed off the surface, world units
+    constexpr float kFarDistance = 1e4f;
+    constexpr float kMinContribution = 1e-3f;  // dimmer lamps cast no shadow rays
+    constexpr float kBackfaceLimit = 0.25f;    // share of gather rays hitting back faces before a texel counts as buried
+    constexpr float kEdgeCoverage = 0.7072f;   // half a texel diagonal: triangle touches the texel square
+    constexpr int kDenoiseIterations = 3;
+    constexpr int kDilateIterations = 2;
+    constexpr std::size_t kRowGrain = 4;
+
+    // Coverage of a texel by the rasterized charts
+    constexpr std::uint8_t kEmpty = 0;
+    constexpr std::uint8_t kEdge = 1;     // triangle only touches the texel; sampled at its closest point
+    constexpr std::uint8_t kInterior = 2; // texel center lies inside a triangle
+    constexpr std::uint8_t kBuried = 3;   // covered, but sees mostly back faces (inside geometry)
+
+    float elapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::uint32_t hash32(std::uint32_t x)
+    {
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return x;
+    }
+
+    // PCG-style generator, one per texel so the bake is deterministic for any thread count
+    struct Random
+    {
+        std::uint32_t state;
+
+        float next()
+        {
+            state = state * 747796405u + 2891336453u;
+            std::uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+            word = (word >> 22u) ^ word;
+            return static_cast<float>(word >> 8) * (1.0f / 16777216.0f);
+        }
+    };
+
+    int laneCount(int mask)
+    {
+        int count = 0;
+        for (; mask != 0; mask &= mask - 1)
+            count++;
+        return count;
+    }
+
+    // Orthonormal basis around a unit normal (Duff et al. 2017)
+    void makeBasis(const glm::vec3 &n, glm::vec3 &tangent, glm::vec3 &bitangent)
+    {
+        const float sign = std::copysign(1.0f, n.z);
+        const float a = -1.0f / (sign + n.z);
+        const float b = n.x * n.y * a;
+        tangent = glm::vec3(1.0f + sign * n.x * n.x * a, sign * b, -sign * n.x);
+        bitangent = glm::vec3(b, sign + n.y * n.y * a, -n.y);
+    }
+
+    float cross2(const glm::vec2 &a, const glm::vec2 &b)
+    {
+        return a.x * b.y - a.y * b.x;
+    }
+
+    // Closest point of a 2D triangle's edges to p, as barycentrics; returns the distance
+    float closestOnEdges(const glm::vec2 corner[3], const glm::vec2 &p, glm::vec3 &barycentric)
+    {
+        float best = std::numeric_limits<float>::max();
+        for (int e = 0; e < 3; e++)
+        {
+            const glm::vec2 &a = corner[e];
+            const glm::vec2 &b = corner[(e + 1) % 3];
+            const glm::vec2 ab = b - a;
+            const float lengthSq = glm::dot(ab, ab);
+            const float s = lengthSq > 0.0f ? glm::clamp(glm::dot(p - a, ab) / lengthSq, 0.0f, 1.0f) : 0.0f;
+            const float distance = glm::length(p - (a + ab * s));
+            if (distance < best)
+            {
+                best = distance;
+                barycentric = glm::vec3(0.0f);
+                barycentric[e] = 1.0f - s;
+                barycentric[(e + 1) % 3] = s;
+            }
+        }
+        return best;
+    }
+
+    std::uint8_t quantize(float value, float invScale)
+    {
+        const float encoded = std::sqrt(glm::clamp(value * invScale, 0.0f, 1.0f));
+        return static_cast<std::uint8_t>(std::lround(encoded * 255.0f));
+    }
+
+    // BC4 (one RGTC channel): endpoints are the block's max and min, every
+    // texel picks the nearest of the eight interpolated values
+    void encodeBc4(const std::uint8_t values[16], std::uint8_t *out)
+    {
+        const std::uint8_t high = *std::max_element(values, values + 16);
+        const std::uint8_t low = *std::min_element(values, values + 16);
+        out[0] = high;
+        out[1] = low;
+        std::uint64_t bits = 0;
+        if (high > low)
+        {
+            int palette[8];
+            palette[0] = high;
+            palette[1] = low;
+            for (int i = 2; i < 8; i++)
+                palette[i] = ((8 - i) * high + (i - 1) * low + 3) / 7;
+            for (int texel = 0; texel < 16; texel++)
+            {
+                int bestIndex = 0;
+                int bestError = 256;
+                for (int i = 0; i < 8; i++)
+                {
+                    const int error = std::abs(palette[i] - values[texel]);
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        bestIndex = i;
+                    }
+                }
+                bits |= static_cast<std::uint64_t>(bestIndex) << (3 * texel);
+            }
+        }
+        for (int i = 0; i < 6; i++)
+            out[2 + i] = static_cast<std::uint8_t>(bits >> (8 * i));
+    }
+
+    std::uint64_t fnv1a(std::uint64_t hash, const void *data, std::size_t bytes)
+    {
+        const auto *p = static_cast<const std::uint8_t *>(data);
+        for (std::size_t i = 0; i < bytes; i++)
+        {
+            hash ^= p[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    template <typename T>
+    std::uint64_t fnv1a(std::uint64_t hash, const std::vector<T> &values)
+    {
+        return fnv1a(hash, values.data(), values.size() * sizeof(T));
+    }
+}
+
+bool LightmapData::save(const std::filesystem::path &path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    const std::int32_t header[2] = {size, kLayerCount};
+    const float scales[2] = {lampScale, skyScale};
+    const std::uint64_t blockBytes = blocks.size();
+    file.write(reinterpret_cast<const char *>(&kCacheMagic), sizeof(kCacheMagic));
+    file.write(reinterpret_cast<const char *>(&kCacheVersion), sizeof(kCacheVersion));
+    file.write(reinterpret_cast<const char *>(&key), sizeof(key));
+    file.write(reinterpret_cast<const char *>(header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(scales), sizeof(scales));
+    file.write(reinterpret_cast<const char *>(&blockBytes), sizeof(blockBytes));
+    file.write(reinterpret_cast<const char *>(blocks.data()), static_cast<std::streamsize>(blocks.size()));
+    return static_cast<bool>(file);
+}
+
+bool LightmapData::load(const std::filesystem::path &path, std::uint64_t expectedKey)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    std::uint32_t magic = 0;
+    std::uint32_t version = 0;
+    std::uint64_t fileKey = 0;
+    std::int32_t header[2] = {0, 0};
+    float scales[2] = {1.0f, 1.0f};
+    std::uint64_t blockBytes = 0;
+    file.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+    file.read(reinterpret_cast<char *>(&version), sizeof(version));
+    file.read(reinterpret_cast<char *>(&fileKey), sizeof(fileKey));
+    file.read(reinterpret_cast<char *>(header), sizeof(header));
+    file.read(reinterpret_cast<char *>(scales), sizeof(scales));
+    file.read(reinterpret_cast<char *>(&blockBytes), sizeof(blockBytes));
+    if (!file || magic != kCacheMagic || version != kCacheVersion || fileKey != expectedKey ||
+        header[1] != kLayerCount || header[0] <= 0 || header[0] % 4 != 0)
+        return false;
+
+    // 16 bytes per 4x4 block and layer
+    const std::uint64_t expectedBytes = static_cast<std::uint64_t>(header[0] / 4) * (header[0] / 4) * 16u * kLayerCount;
+    if (blockBytes != expectedBytes)
+        return false;
+    std::vector<std::uint8_t> data(blockBytes);
+    file.read(reinterpret_cast<char *>(data.data()), static_cast<std::streamsize>(blockBytes));
+    if (!file)
+        return false;
+
+    size = header[0];
+    lampScale = scales[0];
+    skyScale = scales[1];
+    key = fileKey;
+    blocks = std::move(data);
+    return true;
+}
+
+std::uint64_t lightmapCacheKey(const LightmapBakeInput &input, const LightmapSettings &settings)
+{
+    std::uint64_t hash = 14695981039346656037ull;
+    hash = fnv1a(hash, &kCacheVersion, sizeof(kCacheVersion));
+    hash = fnv1a(hash, &input.atlasSize, sizeof(input.atlasSize));
+    hash = fnv1a(hash, &input.texelsPerUnit, sizeof(input.texelsPerUnit));
+    hash = fnv1a(hash, input.positions);
+    hash = fnv1a(hash, input.normals);
+    hash = fnv1a(hash, input.uvs);
+    hash = fnv1a(hash, input.albedo);
+    hash = fnv1a(hash, input.lampPositions.data(), sizeof(input.lampPositions));
+    hash = fnv1a(hash, &input.lampRadius, sizeof(input.lampRadius));
+    hash = fnv1a(hash, &input.lampAttenuation, sizeof(input.lampAttenuation));
+    const std::int32_t bakeSettings[3] = {settings.samples, settings.bounces, settings.denoise ? 1 : 0};
+    return fnv1a(hash, bakeSettings, sizeof(bakeSettings));
+}
+
+LightmapBaker::~LightmapBaker()
+{
+    cancelRequested = true;
+    if (worker.joinable())
+        worker.join();
+}
+
+bool LightmapBaker::start(LightmapBakeInput input, const LightmapSettings &settings)
+{
+    if (running.load())
+        return false;
+    if (worker.joinable())
+        worker.join();
+
+    cancelRequested = false;
+    finished = false;
+    workDone = 0;
+    workTotal = 1;
+    running = true;
+    worker = std::thread(&LightmapBaker::run, this, std::move(input), settings);
+    return true;
+}
+
+float LightmapBaker::progress() const
+{
+    return static_cast<float>(workDone.load()) / static_cast<float>(std::max<std::uint64_t>(workTotal.load(), 1));
+}
+
+const char *LightmapBaker::stageName() const
+{
+    switch (stage.load())
+    {
+    case Stage::Bvh:
+        return "building BVH";
+    case Stage::Rasterize:
+        return "rasterizing charts";
+    case Stage::Direct:
+        return "direct light";
+    case Stage::Indirect:
+        return "indirect light";
+    case Stage::Denoise:
+        return "denoising";
+    case Stage::Compress:
+        return "compressing";
+    default:
+        return "idle";
+    }
+}
+
+bool LightmapBaker::poll(LightmapData &data)
+{
+    if (!finished.load())
+        return false;
+    worker.join();
+    finished = false;
+    stats = pendingStats;
+    data = std::move(result);
+    result = LightmapData{};
+    if (data.blocks.empty())
+        return false;
+
+    const float uncompressedKb = static_cast<float>(data.size) * data.size * LightmapData::kLayerCount * 2 * 2 / 1024.0f;
+    std::cout << "[Lightmap] " << data.size << "x" << data.size << ", " << stats.texels << " texels, "
+              << stats.totalMs / 1000.0f << " s on " << stats.threads << " threads (BVH " << stats.bvhMs << " ms, direct "
+              << stats.directMs << " ms, indirect " << stats.indirectMs << " ms, denoise " << stats.denoiseMs << " ms), "
+              << static_cast<float>(stats.rays) / (stats.directMs + stats.indirectMs) / 1000.0f << " Mrays/s, BC5 "
+              << data.blocks.size() / 1024 << " KB vs " << uncompressedKb << " KB RG16F" << std::endl;
+    return true;
+}
+
+void LightmapBaker::run(LightmapBakeInput input, LightmapSettings settings)
+{
+    const auto bakeStart = std::chrono::steady_clock::now();
+    Stats bakeStats;
+    JobSystem jobs;
+    bakeStats.threads = jobs.threadCount();
+
+    const int size = input.atlasSize;
+    const std::size_t texelCount = static_cast<std::size_t>(size) * size;
+    const std::size_t triangleCount = input.positions.size() / 3;
+    const int samples = std::max(4, settings.samples / 4 * 4);
+    const int bounces = std::max(0, settings.bounces);
+    // The denoiser filters the gathered light, so it only runs after a bounce
+    const std::size_t denoisePasses = settings.denoise && bounces > 0 ? kDenoiseIterations : 0;
+    workTotal = static_cast<std::uint64_t>(size) * (1 + bounces + denoisePasses);
+    std::atomic<std::uint64_t> rayCount{0};
+
+    const auto finish = [&]() {
+        bakeStats.totalMs = elapsedMs(bakeStart);
+        bakeStats.rays = rayCount.load();
+        pendingStats = bakeStats;
+        stage = Stage::Idle;
+        finished = true;
+        running = false;
+    };
+    if (size <= 0 || size % 4 != 0 || triangleCount == 0)
+    {
+        finish();
+        return;
+    }
+
+    stage = Stage::Bvh;
+    auto stageStart = std::chrono::steady_clock::now();
+    Bvh bvh;
+    bvh.build(input.positions);
+    bakeStats.bvhMs = elapsedMs(stageStart);
+
+    // Texel samples: world position and normal from the lightmap UVs
+    stage = Stage::Rasterize;
+    std::vector<glm::vec3> texelPosition(texelCount);
+    std::vector<glm::vec3> texelNormal(texelCount);
+    std::vector<std::uint8_t> coverage(texelCount, kEmpty);
+    std::vector<glm::vec3> facing(triangleCount);
+    for (std::size_t t = 0; t < triangleCount; t++)
+    {
+        const glm::vec3 *p = &input.positions[t * 3];
+        const glm::vec3 *n = &input.normals[t * 3];
+        const glm::vec3 faceNormal = glm::cross(p[1] - p[0], p[2] - p[0]);
+        const glm::vec3 vertexNormal = n[0] + n[1] + n[2];
+        facing[t] = glm::dot(vertexNormal, vertexNormal) > 0.0f ? glm::normalize(vertexNormal) : glm::normalize(faceNormal);
+
+        glm::vec2 corner[3];
+        for (int k = 0; k < 3; k++)
+            corner[k] = input.uvs[t * 3 + k] * static_cast<float>(size);
+        const float area = cross2(corner[1] - corner[0], corner[2] - corner[0]);
+        const glm::vec2 lo = glm::min(corner[0], glm::min(corner[1], corner[2])) - kEdgeCoverage - 0.5f;
+        const glm::vec2 hi = glm::max(corner[0], glm::max(corner[1], corner[2])) + kEdgeCoverage - 0.5f;
+        const int x0 = std::max(0, static_cast<int>(std::floor(lo.x)));
+        const int y0 = std::max(0, static_cast<int>(std::floor(lo.y)));
+        const int x1 = std::min(size - 1, static_cast<int>(std::ceil(hi.x)));
+        const int y1 = std::min(size - 1, static_cast<int>(std::ceil(hi.y)));
+        for (int y = y0; y <= y1; y++)
+        {
+            for (int x = x0; x <= x1; x++)
+            {
+                const std::size_t index = static_cast<std::size_t>(y) * size + x;
+                if (coverage[index] == kInterior)
+                    continue;
+                const glm::vec2 center(static_cast<float>(x) + 0.5f, static_cast<float>(y) + 0.5f);
+                glm::vec3 barycentric(0.0f);
+                std::uint8_t kind = kEmpty;
+                if (std::fabs(area) > 1e-12f)
+                {
+                    barycentric.x = cross2(corner[1] - center, corner[2] - center) / area;
+                    barycentric.y = cross2(corner[2] - center, corner[0] - center) / area;
+                    barycentric.z = 1.0f - barycentric.x - barycentric.y;
+                    if (barycentric.x >= -1e-5f && barycentric.y >= -1e-5f && barycentric.z >= -1e-5f)
+                        kind = kInterior;
+                }
+                if (kind == kEmpty)
+                {
+                    if (coverage[index] != kEmpty || closestOnEdges(corner, center, barycentric) > kEdgeCoverage)
+                        continue;
+                    kind = kEdge;
+                }
+                const glm::vec3 normal = n[0] * barycentric.x + n[1] * barycentric.y + n[2] * barycentric.z;
+                texelPosition[index] = p[0] * barycentric.x + p[1] * barycentric.y + p[2] * barycentric.z;
+                texelNormal[index] = glm::dot(normal, normal) > 0.0f ? glm::normalize(normal) : facing[t];
+                coverage[index] = kind;
+            }
+        }
+    }
+    int coveredTexels = 0;
+    for (std::uint8_t c : coverage)
+        coveredTexels += c != kEmpty ? 1 : 0;
+    bakeStats.texels = coveredTexels;
+
+    // Direct light: one packet of four jittered shadow rays per lamp
+    stage = Stage::Direct;
+    stageStart = std::chrono::steady_clock::now();
+    const glm::vec3 attenuation = input.lampAttenuation;
+    std::vector<float> direct(texelCount * kLampCount, 0.0f);
+    jobs.parallelFor(static_cast<std::size_t>(size), kRowGrain, [&](std::size_t begin, std::size_t end) {
+        std::uint64_t rays = 0;
+        for (std::size_t y = begin; y < end && !cancelRequested; y++)
+        {
+            for (std::size_t x = 0; x < static_cast<std::size_t>(size); x++)
+            {
+                const std::size_t index = y * size + x;
+                if (coverage[index] == kEmpty)
+                    continue;
+                const glm::vec3 normal = texelNormal[index];
+                const glm::vec3 origin = texelPosition[index] + normal * kRayOffset;
+                Random random{hash32(static_cast<std::uint32_t>(index) * 2u + 1u)};
+                for (int lamp = 0; lamp < kLampCount; lamp++)
+                {
+                    const glm::vec3 toLamp = input.lampPositions[lamp] - origin;
+                    const float distance = glm::length(toLamp);
+                    if (distance <= input.lampRadius)
+                        continue;
+                    const float cosine = glm::dot(normal, toLamp / distance);
+                    const float falloff = 1.0f / (attenuation.x + attenuation.y * distance + attenuation.z * distance * distance);
+                    if (cosine <= 0.0f || cosine * falloff < kMinContribution)
+                        continue;
+
+                    RayPacket4 packet;
+                    for (int lane = 0; lane < 4; lane++)
+                    {
+                        // Uniform point on the lamp sphere
+                        const float z = 1.0f - 2.0f * random.next();
+                        const float phi = 2.0f * kPi * random.next();
+                        const float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+                        const glm::vec3 target = input.lampPositions[lamp] +
+                                                 input.lampRadius * glm::vec3(r * std::cos(phi), r * std::sin(phi), z);
+                        const glm::vec3 toTarget = target - origin;
+                        const float length = glm::length(toTarget);
+                        const glm::vec3 direction = toTarget / length;
+                        packet.originX[lane] = origin.x;
+                        packet.originY[lane] = origin.y;
+                        packet.originZ[lane] = origin.z;
+                        packet.directionX[lane] = direction.x;
+                        packet.directionY[lane] = direction.y;
+                        packet.directionZ[lane] = direction.z;
+                        packet.tMax[lane] = length * 0.999f;
+                    }
+                    const int blocked = bvh.occluded(packet);
+                    rays += 4;
+                    direct[index * kLampCount + lamp] = cosine * falloff * static_cast<float>(4 - laneCount(blocked)) * 0.25f;
+                }
+            }
+            workDone++;
+        }
+        rayCount += rays;
+    });
+    bakeStats.directMs = elapsedMs(stageStart);
+
+    // Light leaving each texel (before albedo) as seen by the previous bounce
+    std::vector<float> previous(texelCount * kChannels, 0.0f);
+    std::vector<float> gathered(texelCount * kChannels, 0.0f);
+    const auto combine = [&]() {
+        for (std::size_t i = 0; i < texelCount; i++)
+        {
+            for (int c = 0; c < kLampCount; c++)
+                previous[i * kChannels + c] = direct[i * kLampCount + c] + gathered[i * kChannels + c];
+            previous[i * kChannels + kSkyChannel] = gathered[i * kChannels + kSkyChannel];
+        }
+    };
+    // Fills uncovered and buried texels from covered neighbours, so bilinear
+    // filtering and gather hits near chart borders never read black
+    const auto dilate = [&](std::vector<float> &values) {
+        std::vector<std::uint8_t> valid(texelCount);
+        for (std::size_t i = 0; i < texelCount; i++)
+            valid[i] = (coverage[i] == kInterior || coverage[i] == kEdge) ? 1 : 0;
+        for (int iteration = 0; iteration < kDilateIterations; iteration++)
+        {
+            std::vector<std::uint8_t> next = valid;
+            for (int y = 0; y < size; y++)
+            {
+                for (int x = 0; x < size; x++)
+                {
+                    const std::size_t index = static_cast<std::size_t>(y) * size + x;
+                    if (valid[index])
+                        continue;
+                    float sum[kChannels] = {};
+                    int count = 0;
+                    for (int dy = -1; dy <= 1; dy++)
+                    {
+                        for (int dx = -1; dx <= 1; dx++)
+                        {
+                            const int nx = x + dx;
+                            const int ny = y + dy;
+                            if (nx < 0 || ny < 0 || nx >= size || ny >= size)
+                                continue;
+                            const std::size_t neighbour = static_cast<std::size_t>(ny) * size + nx;
+                            if (!valid[neighbour])
+                                continue;
+                            for (int c = 0; c < kChannels; c++)
+                                sum[c] += values[neighbour * kChannels + c];
+                            count++;
+                        }
+                    }
+                    if (count == 0)
+                        continue;
+                    for (int c = 0; c < kChannels; c++)
+                        values[index * kChannels + c] = sum[c] / static_cast<float>(count);
+                    next[index] = 1;
+                }
+            }
+            valid.swap(next);
+        }
+    };
+    combine();
+    dilate(previous);
+
+    // Indirect light: each bounce gathers the previous one through the lightmap
+    stage = Stage::Indirect;
+    stageStart = std::chrono::steady_clock::now();
+    for (int bounce = 0; bounce < bounces && !cancelRequested; bounce++)
+    {
+        jobs.parallelFor(static_cast<std::size_t>(size), kRowGrain, [&](std::size_t begin, std::size_t end) {
+            std::uint64_t rays = 0;
+            for (std::size_t y = begin; y < end && !cancelRequested; y++)
+            {
+                for (std::size_t x = 0; x < static_cast<std::size_t>(size); x++)
+                {
+                    const std::size_t index = y * size + x;
+                    if (coverage[index] == kEmpty)
+                        continue;
+                    const glm::vec3 normal = texelNormal[index];
+                    const glm::vec3 origin = texelPosition[index] + normal * kRayOffset;
+                    glm::vec3 tangent;
+                    glm::vec3 bitangent;
+                    makeBasis(normal, tangent, bitangent);
+                    // Per-texel rotation of a 2D low-discrepancy set: stratified, and decorrelated between texels
+                    Random random{hash32(static_cast<std::uint32_t>(index) * 2u + 2u + static_cast<std::uint32_t>(bounce) * 0x9e3779b9u)};
+                    const float shift1 = random.next();
+                    const float shift2 = random.next();
+
+                    float sum[kChannels] = {};
+                    int backfaces = 0;
+                    for (int s = 0; s < samples; s += 4)
+                    {
+                        RayPacket4 packet;
+                        for (int lane = 0; lane < 4; lane++)
+                        {
+                            const float i = static_cast<float>(s + lane);
+                            const float u1 = std::fmod(i / static_cast<float>(samples) + shift1, 1.0f);
+                            const float u2 = std::fmod(i * 0.618033988f + shift2, 1.0f);
+                            const float r = std::sqrt(u1);
+                            const float phi = 2.0f * kPi * u2;
+                            const glm::vec3 direction = tangent * (r * std::cos(phi)) + bitangent * (r * std::sin(phi)) +
+                                                        normal * std::sqrt(std::max(0.0f, 1.0f - u1));
+                            packet.originX[lane] = origin.x;
+                            packet.originY[lane] = origin.y;
+                            packet.originZ[lane] = origin.z;
+                            packet.directionX[lane] = direction.x;
+                            packet.directionY[lane] = direction.y;
+                            packet.directionZ[lane] = direction.z;
+                            packet.tMax[lane] = kFarDistance;
+                        }
+                        PacketHit4 hit;
+                        bvh.intersect(packet, hit);
+                        rays += 4;
+
+                        for (int lane = 0; lane < 4; lane++)
+                        {
+                            const std::int32_t triangle = hit.triangle[lane];
+                            if (triangle < 0)
+                            {
+                                sum[kSkyChannel] += 1.0f;
+                                continue;
+                            }
+                            const glm::vec3 direction(packet.directionX[lane], packet.directionY[lane], packet.directionZ[lane]);
+                            if (glm::dot(direction, facing[triangle]) > 0.0f)
+                            {
+                                backfaces++;
+                                continue;
+                            }
+                            const glm::vec2 *uv = &input.uvs[static_cast<std::size_t>(triangle) * 3];
+                            const glm::vec2 atlas =
+                                (uv[0] * (1.0f - hit.u[lane] - hit.v[lane]) + uv[1] * hit.u[lane] + uv[2] * hit.v[lane]) *
+                                static_cast<float>(size);
+                            const int hx = glm::clamp(static_cast<int>(atlas.x), 0, size - 1);
+                            const int hy = glm::clamp(static_cast<int>(atlas.y), 0, size - 1);
+                            const float *radiance = &previous[(static_cast<std::size_t>(hy) * size + hx) * kChannels];
+                            const float albedo = input.albedo[triangle];
+                            for (int c = 0; c < kChannels; c++)
+                                sum[c] += albedo * radiance[c];
+                        }
+                    }
+
+                    float *out = &gathered[index * kChannels];
+                    if (static_cast<float>(backfaces) > kBackfaceLimit * static_cast<float>(samples))
+                    {
+                        coverage[index] = kBuried;
+                        std::fill(out, out + kChannels, 0.0f);
+                        continue;
+                    }
+                    for (int c = 0; c < kChannels; c++)
+                        out[c] = sum[c] / static_cast<float>(samples);
+                }
+                workDone++;
+            }
+            rayCount += rays;
+        });
+        combine();
+        dilate(previous);
+    }
+    bakeStats.indirectMs = elapsedMs(stageStart);
+
+    // Edge-aware a-trous filter on the gathered light only; direct light is
+    // already smooth apart from shadow edges, which the filter would blur
+    stage = Stage::Denoise;
+    stageStart = std::chrono::steady_clock::now();
+    if (settings.denoise && bounces > 0)
+    {
+        const float kernel[3] = {3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f};
+        const float texelWorld = 1.0f / std::max(input.texelsPerUnit, 1e-3f);
+        std::vector<float> &filtered = previous; // free once the last bounce has run
+        for (int iteration = 0; iteration < kDenoiseIterations && !cancelRequested; iteration++)
+        {
+            const int step = 1 << iteration;
+            const float sigma = 2.0f * texelWorld * static_cast<float>(step);
+            const float invTwoSigmaSq = 1.0f / (2.0f * sigma * sigma);
+            jobs.parallelFor(static_cast<std::size_t>(size), kRowGrain, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t y = begin; y < end; y++)
+                {
+                    for (std::size_t x = 0; x < static_cast<std::size_t>(size); x++)
+                    {
+                        const std::size_t index = y * size + x;
+                        float *out = &filtered[index * kChannels];
+                        if (coverage[index] != kInterior && coverage[index] != kEdge)
+                        {
+                            std::copy(&gathered[index * kChannels], &gathered[index * kChannels] + kChannels, out);
+                            continue;
+                        }
+                        float sum[kChannels] = {};
+                        float weightSum = 0.0f;
+                        for (int dy = -2; dy <= 2; dy++)
+                        {
+                            const int ny = static_cast<int>(y) + dy * step;
+                            if (ny < 0 || ny >= size)
+                                continue;
+                            for (int dx = -2; dx <= 2; dx++)
+                            {
+                                const int nx = static_cast<int>(x) + dx * step;
+                                if (nx < 0 || nx >= size)
+                                    continue;
+                                const std::size_t neighbour = static_cast<std::size_t>(ny) * size + nx;
+                                if (coverage[neighbour] != kInterior && coverage[neighbour] != kEdge)
+                                    continue;
+                                const float normalWeight = std::pow(std::max(0.0f, glm::dot(texelNormal[index], texelNormal[neighbour])), 16.0f);
+                                const glm::vec3 offset = texelPosition[index] - texelPosition[neighbour];
+                                const float positionWeight = std::exp(-glm::dot(offset, offset) * invTwoSigmaSq);
+                                const float weight = kernel[std::abs(dx)] * kernel[std::abs(dy)] * normalWeight * positionWeight;
+                                for (int c = 0; c < kChannels; c++)
+                                    sum[c] += weight * gathered[neighbour * kChannels + c];
+                                weightSum += weight;
+                            }
+                        }
+                        for (int c = 0; c < kChannels; c++)
+                            out[c] = sum[c] / std::max(weightSum, 1e-8f);
+                    }
+                    workDone++;
+                }
+            });
+            gathered.swap(filtered);
+        }
+    }
+    bakeStats.denoiseMs = elapsedMs(stageStart);
+
+    // Final irradiance: direct + denoised gather, dilated into the chart padding
+    combine();
+    dilate(previous);
+    if (cancelRequested)
+    {
+        finish();
+        return;
+    }
+
+    stage = Stage::Compress;
+    LightmapData data;
+    data.size = size;
+    data.key = lightmapCacheKey(input, settings);
+    float lampMax = 1e-4f;
+    float skyMax = 1e-4f;
+    for (std::size_t i = 0; i < texelCount; i++)
+    {
+        for (int c = 0; c < kLampCount; c++)
+            lampMax = std::max(lampMax, previous[i * kChannels + c]);
+        skyMax = std::max(skyMax, previous[i * kChannels + kSkyChannel]);
+    }
+    data.lampScale = lampMax;
+    data.skyScale = skyMax;
+
+    const int blocksPerRow = size / 4;
+    const std::size_t layerBytes = static_cast<std::size_t>(blocksPerRow) * blocksPerRow * 16;
+    data.blocks.resize(layerBytes * LightmapData::kLayerCount);
+    jobs.parallelFor(static_cast<std::size_t>(blocksPerRow), 4, [&](std::size_t begin, std::size_t end) {
+        std::uint8_t values[16];
+        for (std::size_t by = begin; by < end; by++)
+        {
+            for (int bx = 0; bx < blocksPerRow; bx++)
+            {
+                for (int layer = 0; layer < LightmapData::kLayerCount; layer++)
+                {
+                    std::uint8_t *block = &data.blocks[layer * layerBytes + (by * blocksPerRow + bx) * 16];
+                    for (int half = 0; half < 2; half++)
+                    {
+                        // Layer 4 is (sky, unused)
+                        const int channel = layer < 4 ? layer * 2 + half : (half == 0 ? kSkyChannel : -1);
+                        const float invScale = 1.0f / (channel == kSkyChannel ? skyMax : lampMax);
+                        for (int texel = 0; texel < 16; texel++)
+                        {
+                            const std::size_t index = (by * 4 + texel / 4) * size + bx * 4 + texel % 4;
+                            values[texel] = channel < 0 ? 0 : quantize(previous[index * kChannels + channel], invScale);
+                        }
+                        encodeBc4(values, block + half * 8);
+                    }
+                }
+            }
+        }
+    });
+
+    result = std::move(data);
+    finish();
+}
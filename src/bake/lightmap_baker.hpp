@@ -0,0 +1,126 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+struct LightmapSettings
+{
+    bool enabled = true;       // shade static geometry from the baked lightmap
+    int atlasSize = 1024;
+    float texelsPerUnit = 4.0f; // requested; the chart packer may lower it to fit
+    int samples = 64;          // gather rays per texel and bounce, multiple of 4
+    int bounces = 2;
+    bool denoise = true;
+};
+
+// Static scene flattened to world space for the baker, three corners per triangle
+struct LightmapBakeInput
+{
+    static constexpr int kLampCount = 8;
+
+    int atlasSize = 0;
+    float texelsPerUnit = 0.0f;
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> uvs;  // lightmap UVs in [0, 1]
+    std::vector<float> albedo;   // diffuse reflectance per triangle
+    std::array<glm::vec3, kLampCount> lampPositions{};
+    float lampRadius = 0.15f;
+    glm::vec3 lampAttenuation{1.0f, 0.09f, 0.032f}; // constant, linear, quadratic
+};
+
+// Baked irradiance as BC5 (RGTC2) blocks in a 2D array. Layers 0-3 hold two
+// lamps each in R and G, layer 4 the sky in R. Lamp values are in units of the
+// lamp color, sky values in units of the ambient color; texels store
+// sqrt(value / scale) for precision in the dark range.
+struct LightmapData
+{
+    static constexpr int kLayerCount = 5;
+
+    int size = 0;
+    float lampScale = 1.0f;
+    float skyScale = 1.0f;
+    std::uint64_t key = 0;
+    std::vector<std::uint8_t> blocks;
+
+    bool save(const std::filesystem::path &path) const;
+    // False when the file is missing, corrupt or was baked from another scene/settings
+    bool load(const std::filesystem::path &path, std::uint64_t expectedKey);
+};
+
+// Identifies a bake: geometry, lamps and settings
+std::uint64_t lightmapCacheKey(const LightmapBakeInput &input, const LightmapSettings &settings);
+
+// Path-traces the lamps and a uniform sky into the lightmap atlas on a
+// background thread that drives its own worker pool:
+//  - texels are rasterized from the lightmap UVs (conservatively, so thin
+//    charts still get a sample) into world positions and normals
+//  - direct light: four jittered shadow rays per lamp, one ray packet
+//  - indirect light: cosine-weighted gather packets per texel and bounce;
+//    hits read the previous bounce from the lightmap instead of recursing
+//  - the gathered part is denoised with an edge-aware a-trous filter, charts
+//    are dilated into their padding, and everything is BC5-compressed
+// Each lamp keeps its own channel, so switching lamps needs no rebake.
+class LightmapBaker
+{
+public:
+    struct Stats
+    {
+        int texels = 0;
+        unsigned int threads = 0;
+        std::uint64_t rays = 0;
+        float bvhMs = 0.0f;
+        float directMs = 0.0f;
+        float indirectMs = 0.0f;
+        float denoiseMs = 0.0f;
+        float totalMs = 0.0f;
+    };
+
+    LightmapBaker() = default;
+    ~LightmapBaker();
+    LightmapBaker(const LightmapBaker &) = delete;
+    LightmapBaker &operator=(const LightmapBaker &) = delete;
+
+    // False if a bake is already running
+    bool start(LightmapBakeInput input, const LightmapSettings &settings);
+    bool isBaking() const { return running.load(); }
+    float progress() const;
+    const char *stageName() const;
+
+    // True once after a bake finished; moves the result into `data`
+    bool poll(LightmapData &data);
+    const Stats &lastStats() const { return stats; }
+
+private:
+    enum class Stage
+    {
+        Idle,
+        Bvh,
+        Rasterize,
+        Direct,
+        Indirect,
+        Denoise,
+        Compress
+    };
+
+    void run(LightmapBakeInput input, LightmapSettings settings);
+
+    std::thread worker;
+    std::atomic<bool> running{false};
+    std::atomic<bool> finished{false};
+    std::atomic<bool> cancelRequested{false};
+    std::atomic<Stage> stage{Stage::Idle};
+    std::atomic<std::uint64_t> workDone{0};
+    std::atomic<std::uint64_t> workTotal{1};
+
+    // Written by the bake thread, handed over in poll()
+    LightmapData result;
+    Stats pendingStats;
+    Stats stats;
+};
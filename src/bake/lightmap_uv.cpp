@@ -0,0 +1,304 @@
+#include "bake/lightmap_uv.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+
+namespace
+{
+    constexpr int kClassCount = 6; // +X, -X, +Y, -Y, +Z, -Z
+    constexpr int kMaxPackAttempts = 24;
+    constexpr float kBlockSlack = 1.15f; // block width over the square root of its chart area
+
+    struct Chart
+    {
+        glm::vec2 projMin{std::numeric_limits<float>::max()};
+        glm::vec2 projMax{-std::numeric_limits<float>::max()};
+        int width = 0;  // texels, padding included
+        int height = 0;
+        int x = 0;
+        int y = 0;
+    };
+
+    // Charts of one mesh, from positions in the space they are unwrapped in
+    struct MeshCharts
+    {
+        std::vector<glm::vec3> positions;
+        std::vector<std::int32_t> triangleChart;
+        std::vector<std::uint8_t> triangleClass;
+    };
+
+    glm::vec2 project(const glm::vec3 &p, int axis)
+    {
+        return glm::vec2(p[(axis + 1) % 3], p[(axis + 2) % 3]);
+    }
+
+    std::int32_t findRoot(std::vector<std::int32_t> &parent, std::int32_t i)
+    {
+        while (parent[i] != i)
+        {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    }
+
+    // Charts: connected triangles that share a dominant axis direction
+    void buildCharts(const Mesh &mesh, MeshCharts &mc, std::vector<Chart> &charts)
+    {
+        const std::vector<glm::vec3> &world = mc.positions;
+        const std::size_t triangleCount = mesh.indices.size() / 3;
+        std::vector<std::uint8_t> &classes = mc.triangleClass;
+        classes.resize(triangleCount);
+        std::vector<std::int32_t> parent(triangleCount);
+        std::iota(parent.begin(), parent.end(), 0);
+        std::vector<std::int32_t> representative(mesh.vertices.size() * kClassCount, -1);
+        for (std::size_t t = 0; t < triangleCount; t++)
+        {
+            const unsigned int *corner = &mesh.indices[t * 3];
+            const glm::vec3 normal = glm::cross(world[corner[1]] - world[corner[0]], world[corner[2]] - world[corner[0]]);
+            const glm::vec3 magnitude = glm::abs(normal);
+            const int axis = (magnitude.x >= magnitude.y && magnitude.x >= magnitude.z) ? 0 : (magnitude.y >= magnitude.z ? 1 : 2);
+            const int triangleClassId = axis * 2 + (normal[axis] < 0.0f ? 1 : 0);
+            classes[t] = static_cast<std::uint8_t>(triangleClassId);
+            for (int k = 0; k < 3; k++)
+            {
+                std::int32_t &rep = representative[corner[k] * kClassCount + triangleClassId];
+                if (rep < 0)
+                    rep = static_cast<std::int32_t>(t);
+                else
+                    parent[findRoot(parent, static_cast<std::int32_t>(t))] = findRoot(parent, rep);
+            }
+        }
+
+        std::vector<std::int32_t> rootChart(triangleCount, -1);
+        std::vector<std::int32_t> &chartOf = mc.triangleChart;
+        chartOf.resize(triangleCount);
+        for (std::size_t t = 0; t < triangleCount; t++)
+        {
+            const std::int32_t root = findRoot(parent, static_cast<std::int32_t>(t));
+            if (rootChart[root] < 0)
+            {
+                rootChart[root] = static_cast<std::int32_t>(charts.size());
+                charts.emplace_back();
+            }
+            chartOf[t] = rootChart[root];
+            Chart &chart = charts[chartOf[t]];
+            for (int k = 0; k < 3; k++)
+            {
+                const glm::vec2 p = project(world[mesh.indices[t * 3 + k]], classes[t] / 2);
+                chart.projMin = glm::min(chart.projMin, p);
+                chart.projMax = glm::max(chart.projMax, p);
+            }
+        }
+    }
+
+    double sizeCharts(std::vector<Chart> &charts, float density, int padding)
+    {
+        double area = 0.0;
+        for (Chart &chart : charts)
+        {
+            const glm::vec2 extent = (chart.projMax - chart.projMin) * density;
+            chart.width = std::max(1, static_cast<int>(std::ceil(extent.x))) + 2 * padding;
+            chart.height = std::max(1, static_cast<int>(std::ceil(extent.y))) + 2 * padding;
+            area += static_cast<double>(chart.width) * chart.height;
+        }
+        return area;
+    }
+
+    std::vector<std::size_t> tallestFirst(const std::vector<Chart> &charts)
+    {
+        std::vector<std::size_t> order(charts.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+            return charts[a].height != charts[b].height ? charts[a].height > charts[b].height : charts[a].width > charts[b].width;
+        });
+        return order;
+    }
+
+    // Shelf packing in the given order; false when the area overflows
+    bool packShelves(std::vector<Chart> &charts, const std::vector<std::size_t> &order, int width, int height)
+    {
+        int shelfX = 0;
+        int shelfY = 0;
+        int shelfHeight = 0;
+        for (std::size_t index : order)
+        {
+            Chart &chart = charts[index];
+            if (chart.width > width)
+                return false;
+            if (shelfX + chart.width > width)
+            {
+                shelfY += shelfHeight;
+                shelfX = 0;
+                shelfHeight = 0;
+            }
+            if (shelfY + chart.height > height)
+                return false;
+            chart.x = shelfX;
+            chart.y = shelfY;
+            shelfX += chart.width;
+            shelfHeight = std::max(shelfHeight, chart.height);
+        }
+        return true;
+    }
+
+    // Packs a block's (already sized) charts into a roughly square block
+    glm::ivec2 packBlock(std::vector<Chart> &charts, double area)
+    {
+        int width = static_cast<int>(std::ceil(std::sqrt(area) * kBlockSlack));
+        for (const Chart &chart : charts)
+            width = std::max(width, chart.width);
+        packShelves(charts, tallestFirst(charts), width, std::numeric_limits<int>::max());
+        glm::ivec2 size(width, 0);
+        for (const Chart &chart : charts)
+            size.y = std::max(size.y, chart.y + chart.height);
+        return size;
+    }
+
+    // Splits vertices per chart and writes their coordinates over `size` texels
+    void writeUvs(Mesh &mesh, const MeshCharts &mc, const std::vector<Chart> &charts, float density, int padding,
+                  const glm::vec2 &size)
+    {
+        const glm::vec2 invSize = 1.0f / size;
+        std::vector<Vertex> vertices;
+        vertices.reserve(mesh.vertices.size());
+        std::vector<std::int32_t> remap(mesh.vertices.size() * kClassCount, -1);
+        for (std::size_t i = 0; i < mesh.indices.size(); i++)
+        {
+            const std::size_t t = i / 3;
+            const unsigned int source = mesh.indices[i];
+            std::int32_t &target = remap[source * kClassCount + mc.triangleClass[t]];
+            if (target < 0)
+            {
+                const Chart &chart = charts[mc.triangleChart[t]];
+                const glm::vec2 local = (project(mc.positions[source], mc.triangleClass[t] / 2) - chart.projMin) * density;
+                Vertex vertex = mesh.vertices[source];
+                vertex.LightmapUV = (glm::vec2(chart.x, chart.y) + static_cast<float>(padding) + local) * invSize;
+                target = static_cast<std::int32_t>(vertices.size());
+                vertices.push_back(vertex);
+            }
+            mesh.indices[i] = static_cast<unsigned int>(target);
+        }
+        mesh.vertices = std::move(vertices);
+    }
+}
+
+LightmapAtlasInfo packLightmapUvs(const std::vector<Mesh *> &meshes, const std::vector<glm::mat4> &modelMatrices,
+                                  std::vector<LightmapInstancedMesh> &instancedMeshes, int atlasSize,
+                                  float texelsPerUnit, int padding)
+{
+    LightmapAtlasInfo info;
+    info.size = atlasSize;
+
+    // Single meshes are unwrapped in world space
+    std::vector<Chart> charts;
+    std::vector<MeshCharts> meshCharts(meshes.size());
+    for (std::size_t m = 0; m < meshes.size(); m++)
+    {
+        const Mesh &mesh = *meshes[m];
+        meshCharts[m].positions.resize(mesh.vertices.size());
+        for (std::size_t v = 0; v < mesh.vertices.size(); v++)
+            meshCharts[m].positions[v] = glm::vec3(modelMatrices[m] * glm::vec4(mesh.vertices[v].Position, 1.0f));
+        buildCharts(mesh, meshCharts[m], charts);
+    }
+
+    // Instanced meshes in object space, scaled to their largest placement
+    std::vector<std::vector<Chart>> blockCharts(instancedMeshes.size());
+    std::vector<MeshCharts> blockMeshCharts(instancedMeshes.size());
+    std::size_t blockCopies = 0;
+    for (std::size_t b = 0; b < instancedMeshes.size(); b++)
+    {
+        const LightmapInstancedMesh &instanced = instancedMeshes[b];
+        float scale = 0.0f;
+        for (const glm::mat4 &model : instanced.modelMatrices)
+            scale = std::max(scale, std::max(glm::length(glm::vec3(model[0])),
+                                             std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])))));
+        const Mesh &mesh = *instanced.mesh;
+        blockMeshCharts[b].positions.resize(mesh.vertices.size());
+        for (std::size_t v = 0; v < mesh.vertices.size(); v++)
+            blockMeshCharts[b].positions[v] = mesh.vertices[v].Position * scale;
+        buildCharts(mesh, blockMeshCharts[b], blockCharts[b]);
+        blockCopies += instanced.modelMatrices.size();
+        info.chartCount += static_cast<int>(blockCharts[b].size() * instanced.modelMatrices.size());
+    }
+    info.chartCount += static_cast<int>(charts.size());
+    if (charts.empty() && blockCopies == 0)
+        return info;
+
+    // Shrink the density until the shelves fit
+    const float atlasArea = static_cast<float>(atlasSize) * static_cast<float>(atlasSize);
+    float largestExtent = 0.0f;
+    for (const Chart &chart : charts)
+    {
+        const glm::vec2 extent = chart.projMax - chart.projMin;
+        largestExtent = std::max(largestExtent, std::max(extent.x, extent.y));
+    }
+    float density = texelsPerUnit;
+    if (largestExtent > 0.0f)
+        density = std::min(density, static_cast<float>(atlasSize - 2 * padding - 1) / largestExtent);
+
+    // Atlas items: the single-mesh charts, then one rectangle per block copy
+    std::vector<Chart> items(charts.size() + blockCopies);
+    std::vector<glm::ivec2> blockSize(instancedMeshes.size());
+    bool packed = false;
+    for (int attempt = 0; attempt < kMaxPackAttempts && !packed; attempt++)
+    {
+        double usedArea = sizeCharts(charts, density, padding);
+        std::copy(charts.begin(), charts.end(), items.begin());
+        std::size_t item = charts.size();
+        for (std::size_t b = 0; b < instancedMeshes.size(); b++)
+        {
+            blockSize[b] = packBlock(blockCharts[b], sizeCharts(blockCharts[b], density, padding));
+            for (std::size_t i = 0; i < instancedMeshes[b].modelMatrices.size(); i++, item++)
+            {
+                items[item].width = blockSize[b].x;
+                items[item].height = blockSize[b].y;
+                usedArea += static_cast<double>(blockSize[b].x) * blockSize[b].y;
+            }
+        }
+        packed = packShelves(items, tallestFirst(items), atlasSize, atlasSize);
+        if (!packed)
+        {
+            const float areaScale = std::sqrt(static_cast<float>(atlasArea / usedArea));
+            density *= std::min(0.95f, areaScale * 0.95f);
+        }
+    }
+    info.texelsPerUnit = density;
+    if (!packed)
+    {
+        // Charts too small to shrink further (padding dominates): give up on UVs
+        info.texelsPerUnit = 0.0f;
+        return info;
+    }
+    std::copy(items.begin(), items.begin() + static_cast<std::ptrdiff_t>(charts.size()), charts.begin());
+
+    double interiorArea = 0.0;
+    for (const Chart &chart : charts)
+        interiorArea += static_cast<double>(chart.width - 2 * padding) * (chart.height - 2 * padding);
+    for (std::size_t b = 0; b < instancedMeshes.size(); b++)
+        for (const Chart &chart : blockCharts[b])
+            interiorArea += static_cast<double>(chart.width - 2 * padding) * (chart.height - 2 * padding) *
+                            static_cast<double>(instancedMeshes[b].modelMatrices.size());
+    info.coverage = static_cast<float>(interiorArea / atlasArea);
+
+    for (std::size_t m = 0; m < meshes.size(); m++)
+        writeUvs(*meshes[m], meshCharts[m], charts, density, padding, glm::vec2(static_cast<float>(atlasSize)));
+
+    const float invAtlas = 1.0f / static_cast<float>(atlasSize);
+    std::size_t item = charts.size();
+    for (std::size_t b = 0; b < instancedMeshes.size(); b++)
+    {
+        LightmapInstancedMesh &instanced = instancedMeshes[b];
+        writeUvs(*instanced.mesh, blockMeshCharts[b], blockCharts[b], density, padding, glm::vec2(blockSize[b]));
+        instanced.scaleOffsets.clear();
+        for (std::size_t i = 0; i < instanced.modelMatrices.size(); i++, item++)
+        {
+            instanced.scaleOffsets.emplace_back(glm::vec2(blockSize[b]) * invAtlas,
+                                                glm::vec2(items[item].x, items[item].y) * invAtlas);
+        }
+    }
+    return info;
+}
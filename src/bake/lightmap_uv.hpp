@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+
+struct LightmapAtlasInfo
+{
+    int size = 0;             // square atlas, texels
+    float texelsPerUnit = 0;  // after shrinking to fit
+    int chartCount = 0;
+    float coverage = 0;       // fraction of the atlas inside charts
+};
+
+// A mesh drawn at several placements (see Model::placements). Its charts are
+// unwrapped once, in object space at the largest placement scale, and packed
+// into one block; every placement gets its own copy of the block in the atlas.
+struct LightmapInstancedMesh
+{
+    Mesh *mesh = nullptr;
+    std::vector<glm::mat4> modelMatrices;
+    std::vector<glm::vec4> scaleOffsets; // written: atlas UV = LightmapUV * xy + zw, per placement
+};
+
+// Generates the second (lightmap) UV set. Triangles of each mesh are grouped
+// into charts by their dominant world axis and vertex connectivity, every
+// chart is projected onto its axis plane at `texelsPerUnit`, and the charts
+// (and instance blocks) are shelf-packed, tallest first, into one square atlas
+// with `padding` texels on each side. Density shrinks until everything fits.
+// Vertices shared by two charts are duplicated, so `vertices` and `indices`
+// are rewritten; call Mesh::refreshBuffers afterwards. UVs are in [0, 1] over
+// the atlas, or over the block for instanced meshes.
+LightmapAtlasInfo packLightmapUvs(const std::vector<Mesh *> &meshes, const std::vector<glm::mat4> &modelMatrices,
+                                  std::vector<LightmapInstancedMesh> &instancedMeshes, int atlasSize,
+                                  float texelsPerUnit, int padding);
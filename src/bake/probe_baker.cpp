@@ -0,0 +1,457 @@
+#include "bake/probe_baker.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <utility>
+
+#include "bake/bvh.hpp"
+#include "core/job_system.hpp"
+
+namespace
+{
+    constexpr int kCoefficients = ProbeGridData::kCoefficients;
+    constexpr float kPi = 3.14159265358979f;
+    constexpr float kGoldenAngle = 2.39996322972865f;
+    constexpr float kFarDistance = 1e4f;
+    constexpr float kHitOffset = 0.05f;      // hit lookups are pushed off the surface, world units
+    constexpr float kBackfaceLimit = 0.25f;  // share of rays hitting back faces before a probe counts as inside
+    // 3D texture limits: GL 3.3 guarantees 256 per axis, and the seven
+    // coefficient slabs are stacked vertically
+    constexpr int kMaxHorizontalProbes = 128;
+    constexpr int kMaxVerticalProbes = 256 / ProbeGridData::kTexels;
+    constexpr std::array<float, 4> kBenchmarkSpacings = {8.0f, 4.0f, 2.0f, 1.0f};
+    constexpr std::size_t kProbeGrain = 16;
+
+    // Clamped-cosine convolution per band, divided by pi (Ramamoorthi & Hanrahan 2001)
+    constexpr float kBandScale[kCoefficients] = {1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f,
+                                                 0.25f, 0.25f, 0.25f, 0.25f, 0.25f};
+
+    float elapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::uint32_t hash32(std::uint32_t x)
+    {
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return x;
+    }
+
+    // Real L2 spherical harmonics basis; shader.frag evaluates the same order
+    void shBasis(const glm::vec3 &d, float basis[kCoefficients])
+    {
+        basis[0] = 0.282095f;
+        basis[1] = 0.488603f * d.y;
+        basis[2] = 0.488603f * d.z;
+        basis[3] = 0.488603f * d.x;
+        basis[4] = 1.092548f * d.x * d.y;
+        basis[5] = 1.092548f * d.y * d.z;
+        basis[6] = 0.315392f * (3.0f * d.z * d.z - 1.0f);
+        basis[7] = 1.092548f * d.x * d.z;
+        basis[8] = 0.546274f * (d.x * d.x - d.y * d.y);
+    }
+
+    glm::vec3 shEvaluate(const glm::vec3 *coefficients, const glm::vec3 &d)
+    {
+        float basis[kCoefficients];
+        shBasis(d, basis);
+        glm::vec3 value(0.0f);
+        for (int i = 0; i < kCoefficients; i++)
+            value += coefficients[i] * basis[i];
+        return glm::max(value, glm::vec3(0.0f));
+    }
+
+    // Trilinear lookup of a convolved grid: the ambient multiplier at p for normal n
+    glm::vec3 sampleGrid(const ProbeGridData &grid, const std::vector<glm::vec3> &coefficients,
+                         const glm::vec3 &p, const glm::vec3 &n)
+    {
+        const glm::vec3 local = glm::clamp((p - grid.origin) / grid.spacing, glm::vec3(0.0f), glm::vec3(grid.size - 1));
+        const glm::ivec3 base = glm::min(glm::ivec3(local), glm::max(grid.size - 2, glm::ivec3(0)));
+        const glm::vec3 f = local - glm::vec3(base);
+        glm::vec3 blended[kCoefficients] = {};
+        for (int corner = 0; corner < 8; corner++)
+        {
+            const glm::ivec3 offset(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1);
+            const glm::ivec3 cell = glm::min(base + offset, grid.size - 1);
+            const glm::vec3 w3 = glm::mix(glm::vec3(1.0f) - f, f, glm::vec3(offset));
+            const float weight = w3.x * w3.y * w3.z;
+            const std::size_t probe = static_cast<std::size_t>(cell.x) + grid.size.x * (cell.y + static_cast<std::size_t>(grid.size.y) * cell.z);
+            for (int i = 0; i < kCoefficients; i++)
+                blended[i] += coefficients[probe * kCoefficients + i] * weight;
+        }
+        return shEvaluate(blended, n);
+    }
+
+    // Radiance SH of the whole sky image, each pixel weighted by its solid
+    // angle, and scaled so an open upward-facing probe sees irradiance pi
+    std::array<glm::vec3, kCoefficients> projectSky(const ProbeBakeInput &input)
+    {
+        std::array<glm::vec3, kCoefficients> sky{};
+        if (input.skyWidth <= 0 || input.skyHeight <= 0 ||
+            input.skyRadiance.size() != static_cast<std::size_t>(input.skyWidth) * input.skyHeight)
+        {
+            sky[0] = glm::vec3(4.0f * kPi * 0.282095f); // uniform white sky
+            return sky;
+        }
+
+        const float pixelAngle = (2.0f * kPi / static_cast<float>(input.skyWidth)) * (kPi / static_cast<float>(input.skyHeight));
+        float basis[kCoefficients];
+        for (int y = 0; y < input.skyHeight; y++)
+        {
+            // skybox.frag: u = atan(z, x) / 2pi + 0.5, v = 0.5 - asin(y) / pi (top row up)
+            const float latitude = (0.5f - (static_cast<float>(y) + 0.5f) / static_cast<float>(input.skyHeight)) * kPi;
+            const float weight = pixelAngle * std::cos(latitude);
+            for (int x = 0; x < input.skyWidth; x++)
+            {
+                const float longitude = ((static_cast<float>(x) + 0.5f) / static_cast<float>(input.skyWidth) - 0.5f) * 2.0f * kPi;
+                const glm::vec3 d(std::cos(latitude) * std::cos(longitude), std::sin(latitude),
+                                  std::cos(latitude) * std::sin(longitude));
+                shBasis(d, basis);
+                const glm::vec3 radiance = input.skyRadiance[static_cast<std::size_t>(y) * input.skyWidth + x] * weight;
+                for (int i = 0; i < kCoefficients; i++)
+                    sky[i] += radiance * basis[i];
+            }
+        }
+
+        glm::vec3 convolved[kCoefficients];
+        for (int i = 0; i < kCoefficients; i++)
+            convolved[i] = sky[i] * kBandScale[i];
+        const float upLuminance = glm::dot(shEvaluate(convolved, glm::vec3(0.0f, 1.0f, 0.0f)), glm::vec3(0.2126f, 0.7152f, 0.0722f));
+        if (upLuminance > 1e-6f)
+        {
+            for (glm::vec3 &c : sky)
+                c /= upLuminance;
+        }
+        return sky;
+    }
+
+    struct GatherPass
+    {
+        const Bvh &bvh;
+        const ProbeBakeInput &input;
+        const std::array<glm::vec3, kCoefficients> &sky;
+        const ProbeGridData &grid;
+        const std::vector<glm::vec3> *previous; // last pass's grid, null on the first pass
+        int samples;
+    };
+
+    // Projects one sphere of rays around every probe; flags probes that see mostly back faces
+    void gatherProbes(JobSystem &jobs, const GatherPass &pass, std::vector<glm::vec3> &coefficients,
+                      std::vector<std::uint8_t> &inside, std::atomic<std::uint64_t> &rays,
+                      std::atomic<std::uint64_t> &workDone, const std::atomic<bool> &cancel)
+    {
+        const ProbeGridData &grid = pass.grid;
+        const std::size_t probeCount = static_cast<std::size_t>(grid.probeCount());
+        const float sampleWeight = 4.0f * kPi / static_cast<float>(pass.samples);
+        jobs.parallelFor(probeCount, kProbeGrain, [&](std::size_t begin, std::size_t end) {
+            float basis[kCoefficients];
+            for (std::size_t probe = begin; probe < end && !cancel; probe++)
+            {
+                const glm::ivec3 cell(static_cast<int>(probe % grid.size.x),
+                                      static_cast<int>((probe / grid.size.x) % grid.size.y),
+                                      static_cast<int>(probe / (static_cast<std::size_t>(grid.size.x) * grid.size.y)));
+                const glm::vec3 origin = grid.origin + glm::vec3(cell) * grid.spacing;
+                // Fibonacci sphere, spun by a per-probe angle so neighbours sample different directions
+                const float spin = static_cast<float>(hash32(static_cast<std::uint32_t>(probe)) >> 8) * (2.0f * kPi / 16777216.0f);
+
+                glm::vec3 sum[kCoefficients] = {};
+                int backfaces = 0;
+                RayPacket4 packet;
+                PacketHit4 hit;
+                for (int lane = 0; lane < 4; lane++)
+                {
+                    packet.originX[lane] = origin.x;
+                    packet.originY[lane] = origin.y;
+                    packet.originZ[lane] = origin.z;
+                }
+                for (int first = 0; first < pass.samples; first += 4)
+                {
+                    glm::vec3 direction[4];
+                    for (int lane = 0; lane < 4; lane++)
+                    {
+                        const int i = first + lane;
+                        const float y = 1.0f - (2.0f * static_cast<float>(i) + 1.0f) / static_cast<float>(pass.samples);
+                        const float radius = std::sqrt(std::max(0.0f, 1.0f - y * y));
+                        const float phi = static_cast<float>(i) * kGoldenAngle + spin;
+                        direction[lane] = glm::vec3(radius * std::cos(phi), y, radius * std::sin(phi));
+                        packet.directionX[lane] = direction[lane].x;
+                        packet.directionY[lane] = direction[lane].y;
+                        packet.directionZ[lane] = direction[lane].z;
+                        packet.tMax[lane] = kFarDistance;
+                    }
+                    pass.bvh.intersect(packet, hit);
+
+                    for (int lane = 0; lane < 4; lane++)
+                    {
+                        const glm::vec3 &d = direction[lane];
+                        glm::vec3 radiance(0.0f);
+                        if (hit.triangle[lane] < 0)
+                        {
+                            radiance = shEvaluate(pass.sky.data(), d);
+                        }
+                        else
+                        {
+                            const std::size_t triangle = static_cast<std::size_t>(hit.triangle[lane]);
+                            const glm::vec3 &n = pass.input.normals[triangle];
+                            if (glm::dot(n, d) > 0.0f)
+                            {
+                                backfaces++;
+                            }
+                            else if (pass.previous)
+                            {
+                                const glm::vec3 point = origin + d * hit.t[lane] + n * kHitOffset;
+                                radiance = pass.input.albedo[triangle] * sampleGrid(grid, *pass.previous, point, n);
+                            }
+                        }
+                        shBasis(d, basis);
+                        for (int c = 0; c < kCoefficients; c++)
+                            sum[c] += radiance * basis[c];
+                    }
+                }
+                rays.fetch_add(static_cast<std::uint64_t>(pass.samples), std::memory_order_relaxed);
+
+                for (int c = 0; c < kCoefficients; c++)
+                    coefficients[probe * kCoefficients + c] = sum[c] * (sampleWeight * kBandScale[c]);
+                inside[probe] = backfaces > static_cast<int>(kBackfaceLimit * static_cast<float>(pass.samples)) ? 1 : 0;
+            }
+            workDone.fetch_add(end - begin, std::memory_order_relaxed);
+        });
+    }
+
+    // Buried probes take the average of their valid neighbours, growing outwards
+    void fillInsideProbes(const ProbeGridData &grid, std::vector<glm::vec3> &coefficients, const std::vector<std::uint8_t> &inside)
+    {
+        const std::size_t probeCount = static_cast<std::size_t>(grid.probeCount());
+        std::vector<std::uint8_t> valid(probeCount);
+        for (std::size_t probe = 0; probe < probeCount; probe++)
+            valid[probe] = inside[probe] ? 0 : 1;
+
+        const int maxIterations = std::max(grid.size.x, std::max(grid.size.y, grid.size.z));
+        std::vector<std::size_t> filled;
+        for (int iteration = 0; iteration < maxIterations; iteration++)
+        {
+            filled.clear();
+            for (std::size_t probe = 0; probe < probeCount; probe++)
+            {
+                if (valid[probe])
+                    continue;
+                const glm::ivec3 cell(static_cast<int>(probe % grid.size.x),
+                                      static_cast<int>((probe / grid.size.x) % grid.size.y),
+                                      static_cast<int>(probe / (static_cast<std::size_t>(grid.size.x) * grid.size.y)));
+                glm::vec3 sum[kCoefficients] = {};
+                int neighbours = 0;
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    for (int step = -1; step <= 1; step += 2)
+                    {
+                        glm::ivec3 other = cell;
+                        other[axis] += step;
+                        if (other[axis] < 0 || other[axis] >= grid.size[axis])
+                            continue;
+                        const std::size_t index = static_cast<std::size_t>(other.x) + grid.size.x * (other.y + static_cast<std::size_t>(grid.size.y) * other.z);
+                        if (!valid[index])
+                            continue;
+                        for (int c = 0; c < kCoefficients; c++)
+                            sum[c] += coefficients[index * kCoefficients + c];
+                        neighbours++;
+                    }
+                }
+                if (neighbours == 0)
+                    continue;
+                for (int c = 0; c < kCoefficients; c++)
+                    coefficients[probe * kCoefficients + c] = sum[c] / static_cast<float>(neighbours);
+                filled.push_back(probe);
+            }
+            if (filled.empty())
+                break;
+            for (std::size_t probe : filled)
+                valid[probe] = 1;
+        }
+    }
+
+    int countInside(const std::vector<std::uint8_t> &inside)
+    {
+        return static_cast<int>(std::count(inside.begin(), inside.end(), std::uint8_t{1}));
+    }
+}
+
+ProbeBaker::~ProbeBaker()
+{
+    cancelRequested = true;
+    if (worker.joinable())
+        worker.join();
+}
+
+ProbeGridData ProbeBaker::layoutGrid(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, float spacing)
+{
+    ProbeGridData grid;
+    const glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3(0.0f));
+    const glm::ivec3 limit(kMaxHorizontalProbes, kMaxVerticalProbes, kMaxHorizontalProbes);
+    spacing = std::max(spacing, 0.01f);
+    for (int axis = 0; axis < 3; axis++)
+    {
+        const int wanted = static_cast<int>(std::ceil(extent[axis] / spacing)) + 1;
+        grid.size[axis] = glm::clamp(wanted, 2, limit[axis]);
+        grid.spacing[axis] = std::max(extent[axis] / static_cast<float>(grid.size[axis] - 1), 1e-3f);
+    }
+    grid.origin = boundsMin;
+    return grid;
+}
+
+bool ProbeBaker::start(ProbeBakeInput input, const ProbeGridSettings &settings)
+{
+    if (running.load())
+        return false;
+    if (worker.joinable())
+        worker.join();
+
+    cancelRequested = false;
+    finished = false;
+    workDone = 0;
+    workTotal = 1;
+    running = true;
+    worker = std::thread(&ProbeBaker::run, this, std::move(input), settings, false);
+    return true;
+}
+
+bool ProbeBaker::startBenchmark(ProbeBakeInput input, const ProbeGridSettings &settings)
+{
+    if (running.load())
+        return false;
+    if (worker.joinable())
+        worker.join();
+
+    cancelRequested = false;
+    finished = false;
+    workDone = 0;
+    workTotal = 1;
+    running = true;
+    worker = std::thread(&ProbeBaker::run, this, std::move(input), settings, true);
+    return true;
+}
+
+float ProbeBaker::progress() const
+{
+    return static_cast<float>(workDone.load()) / static_cast<float>(std::max<std::uint64_t>(workTotal.load(), 1));
+}
+
+bool ProbeBaker::poll(ProbeGridData &data)
+{
+    if (!finished.load())
+        return false;
+    worker.join();
+    finished = false;
+    stats = pendingStats;
+    data = std::move(result);
+    result = ProbeGridData{};
+    if (data.coefficients.empty())
+        return false;
+
+    const glm::vec3 extent = glm::vec3(data.size - 1) * data.spacing;
+    const float volume = std::max(extent.x * extent.y * extent.z, 1e-3f);
+    const float textureKb = static_cast<float>(data.probeCount()) * ProbeGridData::kTexels * 8 / 1024.0f;
+    std::cout << "[Probes] " << data.size.x << "x" << data.size.y << "x" << data.size.z << " grid, " << data.probeCount()
+              << " probes at " << data.spacing.x << " x " << data.spacing.y << " x " << data.spacing.z << " m ("
+              << static_cast<float>(data.probeCount()) / volume << " probes/m^3, " << data.insideProbes
+              << " inside geometry), " << stats.samples << " rays x " << stats.passes << " passes, "
+              << stats.totalMs / 1000.0f << " s on " << stats.threads << " threads (BVH " << stats.bvhMs << " ms, sky "
+              << stats.skyMs << " ms, gather " << stats.gatherMs << " ms), "
+              << static_cast<float>(stats.rays) / stats.gatherMs / 1000.0f << " Mrays/s, RGBA16F " << textureKb << " KB"
+              << std::endl;
+    return true;
+}
+
+void ProbeBaker::run(ProbeBakeInput input, ProbeGridSettings settings, bool benchmark)
+{
+    const auto bakeStart = std::chrono::steady_clock::now();
+    Stats bakeStats;
+    JobSystem jobs;
+    bakeStats.threads = jobs.threadCount();
+
+    const int samples = std::max(4, settings.samples / 4 * 4);
+    const int passes = 1 + std::max(0, settings.bounces);
+    bakeStats.samples = samples;
+    bakeStats.passes = passes;
+    std::vector<ProbeGridData> grids;
+    if (benchmark)
+    {
+        for (float spacing : kBenchmarkSpacings)
+            grids.push_back(layoutGrid(input.boundsMin, input.boundsMax, spacing));
+    }
+    else
+    {
+        grids.push_back(layoutGrid(input.boundsMin, input.boundsMax, settings.spacing));
+    }
+    std::uint64_t totalWork = 0;
+    for (const ProbeGridData &grid : grids)
+        totalWork += static_cast<std::uint64_t>(grid.probeCount()) * passes;
+    workTotal = std::max<std::uint64_t>(totalWork, 1);
+    std::atomic<std::uint64_t> rayCount{0};
+
+    const auto finish = [&]() {
+        bakeStats.totalMs = elapsedMs(bakeStart);
+        bakeStats.rays = rayCount.load();
+        pendingStats = bakeStats;
+        finished = true;
+        running = false;
+    };
+    const std::size_t triangleCount = input.positions.size() / 3;
+    if (triangleCount == 0 || input.albedo.size() != triangleCount || input.normals.size() != triangleCount)
+    {
+        finish();
+        return;
+    }
+
+    auto stageStart = std::chrono::steady_clock::now();
+    Bvh bvh;
+    bvh.build(input.positions);
+    bakeStats.bvhMs = elapsedMs(stageStart);
+
+    stageStart = std::chrono::steady_clock::now();
+    const std::array<glm::vec3, kCoefficients> sky = projectSky(input);
+    bakeStats.skyMs = elapsedMs(stageStart);
+
+    for (ProbeGridData &grid : grids)
+    {
+        stageStart = std::chrono::steady_clock::now();
+        const std::uint64_t raysBefore = rayCount.load();
+        const std::size_t probeCount = static_cast<std::size_t>(grid.probeCount());
+        std::vector<glm::vec3> current(probeCount * kCoefficients);
+        std::vector<glm::vec3> previous(probeCount * kCoefficients);
+        std::vector<std::uint8_t> inside(probeCount, 0);
+        for (int pass = 0; pass < passes && !cancelRequested; pass++)
+        {
+            const GatherPass gather{bvh, input, sky, grid, pass > 0 ? &previous : nullptr, samples};
+            gatherProbes(jobs, gather, current, inside, rayCount, workDone, cancelRequested);
+            fillInsideProbes(grid, current, inside);
+            std::swap(current, previous);
+        }
+        if (cancelRequested)
+            break;
+
+        const float gridMs = elapsedMs(stageStart);
+        grid.insideProbes = countInside(inside);
+        grid.coefficients = std::move(previous);
+        const glm::vec3 cell = grid.spacing;
+        if (benchmark)
+        {
+            std::cout << "[Probes] spacing " << cell.x << " x " << cell.y << " x " << cell.z << ": " << grid.size.x << "x"
+                      << grid.size.y << "x" << grid.size.z << " = " << probeCount << " probes, " << gridMs << " ms ("
+                      << gridMs * 1000.0f / static_cast<float>(probeCount) << " us/probe, "
+                      << static_cast<float>(rayCount.load() - raysBefore) / gridMs / 1000.0f << " Mrays/s)" << std::endl;
+            continue;
+        }
+
+        bakeStats.probes = static_cast<int>(probeCount);
+        bakeStats.gatherMs = gridMs;
+        result = std::move(grid);
+    }
+    finish();
+}
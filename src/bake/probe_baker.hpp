@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+struct ProbeGridSettings
+{
+    bool enabled = true;   // ambient from the probes where no lightmap sky is available
+    float spacing = 2.0f;  // requested world units between probes; coarsened to fit the grid limits
+    int samples = 256;     // rays per probe and pass, multiple of 4
+    int bounces = 2;
+};
+
+// Static scene and sky for the probe bake
+struct ProbeBakeInput
+{
+    glm::vec3 boundsMin{0.0f};
+    glm::vec3 boundsMax{0.0f};
+    std::vector<glm::vec3> positions; // world space, three corners per triangle
+    std::vector<glm::vec3> normals;   // unit front-face normal per triangle (from the vertex normals)
+    std::vector<float> albedo;        // diffuse reflectance per triangle
+    // Equirectangular sky in linear RGB, top row first (same mapping as skybox.frag)
+    int skyWidth = 0;
+    int skyHeight = 0;
+    std::vector<glm::vec3> skyRadiance;
+};
+
+// Irradiance probes on a regular grid, each as L2 spherical harmonics (9 RGB
+// coefficients) already convolved with the clamped cosine and divided by pi,
+// so evaluating them at a normal gives the ambient multiplier directly. The
+// sky is normalized so an open, upward-facing probe evaluates to ~1 there.
+struct ProbeGridData
+{
+    static constexpr int kCoefficients = 9;
+    static constexpr int kTexels = 7; // RGBA texels per probe (27 floats, one spare)
+
+    glm::ivec3 size{0};
+    glm::vec3 origin{0.0f};  // position of probe (0, 0, 0)
+    glm::vec3 spacing{1.0f};
+    int insideProbes = 0;    // probes buried in geometry, filled from their neighbours
+    std::vector<glm::vec3> coefficients; // kCoefficients per probe, x fastest, then y, then z
+
+    int probeCount() const { return size.x * size.y * size.z; }
+};
+
+// Bakes the probe grid on a background thread with its own worker pool. Each
+// probe traces one packet-traced sphere of rays per pass against a BVH of the
+// static scene: misses read the sky (projected to SH once, from every sky
+// pixel), hits read the previous pass's grid at the hit point times the
+// surface albedo, so every extra pass adds a bounce. Probes that mostly see
+// back faces are inside buildings and are replaced by their neighbours.
+class ProbeBaker
+{
+public:
+    struct Stats
+    {
+        int probes = 0;
+        int samples = 0; // rays per probe and pass
+        int passes = 0;
+        unsigned int threads = 0;
+        std::uint64_t rays = 0;
+        float bvhMs = 0.0f;
+        float skyMs = 0.0f;
+        float gatherMs = 0.0f;
+        float totalMs = 0.0f;
+    };
+
+    ProbeBaker() = default;
+    ~ProbeBaker();
+    ProbeBaker(const ProbeBaker &) = delete;
+    ProbeBaker &operator=(const ProbeBaker &) = delete;
+
+    // False if a bake is already running
+    bool start(ProbeBakeInput input, const ProbeGridSettings &settings);
+    // Bakes at several spacings and prints the timing of each; produces no grid
+    bool startBenchmark(ProbeBakeInput input, const ProbeGridSettings &settings);
+    bool isBaking() const { return running.load(); }
+    float progress() const;
+
+    // True once after a bake finished; moves the grid into `data`
+    bool poll(ProbeGridData &data);
+    const Stats &lastStats() const { return stats; }
+
+    // Grid over `boundsMin..boundsMax` at about `spacing`, within the 3D texture limits
+    static ProbeGridData layoutGrid(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, float spacing);
+
+private:
+    void run(ProbeBakeInput input, ProbeGridSettings settings, bool benchmark);
+
+    std::thread worker;
+    std::atomic<bool> running{false};
+    std::atomic<bool> finished{false};
+    std::atomic<bool> cancelRequested{false};
+    std::atomic<std::uint64_t> workDone{0};
+    std::atomic<std::uint64_t> workTotal{1};
+
+    // Written by the bake thread, handed over in poll()
+    ProbeGridData result;
+    Stats pendingStats;
+    Stats stats;
+};
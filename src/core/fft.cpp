@@ -0,0 +1,172 @@
+#include "core/fft.hpp"
+
+#include <cmath>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FFT_USE_SSE 1
+#include <emmintrin.h>
+#else
+#define FFT_USE_SSE 0
+#endif
+
+void Fft::init(std::size_t size)
+{
+    n = size;
+    unsigned int bits = 0;
+    while ((std::size_t(1) << bits) < n)
+        ++bits;
+
+    bitReverse.resize(n);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        std::uint32_t reversed = 0;
+        for (unsigned int b = 0; b < bits; b++)
+        {
+            if (i & (std::size_t(1) << b))
+                reversed |= 1u << (bits - 1 - b);
+        }
+        bitReverse[i] = reversed;
+    }
+
+    twiddleRe.assign(n, 0.0f);
+    twiddleIm.assign(n, 0.0f);
+    for (std::size_t half = 1; half < n; half *= 2)
+    {
+        for (std::size_t j = 0; j < half; j++)
+        {
+            const double angle = 3.14159265358979323846 * static_cast<double>(j) / static_cast<double>(half);
+            twiddleRe[half - 1 + j] = static_cast<float>(std::cos(angle));
+            twiddleIm[half - 1 + j] = static_cast<float>(std::sin(angle));
+        }
+    }
+}
+
+void Fft::inverse(float *re, float *im) const
+{
+    for (std::size_t i = 0; i < n; i++)
+    {
+        const std::size_t j = bitReverse[i];
+        if (i < j)
+        {
+            std::swap(re[i], re[j]);
+            std::swap(im[i], im[j]);
+        }
+    }
+
+    // Stages 1 and 2 as one radix-4 butterfly (twiddles 1 and +i)
+    for (std::size_t base = 0; base < n; base += 4)
+    {
+        const float a0r = re[base] + re[base + 1], a0i = im[base] + im[base + 1];
+        const float a1r = re[base] - re[base + 1], a1i = im[base] - im[base + 1];
+        const float a2r = re[base + 2] + re[base + 3], a2i = im[base + 2] + im[base + 3];
+        const float a3r = re[base + 2] - re[base + 3], a3i = im[base + 2] - im[base + 3];
+        re[base] = a0r + a2r;
+        im[base] = a0i + a2i;
+        re[base + 2] = a0r - a2r;
+        im[base + 2] = a0i - a2i;
+        re[base + 1] = a1r - a3i;
+        im[base + 1] = a1i + a3r;
+        re[base + 3] = a1r + a3i;
+        im[base + 3] = a1i - a3r;
+    }
+
+    for (std::size_t half = 4; half < n; half *= 2)
+    {
+        const float *wr = twiddleRe.data() + half - 1;
+        const float *wi = twiddleIm.data() + half - 1;
+        for (std::size_t base = 0; base < n; base += 2 * half)
+        {
+            float *ar = re + base;
+            float *ai = im + base;
+            float *br = ar + half;
+            float *bi = ai + half;
+#if FFT_USE_SSE
+            for (std::size_t j = 0; j < half; j += 4)
+            {
+                const __m128 twr = _mm_loadu_ps(wr + j);
+                const __m128 twi = _mm_loadu_ps(wi + j);
+                const __m128 xr = _mm_loadu_ps(br + j);
+                const __m128 xi = _mm_loadu_ps(bi + j);
+                const __m128 tr = _mm_sub_ps(_mm_mul_ps(xr, twr), _mm_mul_ps(xi, twi));
+                const __m128 ti = _mm_add_ps(_mm_mul_ps(xr, twi), _mm_mul_ps(xi, twr));
+                const __m128 yr = _mm_loadu_ps(ar + j);
+                const __m128 yi = _mm_loadu_ps(ai + j);
+                _mm_storeu_ps(ar + j, _mm_add_ps(yr, tr));
+                _mm_storeu_ps(ai + j, _mm_add_ps(yi, ti));
+                _mm_storeu_ps(br + j, _mm_sub_ps(yr, tr));
+                _mm_storeu_ps(bi + j, _mm_sub_ps(yi, ti));
+            }
+#else
+            for (std::size_t j = 0; j < half; j++)
+            {
+                const float tr = br[j] * wr[j] - bi[j] * wi[j];
+                const float ti = br[j] * wi[j] + bi[j] * wr[j];
+                br[j] = ar[j] - tr;
+                bi[j] = ai[j] - ti;
+                ar[j] += tr;
+                ai[j] += ti;
+            }
+#endif
+        }
+    }
+}
+
+void Fft::inverseColumns(float *re, float *im, std::size_t stride, std::size_t count) const
+{
+    for (std::size_t i = 0; i < n; i++)
+    {
+        const std::size_t j = bitReverse[i];
+        if (i < j)
+        {
+            for (std::size_t lane = 0; lane < count; lane++)
+            {
+                std::swap(re[i * stride + lane], re[j * stride + lane]);
+                std::swap(im[i * stride + lane], im[j * stride + lane]);
+            }
+        }
+    }
+
+    for (std::size_t half = 1; half < n; half *= 2)
+    {
+        const float *wr = twiddleRe.data() + half - 1;
+        const float *wi = twiddleIm.data() + half - 1;
+        for (std::size_t base = 0; base < n; base += 2 * half)
+        {
+            for (std::size_t j = 0; j < half; j++)
+            {
+                float *ar = re + (base + j) * stride;
+                float *ai = im + (base + j) * stride;
+                float *br = ar + half * stride;
+                float *bi = ai + half * stride;
+#if FFT_USE_SSE
+                const __m128 twr = _mm_set1_ps(wr[j]);
+                const __m128 twi = _mm_set1_ps(wi[j]);
+                for (std::size_t lane = 0; lane < count; lane += 4)
+                {
+                    const __m128 xr = _mm_loadu_ps(br + lane);
+                    const __m128 xi = _mm_loadu_ps(bi + lane);
+                    const __m128 tr = _mm_sub_ps(_mm_mul_ps(xr, twr), _mm_mul_ps(xi, twi));
+                    const __m128 ti = _mm_add_ps(_mm_mul_ps(xr, twi), _mm_mul_ps(xi, twr));
+                    const __m128 yr = _mm_loadu_ps(ar + lane);
+                    const __m128 yi = _mm_loadu_ps(ai + lane);
+                    _mm_storeu_ps(ar + lane, _mm_add_ps(yr, tr));
+                    _mm_storeu_ps(ai + lane, _mm_add_ps(yi, ti));
+                    _mm_storeu_ps(br + lane, _mm_sub_ps(yr, tr));
+                    _mm_storeu_ps(bi + lane, _mm_sub_ps(yi, ti));
+                }
+#else
+                for (std::size_t lane = 0; lane < count; lane++)
+                {
+                    const float tr = br[lane] * wr[j] - bi[lane] * wi[j];
+                    const float ti = br[lane] * wi[j] + bi[lane] * wr[j];
+                    br[lane] = ar[lane] - tr;
+                    bi[lane] = ai[lane] - ti;
+                    ar[lane] += tr;
+                    ai[lane] += ti;
+                }
+#endif
+            }
+        }
+    }
+}
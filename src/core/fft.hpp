@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// In-place radix-2 complex FFT on split (structure-of-arrays) real and
+// imaginary lines. Twiddles are stored contiguously per stage, so every
+// stage with at least four butterflies per group runs four butterflies per
+// SSE instruction; the first two stages are fused into one scalar radix-4 pass.
+// Columns are transformed in blocks with one column per lane, which needs no
+// gather, keeps every stage vectorized and uses whole cache lines.
+class Fft
+{
+public:
+    // `size` must be a power of two, at least 4
+    void init(std::size_t size);
+    std::size_t size() const { return n; }
+
+    // Unnormalized inverse transform: x[j] = sum_k X[k] e^(+2 pi i jk / N)
+    void inverse(float *re, float *im) const;
+    // Same transform on `count` adjacent columns of a row-major grid (element
+    // j of column c at re[j * stride + c]), one column per SIMD lane, in place.
+    // `count` must be a multiple of 4.
+    void inverseColumns(float *re, float *im, std::size_t stride, std::size_t count) const;
+
+private:
+    std::size_t n = 0;
+    std::vector<std::uint32_t> bitReverse;
+    // Stage with half-size h uses entries [h - 1, 2h - 1)
+    std::vector<float> twiddleRe;
+    std::vector<float> twiddleIm;
+};
@@ -0,0 +1,112 @@
+#include "core/job_system.hpp"
+
+#include <algorithm>
+
+JobSystem::JobSystem(unsigned int workerCount)
+{
+    if (workerCount == 0)
+    {
+        const unsigned int hardware = std::thread::hardware_concurrency();
+        workerCount = hardware > 1 ? hardware - 1 : 0;
+    }
+
+    workers.reserve(workerCount);
+    for (unsigned int i = 0; i < workerCount; ++i)
+        workers.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeWorkers.notify_all();
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+unsigned int JobSystem::activeThreads() const
+{
+    return maxThreads == 0 ? threadCount() : std::min(maxThreads, threadCount());
+}
+
+void JobSystem::parallelFor(std::size_t count, std::size_t grain, const RangeFunction &function)
+{
+    if (count == 0)
+        return;
+    grain = std::max<std::size_t>(grain, 1);
+
+    const unsigned int threads = activeThreads();
+    if (threads <= 1 || count <= grain)
+    {
+        function(0, count);
+        return;
+    }
+
+    std::lock_guard<std::mutex> batchLock(batchMutex);
+    {
+        // A worker that woke late for the previous batch may still be reading it
+        std::unique_lock<std::mutex> lock(mutex);
+        batchFinished.wait(lock, [this] { return busyWorkers == 0; });
+        batchFunction = &function;
+        batchCount = count;
+        batchGrain = grain;
+        batchThreads = threads;
+        nextIndex.store(0);
+        completed.store(0);
+        ++generation;
+    }
+    wakeWorkers.notify_all();
+
+    runChunks();
+
+    // Wait for the last chunk and for every worker to leave this batch, so
+    // none of them can pick up chunks of the next one with stale parameters
+    std::unique_lock<std::mutex> lock(mutex);
+    batchFinished.wait(lock, [this] { return completed.load() == batchCount && busyWorkers == 0; });
+    batchFunction = nullptr;
+}
+
+void JobSystem::runChunks()
+{
+    for (;;)
+    {
+        const std::size_t begin = nextIndex.fetch_add(batchGrain);
+        if (begin >= batchCount)
+            return;
+        const std::size_t end = std::min(begin + batchGrain, batchCount);
+        (*batchFunction)(begin, end);
+
+        if (completed.fetch_add(end - begin) + (end - begin) == batchCount)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            batchFinished.notify_all();
+        }
+    }
+}
+
+void JobSystem::workerLoop(unsigned int workerIndex)
+{
+    unsigned long long seenGeneration = 0;
+    for (;;)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        wakeWorkers.wait(lock, [&] { return stopping || generation != seenGeneration; });
+        if (stopping)
+            return;
+        seenGeneration = generation;
+
+        // Workers beyond the thread cap sit this batch out (the caller is thread 0)
+        if (workerIndex + 1 >= batchThreads)
+            continue;
+
+        ++busyWorkers;
+        lock.unlock();
+        runChunks();
+        lock.lock();
+        --busyWorkers;
+        if (busyWorkers == 0)
+            batchFinished.notify_all();
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed pool of worker threads for data-parallel loops. parallelFor splits
+// [0, count) into chunks of `grain` items which the workers and the calling
+// thread pull from a shared atomic counter, then returns once every chunk has
+// run. Only one parallelFor runs at a time; call it from the main thread.
+class JobSystem
+{
+public:
+    using RangeFunction = std::function<void(std::size_t begin, std::size_t end)>;
+
+    // 0 = one worker per hardware thread, minus the caller
+    explicit JobSystem(unsigned int workerCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    // Threads that execute a parallelFor, including the caller
+    unsigned int threadCount() const { return static_cast<unsigned int>(workers.size()) + 1; }
+
+    // Caps the threads used by later parallelFor calls (1 = caller only);
+    // 0 restores the full pool. Used by benchmarks that scale thread count.
+    void setMaxThreads(unsigned int count) { maxThreads = count; }
+    unsigned int activeThreads() const;
+
+    void parallelFor(std::size_t count, std::size_t grain, const RangeFunction &function);
+
+private:
+    void workerLoop(unsigned int workerIndex);
+    void runChunks();
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wakeWorkers;
+    std::condition_variable batchFinished;
+    std::mutex batchMutex; // serializes parallelFor callers
+
+    // Current batch, written under `mutex` before `generation` is bumped
+    const RangeFunction *batchFunction = nullptr;
+    std::size_t batchCount = 0;
+    std::size_t batchGrain = 1;
+    unsigned int batchThreads = 1;
+    std::atomic<std::size_t> nextIndex{0};
+    std::atomic<std::size_t> completed{0};
+    unsigned long long generation = 0;
+    unsigned int busyWorkers = 0;
+    bool stopping = false;
+    unsigned int maxThreads = 0;
+};
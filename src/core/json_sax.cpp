@@ -0,0 +1,351 @@
+#include "core/json_sax.hpp"
+
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+    constexpr std::size_t kMaxNumberLength = 63;
+
+    class Parser
+    {
+    public:
+        Parser(std::string_view text, JsonHandler &target)
+            : begin(text.data()), p(text.data()), end(text.data() + text.size()), handler(target)
+        {
+        }
+
+        bool run(std::string &error);
+
+    private:
+        enum class State
+        {
+            Value,    // a value comes next
+            Key,      // a member name comes next
+            AfterValue,
+        };
+
+        bool fail(const char *message)
+        {
+            if (failure.empty())
+                failure = message;
+            return false;
+        }
+        void skipSpace()
+        {
+            while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+                p++;
+        }
+        bool parseString(std::string_view &out);
+        bool parseNumber(double &out);
+        bool literal(std::string_view word)
+        {
+            if (static_cast<std::size_t>(end - p) < word.size() || std::string_view(p, word.size()) != word)
+                return fail("invalid literal");
+            p += word.size();
+            return true;
+        }
+        bool value(State &next);
+
+        const char *begin;
+        const char *p;
+        const char *end;
+        JsonHandler &handler;
+        std::vector<char> containers; // '{' or '[' per open level
+        std::string scratch;
+        std::string failure;
+    };
+
+    void appendUtf8(std::string &out, unsigned long codepoint)
+    {
+        if (codepoint < 0x80)
+        {
+            out.push_back(static_cast<char>(codepoint));
+        }
+        else if (codepoint < 0x800)
+        {
+            out.push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
+            out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+        }
+        else if (codepoint < 0x10000)
+        {
+            out.push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+        }
+        else
+        {
+            out.push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+        }
+    }
+
+    int hexDigit(char c)
+    {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    }
+
+    bool Parser::parseString(std::string_view &out)
+    {
+        p++; // opening quote
+        const char *start = p;
+        while (p < end && *p != '"' && *p != '\\')
+        {
+            if (static_cast<unsigned char>(*p) < 0x20)
+                return fail("control character in string");
+            p++;
+        }
+        if (p == end)
+            return fail("unterminated string");
+        if (*p == '"')
+        {
+            out = std::string_view(start, static_cast<std::size_t>(p - start));
+            p++;
+            return true;
+        }
+
+        // Escaped: decode the rest into the scratch buffer
+        scratch.assign(start, p);
+        while (p < end && *p != '"')
+        {
+            if (static_cast<unsigned char>(*p) < 0x20)
+                return fail("control character in string");
+            if (*p != '\\')
+            {
+                scratch.push_back(*p++);
+                continue;
+            }
+            if (++p == end)
+                return fail("unterminated string");
+            switch (*p++)
+            {
+            case '"': scratch.push_back('"'); break;
+            case '\\': scratch.push_back('\\'); break;
+            case '/': scratch.push_back('/'); break;
+            case 'b': scratch.push_back('\b'); break;
+            case 'f': scratch.push_back('\f'); break;
+            case 'n': scratch.push_back('\n'); break;
+            case 'r': scratch.push_back('\r'); break;
+            case 't': scratch.push_back('\t'); break;
+            case 'u':
+            {
+                auto readHex = [this](unsigned long &codepoint) {
+                    if (end - p < 4)
+                        return false;
+                    codepoint = 0;
+                    for (int i = 0; i < 4; i++)
+                    {
+                        const int digit = hexDigit(*p++);
+                        if (digit < 0)
+                            return false;
+                        codepoint = codepoint * 16 + static_cast<unsigned long>(digit);
+                    }
+                    return true;
+                };
+                unsigned long codepoint = 0;
+                if (!readHex(codepoint))
+                    return fail("invalid \\u escape");
+                // A surrogate pair spells one codepoint above the basic plane
+                if (codepoint >= 0xD800 && codepoint < 0xDC00 && end - p >= 2 && p[0] == '\\' && p[1] == 'u')
+                {
+                    p += 2;
+                    unsigned long low = 0;
+                    if (!readHex(low) || low < 0xDC00 || low >= 0xE000)
+                        return fail("invalid surrogate pair");
+                    codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                }
+                appendUtf8(scratch, codepoint);
+                break;
+            }
+            default:
+                return fail("invalid escape");
+            }
+        }
+        if (p == end)
+            return fail("unterminated string");
+        p++;
+        out = scratch;
+        return true;
+    }
+
+    bool Parser::parseNumber(double &out)
+    {
+        // Checked against the JSON grammar, then converted by strtod from a
+        // terminated copy (the text itself need not be terminated)
+        const char *start = p;
+        if (p < end && *p == '-')
+            p++;
+        if (p == end || *p < '0' || *p > '9')
+            return fail("invalid number");
+        if (*p == '0')
+            p++;
+        else
+            while (p < end && *p >= '0' && *p <= '9')
+                p++;
+        if (p < end && *p == '.')
+        {
+            p++;
+            if (p == end || *p < '0' || *p > '9')
+                return fail("invalid number");
+            while (p < end && *p >= '0' && *p <= '9')
+                p++;
+        }
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            p++;
+            if (p < end && (*p == '+' || *p == '-'))
+                p++;
+            if (p == end || *p < '0' || *p > '9')
+                return fail("invalid number");
+            while (p < end && *p >= '0' && *p <= '9')
+                p++;
+        }
+        const std::size_t length = static_cast<std::size_t>(p - start);
+        if (length > kMaxNumberLength)
+            return fail("number too long");
+        char copy[kMaxNumberLength + 1];
+        for (std::size_t i = 0; i < length; i++)
+            copy[i] = start[i];
+        copy[length] = '\0';
+        out = std::strtod(copy, nullptr);
+        return true;
+    }
+
+    bool Parser::value(State &next)
+    {
+        next = State::AfterValue;
+        switch (*p)
+        {
+        case '{':
+            p++;
+            if (!handler.beginObject())
+                return fail("stopped by the handler");
+            skipSpace();
+            if (p < end && *p == '}')
+            {
+                p++;
+                return handler.endObject() || fail("stopped by the handler");
+            }
+            containers.push_back('{');
+            next = State::Key;
+            return true;
+        case '[':
+            p++;
+            if (!handler.beginArray())
+                return fail("stopped by the handler");
+            skipSpace();
+            if (p < end && *p == ']')
+            {
+                p++;
+                return handler.endArray() || fail("stopped by the handler");
+            }
+            containers.push_back('[');
+            next = State::Value;
+            return true;
+        case '"':
+        {
+            std::string_view text;
+            if (!parseString(text))
+                return false;
+            return handler.string(text) || fail("stopped by the handler");
+        }
+        case 't':
+            return literal("true") && (handler.boolean(true) || fail("stopped by the handler"));
+        case 'f':
+            return literal("false") && (handler.boolean(false) || fail("stopped by the handler"));
+        case 'n':
+            return literal("null") && (handler.null() || fail("stopped by the handler"));
+        default:
+        {
+            double number = 0.0;
+            if (!parseNumber(number))
+                return false;
+            return handler.number(number) || fail("stopped by the handler");
+        }
+        }
+    }
+
+    bool Parser::run(std::string &error)
+    {
+        State state = State::Value;
+        bool ok = true;
+        while (ok)
+        {
+            skipSpace();
+            if (state == State::AfterValue && containers.empty())
+            {
+                if (p != end)
+                    ok = fail("trailing characters");
+                break;
+            }
+            if (p == end)
+            {
+                ok = fail("unexpected end of document");
+                break;
+            }
+            switch (state)
+            {
+            case State::Value:
+                ok = value(state);
+                break;
+            case State::Key:
+            {
+                std::string_view name;
+                if (*p != '"')
+                {
+                    ok = fail("expected a member name");
+                    break;
+                }
+                ok = parseString(name) && (handler.key(name) || fail("stopped by the handler"));
+                skipSpace();
+                if (ok && (p == end || *p != ':'))
+                    ok = fail("expected ':'");
+                if (ok)
+                    p++;
+                state = State::Value;
+                break;
+            }
+            case State::AfterValue:
+                if (*p == ',')
+                {
+                    p++;
+                    state = containers.back() == '{' ? State::Key : State::Value;
+                }
+                else if (*p == '}' && containers.back() == '{')
+                {
+                    p++;
+                    containers.pop_back();
+                    ok = handler.endObject() || fail("stopped by the handler");
+                }
+                else if (*p == ']' && containers.back() == '[')
+                {
+                    p++;
+                    containers.pop_back();
+                    ok = handler.endArray() || fail("stopped by the handler");
+                }
+                else
+                {
+                    ok = fail("expected ',' or the end of the container");
+                }
+                break;
+            }
+        }
+        if (!ok)
+            error = failure + " at byte " + std::to_string(p - begin);
+        return ok;
+    }
+}
+
+bool parseJson(std::string_view text, JsonHandler &handler, std::string &error)
+{
+    Parser parser(text, handler);
+    return parser.run(error);
+}
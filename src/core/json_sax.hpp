@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Receives a JSON document as events in document order. Returning false from
+// any callback stops the parse. Strings are only valid during the callback.
+class JsonHandler
+{
+public:
+    virtual ~JsonHandler() = default;
+    virtual bool beginObject() = 0;
+    virtual bool endObject() = 0;
+    virtual bool beginArray() = 0;
+    virtual bool endArray() = 0;
+    virtual bool key(std::string_view name) = 0;
+    virtual bool string(std::string_view value) = 0;
+    virtual bool number(double value) = 0;
+    virtual bool boolean(bool value) = 0;
+    virtual bool null() = 0;
+};
+
+// Single pass over `text` with no document tree: strings without escapes are
+// handed out as views into `text`, escaped ones are decoded into one scratch
+// buffer. Nesting is tracked on an explicit stack, so depth costs no recursion.
+// On failure `error` names the problem and its byte offset.
+bool parseJson(std::string_view text, JsonHandler &handler, std::string &error);
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+// Read-only view of a whole file through the OS page cache: nothing is read
+// until a page is touched, and the pages are shared with the cache instead of
+// being copied into the heap
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // Fails when the file is missing or can't be mapped; an empty file maps to no data
+    bool open(const std::filesystem::path &path);
+    void close();
+
+    const unsigned char *data() const { return bytes; }
+    std::size_t size() const { return length; }
+    bool isOpen() const { return opened; }
+
+private:
+    const unsigned char *bytes = nullptr;
+    std::size_t length = 0;
+    bool opened = false;
+#ifdef _WIN32
+    void *file = nullptr;
+    void *mapping = nullptr;
+#endif
+};
+
+// Highest resident set size of the process so far, in bytes (0 where unsupported)
+std::size_t peakResidentBytes();
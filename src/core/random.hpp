@@ -0,0 +1,19 @@
+#pragma once
+
+#include <random>
+
+// Seeded content draws straight from std::mt19937, whose output the standard
+// fixes; the <random> distributions are implementation-defined and would give
+// other numbers under another standard library.
+
+// Uniform in [0, 1) from the top 24 bits of one draw
+inline float unitFloat(std::mt19937 &rng)
+{
+    return static_cast<float>(rng() >> 8) * 0x1p-24f;
+}
+
+// One of [0, count), count > 0; from one draw
+inline int uniformIndex(std::mt19937 &rng, int count)
+{
+    return static_cast<int>(rng() % static_cast<unsigned int>(count));
+}
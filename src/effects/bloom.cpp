@@ -0,0 +1,132 @@
+#include "effects/bloom.hpp"
+
+#include <algorithm>
+
+bool Bloom::init(const std::filesystem::path &shaderRoot, int width, int height)
+{
+    downsampleShader = loadFullscreenShader(shaderRoot, "bloom_downsample.frag");
+    upsampleShader = loadFullscreenShader(shaderRoot, "bloom_upsample.frag");
+    triangle.init();
+
+    for (int i = 0; i < kMaxMipLevels; ++i)
+    {
+        downNames.push_back("Bloom Down " + std::to_string(i + 1));
+        upNames.push_back("Bloom Up " + std::to_string(i + 1));
+    }
+
+    outputWidth = width;
+    outputHeight = height;
+    allocateLevels();
+    return !levels.empty();
+}
+
+void Bloom::resize(int width, int height)
+{
+    if (width == outputWidth && height == outputHeight)
+        return;
+    outputWidth = width;
+    outputHeight = height;
+    allocateLevels();
+}
+
+void Bloom::allocateLevels()
+{
+    for (RenderTarget &level : levels)
+        level.shutdown();
+    levels.clear();
+
+    // Always allocate the full chain; the setting only chooses how much of it runs
+    levels.resize(kMaxMipLevels);
+    for (int i = 0; i < kMaxMipLevels; ++i)
+    {
+        const glm::ivec2 size = levelSize(i);
+        levels[i].init(size.x, size.y, GL_R11F_G11F_B10F, false);
+    }
+}
+
+void Bloom::shutdown()
+{
+    for (RenderTarget &level : levels)
+        level.shutdown();
+    levels.clear();
+    triangle.shutdown();
+    downsampleShader.reset();
+    upsampleShader.reset();
+}
+
+void Bloom::setThresholdFromLight(const glm::vec3 &lightColor)
+{
+    baseThreshold = std::max(lightColor.r, std::max(lightColor.g, lightColor.b));
+}
+
+int Bloom::activeLevels() const
+{
+    return std::clamp(settings.mipLevels, 1, kMaxMipLevels);
+}
+
+glm::ivec2 Bloom::levelSize(int level) const
+{
+    return glm::ivec2(std::max(1, outputWidth >> (level + 1)), std::max(1, outputHeight >> (level + 1)));
+}
+
+unsigned int Bloom::render(unsigned int hdrTexture, const glm::vec2 &uvScale, const glm::vec2 &hdrTextureSize,
+                           GpuProfiler &profiler)
+{
+    const int levelCount = activeLevels();
+    glDisable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+    glActiveTexture(GL_TEXTURE0);
+
+    // Downsample: scene -> 1/2 -> 1/4 -> ...
+    downsampleShader->use();
+    downsampleShader->setInt("sourceTexture", 0);
+    downsampleShader->setFloat("threshold", threshold());
+    downsampleShader->setFloat("knee", threshold() * settings.knee);
+    for (int i = 0; i < levelCount; ++i)
+    {
+        profiler.begin(downNames[i]);
+        const glm::ivec2 size = levelSize(i);
+        levels[i].bind();
+        glViewport(0, 0, size.x, size.y);
+
+        if (i == 0)
+        {
+            downsampleShader->setVec2("sourceTexelSize", 1.0f / hdrTextureSize);
+            downsampleShader->setVec2("uvScale", uvScale);
+            glBindTexture(GL_TEXTURE_2D, hdrTexture);
+        }
+        else
+        {
+            const glm::ivec2 source = levelSize(i - 1);
+            downsampleShader->setVec2("sourceTexelSize", 1.0f / glm::vec2(source));
+            downsampleShader->setVec2("uvScale", glm::vec2(1.0f));
+            glBindTexture(GL_TEXTURE_2D, levels[i - 1].colorTexture());
+        }
+        downsampleShader->setBool("prefilter", i == 0);
+        triangle.draw();
+        profiler.end(downNames[i]);
+    }
+
+    // Upsample: accumulate each smaller level onto the next larger one
+    upsampleShader->use();
+    upsampleShader->setInt("sourceTexture", 0);
+    upsampleShader->setFloat("radius", settings.radius);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    for (int i = levelCount - 1; i > 0; --i)
+    {
+        profiler.begin(upNames[i]);
+        const glm::ivec2 target = levelSize(i - 1);
+        levels[i - 1].bind();
+        glViewport(0, 0, target.x, target.y);
+        upsampleShader->setVec2("sourceTexelSize", 1.0f / glm::vec2(levelSize(i)));
+        glBindTexture(GL_TEXTURE_2D, levels[i].colorTexture());
+        triangle.draw();
+        profiler.end(upNames[i]);
+    }
+    glDisable(GL_BLEND);
+
+    glDepthMask(GL_TRUE);
+    glEnable(GL_DEPTH_TEST);
+    return levels[0].colorTexture();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "shader.hpp"
+#include "render/fullscreen_pass.hpp"
+#include "render/gpu_timer.hpp"
+#include "render/render_target.hpp"
+
+struct BloomSettings
+{
+    bool enabled = true;
+    int mipLevels = 5;              // 1..kMaxMipLevels, each half the size of the previous
+    float thresholdScale = 1.0f;    // multiplies the street lamp luminance
+    float knee = 0.5f;              // soft threshold width (fraction of the threshold)
+    float intensity = 0.6f;
+    float radius = 1.0f;            // upsample tent radius in texels
+    float budgetMs = 0.3f;          // target for the whole effect at 1080p
+};
+
+// Bandwidth-efficient bloom on a progressive mip chain (dual filter). The
+// thresholded HDR scene is downsampled level by level to 1/2, 1/4, ... of
+// the output size, then upsampled back with additive blending. Every pass
+// runs at the size of its level, so total work is ~1/3 of one full-res pass
+// no matter how wide the glow gets. The post pass adds level 0 to the scene.
+class Bloom
+{
+public:
+    static constexpr int kMaxMipLevels = 8;
+
+    BloomSettings settings;
+
+    bool init(const std::filesystem::path &shaderRoot, int outputWidth, int outputHeight);
+    void resize(int outputWidth, int outputHeight);
+    void shutdown();
+
+    // Threshold tracks the lamp color: only pixels as bright as a surface
+    // lit head-on by a street lamp (or the moon/sky highlights) bloom.
+    void setThresholdFromLight(const glm::vec3 &lightColor);
+    float threshold() const { return baseThreshold * settings.thresholdScale; }
+
+    // Builds the chain from the HDR input (uvScale = used sub-rect) and returns
+    // the bloom texture to add in the post pass. Each level is timed in `profiler`.
+    unsigned int render(unsigned int hdrTexture, const glm::vec2 &uvScale, const glm::vec2 &hdrTextureSize,
+                        GpuProfiler &profiler);
+    unsigned int texture() const { return levels.empty() ? 0 : levels[0].colorTexture(); }
+
+    int activeLevels() const;
+    const std::string &downScopeName(int level) const { return downNames[level]; }
+    const std::string &upScopeName(int level) const { return upNames[level]; }
+    glm::ivec2 levelSize(int level) const;
+
+private:
+    void allocateLevels();
+
+    std::unique_ptr<Shader> downsampleShader;
+    std::unique_ptr<Shader> upsampleShader;
+    FullscreenTriangle triangle;
+
+    std::vector<RenderTarget> levels;
+    std::vector<std::string> downNames;
+    std::vector<std::string> upNames;
+    int outputWidth = 1;
+    int outputHeight = 1;
+    float baseThreshold = 1.0f;
+};
@@ -0,0 +1,375 @@
+#include "effects/fft_ocean.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+#include <glad/glad.h>
+#include <glm/gtc/packing.hpp>
+
+namespace
+{
+    constexpr float kGravity = 9.81f;
+    constexpr float kPi = 3.14159265358979f;
+    // Phillips constant for amplitude 1: about 7 cm RMS height at 6 m/s wind
+    constexpr float kPhillipsScale = 2e-4f;
+    // Waves running against the wind are damped rather than removed
+    constexpr float kUpwindDamping = 0.25f;
+    // Columns per FFT batch: one 64-byte cache line of floats
+    constexpr std::size_t kColumnBlock = 16;
+
+    constexpr std::array<int, 4> kBenchmarkResolutions = {64, 128, 256, 512};
+    constexpr int kBenchmarkWarmup = 2;
+    constexpr int kBenchmarkIterations = 8;
+
+    float elapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    int clampResolution(int resolution)
+    {
+        // Round to the nearest power of two inside the supported range
+        int size = FftOcean::kMinResolution;
+        while (size < FftOcean::kMaxResolution && size * 3 / 2 < resolution)
+            size *= 2;
+        return size;
+    }
+}
+
+bool OceanSimulation::Parameters::operator==(const Parameters &other) const
+{
+    return resolution == other.resolution && patchSize == other.patchSize && windSpeed == other.windSpeed &&
+           windDirection == other.windDirection && amplitude == other.amplitude;
+}
+
+OceanSimulation::Parameters OceanSimulation::parametersFrom(const WaterSettings &settings)
+{
+    Parameters parameters;
+    parameters.resolution = clampResolution(settings.oceanResolution);
+    parameters.patchSize = std::max(settings.oceanPatchSize, 1.0f);
+    parameters.windSpeed = std::max(settings.windSpeed, 0.1f);
+    parameters.windDirection = settings.windDirection;
+    parameters.amplitude = std::max(settings.oceanAmplitude, 0.0f);
+    return parameters;
+}
+
+void OceanSimulation::configure(const Parameters &parameters)
+{
+    if (configured && parameters == params)
+        return;
+    params = parameters;
+    configured = true;
+    buildSpectrum();
+}
+
+void OceanSimulation::buildSpectrum()
+{
+    const int n = params.resolution;
+    const std::size_t count = static_cast<std::size_t>(n) * n;
+    fft.init(static_cast<std::size_t>(n));
+
+    h0Re.assign(count, 0.0f);
+    h0Im.assign(count, 0.0f);
+    h0ConjRe.assign(count, 0.0f);
+    h0ConjIm.assign(count, 0.0f);
+    waveX.assign(count, 0.0f);
+    waveZ.assign(count, 0.0f);
+    omega.assign(count, 0.0f);
+    for (int f = 0; f < 3; f++)
+    {
+        fieldRe[f].assign(count, 0.0f);
+        fieldIm[f].assign(count, 0.0f);
+    }
+
+    const float largestWave = params.windSpeed * params.windSpeed / kGravity;
+    const float smallestWave = largestWave * 0.001f;
+    const float dk = 2.0f * kPi / params.patchSize;
+    const glm::vec2 wind = glm::length(params.windDirection) > 1e-4f ? glm::normalize(params.windDirection)
+                                                                      : glm::vec2(1.0f, 0.0f);
+
+    // Fixed seed: the wave pattern is part of the look and must not change per run
+    std::mt19937 rng(7u);
+    std::normal_distribution<float> gaussian(0.0f, 1.0f);
+
+    for (int z = 0; z < n; z++)
+    {
+        for (int x = 0; x < n; x++)
+        {
+            // Frequencies in FFT order, so the spatial result needs no (-1)^(x+z) sign fix
+            const glm::vec2 k(static_cast<float>(x < n / 2 ? x : x - n) * dk,
+                              static_cast<float>(z < n / 2 ? z : z - n) * dk);
+            const std::size_t i = static_cast<std::size_t>(z) * n + x;
+            const float xiRe = gaussian(rng);
+            const float xiIm = gaussian(rng);
+            waveX[i] = k.x;
+            waveZ[i] = k.y;
+
+            const float length = glm::length(k);
+            if (length < 1e-6f)
+                continue;
+            omega[i] = std::sqrt(kGravity * length);
+
+            // Phillips spectrum, scaled by dk^2 so the height variance does not depend on the grid
+            const float alignment = glm::dot(k / length, wind);
+            const float k2 = length * length;
+            float phillips = kPhillipsScale * params.amplitude * std::exp(-1.0f / (k2 * largestWave * largestWave)) /
+                             (k2 * k2) * alignment * alignment * std::exp(-k2 * smallestWave * smallestWave);
+            if (alignment < 0.0f)
+                phillips *= kUpwindDamping;
+            const float scale = std::sqrt(phillips * dk * dk * 0.5f);
+            h0Re[i] = xiRe * scale;
+            h0Im[i] = xiIm * scale;
+        }
+    }
+
+    for (int z = 0; z < n; z++)
+    {
+        for (int x = 0; x < n; x++)
+        {
+            const std::size_t i = static_cast<std::size_t>(z) * n + x;
+            const std::size_t mirrored = static_cast<std::size_t>((n - z) % n) * n + static_cast<std::size_t>((n - x) % n);
+            h0ConjRe[i] = h0Re[mirrored];
+            h0ConjIm[i] = -h0Im[mirrored];
+        }
+    }
+}
+
+void OceanSimulation::simulate(float time, JobSystem &jobs)
+{
+    const std::size_t n = static_cast<std::size_t>(params.resolution);
+    const auto spectrumStart = std::chrono::steady_clock::now();
+
+    // h(k, t) = h0(k) e^(i w t) + conj(h0(-k)) e^(-i w t), then the derived fields
+    jobs.parallelFor(n, 8, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin * n; i < end * n; i++)
+        {
+            const float c = std::cos(omega[i] * time);
+            const float s = std::sin(omega[i] * time);
+            const float hr = (h0Re[i] + h0ConjRe[i]) * c - (h0Im[i] - h0ConjIm[i]) * s;
+            const float hi = (h0Re[i] - h0ConjRe[i]) * s + (h0Im[i] + h0ConjIm[i]) * c;
+
+            const float kx = waveX[i];
+            const float kz = waveZ[i];
+            const float length = std::sqrt(kx * kx + kz * kz);
+            const float invLength = length > 1e-6f ? 1.0f / length : 0.0f;
+            const float ux = kx * invLength;
+            const float uz = kz * invLength;
+
+            // Pairs of real fields share one transform: IFFT(A + iB) = a + ib
+            // height h, displacement D = -i k/|k| h, slope S = i k h
+            fieldRe[0][i] = hr + ux * hr;
+            fieldIm[0][i] = hi + ux * hi;
+            fieldRe[1][i] = uz * hi - kx * hr;
+            fieldIm[1][i] = -uz * hr - kx * hi;
+            fieldRe[2][i] = -kz * hi;
+            fieldIm[2][i] = kz * hr;
+        }
+    });
+    spectrumMs = elapsedMs(spectrumStart);
+
+    const auto fftStart = std::chrono::steady_clock::now();
+    inverse2d(jobs);
+    fftMs = elapsedMs(fftStart);
+}
+
+void OceanSimulation::inverse2d(JobSystem &jobs)
+{
+    const std::size_t n = static_cast<std::size_t>(params.resolution);
+
+    // Rows of all three fields form one batch, then the columns
+    jobs.parallelFor(3 * n, 8, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t line = begin; line < end; line++)
+        {
+            const std::size_t field = line / n;
+            const std::size_t row = line % n;
+            fft.inverse(fieldRe[field].data() + row * n, fieldIm[field].data() + row * n);
+        }
+    });
+
+    // Columns in cache-line blocks, one per SIMD lane, straight from the row-major grid
+    const std::size_t groups = n / kColumnBlock;
+    jobs.parallelFor(3 * groups, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t group = begin; group < end; group++)
+        {
+            const std::size_t field = group / groups;
+            const std::size_t column = (group % groups) * kColumnBlock;
+            fft.inverseColumns(fieldRe[field].data() + column, fieldIm[field].data() + column, n, kColumnBlock);
+        }
+    });
+}
+
+void OceanSimulation::pack(std::size_t begin, std::size_t end, float choppiness, std::uint16_t *displacement,
+                           std::uint16_t *slopes) const
+{
+    const std::size_t n = static_cast<std::size_t>(params.resolution);
+    const std::uint16_t one = glm::packHalf1x16(1.0f);
+    for (std::size_t i = begin * n; i < end * n; i++)
+    {
+        displacement[i * 4 + 0] = glm::packHalf1x16(choppiness * fieldIm[0][i]);
+        displacement[i * 4 + 1] = glm::packHalf1x16(fieldRe[0][i]);
+        displacement[i * 4 + 2] = glm::packHalf1x16(choppiness * fieldRe[1][i]);
+        displacement[i * 4 + 3] = one;
+        slopes[i * 2 + 0] = glm::packHalf1x16(fieldIm[1][i]);
+        slopes[i * 2 + 1] = glm::packHalf1x16(fieldRe[2][i]);
+    }
+}
+
+bool FftOcean::init()
+{
+    glGenBuffers(1, &pixelBuffer);
+    return pixelBuffer != 0;
+}
+
+void FftOcean::shutdown()
+{
+    if (displacementTex != 0)
+        glDeleteTextures(1, &displacementTex);
+    if (slopeTex != 0)
+        glDeleteTextures(1, &slopeTex);
+    if (pixelBuffer != 0)
+        glDeleteBuffers(1, &pixelBuffer);
+    displacementTex = slopeTex = pixelBuffer = 0;
+    textureResolution = 0;
+}
+
+void FftOcean::allocateTextures(int resolution)
+{
+    if (displacementTex == 0)
+        glGenTextures(1, &displacementTex);
+    if (slopeTex == 0)
+        glGenTextures(1, &slopeTex);
+
+    // Displacement is fetched in the vertex shader at LOD 0; slopes are minified in the fragment shader
+    glBindTexture(GL_TEXTURE_2D, displacementTex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, resolution, resolution, 0, GL_RGBA, GL_HALF_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    glBindTexture(GL_TEXTURE_2D, slopeTex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, resolution, resolution, 0, GL_RG, GL_HALF_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    textureResolution = resolution;
+}
+
+void FftOcean::update(const WaterSettings &settings, float time, JobSystem &jobs)
+{
+    if (!settings.oceanEnabled || pixelBuffer == 0)
+        return;
+
+    const OceanSimulation::Parameters parameters = OceanSimulation::parametersFrom(settings);
+    simulation.configure(parameters);
+    simulation.simulate(time, jobs);
+    activePatchSize = parameters.patchSize;
+
+    const auto uploadStart = std::chrono::steady_clock::now();
+    const int n = simulation.resolution();
+    if (n != textureResolution)
+        allocateTextures(n);
+
+    // Orphan the pixel buffer so the driver never waits on last frame's upload,
+    // then pack half floats straight into the mapping from the workers
+    const std::size_t texels = static_cast<std::size_t>(n) * n;
+    const std::size_t displacementBytes = texels * 4 * sizeof(std::uint16_t);
+    const std::size_t slopeBytes = texels * 2 * sizeof(std::uint16_t);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(displacementBytes + slopeBytes), nullptr, GL_STREAM_DRAW);
+    void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(displacementBytes + slopeBytes),
+                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped != nullptr)
+    {
+        auto *displacement = static_cast<std::uint16_t *>(mapped);
+        auto *slopes = reinterpret_cast<std::uint16_t *>(static_cast<unsigned char *>(mapped) + displacementBytes);
+        const float choppiness = settings.choppiness;
+        jobs.parallelFor(static_cast<std::size_t>(n), 16, [&](std::size_t begin, std::size_t end) {
+            simulation.pack(begin, end, choppiness, displacement, slopes);
+        });
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        glBindTexture(GL_TEXTURE_2D, displacementTex);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, n, n, GL_RGBA, GL_HALF_FLOAT, nullptr);
+        glBindTexture(GL_TEXTURE_2D, slopeTex);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, n, n, GL_RG, GL_HALF_FLOAT,
+                        reinterpret_cast<const void *>(displacementBytes));
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    const float uploadMs = elapsedMs(uploadStart);
+    smoothedSpectrumMs += (simulation.lastSpectrumMs() - smoothedSpectrumMs) * 0.1f;
+    smoothedFftMs += (simulation.lastFftMs() - smoothedFftMs) * 0.1f;
+    smoothedUploadMs += (uploadMs - smoothedUploadMs) * 0.1f;
+}
+
+void FftOcean::startBenchmark(const JobSystem &jobs)
+{
+    if (isBenchmarking())
+        return;
+
+    benchmarkConfigs.clear();
+    for (int resolution : kBenchmarkResolutions)
+    {
+        unsigned int threads = 1;
+        for (;;)
+        {
+            benchmarkConfigs.push_back({resolution, threads});
+            if (threads >= jobs.threadCount())
+                break;
+            threads = std::min(threads * 2, jobs.threadCount());
+        }
+    }
+    results.clear();
+    benchmarkStage = 0;
+}
+
+void FftOcean::updateBenchmark(const WaterSettings &settings, JobSystem &jobs)
+{
+    if (!isBenchmarking())
+        return;
+
+    // A separate simulation, so the live ocean keeps its grid
+    const BenchmarkConfig config = benchmarkConfigs[static_cast<std::size_t>(benchmarkStage)];
+    OceanSimulation::Parameters parameters = OceanSimulation::parametersFrom(settings);
+    parameters.resolution = config.resolution;
+    OceanSimulation bench;
+    bench.configure(parameters);
+
+    jobs.setMaxThreads(config.threads);
+    BenchmarkResult result;
+    result.resolution = config.resolution;
+    result.threads = config.threads;
+    for (int i = 0; i < kBenchmarkWarmup + kBenchmarkIterations; i++)
+    {
+        bench.simulate(static_cast<float>(i) * 0.016f, jobs);
+        if (i >= kBenchmarkWarmup)
+        {
+            result.spectrumMs += bench.lastSpectrumMs() / kBenchmarkIterations;
+            result.fftMs += bench.lastFftMs() / kBenchmarkIterations;
+        }
+    }
+    jobs.setMaxThreads(0);
+    results.push_back(result);
+
+    std::cout << "[Ocean] " << result.resolution << "x" << result.resolution << ", " << result.threads
+              << " threads: FFT " << result.fftMs << " ms, spectrum " << result.spectrumMs << " ms" << std::endl;
+
+    if (++benchmarkStage >= static_cast<int>(benchmarkConfigs.size()))
+        benchmarkStage = -1;
+}
+
+float FftOcean::benchmarkProgress() const
+{
+    if (!isBenchmarking() || benchmarkConfigs.empty())
+        return 1.0f;
+    return static_cast<float>(benchmarkStage) / static_cast<float>(benchmarkConfigs.size());
+}
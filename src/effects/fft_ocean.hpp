@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "core/fft.hpp"
+#include "core/job_system.hpp"
+#include "effects/water.hpp"
+
+// CPU half of the ocean (Tessendorf, "Simulating Ocean Water"): a Phillips
+// spectrum h0(k), evolved each frame with the deep-water dispersion relation,
+// then brought to the spatial domain by 2D inverse FFTs split into row and
+// column passes on the job system. Five real fields (height, two choppy
+// displacements, two slopes) are packed pairwise into three complex
+// transforms. Holds no GL state, so benchmarks can run extra instances.
+class OceanSimulation
+{
+public:
+    struct Parameters
+    {
+        int resolution = 128;
+        float patchSize = 32.0f;
+        float windSpeed = 6.0f;
+        glm::vec2 windDirection{1.0f, 0.0f};
+        float amplitude = 1.0f;
+
+        bool operator==(const Parameters &other) const;
+        bool operator!=(const Parameters &other) const { return !(*this == other); }
+    };
+
+    static Parameters parametersFrom(const WaterSettings &settings);
+
+    // Rebuilds the initial spectrum when the parameters changed
+    void configure(const Parameters &parameters);
+    void simulate(float time, JobSystem &jobs);
+
+    // Writes rows [begin, end) as half floats: (choppy dx, height, choppy dz, 1) and (dh/dx, dh/dz)
+    void pack(std::size_t begin, std::size_t end, float choppiness, std::uint16_t *displacement,
+              std::uint16_t *slopes) const;
+
+    int resolution() const { return params.resolution; }
+    float height(int x, int z) const { return fieldRe[0][static_cast<std::size_t>(z) * params.resolution + x]; }
+    float lastSpectrumMs() const { return spectrumMs; }
+    float lastFftMs() const { return fftMs; }
+
+private:
+    void buildSpectrum();
+    void inverse2d(JobSystem &jobs);
+
+    Parameters params;
+    bool configured = false;
+    Fft fft;
+
+    // Per wave vector: h0(k), conj(h0(-k)), k and the dispersion frequency
+    std::vector<float> h0Re, h0Im;
+    std::vector<float> h0ConjRe, h0ConjIm;
+    std::vector<float> waveX, waveZ, omega;
+
+    // (height + i dx), (dz + i slope x), (slope z + i 0)
+    std::array<std::vector<float>, 3> fieldRe;
+    std::array<std::vector<float>, 3> fieldIm;
+
+    float spectrumMs = 0.0f;
+    float fftMs = 0.0f;
+};
+
+// GL half: streams the simulated displacement and slope maps into two
+// textures through an orphaned pixel buffer each frame. The water shader
+// displaces open-water vertices and takes normals from the slopes.
+class FftOcean
+{
+public:
+    static constexpr int kMinResolution = 64;
+    static constexpr int kMaxResolution = 512;
+
+    struct BenchmarkResult
+    {
+        int resolution = 0;
+        unsigned int threads = 0;
+        float spectrumMs = 0.0f;
+        float fftMs = 0.0f;
+    };
+
+    bool init();
+    void shutdown();
+
+    void update(const WaterSettings &settings, float time, JobSystem &jobs);
+
+    bool ready() const { return textureResolution > 0; }
+    unsigned int displacementTexture() const { return displacementTex; }
+    unsigned int slopeTexture() const { return slopeTex; }
+    float patchSize() const { return activePatchSize; }
+    int resolution() const { return textureResolution; }
+
+    float spectrumMs() const { return smoothedSpectrumMs; }
+    float fftMs() const { return smoothedFftMs; }
+    float uploadMs() const { return smoothedUploadMs; }
+
+    // FFT time for every grid size and power-of-two thread count up to the
+    // pool size; one configuration runs per call to updateBenchmark
+    void startBenchmark(const JobSystem &jobs);
+    void updateBenchmark(const WaterSettings &settings, JobSystem &jobs);
+    bool isBenchmarking() const { return benchmarkStage >= 0; }
+    float benchmarkProgress() const;
+    const std::vector<BenchmarkResult> &benchmarkResults() const { return results; }
+
+private:
+    void allocateTextures(int resolution);
+
+    OceanSimulation simulation;
+    unsigned int displacementTex = 0;
+    unsigned int slopeTex = 0;
+    unsigned int pixelBuffer = 0;
+    int textureResolution = 0;
+    float activePatchSize = 1.0f;
+
+    float smoothedSpectrumMs = 0.0f;
+    float smoothedFftMs = 0.0f;
+    float smoothedUploadMs = 0.0f;
+
+    // Benchmark state
+    struct BenchmarkConfig
+    {
+        int resolution;
+        unsigned int threads;
+    };
+    std::vector<BenchmarkConfig> benchmarkConfigs;
+    int benchmarkStage = -1;
+    std::vector<BenchmarkResult> results;
+};
@@ -0,0 +1,138 @@
+#include "effects/planar_reflection.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+bool PlanarReflection::init(int width, int height)
+{
+    outputWidth = width;
+    outputHeight = height;
+    allocateTarget();
+    return target.framebuffer() != 0;
+}
+
+void PlanarReflection::resize(int width, int height)
+{
+    const float scale = std::clamp(settings.resolutionScale, 0.25f, 1.0f);
+    if (width == outputWidth && height == outputHeight && scale == allocatedScale)
+        return;
+    outputWidth = width;
+    outputHeight = height;
+    allocateTarget();
+}
+
+void PlanarReflection::allocateTarget()
+{
+    // Sized for the full output at the reflection scale; dynamic resolution only uses a sub-rect
+    allocatedScale = std::clamp(settings.resolutionScale, 0.25f, 1.0f);
+    const int w = std::max(1, static_cast<int>(std::ceil(static_cast<float>(outputWidth) * allocatedScale)));
+    const int h = std::max(1, static_cast<int>(std::ceil(static_cast<float>(outputHeight) * allocatedScale)));
+    target.init(w, h, GL_R11F_G11F_B10F, true);
+    valid = false;
+}
+
+void PlanarReflection::shutdown()
+{
+    target.shutdown();
+    valid = false;
+}
+
+bool PlanarReflection::beginFrame(const glm::mat4 &view, const glm::mat4 &projection, int renderWidth,
+                                  int renderHeight, float waterHeight)
+{
+    resize(outputWidth, outputHeight);
+    const glm::vec3 cameraPosition(glm::inverse(view)[3]);
+    if (!settings.enabled || cameraPosition.y <= waterHeight + settings.clipOffset)
+    {
+        // The oblique clip needs the camera above the plane; below it there is nothing to mirror
+        valid = false;
+        return false;
+    }
+
+    const glm::ivec2 newRect(
+        std::clamp(static_cast<int>(std::lround(static_cast<float>(renderWidth) * allocatedScale)), 1, target.width()),
+        std::clamp(static_cast<int>(std::lround(static_cast<float>(renderHeight) * allocatedScale)), 1, target.height()));
+
+    // Still camera: the mirror image only changes with the lights, so a few
+    // frames of reuse are invisible while the pass cost drops to zero
+    const glm::mat4 viewProjection = projection * view;
+    float change = 0.0f;
+    for (int c = 0; c < 4; c++)
+    {
+        for (int r = 0; r < 4; r++)
+            change = std::max(change, std::fabs(viewProjection[c][r] - lastViewProjection[c][r]));
+    }
+    const bool still = valid && change <= settings.stillThreshold && newRect == rect && waterHeight == lastWaterHeight;
+    framesSinceRefresh++;
+    if (settings.adaptiveSkip && still && framesSinceRefresh < settings.maxSkippedFrames)
+    {
+        skippedAverage += (1.0f - skippedAverage) * 0.05f;
+        return false;
+    }
+    skippedAverage -= skippedAverage * 0.05f;
+    framesSinceRefresh = 0;
+
+    rect = newRect;
+    lastViewProjection = viewProjection;
+    lastWaterHeight = waterHeight;
+
+    reflectedView = view * mirrorMatrix(waterHeight);
+    unclippedProjection = projection;
+
+    // World plane, positive above the water; expressed in reflected view space for the oblique clip
+    const glm::vec4 clipPlane(0.0f, 1.0f, 0.0f, -(waterHeight + settings.clipOffset));
+    const glm::vec4 viewPlane = glm::transpose(glm::inverse(reflectedView)) * clipPlane;
+    obliqueProjection = obliqueNearPlane(projection, viewPlane);
+
+    // Mirrored frustum in world space (the mirror is part of the matrix),
+    // plus the water plane: anything fully below it cannot be reflected
+    frustum = Frustum::fromMatrix(projection * reflectedView);
+    frustum.addPlane(glm::vec4(0.0f, 1.0f, 0.0f, -waterHeight));
+
+    valid = true;
+    return true;
+}
+
+void PlanarReflection::bind() const
+{
+    target.bind();
+    glViewport(0, 0, rect.x, rect.y);
+    glClearColor(0.02f, 0.05f, 0.10f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void PlanarReflection::recordCulling(int drawn, int total)
+{
+    drawnMeshes = drawn;
+    totalMeshes = total;
+}
+
+glm::vec2 PlanarReflection::uvScale() const
+{
+    return glm::vec2(static_cast<float>(rect.x) / static_cast<float>(std::max(1, target.width())),
+                     static_cast<float>(rect.y) / static_cast<float>(std::max(1, target.height())));
+}
+
+glm::mat4 PlanarReflection::mirrorMatrix(float height)
+{
+    // Reflect y about the plane y = height
+    glm::mat4 mirror(1.0f);
+    mirror[1][1] = -1.0f;
+    mirror[3][1] = 2.0f * height;
+    return mirror;
+}
+
+glm::mat4 PlanarReflection::obliqueNearPlane(const glm::mat4 &projection, const glm::vec4 &viewSpacePlane)
+{
+    // Lengyel, "Oblique View Frustum Depth Projection and Clipping": q is the
+    // clip-space corner opposite the plane; scaling the plane so that the far
+    // plane still passes through q keeps the depth range as tight as possible
+    const auto sign = [](float v) { return v > 0.0f ? 1.0f : (v < 0.0f ? -1.0f : 0.0f); };
+    const glm::vec4 q = glm::inverse(projection) * glm::vec4(sign(viewSpacePlane.x), sign(viewSpacePlane.y), 1.0f, 1.0f);
+    const glm::vec4 c = viewSpacePlane * (2.0f / glm::dot(viewSpacePlane, q));
+
+    glm::mat4 result = projection;
+    for (int column = 0; column < 4; column++)
+        result[column][2] = c[column] - result[column][3];
+    return result;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "render/frustum.hpp"
+#include "render/render_target.hpp"
+
+struct PlanarReflectionSettings
+{
+    bool enabled = true;
+    float resolutionScale = 0.5f;   // per axis, relative to the scene render size
+    bool adaptiveSkip = true;       // reuse the last reflection while the camera is still
+    int maxSkippedFrames = 8;       // still camera: refresh at least this often (lights, moon)
+    float stillThreshold = 1e-4f;   // largest view-projection change that counts as still
+    float clipOffset = 0.01f;       // raise the clip plane to hide geometry touching the water
+};
+
+// Mirror image of the scene about a horizontal water plane. The scene is
+// rendered from the reflected camera at reduced resolution with an oblique
+// near plane (Lengyel) so nothing below the water leaks into the mirror, and
+// culled against the mirrored frustum plus the water plane. When the camera
+// has not moved, the previous reflection is reused for a few frames.
+class PlanarReflection
+{
+public:
+    PlanarReflectionSettings settings;
+
+    bool init(int outputWidth, int outputHeight);
+    void resize(int outputWidth, int outputHeight);
+    void shutdown();
+
+    // Sets up the mirrored matrices for this frame. Returns false when the
+    // last reflection can be reused (or the camera is below the water), so
+    // the caller skips the reflection pass.
+    bool beginFrame(const glm::mat4 &view, const glm::mat4 &projection, int renderWidth, int renderHeight,
+                    float waterHeight);
+    // Forces the next beginFrame to render (scene or light changes)
+    void invalidate() { valid = false; }
+
+    // Binds the reflection target and viewport and clears it
+    void bind() const;
+    void recordCulling(int drawn, int total);
+
+    const glm::mat4 &view() const { return reflectedView; }
+    const glm::mat4 &projection() const { return obliqueProjection; }
+    // Sky has no geometry below the water; draw it without the oblique clip
+    const glm::mat4 &skyProjection() const { return unclippedProjection; }
+    const Frustum &cullFrustum() const { return frustum; }
+
+    unsigned int texture() const { return target.colorTexture(); }
+    // Maps screen UV [0,1] onto the rendered sub-rect of the texture
+    glm::vec2 uvScale() const;
+    glm::ivec2 size() const { return rect; }
+    bool available() const { return valid; }
+
+    int meshesDrawn() const { return drawnMeshes; }
+    int meshesTotal() const { return totalMeshes; }
+    // Fraction of recent frames that reused the previous reflection
+    float skipRatio() const { return skippedAverage; }
+
+    static glm::mat4 mirrorMatrix(float height);
+    // Replaces the near plane of `projection` with a view-space clip plane
+    static glm::mat4 obliqueNearPlane(const glm::mat4 &projection, const glm::vec4 &viewSpacePlane);
+
+private:
+    void allocateTarget();
+
+    RenderTarget target;
+    int outputWidth = 1;
+    int outputHeight = 1;
+    float allocatedScale = 0.0f;
+    glm::ivec2 rect{1};
+
+    glm::mat4 reflectedView{1.0f};
+    glm::mat4 obliqueProjection{1.0f};
+    glm::mat4 unclippedProjection{1.0f};
+    Frustum frustum;
+
+    glm::mat4 lastViewProjection{0.0f};
+    float lastWaterHeight = 0.0f;
+    bool valid = false;
+    int framesSinceRefresh = 0;
+    float skippedAverage = 0.0f;
+
+    int drawnMeshes = 0;
+    int totalMeshes = 0;
+};
@@ -0,0 +1,151 @@
+#include "effects/ssao.hpp"
+
+#include <algorithm>
+#include <random>
+#include <string>
+
+bool Ssao::init(const std::filesystem::path &shaderRoot, int width, int height)
+{
+    depthShader = loadFullscreenShader(shaderRoot, "ssao_depth.frag");
+    ssaoShader = loadFullscreenShader(shaderRoot, "ssao.frag");
+    blurShader = loadFullscreenShader(shaderRoot, "ssao_blur.frag");
+    triangle.init();
+    buildKernel();
+
+    outputWidth = width;
+    outputHeight = height;
+    allocateTargets();
+    return linearDepth.framebuffer() != 0 && ao[0].framebuffer() != 0 && ao[1].framebuffer() != 0;
+}
+
+void Ssao::resize(int width, int height)
+{
+    if (width == outputWidth && height == outputHeight && allocatedDivisor == divisor())
+        return;
+    outputWidth = width;
+    outputHeight = height;
+    allocateTargets();
+}
+
+void Ssao::allocateTargets()
+{
+    // Sized for the full output; dynamic resolution only uses a sub-rect
+    allocatedDivisor = divisor();
+    const int w = std::max(1, (outputWidth + allocatedDivisor - 1) / allocatedDivisor);
+    const int h = std::max(1, (outputHeight + allocatedDivisor - 1) / allocatedDivisor);
+    linearDepth.init(w, h, GL_R32F, false);
+    ao[0].init(w, h, GL_R8, false);
+    ao[1].init(w, h, GL_R8, false);
+}
+
+void Ssao::shutdown()
+{
+    linearDepth.shutdown();
+    ao[0].shutdown();
+    ao[1].shutdown();
+    triangle.shutdown();
+    depthShader.reset();
+    ssaoShader.reset();
+    blurShader.reset();
+}
+
+void Ssao::buildKernel()
+{
+    // Fixed seed: the kernel is part of the look, it should not change per run
+    std::mt19937 rng(1337u);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    kernel.clear();
+    for (int i = 0; i < kMaxSamples; ++i)
+    {
+        glm::vec3 sample(unit(rng) * 2.0f - 1.0f, unit(rng) * 2.0f - 1.0f, unit(rng));
+        sample = glm::normalize(sample) * unit(rng);
+
+        // Cluster samples near the center, where occluders matter most
+        float scale = static_cast<float>(i) / kMaxSamples;
+        scale = 0.1f + 0.9f * scale * scale;
+        kernel.push_back(sample * scale);
+    }
+}
+
+void Ssao::render(const RenderTarget &scene, int renderWidth, int renderHeight, const glm::mat4 &projection)
+{
+    resize(outputWidth, outputHeight);
+    const int div = divisor();
+    aoRect = glm::ivec2(std::max(1, (renderWidth + div - 1) / div), std::max(1, (renderHeight + div - 1) / div));
+    const glm::ivec2 aoMax = aoRect - 1;
+
+    glDisable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+    glViewport(0, 0, aoRect.x, aoRect.y);
+
+    // Full-res hardware depth -> low-res linear depth
+    linearDepth.bind();
+    depthShader->use();
+    depthShader->setInt("depthTexture", 0);
+    depthShader->setInt("divisor", div);
+    glUniform2i(glGetUniformLocation(depthShader->ID, "sourceMax"), renderWidth - 1, renderHeight - 1);
+    depthShader->setVec2("depthParams", glm::vec2(projection[2][2], projection[3][2]));
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, scene.depthTexture());
+    triangle.draw();
+
+    // Occlusion
+    currentAo = 0;
+    ao[0].bind();
+    ssaoShader->use();
+    ssaoShader->setInt("linearDepth", 0);
+    ssaoShader->setVec2("aoSize", glm::vec2(aoRect));
+    glUniform4f(glGetUniformLocation(ssaoShader->ID, "projInfo"),
+                projection[0][0], projection[1][1], projection[2][0], projection[2][1]);
+    const int count = std::clamp(settings.sampleCount, 1, kMaxSamples);
+    ssaoShader->setInt("sampleCount", count);
+    ssaoShader->setFloat("radius", settings.radius);
+    ssaoShader->setFloat("power", settings.power);
+    for (int i = 0; i < count; ++i)
+        ssaoShader->setVec3("samples[" + std::to_string(i) + "]", kernel[i]);
+    glBindTexture(GL_TEXTURE_2D, linearDepth.colorTexture());
+    triangle.draw();
+
+    // Separable bilateral blur, ping-ponging between the two AO targets
+    if (settings.blur)
+    {
+        blurShader->use();
+        blurShader->setInt("aoTexture", 0);
+        blurShader->setInt("linearDepth", 1);
+        blurShader->setFloat("depthSharpness", settings.depthSharpness);
+        glUniform2i(glGetUniformLocation(blurShader->ID, "aoMax"), aoMax.x, aoMax.y);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, linearDepth.colorTexture());
+
+        const glm::ivec2 directions[2] = {glm::ivec2(1, 0), glm::ivec2(0, 1)};
+        for (const glm::ivec2 &direction : directions)
+        {
+            ao[1 - currentAo].bind();
+            glUniform2i(glGetUniformLocation(blurShader->ID, "direction"), direction.x, direction.y);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, ao[currentAo].colorTexture());
+            triangle.draw();
+            currentAo = 1 - currentAo;
+        }
+    }
+
+    glActiveTexture(GL_TEXTURE0);
+    glDepthMask(GL_TRUE);
+    glEnable(GL_DEPTH_TEST);
+}
+
+void Ssao::bindForLighting(Shader &shader) const
+{
+    shader.setBool("ssaoEnabled", settings.enabled);
+    shader.setInt("ssaoTexture", kAoTextureUnit);
+    shader.setInt("ssaoDepth", kDepthTextureUnit);
+    shader.setInt("ssaoDivisor", divisor());
+    glUniform2i(glGetUniformLocation(shader.ID, "ssaoMax"), aoRect.x - 1, aoRect.y - 1);
+
+    glActiveTexture(GL_TEXTURE0 + kAoTextureUnit);
+    glBindTexture(GL_TEXTURE_2D, ao[currentAo].colorTexture());
+    glActiveTexture(GL_TEXTURE0 + kDepthTextureUnit);
+    glBindTexture(GL_TEXTURE_2D, linearDepth.colorTexture());
+    glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "shader.hpp"
+#include "render/fullscreen_pass.hpp"
+#include "render/render_target.hpp"
+
+struct SsaoSettings
+{
+    bool enabled = true;
+    int resolutionDivisor = 2;      // 2 = half resolution, 4 = quarter
+    int sampleCount = 16;           // 1..Ssao::kMaxSamples
+    float radius = 1.5f;            // world units
+    float power = 1.5f;             // contrast of the final term
+    bool blur = true;
+    float depthSharpness = 16.0f;   // bilateral edge falloff (relative depth)
+};
+
+// Screen-space ambient occlusion computed at 1/2 or 1/4 resolution. The
+// depth prepass is reduced to linear depth, occlusion is sampled on a
+// hemisphere kernel, then blurred separably with depth-aware weights. The
+// lighting shader upsamples it with a 4-tap bilateral filter against the
+// same low-res depth, so edges stay crisp even though AO is computed on
+// 1/4 or 1/16 of the pixels.
+class Ssao
+{
+public:
+    static constexpr int kMaxSamples = 32;
+    static constexpr int kAoTextureUnit = 8;
+    static constexpr int kDepthTextureUnit = 9;
+
+    SsaoSettings settings;
+
+    bool init(const std::filesystem::path &shaderRoot, int outputWidth, int outputHeight);
+    void resize(int outputWidth, int outputHeight);
+    void shutdown();
+
+    // `scene` holds the prepass depth in its lower-left renderWidth x
+    // renderHeight sub-rect; `projection` is the one it was rendered with.
+    void render(const RenderTarget &scene, int renderWidth, int renderHeight, const glm::mat4 &projection);
+
+    // Binds the AO and its depth on high texture units (clear of material
+    // maps) and sets the sampling uniforms of the lighting shader.
+    void bindForLighting(Shader &shader) const;
+
+    unsigned int texture() const { return ao[currentAo].colorTexture(); }
+    glm::ivec2 aoSize() const { return aoRect; }
+
+private:
+    void allocateTargets();
+    void buildKernel();
+    int divisor() const { return settings.resolutionDivisor >= 4 ? 4 : 2; }
+
+    std::unique_ptr<Shader> depthShader;
+    std::unique_ptr<Shader> ssaoShader;
+    std::unique_ptr<Shader> blurShader;
+    FullscreenTriangle triangle;
+
+    RenderTarget linearDepth;
+    RenderTarget ao[2];
+    int currentAo = 0;
+    int allocatedDivisor = 0;
+
+    std::vector<glm::vec3> kernel;
+    int outputWidth = 1;
+    int outputHeight = 1;
+    glm::ivec2 aoRect{1};
+};
@@ -0,0 +1,234 @@
+#include "effects/volumetric_fog.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+namespace
+{
+    unsigned int createVolume(const glm::ivec3 &size)
+    {
+        unsigned int texture = 0;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_3D, texture);
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F, size.x, size.y, size.z, 0, GL_RGBA, GL_HALF_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_3D, 0);
+        return texture;
+    }
+
+    unsigned int createPlane(const glm::ivec3 &size)
+    {
+        unsigned int texture = 0;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, size.x, size.y, 0, GL_RGBA, GL_HALF_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return texture;
+    }
+
+    void setProjectionInfo(const Shader &shader, const glm::mat4 &projection)
+    {
+        glUniform4f(glGetUniformLocation(shader.ID, "projInfo"), projection[0][0], projection[1][1], projection[2][0],
+                    projection[2][1]);
+    }
+}
+
+bool VolumetricFog::init(const std::filesystem::path &shaderRoot, float aspect)
+{
+    injectShader = loadFullscreenShader(shaderRoot, "fog_inject.frag");
+    integrateShader = loadFullscreenShader(shaderRoot, "fog_integrate.frag");
+    triangle.init();
+
+    aspectRatio = aspect;
+    grid = gridForBudget(aspect);
+    allocate();
+    return !injectFramebuffers.empty() && injectShader->ID != 0 && integrateShader->ID != 0;
+}
+
+glm::ivec3 VolumetricFog::gridForBudget(float aspect) const
+{
+    // Fixed slice count; the remaining budget is split into a grid with the
+    // aspect ratio of the view so froxels stay roughly square on screen
+    const int slices = std::clamp(settings.sliceCount, 16, 128);
+    const double perSlice = static_cast<double>(std::max(settings.froxelBudget, slices)) / slices;
+    const int height = std::max(1, static_cast<int>(std::sqrt(perSlice / std::max(aspect, 0.1f))));
+    const int width = std::max(1, static_cast<int>(perSlice / height));
+    return glm::ivec3(width, height, slices);
+}
+
+void VolumetricFog::resize(float aspect)
+{
+    aspectRatio = aspect;
+    const glm::ivec3 wanted = gridForBudget(aspect);
+    if (wanted == grid)
+        return;
+    grid = wanted;
+    allocate();
+}
+
+void VolumetricFog::allocate()
+{
+    release();
+
+    scatteringVolume = createVolume(grid);
+    integratedVolume = createVolume(grid);
+    running[0] = createPlane(grid);
+    running[1] = createPlane(grid);
+
+    injectFramebuffers.resize(grid.z);
+    integrateFramebuffers.resize(grid.z);
+    glGenFramebuffers(grid.z, injectFramebuffers.data());
+    glGenFramebuffers(grid.z, integrateFramebuffers.data());
+
+    const GLenum drawBuffers[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    for (int slice = 0; slice < grid.z; ++slice)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, injectFramebuffers[slice]);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, scatteringVolume, 0, slice);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, integrateFramebuffers[slice]);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, integratedVolume, 0, slice);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, running[slice % 2], 0);
+        glDrawBuffers(2, drawBuffers);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            std::cerr << "Froxel fog framebuffer incomplete" << std::endl;
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            release();
+            return;
+        }
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    rendered = false;
+}
+
+void VolumetricFog::release()
+{
+    if (!injectFramebuffers.empty())
+        glDeleteFramebuffers(static_cast<GLsizei>(injectFramebuffers.size()), injectFramebuffers.data());
+    if (!integrateFramebuffers.empty())
+        glDeleteFramebuffers(static_cast<GLsizei>(integrateFramebuffers.size()), integrateFramebuffers.data());
+    injectFramebuffers.clear();
+    integrateFramebuffers.clear();
+
+    const unsigned int textures[4] = {scatteringVolume, integratedVolume, running[0], running[1]};
+    for (unsigned int texture : textures)
+    {
+        if (texture != 0)
+            glDeleteTextures(1, &texture);
+    }
+    scatteringVolume = integratedVolume = running[0] = running[1] = 0;
+}
+
+void VolumetricFog::shutdown()
+{
+    release();
+    triangle.shutdown();
+    injectShader.reset();
+    integrateShader.reset();
+}
+
+void VolumetricFog::render(const glm::mat4 &view, const glm::mat4 &projection, const FogLights &lights,
+                           float timeSeconds, GpuProfiler &profiler)
+{
+    resize(aspectRatio);
+    if (injectFramebuffers.empty())
+        return;
+
+    const glm::vec2 depthRange(settings.nearDepth, std::max(settings.range, settings.nearDepth + 1.0f));
+    glDisable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+    glViewport(0, 0, grid.x, grid.y);
+
+    // Inject: density and lighting per froxel
+    profiler.begin("Fog Inject");
+    injectShader->use();
+    injectShader->setInt("sliceCount", grid.z);
+    injectShader->setVec2("depthRange", depthRange);
+    injectShader->setMat4("invView", glm::inverse(view));
+    setProjectionInfo(*injectShader, projection);
+    injectShader->setFloat("time", timeSeconds);
+    injectShader->setFloat("density", settings.density);
+    injectShader->setFloat("heightFalloff", settings.heightFalloff);
+    injectShader->setFloat("baseHeight", settings.baseHeight);
+    injectShader->setFloat("noiseAmount", settings.noiseAmount);
+    injectShader->setVec3("wind", glm::vec3(1.0f, 0.1f, 0.4f) * settings.windSpeed * 0.15f);
+    injectShader->setVec3("albedo", settings.albedo);
+    injectShader->setFloat("anisotropy", settings.anisotropy);
+
+    injectShader->setVec3("moonDirection", glm::normalize(lights.moonDirection));
+    injectShader->setVec3("moonColor", lights.moonColor * settings.moonIntensity);
+    const int lampCount = std::min(static_cast<int>(lights.lampPositions.size()), kMaxLamps);
+    for (int i = 0; i < lampCount; ++i)
+        injectShader->setVec3("lampPositions[" + std::to_string(i) + "]", lights.lampPositions[i]);
+    injectShader->setInt("lampCount", lampCount);
+    injectShader->setVec3("lampColor", lights.lampColor * settings.lampIntensity);
+    const float coneOuter = glm::radians(settings.lampConeAngle + 10.0f);
+    const float coneInner = glm::radians(std::max(settings.lampConeAngle - 10.0f, 0.0f));
+    injectShader->setVec2("lampCone", glm::vec2(std::cos(coneOuter), std::cos(coneInner)));
+    injectShader->setBool("flashlightOn", lights.flashlightOn);
+    injectShader->setVec3("flashlightPosition", lights.flashlightPosition);
+    injectShader->setVec3("flashlightDirection", glm::normalize(lights.flashlightDirection));
+    injectShader->setVec2("flashlightCone", glm::vec2(std::cos(glm::radians(lights.flashlightOuterAngle)),
+                                                      std::cos(glm::radians(lights.flashlightInnerAngle))));
+    injectShader->setVec3("flashlightColor", glm::vec3(1.0f, 1.0f, 0.9f) * settings.flashlightIntensity);
+
+    for (int slice = 0; slice < grid.z; ++slice)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, injectFramebuffers[slice]);
+        injectShader->setInt("slice", slice);
+        triangle.draw();
+    }
+    profiler.end("Fog Inject");
+
+    // Integrate front to back, carrying the running sum between slices
+    profiler.begin("Fog Integrate");
+    integrateShader->use();
+    integrateShader->setInt("scattering", 0);
+    integrateShader->setInt("previous", 1);
+    integrateShader->setInt("sliceCount", grid.z);
+    integrateShader->setVec2("depthRange", depthRange);
+    setProjectionInfo(*integrateShader, projection);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_3D, scatteringVolume);
+    for (int slice = 0; slice < grid.z; ++slice)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, integrateFramebuffers[slice]);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, running[(slice + 1) % 2]);
+        integrateShader->setInt("slice", slice);
+        triangle.draw();
+    }
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    profiler.end("Fog Integrate");
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDepthMask(GL_TRUE);
+    glEnable(GL_DEPTH_TEST);
+    rendered = true;
+}
+
+void VolumetricFog::bindForShading(Shader &shader, const glm::vec2 &viewportSize) const
+{
+    const bool active = settings.enabled && rendered && integratedVolume != 0;
+    shader.setBool("fogEnabled", active);
+    shader.setInt("fogVolume", kTextureUnit);
+    shader.setVec2("fogViewport", viewportSize);
+    shader.setVec2("fogDepthRange", glm::vec2(settings.nearDepth, std::max(settings.range, settings.nearDepth + 1.0f)));
+
+    glActiveTexture(GL_TEXTURE0 + kTextureUnit);
+    glBindTexture(GL_TEXTURE_3D, integratedVolume);
+    glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "shader.hpp"
+#include "render/fullscreen_pass.hpp"
+#include "render/gpu_timer.hpp"
+
+struct VolumetricFogSettings
+{
+    bool enabled = true;
+    int froxelBudget = 160 * 90 * 64;   // upper bound on grid cells; sets the cost
+    int sliceCount = 64;                // exponentially distributed depth slices
+    float nearDepth = 0.25f;
+    float range = 120.0f;               // view depth covered by the volume
+    float density = 0.01f;              // extinction per unit length at the base height
+    float heightFalloff = 0.08f;
+    float baseHeight = 0.0f;
+    float noiseAmount = 0.5f;
+    float windSpeed = 0.6f;
+    float anisotropy = 0.55f;           // Henyey-Greenstein g, > 0 scatters forward
+    glm::vec3 albedo{0.9f, 0.9f, 1.0f};
+    float moonIntensity = 1.0f;
+    float lampIntensity = 10.0f;
+    float lampConeAngle = 55.0f;        // half angle of the lit cone below each lamp (degrees)
+    float flashlightIntensity = 2.0f;
+    float budgetMs = 1.0f;
+};
+
+// Lights that scatter in the fog, gathered from the scene each frame
+struct FogLights
+{
+    glm::vec3 moonDirection{0.0f, -1.0f, 0.0f}; // direction the light travels
+    glm::vec3 moonColor{0.0f};
+    std::vector<glm::vec3> lampPositions;       // enabled lamps only
+    glm::vec3 lampColor{0.0f};
+    bool flashlightOn = false;
+    glm::vec3 flashlightPosition{0.0f};
+    glm::vec3 flashlightDirection{0.0f, 0.0f, -1.0f};
+    float flashlightInnerAngle = 20.0f;         // degrees
+    float flashlightOuterAngle = 35.0f;
+};
+
+// Volumetric fog in a view-aligned froxel grid. Density and lighting are
+// injected once per froxel (3D texture, one pass per slice), then integrated
+// front to back into a second volume of (in-scattered radiance,
+// transmittance). Surfaces and the sky apply fog with one trilinear fetch at
+// their depth, so the per-pixel cost is independent of light count and the
+// volume cost is set by the froxel budget rather than the screen resolution.
+class VolumetricFog
+{
+public:
+    static constexpr int kTextureUnit = 10;
+    static constexpr int kMaxLamps = 8;
+
+    VolumetricFogSettings settings;
+
+    bool init(const std::filesystem::path &shaderRoot, float aspect);
+    // Re-derives the grid from the budget and the output aspect ratio
+    void resize(float aspect);
+    void shutdown();
+
+    // Builds the volume for this frame. `projection` should be unjittered.
+    void render(const glm::mat4 &view, const glm::mat4 &projection, const FogLights &lights, float timeSeconds,
+                GpuProfiler &profiler);
+
+    // Binds the integrated volume and sets the lookup uniforms on a shader
+    // that includes the fog application code (shader.frag, skybox.frag, water.frag, impostor.frag)
+    void bindForShading(Shader &shader, const glm::vec2 &viewportSize) const;
+
+    glm::ivec3 gridSize() const { return grid; }
+    long long froxelCount() const { return static_cast<long long>(grid.x) * grid.y * grid.z; }
+
+private:
+    void allocate();
+    void release();
+    glm::ivec3 gridForBudget(float aspect) const;
+
+    std::unique_ptr<Shader> injectShader;
+    std::unique_ptr<Shader> integrateShader;
+    FullscreenTriangle triangle;
+
+    unsigned int scatteringVolume = 0;
+    unsigned int integratedVolume = 0;
+    unsigned int running[2] = {0, 0};
+    std::vector<unsigned int> injectFramebuffers;    // one per slice
+    std::vector<unsigned int> integrateFramebuffers; // one per slice (slice + running target)
+
+    glm::ivec3 grid{0};
+    float aspectRatio = 16.0f / 9.0f;
+    bool rendered = false;
+};
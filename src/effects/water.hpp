@@ -8,6 +8,23 @@ struct WaterSettings
     float waveStrength = 0.02f;
     glm::vec3 deepColor{0.0f, 0.05f, 0.08f};
     glm::vec3 shallowColor{0.05f, 0.15f, 0.2f};
+
+    // FFT ocean on open water (bodies with a hard edge, e.g. the canal)
+    bool oceanEnabled = true;
+    int oceanResolution = 128;          // FFT grid per side, power of two in [64, 512]
+    float oceanPatchSize = 32.0f;       // world size of one repeating tile
+    float windSpeed = 6.0f;             // m/s, sets the dominant wavelength (v^2 / g)
+    glm::vec2 windDirection{1.0f, 0.3f};
+    float oceanAmplitude = 1.0f;        // scales the Phillips spectrum
+    float choppiness = 1.0f;            // horizontal displacement, sharpens crests
+};
+
+// Rectangular water surface on the shared water plane (x/z in world space)
+struct WaterBody
+{
+    glm::vec2 center{0.0f};
+    glm::vec2 halfExtent{1.0f};
+    float edgeSoftness = 0.0f;  // fraction of the extent faded out at the rim (puddles), 0 = hard edge
 };
 
 struct SkyboxSettings
@@ -0,0 +1,203 @@
+#include "effects/water_renderer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include <glad/glad.h>
+
+namespace
+{
+    constexpr int kNormalMapSize = 128;
+    constexpr int kWaveCount = 24;
+    constexpr float kNormalTiling = 0.35f; // slope map repeats per world unit
+    constexpr float kOceanCellSize = 0.5f; // grid spacing of displaced open water
+}
+
+bool WaterRenderer::init(const std::vector<WaterBody> &bodies, float height)
+{
+    waterHeight = height;
+
+    // Triangles per body: position, then (rim coordinate in [-1,1], edge softness).
+    // Puddles are a single quad; open water is subdivided for the ocean displacement.
+    std::vector<float> vertices;
+    for (const WaterBody &body : bodies)
+    {
+        int cellsX = 1;
+        int cellsZ = 1;
+        if (body.edgeSoftness <= 0.0f)
+        {
+            cellsX = std::max(1, static_cast<int>(std::ceil(2.0f * body.halfExtent.x / kOceanCellSize)));
+            cellsZ = std::max(1, static_cast<int>(std::ceil(2.0f * body.halfExtent.y / kOceanCellSize)));
+        }
+        const auto corner = [&](int x, int z) {
+            const glm::vec2 rim(2.0f * static_cast<float>(x) / cellsX - 1.0f, 2.0f * static_cast<float>(z) / cellsZ - 1.0f);
+            const glm::vec2 xz = body.center + rim * body.halfExtent;
+            vertices.insert(vertices.end(), {xz.x, height, xz.y, rim.x, rim.y, body.edgeSoftness});
+        };
+        for (int z = 0; z < cellsZ; z++)
+        {
+            for (int x = 0; x < cellsX; x++)
+            {
+                corner(x, z);
+                corner(x + 1, z);
+                corner(x + 1, z + 1);
+                corner(x + 1, z + 1);
+                corner(x, z + 1);
+                corner(x, z);
+            }
+        }
+    }
+    vertexCount = static_cast<int>(vertices.size() / 6);
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertices.size() * sizeof(float)), vertices.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)(3 * sizeof(float)));
+    glBindVertexArray(0);
+
+    createNormalMap();
+    return vao != 0 && normalMap != 0 && fftOcean.init();
+}
+
+void WaterRenderer::update(const WaterSettings &settings, float timeSeconds, JobSystem &jobs)
+{
+    fftOcean.update(settings, timeSeconds, jobs);
+    fftOcean.updateBenchmark(settings, jobs);
+}
+
+void WaterRenderer::createNormalMap()
+{
+    // Sum of sine waves with integer wave vectors, so the map tiles exactly.
+    // Slopes are stored instead of normals: the shader scales them by waveStrength.
+    struct Wave
+    {
+        glm::vec2 k;
+        float amplitude;
+        float phase;
+    };
+    std::mt19937 rng(2024u);
+    std::uniform_int_distribution<int> frequency(-7, 7);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<Wave> waves;
+    while (static_cast<int>(waves.size()) < kWaveCount)
+    {
+        const glm::vec2 k(static_cast<float>(frequency(rng)), static_cast<float>(frequency(rng)));
+        const float length = glm::length(k);
+        if (length < 1.0f)
+            continue;
+        waves.push_back({k, 1.0f / (length * length), unit(rng) * 6.2831853f});
+    }
+
+    std::vector<glm::vec2> slopes(kNormalMapSize * kNormalMapSize, glm::vec2(0.0f));
+    float maxSlope = 0.0f;
+    for (int y = 0; y < kNormalMapSize; y++)
+    {
+        for (int x = 0; x < kNormalMapSize; x++)
+        {
+            const glm::vec2 uv(static_cast<float>(x) / kNormalMapSize, static_cast<float>(y) / kNormalMapSize);
+            glm::vec2 slope(0.0f);
+            for (const Wave &wave : waves)
+            {
+                const float angle = 6.2831853f * glm::dot(wave.k, uv) + wave.phase;
+                slope += wave.k * (wave.amplitude * std::cos(angle));
+            }
+            slopes[y * kNormalMapSize + x] = slope;
+            maxSlope = std::max(maxSlope, std::max(std::fabs(slope.x), std::fabs(slope.y)));
+        }
+    }
+
+    std::vector<unsigned char> texels(slopes.size() * 2);
+    for (std::size_t i = 0; i < slopes.size(); i++)
+    {
+        const glm::vec2 encoded = slopes[i] / std::max(maxSlope, 1e-6f) * 0.5f + 0.5f;
+        texels[i * 2 + 0] = static_cast<unsigned char>(std::lround(encoded.x * 255.0f));
+        texels[i * 2 + 1] = static_cast<unsigned char>(std::lround(encoded.y * 255.0f));
+    }
+
+    glGenTextures(1, &normalMap);
+    glBindTexture(GL_TEXTURE_2D, normalMap);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, kNormalMapSize, kNormalMapSize, 0, GL_RG, GL_UNSIGNED_BYTE, texels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void WaterRenderer::shutdown()
+{
+    fftOcean.shutdown();
+    if (normalMap != 0)
+        glDeleteTextures(1, &normalMap);
+    if (vbo != 0)
+        glDeleteBuffers(1, &vbo);
+    if (vao != 0)
+        glDeleteVertexArrays(1, &vao);
+    normalMap = vbo = vao = 0;
+    vertexCount = 0;
+}
+
+void WaterRenderer::render(Shader &shader, const WaterSettings &settings, const glm::mat4 &view,
+                           const glm::mat4 &projection, const PlanarReflection &reflection,
+                           const glm::vec3 &moonDirection, const glm::vec3 &moonColor,
+                           const glm::vec2 &viewportSize, float timeSeconds) const
+{
+    if (vertexCount == 0)
+        return;
+
+    shader.use();
+    shader.setMat4("view", view);
+    shader.setMat4("projection", projection);
+    shader.setVec3("viewPos", glm::vec3(glm::inverse(view)[3]));
+    shader.setFloat("time", timeSeconds);
+    shader.setFloat("waveSpeed", settings.waveSpeed);
+    shader.setFloat("waveStrength", settings.waveStrength);
+    shader.setFloat("normalTiling", kNormalTiling);
+    shader.setVec3("deepColor", settings.deepColor);
+    shader.setVec3("shallowColor", settings.shallowColor);
+    shader.setVec3("moonDirection", moonDirection);
+    shader.setVec3("moonColor", moonColor);
+    shader.setVec2("viewportSize", viewportSize);
+    shader.setBool("reflectionEnabled", reflection.available());
+    shader.setVec2("reflectionUvScale", reflection.uvScale());
+    shader.setInt("reflectionTexture", kReflectionTextureUnit);
+    shader.setInt("normalMap", kNormalTextureUnit);
+    shader.setBool("oceanEnabled", settings.oceanEnabled && fftOcean.ready());
+    shader.setFloat("oceanPatchSize", fftOcean.patchSize());
+    shader.setInt("oceanDisplacement", kOceanDisplacementUnit);
+    shader.setInt("oceanSlopes", kOceanSlopeUnit);
+
+    glActiveTexture(GL_TEXTURE0 + kReflectionTextureUnit);
+    glBindTexture(GL_TEXTURE_2D, reflection.texture());
+    glActiveTexture(GL_TEXTURE0 + kNormalTextureUnit);
+    glBindTexture(GL_TEXTURE_2D, normalMap);
+    glActiveTexture(GL_TEXTURE0 + kOceanDisplacementUnit);
+    glBindTexture(GL_TEXTURE_2D, fftOcean.displacementTexture());
+    glActiveTexture(GL_TEXTURE0 + kOceanSlopeUnit);
+    glBindTexture(GL_TEXTURE_2D, fftOcean.slopeTexture());
+    glActiveTexture(GL_TEXTURE0);
+
+    // Puddles sit on the road surface: pull them forward instead of lifting the plane
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(-1.0f, -1.0f);
+
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+    glBindVertexArray(0);
+
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+}
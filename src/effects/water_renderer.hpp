@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "shader.hpp"
+#include "core/job_system.hpp"
+#include "effects/fft_ocean.hpp"
+#include "effects/planar_reflection.hpp"
+#include "effects/water.hpp"
+
+// Draws the scene's water bodies as one static vertex buffer on the water
+// plane. Puddle waves are two scrolling samples of a tiling slope map:
+// `waveSpeed` scrolls them, `waveStrength` distorts the planar reflection and
+// tilts the normal. Open water (hard-edged bodies) is a finer grid displaced
+// by the FFT ocean instead. Reflection and body color are mixed by Schlick
+// Fresnel; puddles fade out at their rim.
+class WaterRenderer
+{
+public:
+    static constexpr int kReflectionTextureUnit = 0;
+    static constexpr int kNormalTextureUnit = 1;
+    static constexpr int kOceanDisplacementUnit = 2;
+    static constexpr int kOceanSlopeUnit = 3;
+
+    bool init(const std::vector<WaterBody> &bodies, float height);
+    void shutdown();
+
+    // Steps the FFT ocean and streams its maps; call once per frame
+    void update(const WaterSettings &settings, float timeSeconds, JobSystem &jobs);
+
+    // Blends over the opaque scene (depth-tested, not written). `shader` is
+    // water.vert/frag with the fog uniforms already bound.
+    void render(Shader &shader, const WaterSettings &settings, const glm::mat4 &view, const glm::mat4 &projection,
+                const PlanarReflection &reflection, const glm::vec3 &moonDirection, const glm::vec3 &moonColor,
+                const glm::vec2 &viewportSize, float timeSeconds) const;
+
+    float height() const { return waterHeight; }
+    FftOcean &ocean() { return fftOcean; }
+    const FftOcean &ocean() const { return fftOcean; }
+
+private:
+    void createNormalMap();
+
+    FftOcean fftOcean;
+
+    unsigned int vao = 0;
+    unsigned int vbo = 0;
+    unsigned int normalMap = 0;
+    int vertexCount = 0;
+    float waterHeight = 0.0f;
+};
@@ -12,10 +12,26 @@
 #include "camera.hpp"
 #include "shader.hpp"
 #include "city_scene.hpp"
+#include "core/job_system.hpp"
+#include "effects/bloom.hpp"
+#include "effects/planar_reflection.hpp"
+#include "effects/ssao.hpp"
+#include "effects/volumetric_fog.hpp"
+#include "effects/water_renderer.hpp"
+#include "particles/particle_system.hpp"
+#include "render/dynamic_resolution.hpp"
+#include "render/gl43.hpp"
+#include "render/gpu_timer.hpp"
+#include "render/post_process.hpp"
+#include "render/render_target.hpp"
+#include "render/temporal_upscaler.hpp"
 
+#include <algorithm>
 #include <array>
+#include <cstdlib>
 #include <filesystem>
 #include <iostream>
+#include <string>
 
 namespace
 {
@@ -31,6 +47,31 @@ namespace
     float lastFrame = 0.0f;
     bool isPaused = false;
     bool showControlPanel = false;  // P key control panel
+
+    // Actual framebuffer size (differs from SCR_* on HiDPI or after resize)
+    int framebufferWidth = SCR_WIDTH;
+    int framebufferHeight = SCR_HEIGHT;
+
+    // The 3D scene renders offscreen at a dynamic scale, then is upscaled
+    enum class UpscaleMode
+    {
+        Bilinear,
+        Temporal,
+    };
+    UpscaleMode upscaleMode = UpscaleMode::Bilinear;
+
+    RenderTarget sceneTarget;
+    DynamicResolution dynamicResolution;
+    TemporalUpscaler temporalUpscaler;
+    PostProcess postProcess;
+    Bloom bloom;
+    Ssao ssao;
+    VolumetricFog volumetricFog;
+    PlanarReflection planarReflection;
+    WaterRenderer waterRenderer;
+    ParticleSystem particles;
+    JobSystem jobSystem;
+    GpuProfiler gpuProfiler;
 }
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
@@ -38,23 +79,68 @@ void mouse_callback(GLFWwindow *window, double xpos, double ypos);
 void scroll_callback(GLFWwindow *window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window, CityScene &cityScene);
 void renderControlPanel(CityScene &cityScene, float fps);
+void renderLoadingWindow(CityScene &cityScene);
 
-int main()
+int main(int argc, char **argv)
 {
+    // --bake-impostors: cook the impostor atlas cache in a hidden window and exit
+    // --district N [--seed S]: start in an N x N generated district (scale tests)
+    // --import-benchmark [assimp]: time the city import with the glTF reader (or Assimp) and exit
+    // --import-threads N: threads for the per-mesh import work (default: all)
+    bool cookImpostors = false;
+    bool benchmarkImport = false;
+    ModelImportOptions importOptions;
+    int districtBlocks = 0;
+    unsigned int districtSeed = CityGeneratorSettings{}.seed;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--bake-impostors")
+            cookImpostors = true;
+        else if (arg == "--district" && i + 1 < argc)
+            districtBlocks = std::atoi(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc)
+            districtSeed = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--import-benchmark")
+        {
+            benchmarkImport = true;
+            if (i + 1 < argc && std::string(argv[i + 1]) == "assimp")
+            {
+                importOptions.nativeGltf = false;
+                i++;
+            }
+        }
+        else if (arg == "--import-threads" && i + 1 < argc)
+            importOptions.threads = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+    }
+    if (benchmarkImport)
+        return CityScene::benchmarkImport(importOptions) ? 0 : -1;
+
     if (!glfwInit())
     {
         std::cerr << "Failed to init GLFW" << std::endl;
         return -1;
     }
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
+    if (cookImpostors)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
-    GLFWwindow *window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearningOpenGL - City Scaffold", nullptr, nullptr);
+    // 4.3 core enables the GPU-driven path (compute culling, indirect draws);
+    // everything else needs 3.3 core
+    GLFWwindow *window = nullptr;
+    const int contextVersions[][2] = {{4, 3}, {3, 3}};
+    for (const auto &version : contextVersions)
+    {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, version[0]);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, version[1]);
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearningOpenGL - City Scaffold", nullptr, nullptr);
+        if (window)
+            break;
+    }
     if (!window)
     {
         std::cerr << "Failed to create GLFW window" << std::endl;
@@ -74,6 +160,17 @@ int main()
         std::cerr << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    if (cookImpostors)
+    {
+        CityScene cooker;
+        const bool cooked = cooker.cookImpostors();
+        cooker.shutdown();
+        glfwTerminate();
+        return cooked ? 0 : -1;
+    }
+    if (!gl43::load(reinterpret_cast<GLADloadproc>(glfwGetProcAddress)))
+        std::cout << "OpenGL " << GLVersion.major << '.' << GLVersion.minor
+                  << ": GPU-driven rendering needs 4.3, drawing on the 3.3 path" << std::endl;
 
     // Initialize ImGui
     IMGUI_CHECKVERSION();
@@ -85,7 +182,46 @@ int main()
 
     glEnable(GL_DEPTH_TEST);
 
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    // HDR scene color: R11G11B10F is half the bandwidth of RGBA16F and needs no alpha
+    if (!sceneTarget.init(framebufferWidth, framebufferHeight, GL_R11F_G11F_B10F))
+    {
+        std::cerr << "Failed to create scene render target" << std::endl;
+        return -1;
+    }
+
     const std::filesystem::path shaderRoot = std::filesystem::path(SHADER_DIR);
+    if (!temporalUpscaler.init(shaderRoot, framebufferWidth, framebufferHeight))
+    {
+        std::cerr << "Failed to create temporal upscaler targets" << std::endl;
+        return -1;
+    }
+    if (!bloom.init(shaderRoot, framebufferWidth, framebufferHeight))
+    {
+        std::cerr << "Failed to create bloom mip chain" << std::endl;
+        return -1;
+    }
+    if (!ssao.init(shaderRoot, framebufferWidth, framebufferHeight))
+    {
+        std::cerr << "Failed to create SSAO targets" << std::endl;
+        return -1;
+    }
+    if (!volumetricFog.init(shaderRoot, static_cast<float>(framebufferWidth) / static_cast<float>(framebufferHeight)))
+    {
+        std::cerr << "Failed to create volumetric fog volumes" << std::endl;
+        return -1;
+    }
+    if (!planarReflection.init(framebufferWidth, framebufferHeight))
+    {
+        std::cerr << "Failed to create planar reflection target" << std::endl;
+        return -1;
+    }
+    if (!postProcess.init(shaderRoot))
+    {
+        std::cerr << "Failed to create post-processing shader" << std::endl;
+        return -1;
+    }
+
     const auto vertexPath = shaderRoot / "shader.vert";
     const auto fragmentPath = shaderRoot / "shader.frag";
     Shader shader(vertexPath.string().c_str(), fragmentPath.string().c_str());
@@ -98,12 +234,40 @@ int main()
     skyboxShader.use();
     skyboxShader.setInt("skybox", 0);
 
+    const auto depthVert = shaderRoot / "depth.vert";
+    const auto depthFrag = shaderRoot / "depth.frag";
+    Shader depthShader(depthVert.string().c_str(), depthFrag.string().c_str());
+
+    const auto lampVert = shaderRoot / "lampshader.vert";
+    const auto lampFrag = shaderRoot / "lampshader.frag";
+    Shader lampShader(lampVert.string().c_str(), lampFrag.string().c_str());
+
+    const auto waterVert = shaderRoot / "water.vert";
+    const auto waterFrag = shaderRoot / "water.frag";
+    Shader waterShader(waterVert.string().c_str(), waterFrag.string().c_str());
+
     CityScene cityScene;
+    cityScene.getLoadSettings().importThreads = importOptions.threads;
     if (!cityScene.init())
     {
         std::cerr << "Failed to initialize city scene" << std::endl;
         return -1;
     }
+    // A district is generated from the whole city, so it waits for the load
+    bool districtPending = districtBlocks > 0;
+
+    if (!particles.init(shaderRoot))
+    {
+        std::cerr << "Failed to create particle shaders" << std::endl;
+        return -1;
+    }
+    particles.attachToStreetLamps(cityScene.getStreetLampPositions());
+
+    if (!waterRenderer.init(cityScene.getWaterBodies(), CityScene::kWaterLevel))
+    {
+        std::cerr << "Failed to create water surfaces" << std::endl;
+        return -1;
+    }
 
     while (!glfwWindowShouldClose(window))
     {
@@ -125,35 +289,250 @@ int main()
         }
 
         processInput(window, cityScene);
+        camera.TrackVelocity(deltaTime);
 
         // Start ImGui frame
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
-        glClearColor(0.02f, 0.05f, 0.10f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
+        cityScene.updateLoading();
+        if (districtPending && !cityScene.isLoading())
+        {
+            CityGeneratorSettings &district = cityScene.getDistrictSettings();
+            district.enabled = true;
+            district.blocksPerSide = districtBlocks;
+            district.seed = districtSeed;
+            cityScene.regenerateDistrict();
+            districtPending = false;
+        }
         if (!isPaused)
         {
             cityScene.update(deltaTime, currentFrame);
         }
-        
-        const float aspect = static_cast<float>(SCR_WIDTH) / static_cast<float>(SCR_HEIGHT);
+        cityScene.updateBakes();
+        cityScene.updateStreaming(camera.Position, camera.Velocity);
+
+        // Pick this frame's render resolution from the GPU time of earlier frames
+        dynamicResolution.update(gpuProfiler.lastMs("Frame"));
+        sceneTarget.resize(framebufferWidth, framebufferHeight);
+        temporalUpscaler.resize(framebufferWidth, framebufferHeight);
+        bloom.resize(framebufferWidth, framebufferHeight);
+        ssao.resize(framebufferWidth, framebufferHeight);
+        planarReflection.resize(framebufferWidth, framebufferHeight);
+        const int renderWidth = dynamicResolution.scaledWidth(framebufferWidth);
+        const int renderHeight = dynamicResolution.scaledHeight(framebufferHeight);
+        const bool temporal = upscaleMode == UpscaleMode::Temporal;
+        if (temporal)
+        {
+            temporalUpscaler.beginFrame(renderWidth, renderHeight);
+        }
+
+        gpuProfiler.begin("Frame");
+
+        // Particle emitters follow the lamps' on/off state; simulation freezes while paused
+        if (!isPaused)
+        {
+            for (int i = 0; i < 8; i++)
+            {
+                particles.setStreetLampEnabled(i, cityScene.isStreetLampEnabled(i));
+            }
+            particles.update(deltaTime, camera.Position, jobSystem, gpuProfiler);
+            // FFT ocean for the canal, streamed into the water shader's maps
+            waterRenderer.update(cityScene.getWaterSettings(), currentFrame, jobSystem);
+        }
+
+        const float aspect = static_cast<float>(framebufferWidth) / static_cast<float>(framebufferHeight);
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), aspect, 0.1f, 200.0f);
         glm::mat4 view = camera.GetViewMatrix();
+        // Temporal upscaling renders with a sub-pixel jitter; history reprojection uses the unjittered matrix
+        const glm::mat4 sceneProjection = temporal ? temporalUpscaler.jitterProjection(projection) : projection;
 
         // Update flashlight position/direction from camera
         cityScene.setFlashlightParams(camera.Position, camera.Front);
+        // Small-meshlet culling measures projected size in scene pixels
+        cityScene.getMeshletSettings().viewportHeight = static_cast<float>(renderHeight);
+        cityScene.getHlodSettings().viewportHeight = static_cast<float>(renderHeight);
+
+        // Froxel fog volume: lit by the moon, the enabled street lamps and the flashlight
+        if (volumetricFog.settings.enabled)
+        {
+            FogLights fogLights;
+            fogLights.moonDirection = cityScene.getMoonDirection();
+            fogLights.moonColor = cityScene.getMoonColor();
+            for (int i = 0; i < 8; i++)
+            {
+                if (cityScene.isStreetLampEnabled(i))
+                    fogLights.lampPositions.push_back(cityScene.getStreetLampPositions()[i]);
+            }
+            fogLights.lampColor = cityScene.getStreetLampColor();
+            fogLights.flashlightOn = cityScene.isFlashlightOn();
+            fogLights.flashlightPosition = cityScene.getFlashlightPosition();
+            fogLights.flashlightDirection = cityScene.getFlashlightDirection();
+            fogLights.flashlightInnerAngle = CityScene::kFlashlightInnerAngle;
+            fogLights.flashlightOuterAngle = CityScene::kFlashlightOuterAngle;
+
+            gpuProfiler.begin("Volumetric Fog");
+            volumetricFog.resize(aspect);
+            volumetricFog.render(view, projection, fogLights, currentFrame, gpuProfiler);
+            gpuProfiler.end("Volumetric Fog");
+        }
+
+        const glm::vec2 renderSize(static_cast<float>(renderWidth), static_cast<float>(renderHeight));
+
+        // Planar reflection for the water: mirrored camera, reduced resolution,
+        // oblique clip at the water plane; reused while the camera is still.
+        // Screen-space AO and the camera's fog volume do not apply to the mirrored view.
+        if (planarReflection.beginFrame(view, projection, renderWidth, renderHeight, waterRenderer.height()))
+        {
+            gpuProfiler.begin("Reflection");
+            planarReflection.bind();
+            shader.use();
+            shader.setFloat("textureLodBias", 0.0f);
+            ssao.bindForLighting(shader);
+            volumetricFog.bindForShading(shader, renderSize);
+            shader.setBool("ssaoEnabled", false);
+            shader.setBool("fogEnabled", false);
+            const int drawn = cityScene.renderSceneCulled(shader, planarReflection.view(), planarReflection.projection(),
+                                                          planarReflection.cullFrustum());
+            planarReflection.recordCulling(drawn, cityScene.drawableCount());
+            cityScene.renderEmissive(lampShader, planarReflection.view(), planarReflection.projection());
+            if (Shader *impostorShader = cityScene.getSkylineShader())
+            {
+                impostorShader->use();
+                volumetricFog.bindForShading(*impostorShader, renderSize);
+                impostorShader->setBool("fogEnabled", false);
+            }
+            cityScene.renderSkyline(planarReflection.view(), planarReflection.projection());
+
+            skyboxShader.use();
+            volumetricFog.bindForShading(skyboxShader, renderSize);
+            skyboxShader.setBool("fogEnabled", false);
+            cityScene.renderSkybox(skyboxShader, planarReflection.view(), planarReflection.skyProjection());
+            gpuProfiler.end("Reflection");
+        }
+
+        sceneTarget.bind();
+        glViewport(0, 0, renderWidth, renderHeight);
+        glClearColor(0.02f, 0.05f, 0.10f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        // Accumulated history resolves more texture detail than a single frame,
+        // so the temporal path biases one extra mip sharper
+        const float lodBias = dynamicResolution.textureLodBias() - (temporal ? 1.0f : 0.0f);
+
+        // City culling for this camera, shared by the depth prepass and the scene
+        // pass: the GPU-driven compute cull, or the occlusion query results
+        const bool gpuDriven = cityScene.getGpuDrivenSettings().enabled && cityScene.isGpuDrivenSupported();
+        gpuProfiler.begin("Cull");
+        cityScene.prepareFrame(view, sceneProjection);
+        gpuProfiler.end("Cull");
+
+        // SSAO needs depth before lighting: lay it down in a prepass, compute
+        // AO at reduced resolution, then shade with GL_LEQUAL against that depth
+        if (ssao.settings.enabled)
+        {
+            gpuProfiler.begin("Depth Prepass");
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            cityScene.renderDepth(depthShader, view, sceneProjection);
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+            gpuProfiler.end("Depth Prepass");
+
+            gpuProfiler.begin("SSAO");
+            ssao.render(sceneTarget, renderWidth, renderHeight, sceneProjection);
+            gpuProfiler.end("SSAO");
+
+            sceneTarget.bind();
+            glViewport(0, 0, renderWidth, renderHeight);
+            glDepthFunc(GL_LEQUAL);
+        }
 
+        gpuProfiler.begin("Scene");
         shader.use();
-        cityScene.renderScene(shader, view, projection);
+        shader.setFloat("textureLodBias", lodBias);
+        ssao.bindForLighting(shader);
+        volumetricFog.bindForShading(shader, renderSize);
+        cityScene.renderScene(shader, view, sceneProjection);
+        cityScene.renderEmissive(lampShader, view, sceneProjection);
+        glDepthFunc(GL_LESS);
+        if (Shader *impostorShader = cityScene.getSkylineShader())
+        {
+            impostorShader->use();
+            volumetricFog.bindForShading(*impostorShader, renderSize);
+        }
+        cityScene.renderSkyline(view, sceneProjection);
 
         skyboxShader.use();
-        cityScene.renderSkybox(skyboxShader, view, projection);
+        volumetricFog.bindForShading(skyboxShader, renderSize);
+        cityScene.renderSkybox(skyboxShader, view, sceneProjection);
+
+        gpuProfiler.end("Scene");
+
+        // Opaque depth is complete: reduce it for next frame's occlusion test
+        if (gpuDriven && cityScene.getGpuDrivenSettings().occlusionCulling)
+        {
+            gpuProfiler.begin("Hi-Z");
+            cityScene.updateGpuOcclusion(sceneTarget, renderWidth, renderHeight, view, sceneProjection);
+            gpuProfiler.end("Hi-Z");
+        }
+
+        // Canal and puddles blend over the opaque scene with the planar reflection
+        gpuProfiler.begin("Water");
+        volumetricFog.bindForShading(waterShader, renderSize);
+        waterRenderer.render(waterShader, cityScene.getWaterSettings(), view, sceneProjection, planarReflection,
+                             cityScene.getMoonDirection(), cityScene.getMoonColor(), renderSize, currentFrame);
+        gpuProfiler.end("Water");
+
+        // Rain, lamp mist and sparks blend over the opaque scene in HDR
+        particles.render(view, sceneProjection, gpuProfiler);
+
+        // Post input: the resolved temporal history, or the scene sub-rect which
+        // the post pass upscales bilinearly while sampling
+        const glm::vec2 outputSize(static_cast<float>(framebufferWidth), static_cast<float>(framebufferHeight));
+        unsigned int postInput = sceneTarget.colorTexture();
+        glm::vec2 postUvScale(static_cast<float>(renderWidth) / static_cast<float>(sceneTarget.width()),
+                              static_cast<float>(renderHeight) / static_cast<float>(sceneTarget.height()));
+        glm::vec2 postInputSize(static_cast<float>(sceneTarget.width()), static_cast<float>(sceneTarget.height()));
+        if (temporal)
+        {
+            gpuProfiler.begin("Temporal Resolve");
+            postInput = temporalUpscaler.resolve(sceneTarget, view, projection, sceneProjection);
+            postUvScale = glm::vec2(1.0f);
+            postInputSize = outputSize;
+            gpuProfiler.end("Temporal Resolve");
+        }
+
+        PostProcessInput post;
+        post.texture = postInput;
+        post.uvScale = postUvScale;
+        post.textureSize = postInputSize;
+        post.sharpness = temporal ? temporalUpscaler.settings.sharpness : 0.0f;
+
+        // Bloom mip chain from the HDR image, thresholded at street lamp brightness
+        if (bloom.settings.enabled)
+        {
+            gpuProfiler.begin("Bloom");
+            bloom.setThresholdFromLight(cityScene.getStreetLampColor());
+            post.bloomTexture = bloom.render(postInput, postUvScale, postInputSize, gpuProfiler);
+            post.bloomIntensity = bloom.settings.intensity;
+            gpuProfiler.end("Bloom");
+        }
+
+        // HDR -> display in one pass; ImGui draws on top at native resolution
+        gpuProfiler.begin("Post");
+        RenderTarget::bindDefault();
+        glViewport(0, 0, framebufferWidth, framebufferHeight);
+        postProcess.apply(post, cityScene.getSkyboxSettings());
+        gpuProfiler.end("Post");
+        postProcess.updateCostMeasurement(gpuProfiler.lastMs("Post"));
+        particles.updateBenchmark(gpuProfiler);
 
-        // Render Control Panel (P key)
-        if (showControlPanel)
+        // Render Control Panel (P key); a progress window instead while the city loads
+        if (cityScene.isLoading())
+        {
+            renderLoadingWindow(cityScene);
+        }
+        else if (showControlPanel)
         {
             renderControlPanel(cityScene, fps);
         }
@@ -182,8 +561,10 @@ int main()
 
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        gpuProfiler.end("Frame");
 
         glfwSwapBuffers(window);
+        cityScene.notifyFramePresented();
         glfwPollEvents();
     }
 
@@ -193,6 +574,16 @@ int main()
     ImGui::DestroyContext();
 
     cityScene.shutdown();
+    gpuProfiler.shutdown();
+    bloom.shutdown();
+    ssao.shutdown();
+    volumetricFog.shutdown();
+    planarReflection.shutdown();
+    waterRenderer.shutdown();
+    particles.shutdown();
+    postProcess.shutdown();
+    temporalUpscaler.shutdown();
+    sceneTarget.shutdown();
 
     glfwTerminate();
     return 0;
@@ -306,6 +697,12 @@ void processInput(GLFWwindow *window, CityScene &cityScene)
 
 void framebuffer_size_callback(GLFWwindow * /*window*/, int width, int height)
 {
+    // Minimized windows report 0x0; keep the last valid size for the render targets
+    if (width > 0 && height > 0)
+    {
+        framebufferWidth = width;
+        framebufferHeight = height;
+    }
     glViewport(0, 0, width, height);
 }
 
@@ -333,19 +730,305 @@ void scroll_callback(GLFWwindow * /*window*/, double /*xoffset*/, double yoffset
     camera.ProcessMouseScroll(static_cast<float>(yoffset));
 }
 
+void renderLoadingWindow(CityScene &cityScene)
+{
+    ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowSize(ImVec2(350, 0), ImGuiCond_FirstUseEver);
+
+    ImGui::Begin("Loading", nullptr, ImGuiWindowFlags_NoCollapse);
+    ImGui::Text("%s", cityScene.loadStageName());
+    ImGui::ProgressBar(cityScene.loadProgress(), ImVec2(-1.0f, 0.0f));
+    const CityLoader::Stats &loader = cityScene.getLoaderStats();
+    ImGui::Text("Meshes: %d / %d", loader.meshesUploaded, loader.meshesExpected);
+    ImGui::Text("Textures: %d / %d", loader.texturesUploaded + loader.texturesFailed, loader.texturesRequested);
+    ImGui::Text("Sky: %s", loader.skyDone ? "done" : "decoding");
+    ImGui::Text("Upload: %.2f ms last frame (budget %.1f ms)", loader.lastPumpMs,
+                cityScene.getLoadSettings().uploadBudgetMs);
+    const CityScene::LoadStats &load = cityScene.getLoadStats();
+    if (load.framePresented)
+        ImGui::Text("First frame after %.0f ms", load.firstFrameMs);
+    ImGui::End();
+}
+
 void renderControlPanel(CityScene &cityScene, float fps)
 {
     ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_FirstUseEver);
     ImGui::SetNextWindowSize(ImVec2(350, 400), ImGuiCond_FirstUseEver);
     
     ImGui::Begin("Control Panel (P to toggle)", &showControlPanel);
+    SkyboxSettings &tone = cityScene.getSkyboxSettings();
     
     // Performance section
     ImGui::Text("Performance");
     ImGui::Separator();
     ImGui::Text("FPS: %.1f", fps);
     ImGui::Text("Frame Time: %.3f ms", 1000.0f / fps);
+
+    // Dynamic resolution: scene resolution follows the GPU frame budget
+    DynamicResolutionSettings &drs = dynamicResolution.settings;
+    if (ImGui::Checkbox("Dynamic Resolution", &drs.enabled))
+    {
+        dynamicResolution.reset();
+    }
+    float targetFps = 1000.0f / drs.targetFrameMs;
+    if (ImGui::SliderFloat("Target FPS", &targetFps, 30.0f, 144.0f, "%.0f"))
+    {
+        drs.targetFrameMs = 1000.0f / targetFps;
+    }
+    ImGui::SliderFloat("Min Scale", &drs.minScale, 0.25f, 1.0f, "%.2f");
+    if (!drs.enabled)
+    {
+        ImGui::SliderFloat("Fixed Scale", &drs.fixedScale, 0.25f, 1.0f, "%.2f");
+    }
+
+    // Upscaler: plain bilinear blit or temporal accumulation with jitter
+    int mode = static_cast<int>(upscaleMode);
+    const char *upscaleModes[] = {"Bilinear", "Temporal"};
+    if (ImGui::Combo("Upscaler", &mode, upscaleModes, 2))
+    {
+        upscaleMode = static_cast<UpscaleMode>(mode);
+        temporalUpscaler.invalidateHistory();
+    }
+    if (upscaleMode == UpscaleMode::Temporal)
+    {
+        // Fixed-ratio presets: 67% / 59% / 50% per axis
+        if (ImGui::Button("Quality"))
+        {
+            drs.enabled = false;
+            drs.fixedScale = 0.67f;
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Balanced"))
+        {
+            drs.enabled = false;
+            drs.fixedScale = 0.59f;
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Performance"))
+        {
+            drs.enabled = false;
+            drs.fixedScale = 0.5f;
+        }
+        ImGui::SliderFloat("Sharpness", &temporalUpscaler.settings.sharpness, 0.0f, 1.0f, "%.2f");
+        const glm::vec2 jitter = temporalUpscaler.jitterPixels();
+        ImGui::Text("Jitter: (%.2f, %.2f) px", jitter.x, jitter.y);
+    }
+    ImGui::Text("Scale: %.0f%%  (%d x %d)", dynamicResolution.scale() * 100.0f,
+                dynamicResolution.scaledWidth(framebufferWidth), dynamicResolution.scaledHeight(framebufferHeight));
+    ImGui::Text("Texture LOD Bias: %.2f", dynamicResolution.textureLodBias());
+    const CityScene::LoadStats &load = cityScene.getLoadStats();
+    ImGui::Text("Load: first frame %.0f ms, fully loaded %.0f ms", load.firstFrameMs, load.totalMs);
+    const ModelImportStats &cityImport = cityScene.getCityImportStats();
+    ImGui::Text("City: %d meshes -> %d GPU meshes (%d instanced), %d -> %d draws, %.1f MB saved", cityImport.sourceMeshes,
+                cityImport.uniqueMeshes, cityImport.instancedMeshes, cityImport.placements, cityImport.uniqueMeshes,
+                static_cast<float>(cityImport.savedBytes) / (1024.0f * 1024.0f));
+    ImGui::Text("Import: %.0f ms on %d threads (read %.0f ms; convert %.0f, hash %.0f, meshlets %.0f ms thread time)",
+                cityImport.wallMs, cityImport.threads, cityImport.readMs, cityImport.convertMs, cityImport.hashMs,
+                cityImport.meshletMs);
+
+    // GPU pass timings (timestamp queries, smoothed); per-level bloom costs are listed below
+    for (const GpuProfiler::Entry &entry : gpuProfiler.entries())
+    {
+        if (entry.name.rfind("Bloom ", 0) == 0)
+            continue;
+        ImGui::BulletText("GPU %s: %.3f ms", entry.name.c_str(), entry.timer.averageMs());
+    }
     
+    ImGui::Spacing();
+
+    // Post-processing (single fused HDR -> LDR pass)
+    ImGui::Text("Post Processing");
+    ImGui::Separator();
+    PostProcessSettings &post = postProcess.settings;
+    ImGui::SliderFloat("Exposure", &tone.exposure, 0.1f, 8.0f, "%.2f");
+    ImGui::SliderFloat("Gamma", &tone.gamma, 1.0f, 3.0f, "%.2f");
+    ImGui::Checkbox("Tonemap", &post.tonemap);
+    ImGui::SameLine();
+    ImGui::Checkbox("Gamma##toggle", &post.gammaCorrect);
+    ImGui::SameLine();
+    ImGui::Checkbox("FXAA", &post.fxaa);
+    ImGui::SameLine();
+    ImGui::Checkbox("Sharpen", &post.sharpen);
+
+    const float postMs = gpuProfiler.averageMs("Post");
+    ImGui::Text("Post GPU: %.3f / %.2f ms budget", postMs, post.budgetMs);
+    ImGui::ProgressBar(postMs / post.budgetMs, ImVec2(-1.0f, 0.0f));
+    if (postProcess.isMeasuring())
+    {
+        ImGui::ProgressBar(postProcess.measurementProgress(), ImVec2(-1.0f, 0.0f), "Measuring...");
+    }
+    else if (ImGui::Button("Measure Effect Costs"))
+    {
+        postProcess.startCostMeasurement();
+    }
+    const auto &costs = postProcess.effectCostsMs();
+    for (int i = 0; i < PostProcess::EffectCount; i++)
+    {
+        ImGui::BulletText("%s: %.3f ms", PostProcess::effectName(i), costs[i]);
+    }
+
+    ImGui::Spacing();
+
+    // SSAO (reduced resolution, bilateral upsample)
+    ImGui::Text("Ambient Occlusion");
+    ImGui::Separator();
+    SsaoSettings &ssaoSettings = ssao.settings;
+    ImGui::Checkbox("SSAO Enabled", &ssaoSettings.enabled);
+    int ssaoResolution = ssaoSettings.resolutionDivisor >= 4 ? 1 : 0;
+    const char *ssaoResolutions[] = {"Half", "Quarter"};
+    if (ImGui::Combo("AO Resolution", &ssaoResolution, ssaoResolutions, 2))
+    {
+        ssaoSettings.resolutionDivisor = ssaoResolution == 1 ? 4 : 2;
+    }
+    ImGui::SliderInt("AO Samples", &ssaoSettings.sampleCount, 4, Ssao::kMaxSamples);
+    ImGui::SliderFloat("AO Radius", &ssaoSettings.radius, 0.1f, 5.0f, "%.2f");
+    ImGui::SliderFloat("AO Power", &ssaoSettings.power, 0.5f, 4.0f, "%.2f");
+    ImGui::Checkbox("AO Bilateral Blur", &ssaoSettings.blur);
+    const glm::ivec2 aoSize = ssao.aoSize();
+    ImGui::Text("AO buffer: %dx%d, prepass %.3f ms, AO %.3f ms", aoSize.x, aoSize.y,
+                gpuProfiler.averageMs("Depth Prepass"), gpuProfiler.averageMs("SSAO"));
+
+    ImGui::Spacing();
+
+    // Volumetric fog (froxel grid)
+    ImGui::Text("Volumetric Fog");
+    ImGui::Separator();
+    VolumetricFogSettings &fog = volumetricFog.settings;
+    ImGui::Checkbox("Fog Enabled", &fog.enabled);
+    ImGui::SliderInt("Froxel Budget", &fog.froxelBudget, 64 * 1024, 2 * 1024 * 1024, "%d", ImGuiSliderFlags_Logarithmic);
+    ImGui::SliderInt("Depth Slices", &fog.sliceCount, 16, 128);
+    ImGui::SliderFloat("Fog Range", &fog.range, 20.0f, 200.0f, "%.0f");
+    ImGui::SliderFloat("Fog Density", &fog.density, 0.0f, 0.1f, "%.4f", ImGuiSliderFlags_Logarithmic);
+    ImGui::SliderFloat("Height Falloff", &fog.heightFalloff, 0.0f, 0.5f, "%.3f");
+    ImGui::SliderFloat("Anisotropy", &fog.anisotropy, -0.9f, 0.9f, "%.2f");
+    ImGui::SliderFloat("Wisps", &fog.noiseAmount, 0.0f, 1.0f, "%.2f");
+    ImGui::SliderFloat("Lamp Scatter", &fog.lampIntensity, 0.0f, 20.0f, "%.1f");
+    ImGui::SliderFloat("Lamp Cone", &fog.lampConeAngle, 10.0f, 80.0f, "%.0f deg");
+    ImGui::SliderFloat("Moon Scatter", &fog.moonIntensity, 0.0f, 5.0f, "%.2f");
+    const glm::ivec3 froxels = volumetricFog.gridSize();
+    ImGui::Text("Grid: %d x %d x %d (%lld froxels)", froxels.x, froxels.y, froxels.z, volumetricFog.froxelCount());
+    const float fogMs = gpuProfiler.averageMs("Volumetric Fog");
+    ImGui::Text("Fog GPU: %.3f / %.2f ms budget (inject %.3f, integrate %.3f)", fogMs, fog.budgetMs,
+                gpuProfiler.averageMs("Fog Inject"), gpuProfiler.averageMs("Fog Integrate"));
+    ImGui::ProgressBar(fogMs / fog.budgetMs, ImVec2(-1.0f, 0.0f));
+
+    ImGui::Spacing();
+
+    // Water (planar reflection + normal-mapped waves)
+    ImGui::Text("Water");
+    ImGui::Separator();
+    WaterSettings &water = cityScene.getWaterSettings();
+    PlanarReflectionSettings &reflection = planarReflection.settings;
+    ImGui::SliderFloat("Wave Speed", &water.waveSpeed, 0.0f, 0.2f, "%.3f");
+    ImGui::SliderFloat("Wave Strength", &water.waveStrength, 0.0f, 0.1f, "%.3f");
+    ImGui::ColorEdit3("Deep Color", &water.deepColor.x);
+    ImGui::ColorEdit3("Shallow Color", &water.shallowColor.x);
+    ImGui::Checkbox("Reflection Enabled", &reflection.enabled);
+    ImGui::SliderFloat("Reflection Scale", &reflection.resolutionScale, 0.25f, 1.0f, "%.2f");
+    ImGui::Checkbox("Skip When Still", &reflection.adaptiveSkip);
+    ImGui::SliderInt("Max Skipped Frames", &reflection.maxSkippedFrames, 1, 30);
+    const glm::ivec2 reflectionSize = planarReflection.size();
+    ImGui::Text("Reflection: %dx%d, %d / %d meshes in mirrored frustum", reflectionSize.x, reflectionSize.y,
+                planarReflection.meshesDrawn(), planarReflection.meshesTotal());
+    ImGui::Text("Frames reusing reflection: %.0f%%", planarReflection.skipRatio() * 100.0f);
+    ImGui::Text("GPU reflection %.3f ms vs scene %.3f ms, water %.3f ms", gpuProfiler.averageMs("Reflection"),
+                gpuProfiler.averageMs("Scene"), gpuProfiler.averageMs("Water"));
+
+    // FFT ocean on the canal
+    FftOcean &ocean = waterRenderer.ocean();
+    ImGui::Checkbox("FFT Ocean", &water.oceanEnabled);
+    int oceanGrid = 0;
+    while ((FftOcean::kMinResolution << oceanGrid) < water.oceanResolution && oceanGrid < 3)
+        oceanGrid++;
+    const char *oceanGrids[] = {"64x64", "128x128", "256x256", "512x512"};
+    if (ImGui::Combo("Ocean Grid", &oceanGrid, oceanGrids, 4))
+    {
+        water.oceanResolution = FftOcean::kMinResolution << oceanGrid;
+    }
+    ImGui::SliderFloat("Ocean Patch", &water.oceanPatchSize, 8.0f, 128.0f, "%.0f m");
+    ImGui::SliderFloat("Wind Speed", &water.windSpeed, 0.5f, 20.0f, "%.1f m/s");
+    ImGui::SliderFloat2("Wind Direction", &water.windDirection.x, -1.0f, 1.0f, "%.2f");
+    ImGui::SliderFloat("Ocean Amplitude", &water.oceanAmplitude, 0.0f, 4.0f, "%.2f");
+    ImGui::SliderFloat("Choppiness", &water.choppiness, 0.0f, 2.0f, "%.2f");
+    ImGui::Text("Ocean CPU: spectrum %.3f ms, FFT %.3f ms, upload %.3f ms (%u threads)", ocean.spectrumMs(),
+                ocean.fftMs(), ocean.uploadMs(), jobSystem.threadCount());
+    if (ocean.isBenchmarking())
+    {
+        ImGui::ProgressBar(ocean.benchmarkProgress(), ImVec2(-1.0f, 0.0f), "Benchmarking...");
+    }
+    else if (ImGui::Button("Run FFT Benchmark"))
+    {
+        ocean.startBenchmark(jobSystem);
+    }
+    for (const FftOcean::BenchmarkResult &result : ocean.benchmarkResults())
+    {
+        ImGui::BulletText("%dx%d, %u threads: FFT %.3f ms, spectrum %.3f ms", result.resolution, result.resolution,
+                          result.threads, result.fftMs, result.spectrumMs);
+    }
+
+    ImGui::Spacing();
+
+    // Particles (rain, lamp mist, sparks)
+    ImGui::Text("Particles");
+    ImGui::Separator();
+    ParticleSettings &particleSettings = particles.settings;
+    ImGui::Checkbox("Particles Enabled", &particleSettings.enabled);
+    int simulation = particleSettings.simulation == ParticleSimulation::Cpu ? 0 : 1;
+    const char *simulations[] = {"CPU (SoA SIMD)", "GPU (transform feedback)"};
+    if (ImGui::Combo("Simulation", &simulation, simulations, 2))
+    {
+        particleSettings.simulation = simulation == 0 ? ParticleSimulation::Cpu : ParticleSimulation::GpuTransformFeedback;
+    }
+    ImGui::SliderInt("Rain Drops", &particleSettings.rainParticles, 1000, 1000000, "%d", ImGuiSliderFlags_Logarithmic);
+    ImGui::SliderFloat2("Wind (x, z)", &particleSettings.wind.x, -5.0f, 5.0f, "%.1f");
+    for (int i = 0; i < ParticleSystem::LayerCount; i++)
+    {
+        ImGui::Checkbox(ParticleSystem::layerName(i), &particles.layers[i].enabled);
+        ImGui::SameLine();
+        ImGui::Text("%zu", particles.particleCount(i));
+    }
+    ImGui::Text("CPU sim %.3f ms, upload %.3f ms (%u threads)", particles.cpuSimulationMs(), particles.cpuUploadMs(),
+                jobSystem.threadCount());
+    ImGui::Text("GPU sim %.3f ms, render %.3f ms", gpuProfiler.averageMs(ParticleSystem::simulationScopeName()),
+                gpuProfiler.averageMs(ParticleSystem::renderScopeName()));
+    if (particles.isBenchmarking())
+    {
+        ImGui::ProgressBar(particles.benchmarkProgress(), ImVec2(-1.0f, 0.0f), "Benchmarking...");
+    }
+    else if (ImGui::Button("Run Particle Benchmark"))
+    {
+        particles.startBenchmark();
+    }
+    for (const ParticleSystem::BenchmarkResult &result : particles.benchmarkResults())
+    {
+        ImGui::BulletText("%s %zu: sim %.2f+%.2f ms CPU, %.2f ms GPU; render %.2f ms",
+                          result.simulation == ParticleSimulation::Cpu ? "CPU" : "GPU", result.particles,
+                          result.cpuSimulationMs, result.cpuUploadMs, result.gpuSimulationMs, result.gpuRenderMs);
+    }
+
+    ImGui::Spacing();
+
+    // Bloom (dual-filter mip chain)
+    ImGui::Text("Bloom");
+    ImGui::Separator();
+    BloomSettings &bloomSettings = bloom.settings;
+    ImGui::Checkbox("Bloom Enabled", &bloomSettings.enabled);
+    ImGui::SliderInt("Mip Levels", &bloomSettings.mipLevels, 1, Bloom::kMaxMipLevels);
+    ImGui::SliderFloat("Intensity##bloom", &bloomSettings.intensity, 0.0f, 2.0f, "%.2f");
+    ImGui::SliderFloat("Threshold Scale", &bloomSettings.thresholdScale, 0.25f, 4.0f, "%.2f");
+    ImGui::SliderFloat("Radius", &bloomSettings.radius, 0.5f, 2.0f, "%.2f");
+    ImGui::Text("Threshold: %.2f (street lamp)", bloom.threshold());
+    const float bloomMs = gpuProfiler.averageMs("Bloom");
+    ImGui::Text("Bloom GPU: %.3f / %.2f ms budget", bloomMs, bloomSettings.budgetMs);
+    ImGui::ProgressBar(bloomMs / bloomSettings.budgetMs, ImVec2(-1.0f, 0.0f));
+    for (int i = 0; i < bloom.activeLevels(); i++)
+    {
+        const glm::ivec2 size = bloom.levelSize(i);
+        const float upMs = (i > 0) ? gpuProfiler.averageMs(bloom.upScopeName(i)) : 0.0f;
+        ImGui::BulletText("L%d %dx%d: down %.3f ms, up %.3f ms", i + 1, size.x, size.y,
+                          gpuProfiler.averageMs(bloom.downScopeName(i)), upMs);
+    }
+
     ImGui::Spacing();
     
     // Camera position section
@@ -430,7 +1113,352 @@ void renderControlPanel(CityScene &cityScene, float fps)
     }
     
     ImGui::Spacing();
-    
+
+    ImGui::Text("Baked Lighting");
+    ImGui::Separator();
+    LightmapSettings &lightmapSettings = cityScene.getLightmapSettings();
+    ImGui::Checkbox("Lamps + Sky from Lightmap", &lightmapSettings.enabled);
+    static const int atlasSizes[] = {512, 1024, 2048};
+    static const char *atlasLabels[] = {"512", "1024", "2048"};
+    int atlasIndex = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        if (atlasSizes[i] == lightmapSettings.atlasSize)
+            atlasIndex = i;
+    }
+    if (ImGui::Combo("Atlas", &atlasIndex, atlasLabels, 3))
+        lightmapSettings.atlasSize = atlasSizes[atlasIndex];
+    ImGui::SliderFloat("Texels / Unit", &lightmapSettings.texelsPerUnit, 0.5f, 16.0f, "%.1f");
+    ImGui::SliderInt("Gather Samples", &lightmapSettings.samples, 16, 256);
+    ImGui::SliderInt("Bounces", &lightmapSettings.bounces, 0, 4);
+    ImGui::Checkbox("Denoise", &lightmapSettings.denoise);
+
+    const LightmapBaker &baker = cityScene.getLightmapBaker();
+    if (baker.isBaking())
+    {
+        ImGui::ProgressBar(baker.progress(), ImVec2(-1.0f, 0.0f), baker.stageName());
+    }
+    else if (ImGui::Button("Bake Lightmap"))
+    {
+        cityScene.startLightmapBake();
+    }
+    const LightmapAtlasInfo &atlas = cityScene.getLightmapAtlas();
+    const Lightmap &lightmap = cityScene.getLightmap();
+    ImGui::Text("Atlas %dx%d, %d charts, %.0f%% used, %.2f texels/unit", atlas.size, atlas.size, atlas.chartCount,
+                atlas.coverage * 100.0f, atlas.texelsPerUnit);
+    ImGui::Text("Lightmap: %s, %.1f MB (BC5, 5 layers)", lightmap.ready() ? "loaded" : "not baked",
+                static_cast<float>(lightmap.memoryBytes()) / (1024.0f * 1024.0f));
+    const LightmapBaker::Stats &bake = baker.lastStats();
+    if (bake.totalMs > 0.0f)
+    {
+        ImGui::Text("Last bake: %.1f s, %d texels, %.2f Mrays/s (%u threads)", bake.totalMs / 1000.0f, bake.texels,
+                    static_cast<float>(bake.rays) / std::max(bake.directMs + bake.indirectMs, 1e-3f) / 1000.0f,
+                    bake.threads);
+    }
+
+    ImGui::Spacing();
+
+    ImGui::Text("Irradiance Probes");
+    ImGui::Separator();
+    ProbeGridSettings &probeSettings = cityScene.getProbeSettings();
+    ImGui::Checkbox("Ambient from Probes", &probeSettings.enabled);
+    ImGui::TextDisabled("Used where the lightmap is off");
+    ImGui::SliderFloat("Spacing (m)", &probeSettings.spacing, 0.5f, 8.0f, "%.1f");
+    ImGui::SliderInt("Rays / Probe", &probeSettings.samples, 32, 1024);
+    ImGui::SliderInt("Bounces##probes", &probeSettings.bounces, 0, 4);
+
+    const ProbeBaker &probeBaker = cityScene.getProbeBaker();
+    if (probeBaker.isBaking())
+    {
+        ImGui::ProgressBar(probeBaker.progress(), ImVec2(-1.0f, 0.0f), "baking probes");
+    }
+    else
+    {
+        if (ImGui::Button("Bake Probes"))
+            cityScene.startProbeBake();
+        ImGui::SameLine();
+        if (ImGui::Button("Benchmark Spacings"))
+            cityScene.startProbeBenchmark();
+    }
+    const ProbeGrid &probeGrid = cityScene.getProbeGrid();
+    const glm::ivec3 probeSize = probeGrid.size();
+    const glm::vec3 probeSpacing = probeGrid.spacing();
+    ImGui::Text("Grid %dx%dx%d = %d probes, %.2f x %.2f x %.2f m", probeSize.x, probeSize.y, probeSize.z,
+                probeSize.x * probeSize.y * probeSize.z, probeSpacing.x, probeSpacing.y, probeSpacing.z);
+    ImGui::Text("Probes: %s, %.1f MB (RGBA16F, 7 texels each)", probeGrid.ready() ? "loaded" : "not baked",
+                static_cast<float>(probeGrid.memoryBytes()) / (1024.0f * 1024.0f));
+    const ProbeBaker::Stats &probeBake = probeBaker.lastStats();
+    if (probeBake.gatherMs > 0.0f)
+    {
+        ImGui::Text("Last bake: %.2f s, %.1f us/probe, %.2f Mrays/s (%u threads)", probeBake.totalMs / 1000.0f,
+                    probeBake.gatherMs * 1000.0f / static_cast<float>(std::max(probeBake.probes, 1)),
+                    static_cast<float>(probeBake.rays) / probeBake.gatherMs / 1000.0f, probeBake.threads);
+    }
+
+    ImGui::Spacing();
+
+    ImGui::Text("Street Props");
+    ImGui::Separator();
+    StreetPropSettings &props = cityScene.getStreetPropSettings();
+    ImGui::Checkbox("Enable Props", &props.enabled);
+    ImGui::SameLine();
+    ImGui::Checkbox("Frustum Culling##props", &props.culling);
+    const StreetProps::Stats &propStats = cityScene.getStreetPropStats();
+    ImGui::Text("%d / %d instances of %d props visible", propStats.visible, propStats.instances, propStats.props);
+    ImGui::Text("%d instanced draws, %.1fk triangles, cull + upload %.3f ms", propStats.drawCalls,
+                static_cast<float>(propStats.triangles) / 1000.0f, propStats.cullMs);
+
+    ImGui::Spacing();
+
+    ImGui::Text("Static Batching");
+    ImGui::Separator();
+    StaticBatchSettings &batching = cityScene.getStaticBatchSettings();
+    if (ImGui::Checkbox("Batch City by Chunk + Material", &batching.enabled))
+    {
+        cityScene.rebuildStaticBatches();
+    }
+    ImGui::SliderFloat("Chunk Size", &batching.chunkSize, 2.0f, 128.0f, "%.0f", ImGuiSliderFlags_Logarithmic);
+    // Rebuilding takes a moment, so only once the slider is released
+    if (ImGui::IsItemDeactivatedAfterEdit() && batching.enabled)
+    {
+        cityScene.rebuildStaticBatches();
+    }
+    const StaticBatcher::Stats &batchStats = cityScene.getStaticBatchStats();
+    ImGui::Text("%d chunks x %d materials = %d draws, %.1fk triangles", batchStats.chunks, batchStats.materials,
+                batchStats.batches, static_cast<float>(batchStats.triangles) / 1000.0f);
+    ImGui::Text("%.1f MB, built in %.1f ms", static_cast<float>(batchStats.gpuBytes) / (1024.0f * 1024.0f),
+                batchStats.buildMs);
+    if (ImGui::Button("Camera Path Report"))
+    {
+        const float aspect = static_cast<float>(framebufferWidth) / static_cast<float>(framebufferHeight);
+        cityScene.runStaticBatchReport(glm::perspective(glm::radians(camera.Zoom), aspect, 0.1f, 200.0f));
+    }
+    ImGui::SameLine();
+    ImGui::TextDisabled("(printed to the console)");
+
+    ImGui::Spacing();
+
+    ImGui::Text("Meshlet Culling");
+    ImGui::Separator();
+    MeshletSettings &meshletSettings = cityScene.getMeshletSettings();
+    ImGui::Checkbox("Enable Meshlet Culling", &meshletSettings.enabled);
+    ImGui::Checkbox("Frustum##meshlets", &meshletSettings.frustumCulling);
+    ImGui::SameLine();
+    ImGui::Checkbox("Backface Cone", &meshletSettings.coneCulling);
+    ImGui::SameLine();
+    ImGui::Checkbox("Small", &meshletSettings.smallCulling);
+    ImGui::SliderFloat("Min Size (px)", &meshletSettings.minPixels, 0.25f, 16.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+    const MeshletCullStats &meshletStats = cityScene.getMeshletStats();
+    ImGui::Text("%zu / %zu meshlets rejected (frustum %zu, cone %zu, small %zu)",
+                meshletStats.frustumRejected + meshletStats.coneRejected + meshletStats.smallRejected,
+                meshletStats.meshlets, meshletStats.frustumRejected, meshletStats.coneRejected, meshletStats.smallRejected);
+    ImGui::Text("%.1fk / %.1fk triangles rejected, cull %.3f ms",
+                static_cast<float>(meshletStats.trianglesRejected) / 1000.0f,
+                static_cast<float>(meshletStats.triangles) / 1000.0f, meshletStats.cullMs);
+    if (ImGui::Button("Meshlet Report"))
+    {
+        const float aspect = static_cast<float>(framebufferWidth) / static_cast<float>(framebufferHeight);
+        cityScene.runMeshletReport(glm::perspective(glm::radians(camera.Zoom), aspect, 0.1f, 200.0f));
+    }
+    ImGui::SameLine();
+    ImGui::TextDisabled("(printed to the console)");
+
+    ImGui::Spacing();
+
+    ImGui::Text("GPU-Driven Rendering");
+    ImGui::Separator();
+    if (cityScene.isGpuDrivenSupported())
+    {
+        GpuDrivenSettings &gpuSettings = cityScene.getGpuDrivenSettings();
+        ImGui::Checkbox("Enable GPU-Driven", &gpuSettings.enabled);
+        ImGui::Checkbox("Hi-Z Occlusion", &gpuSettings.occlusionCulling);
+        const GpuDrivenRenderer::Stats &gpuStats = cityScene.getGpuDrivenStats();
+        ImGui::Text("%d placements, %d meshes, %d indirect draws per pass", gpuStats.records, gpuStats.meshes,
+                    gpuStats.materials);
+        const GpuDrivenRenderer::CullStats &gpuCull = cityScene.getGpuCullStats();
+        ImGui::Text("Visible %u, frustum culled %u, occluded %u", gpuCull.visible, gpuCull.frustumRejected,
+                    gpuCull.occlusionRejected);
+    }
+    else
+    {
+        ImGui::TextDisabled("Needs OpenGL 4.3; drawing on the 3.3 path");
+    }
+
+    ImGui::Spacing();
+
+    ImGui::Text("HLOD");
+    ImGui::Separator();
+    HlodSettings &hlodSettings = cityScene.getHlodSettings();
+    if (ImGui::Checkbox("Enable HLOD Proxies", &hlodSettings.enabled))
+    {
+        cityScene.rebuildHlod();
+    }
+    ImGui::SliderInt("Levels", &hlodSettings.levels, 1, HlodTree::kMaxLevels);
+    if (ImGui::IsItemDeactivatedAfterEdit() && hlodSettings.enabled)
+    {
+        cityScene.rebuildHlod();
+    }
+    ImGui::SliderInt("Triangle Budget", &hlodSettings.triangleBudget, 250, 20000, "%d", ImGuiSliderFlags_Logarithmic);
+    if (ImGui::IsItemDeactivatedAfterEdit() && hlodSettings.enabled)
+    {
+        cityScene.rebuildHlod();
+    }
+    ImGui::SliderFloat("Max Error (px)", &hlodSettings.maxPixelError, 0.25f, 32.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+    const HlodTree::Stats &hlodStats = cityScene.getHlodStats();
+    if (hlodStats.clusters > 0)
+    {
+        ImGui::Text("%d clusters, %.1fk proxy triangles, %.2f MB + %zu B palette, built in %.0f ms", hlodStats.clusters,
+                    static_cast<float>(hlodStats.proxyTriangles) / 1000.0f,
+                    static_cast<float>(hlodStats.gpuBytes) / (1024.0f * 1024.0f), hlodStats.paletteBytes,
+                    hlodStats.buildMs);
+        const HlodTree::SelectionStats &hlodSelection = cityScene.getHlodSelection();
+        ImGui::Text("%d proxies (%.1fk triangles) + %d chunks this frame", hlodSelection.proxies,
+                    static_cast<float>(hlodSelection.proxyTriangles) / 1000.0f, hlodSelection.chunks);
+        for (int level = 0; level < hlodStats.levels; level++)
+        {
+            ImGui::Text("Level %d: %d clusters, %d drawn, switch at %.0f-%.0f units", level,
+                        hlodStats.level[level].clusters, hlodSelection.levelProxies[level],
+                        hlodSelection.switchNear[level], hlodSelection.switchFar[level]);
+        }
+    }
+    else
+    {
+        ImGui::TextDisabled("Needs static batching");
+    }
+
+    ImGui::Spacing();
+
+    ImGui::Text("District Generator");
+    ImGui::Separator();
+    CityGeneratorSettings &district = cityScene.getDistrictSettings();
+    ImGui::Checkbox("Generate District", &district.enabled);
+    int districtMode = static_cast<int>(district.mode);
+    const char *districtModes[] = {"Tile City", "Permute Buildings"};
+    ImGui::Combo("Block Content", &districtMode, districtModes, 2);
+    district.mode = static_cast<DistrictMode>(districtMode);
+    ImGui::SliderInt("Blocks Per Side", &district.blocksPerSide, 1, 100);
+    ImGui::SliderFloat("Road Width", &district.roadWidth, 2.0f, 30.0f, "%.1f");
+    ImGui::Checkbox("Rotate Blocks", &district.rotateBlocks);
+    if (district.mode == DistrictMode::PermuteBuildings)
+    {
+        ImGui::SliderInt("Lots Per Side", &district.lotsPerSide, 1, 6);
+        ImGui::SliderFloat("Empty Lots", &district.emptyLotChance, 0.0f, 0.9f, "%.2f");
+    }
+    int districtSeedInput = static_cast<int>(district.seed);
+    if (ImGui::InputInt("Seed", &districtSeedInput))
+        district.seed = static_cast<unsigned int>(std::max(districtSeedInput, 0));
+    if (ImGui::Button(district.enabled ? "Generate" : "Restore Authored City"))
+    {
+        cityScene.regenerateDistrict();
+    }
+    const CityScene::DistrictStats &districtStats = cityScene.getDistrictStats();
+    if (districtStats.blocks > 0)
+    {
+        ImGui::Text("%d blocks, %d placements, %d nodes, %d lamps", districtStats.blocks, districtStats.placements,
+                    districtStats.nodes, districtStats.lamps);
+        ImGui::Text("%.1f M triangles, generated in %.0f ms", static_cast<float>(districtStats.triangles) / 1.0e6f,
+                    districtStats.generateMs);
+        if (districtStats.streamedTiles > 0)
+            ImGui::Text("%d blocks streamed as tiles", districtStats.streamedTiles);
+        ImGui::TextDisabled("Lightmap and probe bakes stay with the authored city");
+    }
+    else
+    {
+        ImGui::TextDisabled("Authored city");
+    }
+
+    ImGui::Spacing();
+
+    ImGui::Text("World Streaming");
+    ImGui::Separator();
+    WorldStreamingSettings &streaming = cityScene.getStreamingSettings();
+    ImGui::Checkbox("Stream District Tiles", &streaming.enabled);
+    ImGui::TextDisabled("Applies on Generate");
+    ImGui::SliderFloat("Load Radius", &streaming.loadRadius, 20.0f, 400.0f, "%.0f");
+    ImGui::SliderFloat("Evict Radius", &streaming.evictRadius, 20.0f, 500.0f, "%.0f");
+    streaming.evictRadius = std::max(streaming.evictRadius, streaming.loadRadius);
+    ImGui::SliderInt("Memory Budget", &streaming.budgetMB, 16, 4096, "%d MB");
+    ImGui::SliderFloat("Upload Budget", &streaming.uploadBudgetMs, 0.1f, 8.0f, "%.1f ms");
+    ImGui::SliderFloat("Prefetch Ahead", &streaming.prefetchSeconds, 0.0f, 6.0f, "%.1f s");
+    ImGui::SliderInt("Max In Flight", &streaming.maxInFlight, 1, 16);
+    const WorldStreamer::Stats &streamStats = cityScene.getStreamingStats();
+    if (streamStats.tiles > 0)
+    {
+        ImGui::Text("Resident %d / %d tiles, %d loading", streamStats.resident, streamStats.tiles, streamStats.loading);
+        ImGui::Text("%.1f / %.0f MB%s", static_cast<float>(streamStats.residentBytes) / (1024.0f * 1024.0f),
+                    static_cast<float>(streamStats.budgetBytes) / (1024.0f * 1024.0f),
+                    streamStats.budgetFull ? " (budget full)" : "");
+        ImGui::Text("Latency: last %.0f ms, avg %.0f ms, max %.0f ms", streamStats.lastLatencyMs,
+                    streamStats.averageLatencyMs, streamStats.maxLatencyMs);
+        ImGui::Text("Upload %.2f ms in %d slices, %d cooked, %d evicted", streamStats.uploadMs, streamStats.uploadSlices,
+                    streamStats.cooked, streamStats.evicted);
+    }
+    else
+    {
+        ImGui::TextDisabled("No streamed tiles");
+    }
+
+    ImGui::Spacing();
+
+    ImGui::Text("Skyline Impostors");
+    ImGui::Separator();
+    ImpostorSettings &impostorSettings = cityScene.getImpostorSettings();
+    ImGui::Checkbox("Enable Skyline", &impostorSettings.enabled);
+    ImGui::SliderInt("Skyline Buildings", &impostorSettings.skylineCount, 0, 512);
+    if (ImGui::IsItemDeactivatedAfterEdit())
+    {
+        cityScene.placeSkyline();
+    }
+    ImGui::SliderInt("View Resolution", &impostorSettings.resolution, 32, 256, "%d px");
+    ImGui::SliderInt("Views Per Side", &impostorSettings.frames, 4, 16);
+    ImGui::SliderInt("Baked Meshes", &impostorSettings.buildings, 1, Skyline::kMaxLayers);
+    if (ImGui::Button("Rebake Impostors"))
+    {
+        cityScene.rebakeImpostors();
+    }
+    const Skyline::Stats &skylineStats = cityScene.getSkylineStats();
+    if (skylineStats.layers > 0)
+    {
+        ImGui::Text("%d impostors of %d meshes, 1 instanced draw", skylineStats.instances, skylineStats.layers);
+        ImGui::Text("%dx%d views at %d px: %.2f MB", skylineStats.frames, skylineStats.frames, skylineStats.resolution,
+                    static_cast<float>(skylineStats.atlasBytes) / (1024.0f * 1024.0f));
+        if (skylineStats.bakeMs > 0.0f)
+            ImGui::Text("Baked in %.0f ms", skylineStats.bakeMs);
+        else
+            ImGui::TextDisabled("Loaded from cache");
+        ImGui::Text("Per impostor: 64 px %zu KB, 128 px %zu KB, 256 px %zu KB",
+                    impostorBytes(64, skylineStats.frames) / 1024, impostorBytes(128, skylineStats.frames) / 1024,
+                    impostorBytes(256, skylineStats.frames) / 1024);
+    }
+    else
+    {
+        ImGui::TextDisabled("No impostor atlas");
+    }
+
+    ImGui::Spacing();
+
+    ImGui::Text("Occlusion Queries");
+    ImGui::Separator();
+    OcclusionQuerySettings &occlusionSettings = cityScene.getOcclusionQuerySettings();
+    ImGui::Checkbox("Enable Occlusion Queries", &occlusionSettings.enabled);
+    ImGui::SliderInt("Retest Interval", &occlusionSettings.retestInterval, 1, 30, "%d frames");
+    ImGui::Checkbox("Wait For Results", &occlusionSettings.waitForResults);
+    if (cityScene.getGpuDrivenSettings().enabled && cityScene.isGpuDrivenSupported())
+    {
+        ImGui::TextDisabled("Inactive while the GPU-driven path draws the city");
+    }
+    else
+    {
+        const OcclusionQueries::Stats &occlusionStats = cityScene.getOcclusionQueryStats();
+        ImGui::Text("%d objects in view, %d hidden", occlusionStats.candidates, occlusionStats.hidden);
+        ImGui::Text("Queries: %d boxes, %d re-tests", occlusionStats.boxQueries, occlusionStats.drawQueries);
+        ImGui::Text("Conditional draws %d, skipped %d", occlusionStats.conditionalDraws, occlusionStats.skippedDraws);
+        ImGui::Text("Late results %d, stalls %d (%.3f ms), starved %d", occlusionStats.lateResults,
+                    occlusionStats.stalls, occlusionStats.stallMs, occlusionStats.starved);
+    }
+
+    ImGui::Spacing();
+
     // Flashlight section
     ImGui::Text("Flashlight");
     ImGui::Separator();
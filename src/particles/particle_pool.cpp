@@ -0,0 +1,181 @@
+#include "particles/particle_pool.hpp"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PARTICLES_USE_SSE 1
+#include <emmintrin.h>
+#else
+#define PARTICLES_USE_SSE 0
+#endif
+
+void ParticlePool::reserve(std::size_t count)
+{
+    // Multiple of 4 so SIMD blocks never straddle the end of the arrays
+    count = (count + 3) & ~std::size_t(3);
+    if (count <= capacity())
+        return;
+
+    for (std::vector<float> *array : {&positionX, &positionY, &positionZ, &velocityX, &velocityY, &velocityZ,
+                                      &life, &invLifetime})
+        array->resize(count, 0.0f);
+}
+
+std::size_t ParticlePool::spawn(std::size_t count, std::size_t &spawned)
+{
+    const std::size_t first = liveCount;
+    spawned = std::min(count, capacity() - liveCount);
+    liveCount += spawned;
+    return first;
+}
+
+void ParticlePool::set(std::size_t i, const glm::vec3 &position, const glm::vec3 &velocity, float lifetime,
+                       float remaining)
+{
+    positionX[i] = position.x;
+    positionY[i] = position.y;
+    positionZ[i] = position.z;
+    velocityX[i] = velocity.x;
+    velocityY[i] = velocity.y;
+    velocityZ[i] = velocity.z;
+    life[i] = remaining;
+    invLifetime[i] = 1.0f / std::max(lifetime, 1e-3f);
+}
+
+void ParticlePool::simulate(std::size_t begin, std::size_t end, const ParticleStep &step)
+{
+    // v' = v * damping + a * dt, p' = p + v' * dt (semi-implicit Euler)
+    const float damping = std::max(0.0f, 1.0f - step.drag * step.dt);
+    const glm::vec3 deltaV = step.acceleration * step.dt;
+    std::size_t i = begin;
+
+#if PARTICLES_USE_SSE
+    const __m128 dt = _mm_set1_ps(step.dt);
+    const __m128 damp = _mm_set1_ps(damping);
+    const __m128 dvx = _mm_set1_ps(deltaV.x);
+    const __m128 dvy = _mm_set1_ps(deltaV.y);
+    const __m128 dvz = _mm_set1_ps(deltaV.z);
+    const __m128 ground = _mm_set1_ps(step.groundY);
+    // All-ones mask keeps every lane alive when ground collisions are off
+    const __m128 noKill = step.killAtGround ? _mm_setzero_ps() : _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 vx = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&velocityX[i]), damp), dvx);
+        __m128 vy = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&velocityY[i]), damp), dvy);
+        __m128 vz = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&velocityZ[i]), damp), dvz);
+        __m128 px = _mm_add_ps(_mm_loadu_ps(&positionX[i]), _mm_mul_ps(vx, dt));
+        __m128 py = _mm_add_ps(_mm_loadu_ps(&positionY[i]), _mm_mul_ps(vy, dt));
+        __m128 pz = _mm_add_ps(_mm_loadu_ps(&positionZ[i]), _mm_mul_ps(vz, dt));
+
+        // Zero the remaining life of lanes that went below the ground
+        const __m128 above = _mm_or_ps(_mm_cmpge_ps(py, ground), noKill);
+        __m128 remaining = _mm_and_ps(_mm_sub_ps(_mm_loadu_ps(&life[i]), dt), above);
+
+        _mm_storeu_ps(&velocityX[i], vx);
+        _mm_storeu_ps(&velocityY[i], vy);
+        _mm_storeu_ps(&velocityZ[i], vz);
+        _mm_storeu_ps(&positionX[i], px);
+        _mm_storeu_ps(&positionY[i], py);
+        _mm_storeu_ps(&positionZ[i], pz);
+        _mm_storeu_ps(&life[i], remaining);
+    }
+#endif
+
+    for (; i < end; ++i)
+    {
+        velocityX[i] = velocityX[i] * damping + deltaV.x;
+        velocityY[i] = velocityY[i] * damping + deltaV.y;
+        velocityZ[i] = velocityZ[i] * damping + deltaV.z;
+        positionX[i] += velocityX[i] * step.dt;
+        positionY[i] += velocityY[i] * step.dt;
+        positionZ[i] += velocityZ[i] * step.dt;
+        life[i] -= step.dt;
+        if (step.killAtGround && positionY[i] < step.groundY)
+            life[i] = 0.0f;
+    }
+}
+
+void ParticlePool::moveParticle(std::size_t from, std::size_t to)
+{
+    positionX[to] = positionX[from];
+    positionY[to] = positionY[from];
+    positionZ[to] = positionZ[from];
+    velocityX[to] = velocityX[from];
+    velocityY[to] = velocityY[from];
+    velocityZ[to] = velocityZ[from];
+    life[to] = life[from];
+    invLifetime[to] = invLifetime[from];
+}
+
+void ParticlePool::compact()
+{
+    std::size_t i = 0;
+    while (i < liveCount)
+    {
+#if PARTICLES_USE_SSE
+        // Skip blocks of four live particles with one compare
+        if (i + 4 <= liveCount &&
+            _mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(&life[i]), _mm_setzero_ps())) == 0)
+        {
+            i += 4;
+            continue;
+        }
+#endif
+        if (life[i] > 0.0f)
+        {
+            ++i;
+            continue;
+        }
+        // Swap in the last particle and re-test this slot
+        --liveCount;
+        if (i != liveCount)
+            moveParticle(liveCount, i);
+    }
+}
+
+void ParticlePool::writeInstances(std::size_t begin, std::size_t end, float *out) const
+{
+    std::size_t i = begin;
+
+#if PARTICLES_USE_SSE
+    // Transpose 4 particles of SoA data into 4 interleaved instances
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 r0 = _mm_loadu_ps(&positionX[i]);
+        __m128 r1 = _mm_loadu_ps(&positionY[i]);
+        __m128 r2 = _mm_loadu_ps(&positionZ[i]);
+        __m128 r3 = _mm_loadu_ps(&life[i]);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+        __m128 v0 = _mm_loadu_ps(&velocityX[i]);
+        __m128 v1 = _mm_loadu_ps(&velocityY[i]);
+        __m128 v2 = _mm_loadu_ps(&velocityZ[i]);
+        __m128 v3 = _mm_loadu_ps(&invLifetime[i]);
+        _MM_TRANSPOSE4_PS(v0, v1, v2, v3);
+
+        float *dst = out + i * kInstanceFloats;
+        _mm_storeu_ps(dst + 0, r0);
+        _mm_storeu_ps(dst + 4, v0);
+        _mm_storeu_ps(dst + 8, r1);
+        _mm_storeu_ps(dst + 12, v1);
+        _mm_storeu_ps(dst + 16, r2);
+        _mm_storeu_ps(dst + 20, v2);
+        _mm_storeu_ps(dst + 24, r3);
+        _mm_storeu_ps(dst + 28, v3);
+    }
+#endif
+
+    for (; i < end; ++i)
+    {
+        float *dst = out + i * kInstanceFloats;
+        dst[0] = positionX[i];
+        dst[1] = positionY[i];
+        dst[2] = positionZ[i];
+        dst[3] = life[i];
+        dst[4] = velocityX[i];
+        dst[5] = velocityY[i];
+        dst[6] = velocityZ[i];
+        dst[7] = invLifetime[i];
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Per-frame integration constants shared by every particle of a pool
+struct ParticleStep
+{
+    float dt = 0.0f;
+    glm::vec3 acceleration{0.0f}; // gravity + wind
+    float drag = 0.0f;            // fraction of velocity lost per second
+    float groundY = 0.0f;
+    bool killAtGround = false;
+};
+
+// Structure-of-arrays particle storage. Each attribute is a contiguous float
+// array so the update kernel can process four particles per SSE instruction,
+// and workers can own disjoint index ranges without false sharing between
+// particles. Dead particles are removed by swapping in the last live one.
+class ParticlePool
+{
+public:
+    static constexpr std::size_t kInstanceFloats = 8; // (position, life) + (velocity, 1/lifetime)
+
+    void reserve(std::size_t capacity);
+    void clear() { liveCount = 0; }
+
+    // Appends up to `count` particles (left uninitialized) and returns the
+    // index of the first; fewer are added when the capacity is exhausted.
+    std::size_t spawn(std::size_t count, std::size_t &spawned);
+
+    void set(std::size_t i, const glm::vec3 &position, const glm::vec3 &velocity, float lifetime, float remaining);
+
+    // Integrates [begin, end); particles that expire or reach the ground get life <= 0
+    void simulate(std::size_t begin, std::size_t end, const ParticleStep &step);
+    // Removes particles with life <= 0 (single-threaded, after simulate)
+    void compact();
+    // Writes kInstanceFloats per particle of [begin, end) into `out`, indexed from `begin`
+    void writeInstances(std::size_t begin, std::size_t end, float *out) const;
+
+    std::size_t size() const { return liveCount; }
+    std::size_t capacity() const { return positionX.size(); }
+
+private:
+    void moveParticle(std::size_t from, std::size_t to);
+
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> velocityX, velocityY, velocityZ;
+    std::vector<float> life;        // seconds remaining
+    std::vector<float> invLifetime; // 1 / total lifetime, for fading
+    std::size_t liveCount = 0;
+};
@@ -0,0 +1,612 @@
+#include "particles/particle_system.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+namespace
+{
+    constexpr float kGroundY = -0.1f;              // matches the ground plane in CityScene
+    constexpr float kMaxStep = 0.1f;               // clamp hitches so emission stays bounded
+    constexpr std::size_t kSimulationGrain = 8192; // particles per job (multiple of 4)
+    constexpr std::size_t kUploadGrain = 16384;
+    constexpr float kSmoothing = 0.1f;
+
+    constexpr std::array<int, 6> kBenchmarkCounts = {25000, 50000, 100000, 200000, 400000, 800000};
+    constexpr int kBenchmarkStages = static_cast<int>(kBenchmarkCounts.size()) * 2; // CPU and GPU per count
+    constexpr int kWarmupFrames = 8;
+    constexpr int kFramesPerStage = 48;
+
+    constexpr GLsizei kInstanceStride = static_cast<GLsizei>(ParticlePool::kInstanceFloats * sizeof(float));
+
+    void configureInstanceAttributes(unsigned int vao, unsigned int vbo, unsigned int divisor)
+    {
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, kInstanceStride, (void *)0);
+        glVertexAttribDivisor(0, divisor);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, kInstanceStride, (void *)(4 * sizeof(float)));
+        glVertexAttribDivisor(1, divisor);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    float elapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+bool ParticleSystem::init(const std::filesystem::path &shaderRoot)
+{
+    const auto renderVert = shaderRoot / "particle.vert";
+    const auto renderFrag = shaderRoot / "particle.frag";
+    renderShader = std::make_unique<Shader>(renderVert.string().c_str(), renderFrag.string().c_str());
+
+    const auto updateVert = shaderRoot / "particle_update.vert";
+    const auto updateFrag = shaderRoot / "particle_update.frag";
+    updateShader = std::make_unique<Shader>(updateVert.string().c_str(), updateFrag.string().c_str(),
+                                            std::vector<const char *>{"outPositionLife", "outVelocity"});
+
+    for (LayerBuffers &layer : buffers)
+    {
+        glGenBuffers(1, &layer.streamVbo);
+        glGenVertexArrays(1, &layer.streamVao);
+        configureInstanceAttributes(layer.streamVao, layer.streamVbo, 1);
+
+        glGenBuffers(2, layer.feedbackVbo);
+        glGenVertexArrays(2, layer.feedbackUpdateVao);
+        glGenVertexArrays(2, layer.feedbackDrawVao);
+        for (int i = 0; i < 2; ++i)
+        {
+            configureInstanceAttributes(layer.feedbackUpdateVao[i], layer.feedbackVbo[i], 0);
+            configureInstanceAttributes(layer.feedbackDrawVao[i], layer.feedbackVbo[i], 1);
+        }
+    }
+
+    applyDefaultLayers();
+    emitters.clear();
+    emitters.push_back(Emitter{Rain, -1, glm::vec3(0.0f), 0.0f, true});
+    activeSimulation = settings.simulation;
+    prewarm(Rain);
+
+    return renderShader->ID != 0 && updateShader->ID != 0;
+}
+
+void ParticleSystem::shutdown()
+{
+    for (LayerBuffers &layer : buffers)
+    {
+        glDeleteBuffers(1, &layer.streamVbo);
+        glDeleteVertexArrays(1, &layer.streamVao);
+        glDeleteBuffers(2, layer.feedbackVbo);
+        glDeleteVertexArrays(2, layer.feedbackUpdateVao);
+        glDeleteVertexArrays(2, layer.feedbackDrawVao);
+        layer = LayerBuffers{};
+    }
+    renderShader.reset();
+    updateShader.reset();
+}
+
+void ParticleSystem::applyDefaultLayers()
+{
+    ParticleLayerSettings &rain = layers[Rain];
+    rain.color = glm::vec3(0.45f, 0.5f, 0.6f);
+    rain.opacity = 0.35f;
+    rain.size = 0.006f;
+    rain.stretch = 0.02f;
+    // Spawned in a thin sheet above the camera; the lifetime roughly matches
+    // the fall to street level so few drops are culled early by the ground
+    rain.spawnExtent = glm::vec3(20.0f, 0.5f, 20.0f);
+    rain.velocityJitter = glm::vec3(0.2f, 1.0f, 0.2f);
+    rain.lifetimeMin = 1.0f;
+    rain.lifetimeMax = 1.2f;
+    rain.killAtGround = true;
+
+    ParticleLayerSettings &mist = layers[Mist];
+    mist.color = glm::vec3(0.5f, 0.35f, 0.15f);
+    mist.opacity = 0.05f;
+    mist.size = 0.7f;
+    mist.spawnExtent = glm::vec3(1.2f, 0.6f, 1.2f);
+    mist.velocity = glm::vec3(0.0f, 0.05f, 0.0f);
+    mist.velocityJitter = glm::vec3(0.15f, 0.05f, 0.15f);
+    mist.drag = 0.3f;
+    mist.lifetimeMin = 4.0f;
+    mist.lifetimeMax = 7.0f;
+    mist.ratePerEmitter = 25.0f;
+
+    ParticleLayerSettings &sparks = layers[Sparks];
+    sparks.color = glm::vec3(6.0f, 3.0f, 0.8f);
+    sparks.opacity = 1.0f;
+    sparks.size = 0.02f;
+    sparks.stretch = 0.015f;
+    sparks.additive = true;
+    sparks.spawnExtent = glm::vec3(0.1f);
+    sparks.velocity = glm::vec3(0.0f, 1.0f, 0.0f);
+    sparks.velocityJitter = glm::vec3(2.5f, 1.5f, 2.5f);
+    sparks.acceleration = glm::vec3(0.0f, -9.81f, 0.0f);
+    sparks.drag = 0.2f;
+    sparks.lifetimeMin = 0.5f;
+    sparks.lifetimeMax = 1.2f;
+    sparks.killAtGround = true;
+    sparks.ratePerEmitter = 80.0f;
+}
+
+void ParticleSystem::attachToStreetLamps(const std::array<glm::vec3, 8> &lampPositions)
+{
+    emitters.erase(std::remove_if(emitters.begin(), emitters.end(), [](const Emitter &e) { return e.lamp >= 0; }),
+                   emitters.end());
+
+    // Lamps 2 and 5 are the faulty ones that shower sparks
+    for (int i = 0; i < static_cast<int>(lampPositions.size()); ++i)
+    {
+        emitters.push_back(Emitter{Mist, i, lampPositions[i] - glm::vec3(0.0f, 0.4f, 0.0f), 0.0f, true});
+        if (i == 2 || i == 5)
+            emitters.push_back(Emitter{Sparks, i, lampPositions[i], 0.0f, true});
+    }
+
+    prewarm(Mist);
+    prewarm(Sparks);
+    buffers[Mist].feedbackValid = false;
+    buffers[Sparks].feedbackValid = false;
+}
+
+void ParticleSystem::setStreetLampEnabled(int lamp, bool enabled)
+{
+    for (Emitter &emitter : emitters)
+    {
+        if (emitter.lamp == lamp)
+            emitter.enabled = enabled;
+    }
+}
+
+float ParticleSystem::emitterRate(int layer) const
+{
+    const ParticleLayerSettings &settingsForLayer = layers[layer];
+    if (layer == Rain)
+    {
+        const float meanLifetime = 0.5f * (settingsForLayer.lifetimeMin + settingsForLayer.lifetimeMax);
+        return static_cast<float>(settings.rainParticles) / std::max(meanLifetime, 1e-3f);
+    }
+    return settingsForLayer.ratePerEmitter;
+}
+
+std::size_t ParticleSystem::targetCount(int layer) const
+{
+    if (!layers[layer].enabled)
+        return 0;
+
+    int activeEmitters = 0;
+    for (const Emitter &emitter : emitters)
+    {
+        if (emitter.layer == layer && emitter.enabled)
+            ++activeEmitters;
+    }
+    const float meanLifetime = 0.5f * (layers[layer].lifetimeMin + layers[layer].lifetimeMax);
+    const float count = emitterRate(layer) * meanLifetime * static_cast<float>(activeEmitters);
+    return std::min(static_cast<std::size_t>(count), kMaxParticlesPerLayer);
+}
+
+float ParticleSystem::random01()
+{
+    // xorshift32: cheap and good enough for spawn jitter
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return static_cast<float>(rngState) * (1.0f / 4294967296.0f);
+}
+
+glm::vec3 ParticleSystem::spawnPosition(const Emitter &emitter, const ParticleLayerSettings &layer)
+{
+    const glm::vec3 r(random01(), random01(), random01());
+    return emitter.position + (r * 2.0f - 1.0f) * layer.spawnExtent;
+}
+
+glm::vec3 ParticleSystem::spawnVelocity(const ParticleLayerSettings &layer)
+{
+    const glm::vec3 r(random01(), random01(), random01());
+    return layer.velocity + (r * 2.0f - 1.0f) * layer.velocityJitter;
+}
+
+float ParticleSystem::randomLifetime(const ParticleLayerSettings &layer)
+{
+    return layer.lifetimeMin + (layer.lifetimeMax - layer.lifetimeMin) * random01();
+}
+
+void ParticleSystem::prewarm(int layer)
+{
+    // Fill the pool with the steady-state population at random ages, so
+    // changing counts or simulation paths does not ramp up from empty
+    ParticlePool &pool = pools[layer];
+    const ParticleLayerSettings &settingsForLayer = layers[layer];
+    const std::size_t total = targetCount(layer);
+    pool.reserve(total + total / 4);
+    pool.clear();
+
+    std::vector<const Emitter *> sources;
+    for (const Emitter &emitter : emitters)
+    {
+        if (emitter.layer == layer && emitter.enabled)
+            sources.push_back(&emitter);
+    }
+    if (sources.empty() || total == 0)
+        return;
+
+    std::size_t spawned = 0;
+    const std::size_t first = pool.spawn(total, spawned);
+    for (std::size_t i = 0; i < spawned; ++i)
+    {
+        const Emitter &emitter = *sources[i % sources.size()];
+        const float lifetime = randomLifetime(settingsForLayer);
+        const float remaining = random01() * lifetime;
+        const float age = lifetime - remaining;
+        const glm::vec3 velocity = spawnVelocity(settingsForLayer);
+        const glm::vec3 position = spawnPosition(emitter, settingsForLayer) + velocity * age +
+                                   0.5f * settingsForLayer.acceleration * age * age;
+        pool.set(first + i, position, velocity + settingsForLayer.acceleration * age, lifetime, remaining);
+    }
+}
+
+void ParticleSystem::emit(int layer, float dt)
+{
+    ParticlePool &pool = pools[layer];
+    const ParticleLayerSettings &settingsForLayer = layers[layer];
+    const float rate = emitterRate(layer);
+
+    for (Emitter &emitter : emitters)
+    {
+        if (emitter.layer != layer || !emitter.enabled)
+            continue;
+
+        emitter.accumulator += rate * dt;
+        const std::size_t wanted = static_cast<std::size_t>(emitter.accumulator);
+        emitter.accumulator -= static_cast<float>(wanted);
+
+        std::size_t spawned = 0;
+        const std::size_t first = pool.spawn(wanted, spawned);
+        for (std::size_t i = 0; i < spawned; ++i)
+        {
+            const float lifetime = randomLifetime(settingsForLayer);
+            pool.set(first + i, spawnPosition(emitter, settingsForLayer), spawnVelocity(settingsForLayer), lifetime,
+                     lifetime);
+        }
+    }
+}
+
+void ParticleSystem::update(float dt, const glm::vec3 &cameraPosition, JobSystem &jobs, GpuProfiler &profiler)
+{
+    if (!settings.enabled)
+        return;
+
+    dt = std::min(dt, kMaxStep);
+    layers[Rain].velocity = glm::vec3(settings.wind.x, -14.0f, settings.wind.y);
+    for (Emitter &emitter : emitters)
+    {
+        if (emitter.lamp < 0)
+            emitter.position = cameraPosition + glm::vec3(0.0f, 16.0f, 0.0f);
+    }
+
+    // Switching paths restarts from a prewarmed population
+    if (settings.simulation != activeSimulation)
+    {
+        activeSimulation = settings.simulation;
+        for (int layer = 0; layer < LayerCount; ++layer)
+        {
+            prewarm(layer);
+            buffers[layer].feedbackValid = false;
+        }
+    }
+
+    if (activeSimulation == ParticleSimulation::Cpu)
+    {
+        auto start = std::chrono::steady_clock::now();
+        simulateCpu(dt, jobs);
+        lastSimulationMs = elapsedMs(start);
+
+        start = std::chrono::steady_clock::now();
+        uploadCpu(jobs);
+        lastUploadMs = elapsedMs(start);
+    }
+    else
+    {
+        profiler.begin(simulationScopeName());
+        simulateGpu(dt);
+        profiler.end(simulationScopeName());
+        lastSimulationMs = 0.0f;
+        lastUploadMs = 0.0f;
+    }
+
+    simulationMs += (lastSimulationMs - simulationMs) * kSmoothing;
+    uploadMs += (lastUploadMs - uploadMs) * kSmoothing;
+}
+
+void ParticleSystem::simulateCpu(float dt, JobSystem &jobs)
+{
+    for (int layer = 0; layer < LayerCount; ++layer)
+    {
+        ParticlePool &pool = pools[layer];
+        const ParticleLayerSettings &settingsForLayer = layers[layer];
+        if (!settingsForLayer.enabled)
+        {
+            pool.clear();
+            continue;
+        }
+
+        const std::size_t target = targetCount(layer);
+        pool.reserve(target + target / 4);
+
+        ParticleStep step;
+        step.dt = dt;
+        step.acceleration = settingsForLayer.acceleration;
+        step.drag = settingsForLayer.drag;
+        step.groundY = kGroundY;
+        step.killAtGround = settingsForLayer.killAtGround;
+        jobs.parallelFor(pool.size(), kSimulationGrain,
+                         [&pool, &step](std::size_t begin, std::size_t end) { pool.simulate(begin, end, step); });
+
+        pool.compact();
+        emit(layer, dt);
+    }
+}
+
+void ParticleSystem::uploadCpu(JobSystem &jobs)
+{
+    for (int layer = 0; layer < LayerCount; ++layer)
+    {
+        LayerBuffers &layerBuffers = buffers[layer];
+        const ParticlePool &pool = pools[layer];
+        const std::size_t count = pool.size();
+        layerBuffers.drawCount = 0;
+        if (count == 0)
+            continue;
+
+        // Orphan the buffer every frame: the driver hands back fresh storage
+        // while the GPU may still read last frame's instances
+        layerBuffers.streamCapacity = std::max(layerBuffers.streamCapacity, count);
+        const GLsizeiptr bytes = static_cast<GLsizeiptr>(count) * kInstanceStride;
+        glBindBuffer(GL_ARRAY_BUFFER, layerBuffers.streamVbo);
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(layerBuffers.streamCapacity) * kInstanceStride, nullptr,
+                     GL_STREAM_DRAW);
+        auto *mapped = static_cast<float *>(glMapBufferRange(
+            GL_ARRAY_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+        if (!mapped)
+            continue;
+
+        // Workers transpose disjoint ranges straight into the mapped storage
+        jobs.parallelFor(count, kUploadGrain,
+                         [&pool, mapped](std::size_t begin, std::size_t end) { pool.writeInstances(begin, end, mapped); });
+
+        if (glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE)
+            layerBuffers.drawCount = count;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void ParticleSystem::seedFeedbackBuffers(int layer)
+{
+    prewarm(layer);
+    LayerBuffers &layerBuffers = buffers[layer];
+    const ParticlePool &pool = pools[layer];
+    const std::size_t count = pool.size();
+
+    std::vector<float> data(count * ParticlePool::kInstanceFloats);
+    pool.writeInstances(0, count, data.data());
+
+    const GLsizeiptr bytes = static_cast<GLsizeiptr>(count) * kInstanceStride;
+    for (int i = 0; i < 2; ++i)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, layerBuffers.feedbackVbo[i]);
+        glBufferData(GL_ARRAY_BUFFER, bytes, i == 0 ? data.data() : nullptr, GL_DYNAMIC_COPY);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    layerBuffers.feedbackCount = count;
+    layerBuffers.feedbackCurrent = 0;
+    layerBuffers.feedbackValid = true;
+}
+
+void ParticleSystem::simulateGpu(float dt)
+{
+    glEnable(GL_RASTERIZER_DISCARD);
+    updateShader->use();
+    updateShader->setFloat("dt", dt);
+    updateShader->setFloat("groundY", kGroundY);
+
+    for (int layer = 0; layer < LayerCount; ++layer)
+    {
+        LayerBuffers &layerBuffers = buffers[layer];
+        const ParticleLayerSettings &settingsForLayer = layers[layer];
+        const std::size_t target = targetCount(layer);
+        layerBuffers.drawCount = 0;
+        if (target == 0)
+            continue;
+        if (!layerBuffers.feedbackValid || layerBuffers.feedbackCount != target)
+            seedFeedbackBuffers(layer);
+
+        int emitterCount = 0;
+        for (const Emitter &emitter : emitters)
+        {
+            if (emitter.layer != layer || !emitter.enabled || emitterCount >= kMaxEmittersPerLayer)
+                continue;
+            updateShader->setVec3("emitterPositions[" + std::to_string(emitterCount) + "]", emitter.position);
+            ++emitterCount;
+        }
+
+        updateShader->setInt("emitterCount", emitterCount);
+        updateShader->setVec3("acceleration", settingsForLayer.acceleration);
+        updateShader->setFloat("damping", std::max(0.0f, 1.0f - settingsForLayer.drag * dt));
+        updateShader->setBool("killAtGround", settingsForLayer.killAtGround);
+        updateShader->setVec3("spawnExtent", settingsForLayer.spawnExtent);
+        updateShader->setVec3("baseVelocity", settingsForLayer.velocity);
+        updateShader->setVec3("velocityJitter", settingsForLayer.velocityJitter);
+        updateShader->setVec2("lifetimeRange", glm::vec2(settingsForLayer.lifetimeMin, settingsForLayer.lifetimeMax));
+        glUniform1ui(glGetUniformLocation(updateShader->ID, "seed"), ++frameSeed * 0x9E3779B9u + layer);
+
+        // Read the current buffer, capture into the other one
+        const int source = layerBuffers.feedbackCurrent;
+        glBindVertexArray(layerBuffers.feedbackUpdateVao[source]);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, layerBuffers.feedbackVbo[1 - source]);
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(layerBuffers.feedbackCount));
+        glEndTransformFeedback();
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+
+        layerBuffers.feedbackCurrent = 1 - source;
+        layerBuffers.drawCount = layerBuffers.feedbackCount;
+    }
+
+    glBindVertexArray(0);
+    glDisable(GL_RASTERIZER_DISCARD);
+}
+
+void ParticleSystem::render(const glm::mat4 &view, const glm::mat4 &projection, GpuProfiler &profiler)
+{
+    if (!settings.enabled)
+        return;
+
+    profiler.begin(renderScopeName());
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA); // premultiplied: alpha 0 is additive
+    glDepthMask(GL_FALSE);
+
+    renderShader->use();
+    renderShader->setMat4("view", view);
+    renderShader->setMat4("projection", projection);
+    for (int layer = 0; layer < LayerCount; ++layer)
+    {
+        const LayerBuffers &layerBuffers = buffers[layer];
+        const ParticleLayerSettings &settingsForLayer = layers[layer];
+        if (!settingsForLayer.enabled || layerBuffers.drawCount == 0)
+            continue;
+
+        renderShader->setVec3("color", settingsForLayer.color);
+        renderShader->setFloat("opacity", settingsForLayer.opacity);
+        renderShader->setFloat("size", settingsForLayer.size);
+        renderShader->setFloat("stretch", settingsForLayer.stretch);
+        renderShader->setFloat("additive", settingsForLayer.additive ? 1.0f : 0.0f);
+
+        const unsigned int vao = activeSimulation == ParticleSimulation::Cpu
+                                     ? layerBuffers.streamVao
+                                     : layerBuffers.feedbackDrawVao[layerBuffers.feedbackCurrent];
+        glBindVertexArray(vao);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(layerBuffers.drawCount));
+    }
+    glBindVertexArray(0);
+
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+    profiler.end(renderScopeName());
+}
+
+std::size_t ParticleSystem::particleCount(int layer) const
+{
+    return buffers[layer].drawCount;
+}
+
+std::size_t ParticleSystem::totalParticles() const
+{
+    std::size_t total = 0;
+    for (int layer = 0; layer < LayerCount; ++layer)
+        total += particleCount(layer);
+    return total;
+}
+
+void ParticleSystem::startBenchmark()
+{
+    if (isBenchmarking())
+        return;
+
+    savedSettings = settings;
+    results.clear();
+    benchmarkStage = 0;
+    applyBenchmarkStage();
+}
+
+void ParticleSystem::applyBenchmarkStage()
+{
+    settings.enabled = true;
+    settings.rainParticles = kBenchmarkCounts[benchmarkStage / 2];
+    settings.simulation = (benchmarkStage % 2 == 0) ? ParticleSimulation::Cpu : ParticleSimulation::GpuTransformFeedback;
+    prewarm(Rain);
+    buffers[Rain].feedbackValid = false;
+
+    benchmarkFrame = 0;
+    benchmarkSamples = 0;
+    benchmarkSum = BenchmarkResult{};
+}
+
+void ParticleSystem::updateBenchmark(const GpuProfiler &profiler)
+{
+    if (!isBenchmarking())
+        return;
+
+    if (benchmarkFrame >= kWarmupFrames)
+    {
+        benchmarkSum.particles += totalParticles();
+        benchmarkSum.cpuSimulationMs += lastSimulationMs;
+        benchmarkSum.cpuUploadMs += lastUploadMs;
+        if (activeSimulation == ParticleSimulation::GpuTransformFeedback)
+            benchmarkSum.gpuSimulationMs += profiler.lastMs(simulationScopeName());
+        benchmarkSum.gpuRenderMs += profiler.lastMs(renderScopeName());
+        ++benchmarkSamples;
+    }
+
+    if (++benchmarkFrame < kFramesPerStage)
+        return;
+
+    const float samples = static_cast<float>(std::max(benchmarkSamples, 1));
+    BenchmarkResult result;
+    result.simulation = settings.simulation;
+    result.particles = benchmarkSum.particles / static_cast<std::size_t>(std::max(benchmarkSamples, 1));
+    result.cpuSimulationMs = benchmarkSum.cpuSimulationMs / samples;
+    result.cpuUploadMs = benchmarkSum.cpuUploadMs / samples;
+    result.gpuSimulationMs = benchmarkSum.gpuSimulationMs / samples;
+    result.gpuRenderMs = benchmarkSum.gpuRenderMs / samples;
+    results.push_back(result);
+
+    std::cout << "[Particles] " << simulationName(result.simulation) << " " << result.particles
+              << " particles: CPU sim " << result.cpuSimulationMs << " ms, upload " << result.cpuUploadMs
+              << " ms, GPU sim " << result.gpuSimulationMs << " ms, render " << result.gpuRenderMs << " ms"
+              << std::endl;
+
+    if (++benchmarkStage < kBenchmarkStages)
+    {
+        applyBenchmarkStage();
+        return;
+    }
+
+    benchmarkStage = -1;
+    settings = savedSettings;
+}
+
+float ParticleSystem::benchmarkProgress() const
+{
+    if (!isBenchmarking())
+        return 1.0f;
+    const float done = static_cast<float>(benchmarkStage * kFramesPerStage + benchmarkFrame);
+    return done / static_cast<float>(kBenchmarkStages * kFramesPerStage);
+}
+
+const char *ParticleSystem::layerName(int layer)
+{
+    switch (layer)
+    {
+    case Rain:
+        return "Rain";
+    case Mist:
+        return "Lamp Mist";
+    case Sparks:
+        return "Sparks";
+    default:
+        return "Unknown";
+    }
+}
+
+const char *ParticleSystem::simulationName(ParticleSimulation simulation)
+{
+    return simulation == ParticleSimulation::Cpu ? "CPU (SoA SIMD)" : "GPU (transform feedback)";
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "shader.hpp"
+#include "core/job_system.hpp"
+#include "particles/particle_pool.hpp"
+#include "render/gpu_timer.hpp"
+
+enum class ParticleSimulation
+{
+    Cpu,                  // SoA pools, SIMD kernels on the job system, streamed to the GPU
+    GpuTransformFeedback, // ping-pong vertex buffers updated by a transform-feedback pass
+};
+
+struct ParticleSettings
+{
+    bool enabled = true;
+    ParticleSimulation simulation = ParticleSimulation::Cpu;
+    int rainParticles = 100000;     // steady-state rain drop count
+    glm::vec2 wind{1.5f, 0.5f};     // horizontal rain drift (x, z)
+};
+
+// Look and motion of one particle layer (rain, mist, sparks)
+struct ParticleLayerSettings
+{
+    bool enabled = true;
+    glm::vec3 color{1.0f};          // HDR, so sparks can drive bloom
+    float opacity = 1.0f;
+    float size = 0.05f;             // half width in world units
+    float stretch = 0.0f;           // streak length per unit of speed
+    bool additive = false;
+    glm::vec3 spawnExtent{0.5f};    // half size of the spawn box around an emitter
+    glm::vec3 velocity{0.0f};
+    glm::vec3 velocityJitter{0.0f};
+    glm::vec3 acceleration{0.0f};
+    float drag = 0.0f;
+    float lifetimeMin = 1.0f;
+    float lifetimeMax = 1.0f;
+    bool killAtGround = false;
+    float ratePerEmitter = 10.0f;   // particles per second (rain derives it from rainParticles)
+};
+
+// Rain, lamp mist and sparks for the night city. Every layer keeps its
+// particles in a structure-of-arrays pool updated by SSE kernels across the
+// job system, then streamed into an orphaned vertex buffer and drawn as
+// instanced camera-facing quads. The optional transform-feedback path keeps
+// the same instance layout in GPU buffers and never touches the CPU.
+class ParticleSystem
+{
+public:
+    enum Layer
+    {
+        Rain,
+        Mist,
+        Sparks,
+        LayerCount,
+    };
+
+    static constexpr int kMaxEmittersPerLayer = 16;
+    static constexpr std::size_t kMaxParticlesPerLayer = std::size_t(1) << 20;
+
+    struct BenchmarkResult
+    {
+        ParticleSimulation simulation = ParticleSimulation::Cpu;
+        std::size_t particles = 0;
+        float cpuSimulationMs = 0.0f;
+        float cpuUploadMs = 0.0f;
+        float gpuSimulationMs = 0.0f;
+        float gpuRenderMs = 0.0f;
+    };
+
+    ParticleSettings settings;
+    std::array<ParticleLayerSettings, LayerCount> layers;
+
+    bool init(const std::filesystem::path &shaderRoot);
+    void shutdown();
+
+    // Mist around every lamp, sparks from a couple of faulty ones
+    void attachToStreetLamps(const std::array<glm::vec3, 8> &lampPositions);
+    void setStreetLampEnabled(int lamp, bool enabled);
+
+    // Emits and simulates; rain follows the camera. GPU simulation is timed in `profiler`.
+    void update(float dt, const glm::vec3 &cameraPosition, JobSystem &jobs, GpuProfiler &profiler);
+    // Draws every layer into the bound HDR target, depth-tested but not written
+    void render(const glm::mat4 &view, const glm::mat4 &projection, GpuProfiler &profiler);
+
+    std::size_t particleCount(int layer) const;
+    std::size_t totalParticles() const;
+    float cpuSimulationMs() const { return simulationMs; }
+    float cpuUploadMs() const { return uploadMs; }
+
+    // Steps through rain counts for both simulation paths, reporting CPU
+    // simulate/upload time and GPU simulate/render time separately
+    void startBenchmark();
+    void updateBenchmark(const GpuProfiler &profiler);
+    bool isBenchmarking() const { return benchmarkStage >= 0; }
+    float benchmarkProgress() const;
+    const std::vector<BenchmarkResult> &benchmarkResults() const { return results; }
+
+    static const char *layerName(int layer);
+    static const char *simulationName(ParticleSimulation simulation);
+    static const char *simulationScopeName() { return "Particle Sim"; }
+    static const char *renderScopeName() { return "Particles"; }
+
+private:
+    struct Emitter
+    {
+        int layer = Rain;
+        int lamp = -1;              // street lamp index, -1 for the camera-following rain
+        glm::vec3 position{0.0f};
+        float accumulator = 0.0f;   // fractional particles carried to the next frame
+        bool enabled = true;
+    };
+
+    // GL side of one layer: a streaming buffer for the CPU path and two
+    // ping-pong buffers for the transform-feedback path
+    struct LayerBuffers
+    {
+        unsigned int streamVbo = 0;
+        unsigned int streamVao = 0;
+        std::size_t streamCapacity = 0;
+
+        unsigned int feedbackVbo[2] = {0, 0};
+        unsigned int feedbackUpdateVao[2] = {0, 0}; // per-vertex attributes for the update pass
+        unsigned int feedbackDrawVao[2] = {0, 0};   // per-instance attributes for drawing
+        std::size_t feedbackCount = 0;
+        int feedbackCurrent = 0;
+        bool feedbackValid = false;
+
+        std::size_t drawCount = 0;
+    };
+
+    void applyDefaultLayers();
+    float emitterRate(int layer) const;
+    std::size_t targetCount(int layer) const;
+    glm::vec3 spawnPosition(const Emitter &emitter, const ParticleLayerSettings &layer);
+    glm::vec3 spawnVelocity(const ParticleLayerSettings &layer);
+    float randomLifetime(const ParticleLayerSettings &layer);
+    float random01();
+
+    void prewarm(int layer);
+    void emit(int layer, float dt);
+    void simulateCpu(float dt, JobSystem &jobs);
+    void uploadCpu(JobSystem &jobs);
+    void simulateGpu(float dt);
+    void seedFeedbackBuffers(int layer);
+    void applyBenchmarkStage();
+
+    std::unique_ptr<Shader> renderShader;
+    std::unique_ptr<Shader> updateShader;
+
+    std::array<ParticlePool, LayerCount> pools;
+    std::array<LayerBuffers, LayerCount> buffers;
+    std::vector<Emitter> emitters;
+    ParticleSimulation activeSimulation = ParticleSimulation::Cpu;
+    std::uint32_t rngState = 0x9E3779B9u;
+    std::uint32_t frameSeed = 0;
+
+    float lastSimulationMs = 0.0f;
+    float lastUploadMs = 0.0f;
+    float simulationMs = 0.0f; // smoothed for display
+    float uploadMs = 0.0f;
+
+    // Benchmark state
+    int benchmarkStage = -1;
+    int benchmarkFrame = 0;
+    BenchmarkResult benchmarkSum;
+    int benchmarkSamples = 0;
+    ParticleSettings savedSettings;
+    std::vector<BenchmarkResult> results;
+};
@@ -0,0 +1,49 @@
+#include "render/dynamic_resolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr float kDeadband = 0.05f;     // ignore +-5% jitter around the budget
+    constexpr float kDropRate = 0.5f;      // fraction of the correction applied when over budget
+    constexpr float kRaiseRate = 0.05f;    // fraction of the correction applied when under budget
+    constexpr float kScaleStep = 1.0f / 64.0f;
+}
+
+void DynamicResolution::update(float gpuFrameMs)
+{
+    if (!settings.enabled || gpuFrameMs <= 0.0f)
+        return;
+
+    const float budgetMs = settings.targetFrameMs * settings.headroom;
+    const float ratio = budgetMs / gpuFrameMs;
+    if (std::fabs(ratio - 1.0f) < kDeadband)
+        return;
+
+    const float idealScale = currentScale * std::sqrt(ratio);
+    const float rate = (idealScale < currentScale) ? kDropRate : kRaiseRate;
+    float next = currentScale + (idealScale - currentScale) * rate;
+
+    // Quantize so the render size does not change every single frame, but
+    // always move at least one step so slow corrections still converge
+    next = std::round(next / kScaleStep) * kScaleStep;
+    if (next == currentScale)
+        next += (idealScale > currentScale) ? kScaleStep : -kScaleStep;
+    currentScale = std::clamp(next, settings.minScale, settings.maxScale);
+}
+
+int DynamicResolution::scaledWidth(int outputWidth) const
+{
+    return std::max(1, static_cast<int>(std::lround(static_cast<float>(outputWidth) * scale())));
+}
+
+int DynamicResolution::scaledHeight(int outputHeight) const
+{
+    return std::max(1, static_cast<int>(std::lround(static_cast<float>(outputHeight) * scale())));
+}
+
+float DynamicResolution::textureLodBias() const
+{
+    return std::log2(scale());
+}
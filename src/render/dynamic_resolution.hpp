@@ -0,0 +1,38 @@
+#pragma once
+
+struct DynamicResolutionSettings
+{
+    bool enabled = true;
+    float targetFrameMs = 1000.0f / 60.0f; // frame budget to hold (vsync interval)
+    float headroom = 0.9f;                  // fraction of the budget the GPU may use
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+    float fixedScale = 1.0f;                // used while the controller is disabled
+};
+
+// Picks a per-axis resolution scale for the 3D scene from the measured GPU
+// frame time. Fragment cost is roughly proportional to pixel count, i.e. to
+// scale^2, so the ideal scale is scale * sqrt(budget / measured). The
+// controller drops quickly when over budget (avoid missed vsyncs) and climbs
+// back slowly (avoid oscillating around the budget).
+class DynamicResolution
+{
+public:
+    DynamicResolutionSettings settings;
+
+    void update(float gpuFrameMs);
+    void reset() { currentScale = settings.maxScale; }
+
+    float scale() const { return settings.enabled ? currentScale : settings.fixedScale; }
+
+    // Render size for a given output size, never below one pixel
+    int scaledWidth(int outputWidth) const;
+    int scaledHeight(int outputHeight) const;
+
+    // Negative mip bias that keeps texture sharpness matched to the output
+    // resolution instead of the reduced render resolution
+    float textureLodBias() const;
+
+private:
+    float currentScale = 1.0f;
+};
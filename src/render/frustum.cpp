@@ -0,0 +1,86 @@
+#include "render/frustum.hpp"
+
+#include <cmath>
+
+Aabb Aabb::empty()
+{
+    return Aabb{glm::vec3(std::numeric_limits<float>::max()), glm::vec3(-std::numeric_limits<float>::max())};
+}
+
+void Aabb::expand(const Aabb &other)
+{
+    min = glm::min(min, other.min);
+    max = glm::max(max, other.max);
+}
+
+Aabb Aabb::transformed(const glm::mat4 &transform) const
+{
+    if (isEmpty())
+        return *this;
+
+    const glm::vec3 translation(transform[3]);
+    Aabb result{translation, translation};
+    for (int column = 0; column < 3; column++)
+    {
+        for (int row = 0; row < 3; row++)
+        {
+            const float a = transform[column][row] * min[column];
+            const float b = transform[column][row] * max[column];
+            result.min[row] += std::fmin(a, b);
+            result.max[row] += std::fmax(a, b);
+        }
+    }
+    return result;
+}
+
+Frustum Frustum::fromMatrix(const glm::mat4 &viewProjection)
+{
+    const glm::mat4 &m = viewProjection;
+    const glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    const glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    const glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    const glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    Frustum frustum;
+    frustum.addPlane(row3 + row0); // left
+    frustum.addPlane(row3 - row0); // right
+    frustum.addPlane(row3 + row1); // bottom
+    frustum.addPlane(row3 - row1); // top
+    frustum.addPlane(row3 + row2); // near
+    frustum.addPlane(row3 - row2); // far
+    return frustum;
+}
+
+void Frustum::addPlane(const glm::vec4 &plane)
+{
+    if (count >= kMaxPlanes)
+        return;
+    const float length = glm::length(glm::vec3(plane));
+    planes[count++] = length > 0.0f ? plane / length : plane;
+}
+
+bool Frustum::intersects(const Aabb &box) const
+{
+    for (int i = 0; i < count; i++)
+    {
+        const glm::vec4 &p = planes[i];
+        // Corner furthest along the plane normal
+        const glm::vec3 positive(p.x >= 0.0f ? box.max.x : box.min.x,
+                                 p.y >= 0.0f ? box.max.y : box.min.y,
+                                 p.z >= 0.0f ? box.max.z : box.min.z);
+        if (glm::dot(glm::vec3(p), positive) + p.w < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+bool Frustum::intersectsSphere(const glm::vec3 &center, float radius) const
+{
+    // Planes are normalized, so the plane equation is a signed distance
+    for (int i = 0; i < count; i++)
+    {
+        if (glm::dot(glm::vec3(planes[i]), center) + planes[i].w < -radius)
+            return false;
+    }
+    return true;
+}
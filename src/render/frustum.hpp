@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <limits>
+
+#include <glm/glm.hpp>
+
+// Axis-aligned bounding box in whatever space its corners were given in
+struct Aabb
+{
+    glm::vec3 min{0.0f};
+    glm::vec3 max{0.0f};
+
+    // Contains nothing; expand() replaces it with the first real box
+    static Aabb empty();
+    bool isEmpty() const { return min.x > max.x; }
+    void expand(const Aabb &other);
+
+    // Bounds of the box after an affine transform (Arvo's method)
+    Aabb transformed(const glm::mat4 &transform) const;
+};
+
+// Culling volume made of inward-facing planes (ax + by + cz + d >= 0 inside).
+// The six frustum planes are extracted from a view-projection matrix (Gribb &
+// Hartmann), so a mirrored view yields the mirrored frustum; extra planes such
+// as a water surface can be appended.
+class Frustum
+{
+public:
+    static constexpr int kMaxPlanes = 8;
+
+    static Frustum fromMatrix(const glm::mat4 &viewProjection);
+
+    void addPlane(const glm::vec4 &plane);
+    // Conservative: false only when the box lies fully outside one plane
+    bool intersects(const Aabb &box) const;
+    bool intersectsSphere(const glm::vec3 &center, float radius) const;
+
+    int planeCount() const { return count; }
+    const glm::vec4 &plane(int index) const { return planes[index]; }
+
+private:
+    std::array<glm::vec4, kMaxPlanes> planes{};
+    int count = 0;
+};
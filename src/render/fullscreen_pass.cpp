@@ -0,0 +1,30 @@
+#include "render/fullscreen_pass.hpp"
+
+#include <glad/glad.h>
+
+void FullscreenTriangle::init()
+{
+    if (vao == 0)
+        glGenVertexArrays(1, &vao);
+}
+
+void FullscreenTriangle::draw() const
+{
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+}
+
+void FullscreenTriangle::shutdown()
+{
+    if (vao != 0)
+        glDeleteVertexArrays(1, &vao);
+    vao = 0;
+}
+
+std::unique_ptr<Shader> loadFullscreenShader(const std::filesystem::path &shaderRoot, const std::string &fragmentName)
+{
+    const auto vertexPath = shaderRoot / "fullscreen.vert";
+    const auto fragmentPath = shaderRoot / fragmentName;
+    return std::make_unique<Shader>(vertexPath.string().c_str(), fragmentPath.string().c_str());
+}
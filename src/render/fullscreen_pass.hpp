@@ -0,0 +1,25 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include "shader.hpp"
+
+// Empty VAO used to draw the gl_VertexID fullscreen triangle from
+// shader/fullscreen.vert. Core profile requires a bound VAO even when the
+// vertex shader reads no attributes.
+class FullscreenTriangle
+{
+public:
+    void init();
+    void draw() const;
+    void shutdown();
+
+private:
+    unsigned int vao = 0;
+};
+
+// Builds a post-processing program from shader/fullscreen.vert and the given
+// fragment shader file name inside shaderRoot.
+std::unique_ptr<Shader> loadFullscreenShader(const std::filesystem::path &shaderRoot, const std::string &fragmentName);
@@ -0,0 +1,37 @@
+#include "render/gl43.hpp"
+
+namespace gl43
+{
+    DispatchComputeProc dispatchCompute = nullptr;
+    MemoryBarrierProc memoryBarrier = nullptr;
+    MultiDrawElementsIndirectProc multiDrawElementsIndirect = nullptr;
+    BindImageTextureProc bindImageTexture = nullptr;
+    TexStorage2DProc texStorage2D = nullptr;
+
+    bool load(GLADloadproc loader)
+    {
+        if (GLVersion.major < 4 || (GLVersion.major == 4 && GLVersion.minor < 3))
+            return false;
+        dispatchCompute = reinterpret_cast<DispatchComputeProc>(loader("glDispatchCompute"));
+        memoryBarrier = reinterpret_cast<MemoryBarrierProc>(loader("glMemoryBarrier"));
+        multiDrawElementsIndirect =
+            reinterpret_cast<MultiDrawElementsIndirectProc>(loader("glMultiDrawElementsIndirect"));
+        bindImageTexture = reinterpret_cast<BindImageTextureProc>(loader("glBindImageTexture"));
+        texStorage2D = reinterpret_cast<TexStorage2DProc>(loader("glTexStorage2D"));
+        if (!available())
+        {
+            dispatchCompute = nullptr;
+            memoryBarrier = nullptr;
+            multiDrawElementsIndirect = nullptr;
+            bindImageTexture = nullptr;
+            texStorage2D = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    bool available()
+    {
+        return dispatchCompute && memoryBarrier && multiDrawElementsIndirect && bindImageTexture && texStorage2D;
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// The bundled GLAD covers GL 3.3 core. The GPU-driven path needs a handful of
+// 4.3 entry points (compute, image load/store, indirect draws); they are
+// loaded here when the context provides them, and everything else keeps
+// running on 3.3.
+
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#endif
+#ifndef GL_TEXTURE_FETCH_BARRIER_BIT
+#define GL_TEXTURE_FETCH_BARRIER_BIT 0x00000008
+#endif
+#ifndef GL_SHADER_IMAGE_ACCESS_BARRIER_BIT
+#define GL_SHADER_IMAGE_ACCESS_BARRIER_BIT 0x00000020
+#endif
+#ifndef GL_COMMAND_BARRIER_BIT
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#endif
+#ifndef GL_BUFFER_UPDATE_BARRIER_BIT
+#define GL_BUFFER_UPDATE_BARRIER_BIT 0x00000200
+#endif
+#ifndef GL_SHADER_STORAGE_BARRIER_BIT
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+#endif
+
+namespace gl43
+{
+    using DispatchComputeProc = void(APIENTRYP)(GLuint groupsX, GLuint groupsY, GLuint groupsZ);
+    using MemoryBarrierProc = void(APIENTRYP)(GLbitfield barriers);
+    using MultiDrawElementsIndirectProc = void(APIENTRYP)(GLenum mode, GLenum type, const void *indirect,
+                                                          GLsizei drawCount, GLsizei stride);
+    using BindImageTextureProc = void(APIENTRYP)(GLuint unit, GLuint texture, GLint level, GLboolean layered,
+                                                 GLint layer, GLenum access, GLenum format);
+    using TexStorage2DProc = void(APIENTRYP)(GLenum target, GLsizei levels, GLenum internalFormat, GLsizei width,
+                                             GLsizei height);
+
+    extern DispatchComputeProc dispatchCompute;
+    extern MemoryBarrierProc memoryBarrier;
+    extern MultiDrawElementsIndirectProc multiDrawElementsIndirect;
+    extern BindImageTextureProc bindImageTexture;
+    extern TexStorage2DProc texStorage2D;
+
+    // Call after gladLoadGLLoader with the same loader; false (and nothing
+    // loaded) when the current context is older than 4.3
+    bool load(GLADloadproc loader);
+    bool available();
+}
+
+// Same layout glMultiDrawElementsIndirect reads
+struct DrawElementsIndirectCommand
+{
+    GLuint count = 0;
+    GLuint instanceCount = 0;
+    GLuint firstIndex = 0;
+    GLint baseVertex = 0;
+    GLuint baseInstance = 0;
+};
@@ -0,0 +1,143 @@
+#include "render/gpu_timer.hpp"
+
+#include <glad/glad.h>
+
+namespace
+{
+    constexpr float kSmoothing = 0.1f; // weight of a new sample in the running average
+}
+
+void GpuTimer::init()
+{
+    if (initialized)
+        return;
+
+    for (Slot &slot : slots)
+    {
+        glGenQueries(1, &slot.startQuery);
+        glGenQueries(1, &slot.endQuery);
+    }
+    initialized = true;
+}
+
+void GpuTimer::shutdown()
+{
+    if (!initialized)
+        return;
+
+    for (Slot &slot : slots)
+    {
+        glDeleteQueries(1, &slot.startQuery);
+        glDeleteQueries(1, &slot.endQuery);
+        slot = Slot{};
+    }
+    initialized = false;
+}
+
+void GpuTimer::collect()
+{
+    for (Slot &slot : slots)
+    {
+        if (!slot.pending)
+            continue;
+
+        GLint available = 0;
+        glGetQueryObjectiv(slot.endQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            continue;
+
+        GLuint64 startNs = 0;
+        GLuint64 endNs = 0;
+        glGetQueryObjectui64v(slot.startQuery, GL_QUERY_RESULT, &startNs);
+        glGetQueryObjectui64v(slot.endQuery, GL_QUERY_RESULT, &endNs);
+        slot.pending = false;
+
+        lastSampleMs = static_cast<float>(endNs - startNs) * 1.0e-6f;
+        smoothedMs = (smoothedMs == 0.0f) ? lastSampleMs : smoothedMs + (lastSampleMs - smoothedMs) * kSmoothing;
+    }
+}
+
+void GpuTimer::begin()
+{
+    init();
+    collect();
+
+    // GPU is more than kSlotCount frames behind: skip rather than wait
+    if (slots[writeIndex].pending)
+    {
+        ++dropped;
+        recording = false;
+        return;
+    }
+
+    glQueryCounter(slots[writeIndex].startQuery, GL_TIMESTAMP);
+    recording = true;
+}
+
+void GpuTimer::end()
+{
+    if (!recording)
+        return;
+
+    Slot &slot = slots[writeIndex];
+    glQueryCounter(slot.endQuery, GL_TIMESTAMP);
+    slot.pending = true;
+    recording = false;
+    writeIndex = (writeIndex + 1) % kSlotCount;
+}
+
+void GpuProfiler::begin(const std::string &name)
+{
+    Entry *entry = find(name);
+    if (!entry)
+    {
+        scopes.push_back(Entry{name, GpuTimer{}});
+        entry = &scopes.back();
+    }
+    entry->timer.begin();
+}
+
+void GpuProfiler::end(const std::string &name)
+{
+    if (Entry *entry = find(name))
+        entry->timer.end();
+}
+
+void GpuProfiler::shutdown()
+{
+    for (Entry &entry : scopes)
+        entry.timer.shutdown();
+    scopes.clear();
+}
+
+float GpuProfiler::lastMs(const std::string &name) const
+{
+    const Entry *entry = find(name);
+    return entry ? entry->timer.lastMs() : 0.0f;
+}
+
+float GpuProfiler::averageMs(const std::string &name) const
+{
+    const Entry *entry = find(name);
+    return entry ? entry->timer.averageMs() : 0.0f;
+}
+
+GpuProfiler::Entry *GpuProfiler::find(const std::string &name)
+{
+    for (Entry &entry : scopes)
+    {
+        if (entry.name == name)
+            return &entry;
+    }
+    return nullptr;
+}
+
+const GpuProfiler::Entry *GpuProfiler::find(const std::string &name) const
+{
+    for (const Entry &entry : scopes)
+    {
+        if (entry.name == name)
+            return &entry;
+    }
+    return nullptr;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+
+// GPU-side timing built on GL_TIMESTAMP queries (core since GL 3.3).
+// Timestamps (rather than GL_TIME_ELAPSED) allow scopes to nest, so a
+// per-pass timer can live inside the whole-frame timer.
+//
+// Each timer owns a small ring of query pairs. Results are collected
+// without blocking a few frames later; if the GPU falls so far behind that
+// the next slot is still in flight, that frame's sample is dropped instead
+// of stalling the pipeline.
+class GpuTimer
+{
+public:
+    void init();
+    void shutdown();
+
+    void begin();
+    void end();
+
+    // Most recent resolved sample and an exponentially smoothed average (ms)
+    float lastMs() const { return lastSampleMs; }
+    float averageMs() const { return smoothedMs; }
+    unsigned int droppedSamples() const { return dropped; }
+
+private:
+    static constexpr int kSlotCount = 4;
+
+    struct Slot
+    {
+        unsigned int startQuery = 0;
+        unsigned int endQuery = 0;
+        bool pending = false;
+    };
+
+    void collect();
+
+    std::array<Slot, kSlotCount> slots{};
+    int writeIndex = 0;
+    bool recording = false;
+    bool initialized = false;
+    float lastSampleMs = 0.0f;
+    float smoothedMs = 0.0f;
+    unsigned int dropped = 0;
+};
+
+// Named collection of GpuTimers so passes can be timed with
+// profiler.begin("Scene") / profiler.end("Scene") and listed in the panel.
+class GpuProfiler
+{
+public:
+    struct Entry
+    {
+        std::string name;
+        GpuTimer timer;
+    };
+
+    void begin(const std::string &name);
+    void end(const std::string &name);
+    void shutdown();
+
+    // Latest / smoothed time of a scope, 0 if it has never been recorded
+    float lastMs(const std::string &name) const;
+    float averageMs(const std::string &name) const;
+    const std::vector<Entry> &entries() const { return scopes; }
+
+private:
+    Entry *find(const std::string &name);
+    const Entry *find(const std::string &name) const;
+
+    std::vector<Entry> scopes;
+};
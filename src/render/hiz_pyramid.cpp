@@ -0,0 +1,103 @@
+#include "render/hiz_pyramid.hpp"
+
+#include <algorithm>
+
+#include "render/gl43.hpp"
+
+namespace
+{
+    constexpr int kGroupSize = 8; // hiz_downsample.comp local size
+
+    int levelCount(int width, int height)
+    {
+        int levels = 1;
+        while (std::max(width, height) >> levels > 0 && levels < HiZPyramid::kMaxLevels)
+            levels++;
+        return levels;
+    }
+
+    GLuint groups(int size)
+    {
+        return static_cast<GLuint>((size + kGroupSize - 1) / kGroupSize);
+    }
+}
+
+bool HiZPyramid::init(const std::filesystem::path &shaderRoot, int width, int height)
+{
+    if (!gl43::available())
+        return false;
+    downsampleShader = std::make_unique<Shader>((shaderRoot / "hiz_downsample.comp").string().c_str());
+    targetWidth = width;
+    targetHeight = height;
+    allocate();
+    return pyramid != 0;
+}
+
+void HiZPyramid::resize(int width, int height)
+{
+    if (width == targetWidth && height == targetHeight)
+        return;
+    targetWidth = width;
+    targetHeight = height;
+    allocate();
+}
+
+void HiZPyramid::allocate()
+{
+    if (pyramid)
+        glDeleteTextures(1, &pyramid);
+    pyramid = 0;
+    builtLevels = 0;
+    const int width = std::max(1, (targetWidth + 1) / 2);
+    const int height = std::max(1, (targetHeight + 1) / 2);
+    allocatedLevels = levelCount(width, height);
+
+    // Immutable storage, so every level can be bound as an image
+    glGenTextures(1, &pyramid);
+    glBindTexture(GL_TEXTURE_2D, pyramid);
+    gl43::texStorage2D(GL_TEXTURE_2D, allocatedLevels, GL_R32F, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void HiZPyramid::shutdown()
+{
+    if (pyramid)
+        glDeleteTextures(1, &pyramid);
+    pyramid = 0;
+    builtLevels = 0;
+    downsampleShader.reset();
+}
+
+void HiZPyramid::build(unsigned int depthTexture, int renderWidth, int renderHeight)
+{
+    if (!pyramid || !downsampleShader)
+        return;
+    renderWidth = std::clamp(renderWidth, 1, targetWidth);
+    renderHeight = std::clamp(renderHeight, 1, targetHeight);
+
+    downsampleShader->use();
+    downsampleShader->setInt("source", 0);
+    glActiveTexture(GL_TEXTURE0);
+    glm::ivec2 sourceSize(renderWidth, renderHeight);
+    const int levels = std::min(allocatedLevels, levelCount((renderWidth + 1) / 2, (renderHeight + 1) / 2));
+    for (int level = 0; level < levels; level++)
+    {
+        const glm::ivec2 size((sourceSize.x + 1) / 2, (sourceSize.y + 1) / 2);
+        // Level 0 reads the depth buffer, the others the level above
+        glBindTexture(GL_TEXTURE_2D, level == 0 ? depthTexture : pyramid);
+        downsampleShader->setInt("sourceLevel", level == 0 ? 0 : level - 1);
+        glUniform2i(glGetUniformLocation(downsampleShader->ID, "sourceMax"), sourceSize.x - 1, sourceSize.y - 1);
+        glUniform2i(glGetUniformLocation(downsampleShader->ID, "destinationSize"), size.x, size.y);
+        gl43::bindImageTexture(0, pyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        gl43::dispatchCompute(groups(size.x), groups(size.y), 1);
+        gl43::memoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+        sourceSize = size;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    builtSize = glm::ivec2(renderWidth, renderHeight);
+    builtLevels = levels;
+}
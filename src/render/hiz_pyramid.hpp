@@ -0,0 +1,43 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+
+#include <glm/glm.hpp>
+
+#include "shader.hpp"
+
+// Max-depth mip chain over a depth buffer, for occlusion culling (GL 4.3).
+// Level 0 is half the source resolution and texel t of level l covers source
+// pixels [t * 2^(l+1), (t + 1) * 2^(l+1)), so any pixel rect maps onto at
+// most 2x2 texels of one level. Odd sizes round up and clamp at the edge,
+// which keeps every level conservative. Allocated for the full target size;
+// builds cover the lower-left sub-rect that was rendered.
+class HiZPyramid
+{
+public:
+    static constexpr int kMaxLevels = 16;
+
+    bool init(const std::filesystem::path &shaderRoot, int width, int height);
+    void resize(int width, int height);
+    void shutdown();
+
+    // One dispatch per level from `depthTexture`'s renderWidth x renderHeight sub-rect
+    void build(unsigned int depthTexture, int renderWidth, int renderHeight);
+
+    unsigned int texture() const { return pyramid; }
+    // Source size and level count of the last build; no levels before the first
+    glm::ivec2 sourceSize() const { return builtSize; }
+    int levels() const { return builtLevels; }
+
+private:
+    void allocate();
+
+    std::unique_ptr<Shader> downsampleShader;
+    unsigned int pyramid = 0;
+    int targetWidth = 0;
+    int targetHeight = 0;
+    int allocatedLevels = 0;
+    glm::ivec2 builtSize{0};
+    int builtLevels = 0;
+};
@@ -0,0 +1,57 @@
+#include "render/lightmap.hpp"
+
+#include <string>
+
+#include <glad/glad.h>
+
+bool Lightmap::upload(const LightmapData &data)
+{
+    if (data.size <= 0 || data.blocks.empty())
+        return false;
+
+    if (texture == 0)
+        glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_COMPRESSED_RG_RGTC2, data.size, data.size,
+                           LightmapData::kLayerCount, 0, static_cast<GLsizei>(data.blocks.size()), data.blocks.data());
+    // Lighting is smooth and charts are only padded for bilinear taps: no mips
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    textureSize = data.size;
+    bytes = data.blocks.size();
+    lampScale = data.lampScale;
+    skyScale = data.skyScale;
+    return true;
+}
+
+void Lightmap::shutdown()
+{
+    if (texture != 0)
+        glDeleteTextures(1, &texture);
+    texture = 0;
+    textureSize = 0;
+    bytes = 0;
+}
+
+void Lightmap::bindForShading(Shader &shader, const bool lampEnabled[LightmapBakeInput::kLampCount],
+                              const glm::vec3 &lampColor, bool enabled) const
+{
+    shader.setBool("lightmapEnabled", enabled && ready());
+    shader.setInt("lightmap", kTextureUnit);
+    shader.setFloat("lightmapLampScale", lampScale);
+    shader.setFloat("lightmapSkyScale", skyScale);
+    shader.setVec3("lightmapLampColor", lampColor);
+    for (int pair = 0; pair < LightmapBakeInput::kLampCount / 2; pair++)
+    {
+        shader.setVec2("lightmapLampMask[" + std::to_string(pair) + "]",
+                       glm::vec2(lampEnabled[pair * 2] ? 1.0f : 0.0f, lampEnabled[pair * 2 + 1] ? 1.0f : 0.0f));
+    }
+
+    glActiveTexture(GL_TEXTURE0 + kTextureUnit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "shader.hpp"
+#include "bake/lightmap_baker.hpp"
+
+// GPU side of the baked lightmap: one BC5 2D array texture (four layers of
+// lamp pairs plus the sky layer, see LightmapData). Static geometry reads its
+// lamps and sky from it instead of evaluating the point lights per fragment.
+class Lightmap
+{
+public:
+    static constexpr int kTextureUnit = 11;
+
+    bool upload(const LightmapData &data);
+    void shutdown();
+    bool ready() const { return texture != 0; }
+    int size() const { return textureSize; }
+    std::size_t memoryBytes() const { return bytes; }
+
+    // Binds the array and sets the lookup uniforms on shader.frag. Lamps that
+    // are switched off are masked out; `enabled` false falls back to the
+    // dynamic point lights.
+    void bindForShading(Shader &shader, const bool lampEnabled[LightmapBakeInput::kLampCount],
+                        const glm::vec3 &lampColor, bool enabled) const;
+
+private:
+    unsigned int texture = 0;
+    int textureSize = 0;
+    std::size_t bytes = 0;
+    float lampScale = 1.0f;
+    float skyScale = 1.0f;
+};
@@ -0,0 +1,391 @@
+#include "render/meshlet.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+#include "mesh.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESHLETS_USE_SSE 1
+#include <emmintrin.h>
+#else
+#define MESHLETS_USE_SSE 0
+#endif
+
+namespace
+{
+    constexpr unsigned int kNone = ~0u;
+    // Normal spreads wider than this (cos of the half angle) cannot cull anything useful
+    constexpr float kMinConeSpread = 0.1f;
+
+    enum CullResult : std::uint8_t
+    {
+        Visible,
+        OutsideFrustum,
+        Backfacing,
+        TooSmall,
+    };
+
+    struct PositionHash
+    {
+        std::size_t operator()(const glm::vec3 &p) const
+        {
+            std::uint32_t bits[3];
+            std::memcpy(bits, &p, sizeof(bits));
+            return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+        }
+    };
+
+    // The view moved into the meshlets' space, one value per SSE lane
+    struct LocalView
+    {
+        std::array<glm::vec4, Frustum::kMaxPlanes> planes{};
+        int planeCount = 0;
+        glm::vec3 camera{0.0f};
+        bool cone = false;
+        float smallScale = std::numeric_limits<float>::infinity(); // reject when radius * smallScale < distance
+    };
+
+#if !MESHLETS_USE_SSE
+    CullResult classify(const MeshletSet &meshlets, std::size_t i, const LocalView &view)
+    {
+        const glm::vec3 center(meshlets.centerX[i], meshlets.centerY[i], meshlets.centerZ[i]);
+        const float radius = meshlets.radius[i];
+        for (int p = 0; p < view.planeCount; p++)
+        {
+            if (glm::dot(glm::vec3(view.planes[p]), center) + view.planes[p].w < -radius)
+                return OutsideFrustum;
+        }
+        const glm::vec3 toCenter = center - view.camera;
+        const float distance = glm::length(toCenter);
+        const glm::vec3 axis(meshlets.coneX[i], meshlets.coneY[i], meshlets.coneZ[i]);
+        if (view.cone && glm::dot(toCenter, axis) >= meshlets.coneCutoff[i] * distance + radius)
+            return Backfacing;
+        if (radius * view.smallScale < distance)
+            return TooSmall;
+        return Visible;
+    }
+#endif
+}
+
+MeshletSet buildMeshlets(const std::vector<Vertex> &vertices, std::vector<unsigned int> &indices)
+{
+    MeshletSet set;
+    const std::size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return set;
+
+    // Weld by position so triangles across hard edges (split normals/UVs) are neighbours
+    std::vector<unsigned int> weld(vertices.size());
+    std::unordered_map<glm::vec3, unsigned int, PositionHash> firstAt;
+    firstAt.reserve(vertices.size());
+    for (std::size_t v = 0; v < vertices.size(); v++)
+        weld[v] = firstAt.emplace(vertices[v].Position, static_cast<unsigned int>(v)).first->second;
+
+    // Triangles around every welded vertex
+    std::vector<unsigned int> adjacencyStart(vertices.size() + 1, 0);
+    for (std::size_t i = 0; i < triangleCount * 3; i++)
+        adjacencyStart[weld[indices[i]] + 1]++;
+    for (std::size_t v = 0; v < vertices.size(); v++)
+        adjacencyStart[v + 1] += adjacencyStart[v];
+    std::vector<unsigned int> adjacency(triangleCount * 3);
+    std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+    for (std::size_t i = 0; i < triangleCount * 3; i++)
+        adjacency[fill[weld[indices[i]]]++] = static_cast<unsigned int>(i / 3);
+
+    std::vector<glm::vec3> normals(triangleCount);
+    for (std::size_t t = 0; t < triangleCount; t++)
+    {
+        const glm::vec3 &a = vertices[indices[t * 3]].Position;
+        const glm::vec3 n = glm::cross(vertices[indices[t * 3 + 1]].Position - a, vertices[indices[t * 3 + 2]].Position - a);
+        const float length = glm::length(n);
+        normals[t] = length > 0.0f ? n / length : glm::vec3(0.0f);
+    }
+
+    std::vector<std::uint8_t> emitted(triangleCount, 0);
+    std::vector<unsigned int> candidateOf(triangleCount, kNone); // meshlet the triangle is a candidate for
+    std::vector<unsigned int> vertexOf(vertices.size(), kNone);  // meshlet already holding the vertex
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> members;
+    std::vector<unsigned int> ordered;
+    ordered.reserve(indices.size());
+
+    std::size_t seed = 0;
+    for (unsigned int meshlet = 0;; meshlet++)
+    {
+        while (seed < triangleCount && emitted[seed])
+            seed++;
+        if (seed == triangleCount)
+            break;
+
+        const std::size_t first = ordered.size();
+        std::size_t vertexCount = 0;
+        glm::vec3 normalSum(0.0f);
+        candidates.clear();
+        members.clear();
+        const auto newVertices = [&](std::size_t t) {
+            int added = 0;
+            for (int k = 0; k < 3; k++)
+                added += vertexOf[indices[t * 3 + k]] != meshlet ? 1 : 0;
+            return added;
+        };
+        const auto add = [&](std::size_t t) {
+            emitted[t] = 1;
+            members.push_back(static_cast<unsigned int>(t));
+            normalSum += normals[t];
+            for (int k = 0; k < 3; k++)
+            {
+                const unsigned int v = indices[t * 3 + k];
+                if (vertexOf[v] != meshlet)
+                {
+                    vertexOf[v] = meshlet;
+                    vertexCount++;
+                }
+                ordered.push_back(v);
+                for (unsigned int a = adjacencyStart[weld[v]]; a < adjacencyStart[weld[v] + 1]; a++)
+                {
+                    const unsigned int neighbour = adjacency[a];
+                    if (!emitted[neighbour] && candidateOf[neighbour] != meshlet)
+                    {
+                        candidateOf[neighbour] = meshlet;
+                        candidates.push_back(neighbour);
+                    }
+                }
+            }
+        };
+
+        // Grow over neighbours: fewest new vertices first, then the most aligned normal
+        add(seed);
+        while (members.size() < MeshletSet::kMaxTriangles)
+        {
+            const float sumLength = glm::length(normalSum);
+            const glm::vec3 axis = sumLength > 0.0f ? normalSum / sumLength : glm::vec3(0.0f);
+            std::size_t best = triangleCount;
+            int bestNew = 4;
+            float bestAlignment = -2.0f;
+            std::size_t kept = 0;
+            for (unsigned int candidate : candidates)
+            {
+                if (emitted[candidate])
+                    continue;
+                candidates[kept++] = candidate;
+                const int added = newVertices(candidate);
+                if (vertexCount + added > MeshletSet::kMaxVertices)
+                    continue;
+                const float alignment = glm::dot(normals[candidate], axis);
+                if (added < bestNew || (added == bestNew && alignment > bestAlignment))
+                {
+                    best = candidate;
+                    bestNew = added;
+                    bestAlignment = alignment;
+                }
+            }
+            candidates.resize(kept);
+            if (best == triangleCount)
+                break;
+            add(best);
+        }
+
+        // Bounding sphere around the box centre, normal cone around the mean normal
+        glm::vec3 lo = vertices[ordered[first]].Position;
+        glm::vec3 hi = lo;
+        for (std::size_t i = first; i < ordered.size(); i++)
+        {
+            lo = glm::min(lo, vertices[ordered[i]].Position);
+            hi = glm::max(hi, vertices[ordered[i]].Position);
+        }
+        const glm::vec3 center = (lo + hi) * 0.5f;
+        float radius = 0.0f;
+        for (std::size_t i = first; i < ordered.size(); i++)
+            radius = std::max(radius, glm::length(vertices[ordered[i]].Position - center));
+
+        const float sumLength = glm::length(normalSum);
+        const glm::vec3 axis = sumLength > 0.0f ? normalSum / sumLength : glm::vec3(0.0f);
+        float minAlignment = sumLength > 0.0f ? 1.0f : -1.0f;
+        for (unsigned int t : members)
+        {
+            // Degenerate triangles rasterize nothing and do not widen the cone
+            if (normals[t] != glm::vec3(0.0f))
+                minAlignment = std::min(minAlignment, glm::dot(normals[t], axis));
+        }
+
+        set.centerX.push_back(center.x);
+        set.centerY.push_back(center.y);
+        set.centerZ.push_back(center.z);
+        set.radius.push_back(radius);
+        set.coneX.push_back(axis.x);
+        set.coneY.push_back(axis.y);
+        set.coneZ.push_back(axis.z);
+        set.coneCutoff.push_back(minAlignment > kMinConeSpread ? std::sqrt(1.0f - minAlignment * minAlignment) : 1.0f);
+        set.firstIndex.push_back(static_cast<unsigned int>(first));
+        set.indexCount.push_back(static_cast<unsigned int>(ordered.size() - first));
+    }
+    indices = std::move(ordered);
+
+    // Padding lanes: a zero sphere with a cone that never culls, masked off by count
+    set.count = set.radius.size();
+    const std::size_t padded = (set.count + 3) & ~std::size_t(3);
+    for (std::vector<float> *array : {&set.centerX, &set.centerY, &set.centerZ, &set.radius, &set.coneX, &set.coneY, &set.coneZ})
+        array->resize(padded, 0.0f);
+    set.coneCutoff.resize(padded, 1.0f);
+    set.firstIndex.resize(padded, 0);
+    set.indexCount.resize(padded, 0);
+    return set;
+}
+
+MeshletView MeshletView::fromMatrices(const glm::mat4 &view, const glm::mat4 &projection, float viewportHeight)
+{
+    MeshletView result;
+    result.frustum = Frustum::fromMatrix(projection * view);
+    result.cameraPosition = glm::vec3(glm::inverse(view)[3]);
+    result.pixelsPerUnit = projection[1][1] * viewportHeight * 0.5f;
+    return result;
+}
+
+void MeshletCullStats::add(const MeshletCullStats &other)
+{
+    meshlets += other.meshlets;
+    frustumRejected += other.frustumRejected;
+    coneRejected += other.coneRejected;
+    smallRejected += other.smallRejected;
+    triangles += other.triangles;
+    trianglesRejected += other.trianglesRejected;
+    cullMs += other.cullMs;
+}
+
+void cullMeshlets(const MeshletSet &meshlets, const glm::mat4 &world, const MeshletView &view,
+                  const MeshletSettings &settings, MeshletDrawList &drawList, MeshletCullStats &stats)
+{
+    if (meshlets.empty())
+        return;
+    const auto start = std::chrono::steady_clock::now();
+
+    // Planes go to mesh space through the transpose (p . Mx = M^T p . x), renormalized
+    // so sphere distances stay in mesh units; the camera through the inverse
+    LocalView local;
+    if (settings.frustumCulling)
+    {
+        const glm::mat4 toPlane = glm::transpose(world);
+        local.planeCount = view.frustum.planeCount();
+        for (int p = 0; p < local.planeCount; p++)
+        {
+            const glm::vec4 plane = toPlane * view.frustum.plane(p);
+            const float length = glm::length(glm::vec3(plane));
+            local.planes[p] = length > 0.0f ? plane / length : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        }
+    }
+    local.camera = glm::vec3(glm::inverse(world) * glm::vec4(view.cameraPosition, 1.0f));
+    const glm::mat3 linear(world);
+    // Facing survives any transform that does not mirror
+    local.cone = settings.coneCulling && glm::determinant(linear) > 0.0f;
+    if (settings.smallCulling && settings.minPixels > 0.0f && view.pixelsPerUnit > 0.0f)
+    {
+        // Projected diameter 2 r sMax ppu / (d sMin) with the mesh-space radius r and
+        // distance d; the axis scales bound it for non-uniform transforms
+        const float maxScale = std::max({glm::length(linear[0]), glm::length(linear[1]), glm::length(linear[2])});
+        const float minScale = std::min({glm::length(linear[0]), glm::length(linear[1]), glm::length(linear[2])});
+        if (minScale > 0.0f)
+            local.smallScale = 2.0f * maxScale * view.pixelsPerUnit / (settings.minPixels * minScale);
+    }
+
+    unsigned int rangeEnd = ~0u;
+    const auto emit = [&](std::size_t i, CullResult result) {
+        const unsigned int count = meshlets.indexCount[i];
+        stats.meshlets++;
+        stats.triangles += count / 3;
+        if (result != Visible)
+        {
+            stats.frustumRejected += result == OutsideFrustum ? 1 : 0;
+            stats.coneRejected += result == Backfacing ? 1 : 0;
+            stats.smallRejected += result == TooSmall ? 1 : 0;
+            stats.trianglesRejected += count / 3;
+            return;
+        }
+        // Meshlets are contiguous, so runs of survivors become one range
+        const unsigned int first = meshlets.firstIndex[i];
+        if (first == rangeEnd)
+            drawList.counts.back() += static_cast<GLsizei>(count);
+        else
+        {
+            drawList.counts.push_back(static_cast<GLsizei>(count));
+            drawList.offsets.push_back(reinterpret_cast<const void *>(static_cast<std::uintptr_t>(first) * sizeof(unsigned int)));
+        }
+        rangeEnd = first + count;
+    };
+
+#if MESHLETS_USE_SSE
+    const __m128 cameraX = _mm_set1_ps(local.camera.x);
+    const __m128 cameraY = _mm_set1_ps(local.camera.y);
+    const __m128 cameraZ = _mm_set1_ps(local.camera.z);
+    const __m128 smallScale = _mm_set1_ps(local.smallScale);
+    const __m128 coneEnabled = local.cone ? _mm_castsi128_ps(_mm_set1_epi32(-1)) : _mm_setzero_ps();
+    for (std::size_t i = 0; i < meshlets.count; i += 4)
+    {
+        const __m128 x = _mm_loadu_ps(&meshlets.centerX[i]);
+        const __m128 y = _mm_loadu_ps(&meshlets.centerY[i]);
+        const __m128 z = _mm_loadu_ps(&meshlets.centerZ[i]);
+        const __m128 radius = _mm_loadu_ps(&meshlets.radius[i]);
+        const __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), radius);
+
+        __m128 outside = _mm_setzero_ps();
+        for (int p = 0; p < local.planeCount; p++)
+        {
+            const glm::vec4 &plane = local.planes[p];
+            const __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+                _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negRadius));
+        }
+
+        const __m128 dx = _mm_sub_ps(x, cameraX);
+        const __m128 dy = _mm_sub_ps(y, cameraY);
+        const __m128 dz = _mm_sub_ps(z, cameraZ);
+        const __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+        const __m128 along = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, _mm_loadu_ps(&meshlets.coneX[i])),
+                                                   _mm_mul_ps(dy, _mm_loadu_ps(&meshlets.coneY[i]))),
+                                        _mm_mul_ps(dz, _mm_loadu_ps(&meshlets.coneZ[i])));
+        const __m128 backfacing = _mm_and_ps(
+            coneEnabled, _mm_cmpge_ps(along, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&meshlets.coneCutoff[i]), distance), radius)));
+        const __m128 small = _mm_cmplt_ps(_mm_mul_ps(radius, smallScale), distance);
+
+        const int outsideMask = _mm_movemask_ps(outside);
+        const int backfacingMask = _mm_movemask_ps(backfacing);
+        const int smallMask = _mm_movemask_ps(small);
+        const std::size_t lanes = std::min<std::size_t>(4, meshlets.count - i);
+        for (std::size_t lane = 0; lane < lanes; lane++)
+        {
+            const int bit = 1 << lane;
+            const CullResult result = (outsideMask & bit)      ? OutsideFrustum
+                                      : (backfacingMask & bit) ? Backfacing
+                                      : (smallMask & bit)      ? TooSmall
+                                                               : Visible;
+            emit(i + lane, result);
+        }
+    }
+#else
+    for (std::size_t i = 0; i < meshlets.count; i++)
+        emit(i, classify(meshlets, i, local));
+#endif
+
+    stats.cullMs += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void MeshletCuller::begin(const MeshletView &view, const MeshletSettings &settings)
+{
+    passView = view;
+    passSettings = settings;
+    passStats = MeshletCullStats{};
+}
+
+const MeshletDrawList &MeshletCuller::cull(const MeshletSet &meshlets, const glm::mat4 &world)
+{
+    drawList.clear();
+    cullMeshlets(meshlets, world, passView, passSettings, drawList, passStats);
+    return drawList;
+}
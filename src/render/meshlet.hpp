@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "render/frustum.hpp"
+
+struct Vertex;
+
+struct MeshletSettings
+{
+    bool enabled = true;
+    bool frustumCulling = true;
+    // Rejects meshlets whose triangles all face away. Off by default: the city's
+    // materials are double-sided and the scene draws without GL_CULL_FACE, so
+    // culling back-facing clusters leaves holes in walls and foliage.
+    bool coneCulling = false;
+    bool smallCulling = true;
+    float minPixels = 1.0f;         // projected bounding-sphere diameter below which a meshlet is dropped
+    float viewportHeight = 1080.0f; // pixels; main keeps it at the scene resolution
+};
+
+// Clusters of at most 64 vertices and 124 triangles whose triangles are
+// contiguous in the index buffer. Bounds are stored SoA, padded to a multiple
+// of four so the culling loop runs four meshlets per SSE step; the same
+// arrays can be uploaded as-is for a compute pass.
+struct MeshletSet
+{
+    static constexpr std::size_t kMaxVertices = 64;
+    static constexpr std::size_t kMaxTriangles = 124;
+
+    std::size_t count = 0;
+    // Bounding sphere
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+    std::vector<float> radius;
+    // Normal cone: axis and sin of its half angle; 1 when it cannot cull
+    std::vector<float> coneX;
+    std::vector<float> coneY;
+    std::vector<float> coneZ;
+    std::vector<float> coneCutoff;
+    // Range in the index buffer
+    std::vector<unsigned int> firstIndex;
+    std::vector<unsigned int> indexCount;
+
+    bool empty() const { return count == 0; }
+};
+
+// Reorders `indices` into meshlets (greedy growth over shared, position-welded
+// vertices, preferring triangles that add no vertex and face the same way) and
+// returns their bounds. Later rewrites of the vertices must keep the triangle order.
+MeshletSet buildMeshlets(const std::vector<Vertex> &vertices, std::vector<unsigned int> &indices);
+
+// Culling inputs for one view, in world space
+struct MeshletView
+{
+    Frustum frustum;
+    glm::vec3 cameraPosition{0.0f};
+    float pixelsPerUnit = 0.0f; // projected size of one unit at distance one
+
+    static MeshletView fromMatrices(const glm::mat4 &view, const glm::mat4 &projection, float viewportHeight);
+};
+
+struct MeshletCullStats
+{
+    std::size_t meshlets = 0;
+    std::size_t frustumRejected = 0;
+    std::size_t coneRejected = 0;
+    std::size_t smallRejected = 0;
+    std::size_t triangles = 0;
+    std::size_t trianglesRejected = 0;
+    float cullMs = 0.0f;
+
+    void add(const MeshletCullStats &other);
+};
+
+// Surviving index ranges, with neighbouring meshlets merged, in the form
+// glMultiDrawElements takes
+struct MeshletDrawList
+{
+    std::vector<GLsizei> counts;
+    std::vector<const void *> offsets;
+
+    void clear()
+    {
+        counts.clear();
+        offsets.clear();
+    }
+};
+
+// Tests the meshlets of a mesh placed with `world` against the view: frustum,
+// normal cone and projected size, each when enabled. The view is moved into
+// the mesh's space instead of moving every meshlet; cone culling is skipped
+// for mirroring transforms.
+void cullMeshlets(const MeshletSet &meshlets, const glm::mat4 &world, const MeshletView &view,
+                  const MeshletSettings &settings, MeshletDrawList &drawList, MeshletCullStats &stats);
+
+// Per-pass wrapper: one view and settings, the stats of every mesh culled in
+// the pass, and the draw-list scratch reused between meshes
+class MeshletCuller
+{
+public:
+    void begin(const MeshletView &view, const MeshletSettings &settings);
+    // Survivors of a mesh placed with `world`; valid until the next call
+    const MeshletDrawList &cull(const MeshletSet &meshlets, const glm::mat4 &world);
+    const MeshletCullStats &stats() const { return passStats; }
+
+private:
+    MeshletView passView;
+    MeshletSettings passSettings;
+    MeshletDrawList drawList;
+    MeshletCullStats passStats;
+};
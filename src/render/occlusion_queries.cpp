@@ -0,0 +1,255 @@
+#include "render/occlusion_queries.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+    // Boxes this close to the camera may be cut by the near plane and pass no
+    // samples while the object is in view; they are drawn without a test
+    constexpr float kNearMargin = 0.5f;
+    // Query boxes grow by this much (world units) so rounding differences
+    // from the mesh transforms cannot leave an edge pixel outside the box
+    constexpr float kBoxPadding = 0.01f;
+}
+
+bool OcclusionQueries::init(const std::filesystem::path &shaderRoot)
+{
+    boxShader = std::make_unique<Shader>((shaderRoot / "occlusion_box.vert").string().c_str(),
+                                         (shaderRoot / "depth.frag").string().c_str());
+
+    // Unit cube, stretched over each box in the vertex shader
+    const float corners[] = {
+        0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f, 0.0f,
+        0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f,
+    };
+    const unsigned char indices[] = {
+        0, 2, 3, 0, 3, 1, 4, 5, 7, 4, 7, 6, 0, 1, 5, 0, 5, 4,
+        2, 6, 7, 2, 7, 3, 0, 4, 6, 0, 6, 2, 1, 3, 7, 1, 7, 5,
+    };
+    glGenVertexArrays(1, &boxVao);
+    glGenBuffers(1, &boxVbo);
+    glGenBuffers(1, &boxEbo);
+    glBindVertexArray(boxVao);
+    glBindBuffer(GL_ARRAY_BUFFER, boxVbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, boxEbo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
+    glBindVertexArray(0);
+    return boxShader->ID != 0;
+}
+
+void OcclusionQueries::shutdown()
+{
+    reset(0);
+    if (boxVao)
+        glDeleteVertexArrays(1, &boxVao);
+    if (boxVbo)
+        glDeleteBuffers(1, &boxVbo);
+    if (boxEbo)
+        glDeleteBuffers(1, &boxEbo);
+    boxVao = boxVbo = boxEbo = 0;
+    boxShader.reset();
+}
+
+void OcclusionQueries::reset(int objectCount)
+{
+    for (Object &object : objects)
+        glDeleteQueries(kQueriesPerObject, object.queries.data());
+    objects.assign(static_cast<std::size_t>(std::max(objectCount, 0)), Object{});
+    for (Object &object : objects)
+        glGenQueries(kQueriesPerObject, object.queries.data());
+    frameStats = Stats{};
+}
+
+void OcclusionQueries::readResults(Object &object)
+{
+    for (int slot = 0; slot < kQueriesPerObject; slot++)
+    {
+        if (object.issuedFrame[slot] < 0)
+            continue;
+        const GLuint query = object.queries[slot];
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            if (!frameSettings.waitForResults)
+            {
+                frameStats.lateResults++;
+                continue;
+            }
+            frameStats.stalls++;
+        }
+        // Blocks only for the late results of waitForResults
+        const auto start = std::chrono::steady_clock::now();
+        GLuint passed = GL_FALSE;
+        glGetQueryObjectuiv(query, GL_QUERY_RESULT, &passed);
+        if (!available)
+            frameStats.stallMs += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        if (object.boxQuery[slot] && !passed)
+            frameStats.skippedDraws++;
+        if (object.issuedFrame[slot] > object.resultFrame)
+        {
+            object.resultFrame = object.issuedFrame[slot];
+            object.visible = passed != GL_FALSE;
+        }
+        object.issuedFrame[slot] = -1;
+    }
+}
+
+void OcclusionQueries::beginFrame(const OcclusionQuerySettings &settings)
+{
+    frame++;
+    frameIssued = false;
+    frameSettings = settings;
+    frameStats = Stats{};
+    for (Object &object : objects)
+    {
+        readResults(object);
+        if (!object.visible)
+            frameStats.hidden++;
+    }
+}
+
+int OcclusionQueries::draw(const std::vector<OcclusionCandidate> &candidates,
+                           const std::function<void(int)> &drawItem, Shader &passShader,
+                           const glm::mat4 &viewProjection, const glm::vec3 &cameraPosition)
+{
+    if (!frameIssued)
+    {
+        frameIssued = true;
+        return issue(candidates, drawItem, passShader, viewProjection, cameraPosition);
+    }
+
+    // A later pass: same groups, conditional on the queries already issued
+    for (const OcclusionCandidate &candidate : candidates)
+    {
+        if (!tracked(candidate))
+        {
+            drawItem(candidate.item);
+            continue;
+        }
+        const Object &object = objects[candidate.id];
+        if (object.decidedFrame == frame && object.mode == Mode::BoxQueried)
+        {
+            glBeginConditionalRender(object.queries[object.slot], GL_QUERY_NO_WAIT);
+            drawItem(candidate.item);
+            glEndConditionalRender();
+        }
+        else
+            drawItem(candidate.item);
+    }
+    return static_cast<int>(candidates.size());
+}
+
+int OcclusionQueries::issue(const std::vector<OcclusionCandidate> &candidates,
+                            const std::function<void(int)> &drawItem, Shader &passShader,
+                            const glm::mat4 &viewProjection, const glm::vec3 &cameraPosition)
+{
+    frameStats.candidates = static_cast<int>(candidates.size());
+    const auto freeSlot = [](const Object &object) {
+        for (int slot = 0; slot < kQueriesPerObject; slot++)
+        {
+            if (object.issuedFrame[slot] < 0)
+                return slot;
+        }
+        return -1;
+    };
+
+    // Visible at the last test: drawn first, so they occlude the boxes below
+    hiddenScratch.clear();
+    for (const OcclusionCandidate &candidate : candidates)
+    {
+        if (!tracked(candidate))
+        {
+            drawItem(candidate.item);
+            continue;
+        }
+        Object &object = objects[candidate.id];
+        object.decidedFrame = frame;
+        object.slot = -1;
+        object.mode = Mode::Draw;
+        const bool cameraInside = glm::all(glm::greaterThanEqual(cameraPosition, candidate.bounds.min - kNearMargin)) &&
+                                  glm::all(glm::lessThanEqual(cameraPosition, candidate.bounds.max + kNearMargin));
+        if (cameraInside)
+        {
+            object.visible = true;
+        }
+        else if (object.visible)
+        {
+            if (frame - object.lastTest >= frameSettings.retestInterval && (object.slot = freeSlot(object)) >= 0)
+                object.mode = Mode::DrawQueried;
+        }
+        else if ((object.slot = freeSlot(object)) >= 0)
+        {
+            object.mode = Mode::BoxQueried;
+            hiddenScratch.push_back(&candidate);
+            continue;
+        }
+        else
+        {
+            frameStats.starved++;
+        }
+
+        if (object.mode == Mode::DrawQueried)
+        {
+            glBeginQuery(GL_ANY_SAMPLES_PASSED, object.queries[object.slot]);
+            drawItem(candidate.item);
+            glEndQuery(GL_ANY_SAMPLES_PASSED);
+            object.issuedFrame[object.slot] = frame;
+            object.boxQuery[object.slot] = false;
+            object.lastTest = frame;
+            frameStats.drawQueries++;
+        }
+        else
+            drawItem(candidate.item);
+    }
+    if (hiddenScratch.empty())
+        return static_cast<int>(candidates.size());
+
+    // Boxes of the hidden ones, tested against everything drawn so far
+    GLboolean colorMask[4];
+    GLboolean depthMask = GL_TRUE;
+    glGetBooleanv(GL_COLOR_WRITEMASK, colorMask);
+    glGetBooleanv(GL_DEPTH_WRITEMASK, &depthMask);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    boxShader->use();
+    boxShader->setMat4("viewProjection", viewProjection);
+    glBindVertexArray(boxVao);
+    for (const OcclusionCandidate *candidate : hiddenScratch)
+    {
+        Object &object = objects[candidate->id];
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, object.queries[object.slot]);
+        drawBox(candidate->bounds);
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+        object.issuedFrame[object.slot] = frame;
+        object.boxQuery[object.slot] = true;
+        object.lastTest = frame;
+        frameStats.boxQueries++;
+    }
+    glBindVertexArray(0);
+    glColorMask(colorMask[0], colorMask[1], colorMask[2], colorMask[3]);
+    glDepthMask(depthMask);
+
+    // The real draws; the GPU skips those whose box passed no samples
+    passShader.use();
+    for (const OcclusionCandidate *candidate : hiddenScratch)
+    {
+        glBeginConditionalRender(objects[candidate->id].queries[objects[candidate->id].slot], GL_QUERY_NO_WAIT);
+        drawItem(candidate->item);
+        glEndConditionalRender();
+        frameStats.conditionalDraws++;
+    }
+    return static_cast<int>(candidates.size());
+}
+
+void OcclusionQueries::drawBox(const Aabb &bounds) const
+{
+    boxShader->setVec3("boxMin", bounds.min - kBoxPadding);
+    boxShader->setVec3("boxMax", bounds.max + kBoxPadding);
+    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_BYTE, nullptr);
+}
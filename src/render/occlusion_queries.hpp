@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "shader.hpp"
+#include "render/frustum.hpp"
+
+struct OcclusionQuerySettings
+{
+    bool enabled = true;
+    int retestInterval = 8;      // frames between re-tests of an object that was visible
+    bool waitForResults = false; // block on results that are not back yet (to measure the stall) instead of reusing the last known state
+};
+
+// One object of a pass: its world bounds and what the pass's draw callback draws for it
+struct OcclusionCandidate
+{
+    int id = 0; // stable across frames, below the count given to OcclusionQueries::reset
+    Aabb bounds;
+    int item = 0; // handed to the draw callback; the caller's own index
+};
+
+// GL 3.3 hardware occlusion culling with temporal coherence. A pass draws its
+// objects in three groups: those visible at their last test, unconditionally
+// (every retestInterval frames the draw itself is wrapped in a query, which
+// notices once they are covered); then, with color and depth writes off, the
+// bounding box of every hidden object in its own query; then the hidden
+// objects under glBeginConditionalRender(GL_QUERY_NO_WAIT), so the GPU drops
+// those whose box passed no samples and the CPU never waits. Results are read
+// frames later, once available, and sort the objects for the next frame.
+// Later passes of a frame (the scene pass after a depth prepass) reuse the
+// frame's queries, so both passes draw the same set.
+class OcclusionQueries
+{
+public:
+    static constexpr int kQueriesPerObject = 2; // a new test can start while the last result is in flight
+
+    struct Stats
+    {
+        int candidates = 0;       // objects the first pass of the frame was given
+        int boxQueries = 0;       // bounding boxes drawn for hidden objects
+        int drawQueries = 0;      // re-tests wrapped around the draw of visible objects
+        int conditionalDraws = 0; // draws left to the GPU's decision
+        int skippedDraws = 0;     // conditional draws the GPU dropped, counted when their result is read
+        int hidden = 0;           // objects whose last result was "no samples"
+        int lateResults = 0;      // results not back when polled; the last known state was kept
+        int stalls = 0;           // blocking reads (waitForResults)
+        float stallMs = 0.0f;
+        int starved = 0;          // no free query: drawn unconditionally
+    };
+
+    bool init(const std::filesystem::path &shaderRoot);
+    void shutdown();
+    // Forgets every object; ids then run from 0 to objectCount - 1
+    void reset(int objectCount);
+    int objectCount() const { return static_cast<int>(objects.size()); }
+
+    // Reads the results that came back; once per frame, before the passes
+    void beginFrame(const OcclusionQuerySettings &settings);
+    // Draws the candidates through drawItem(candidate.item) with `passShader`
+    // (bound again after the boxes); returns draws submitted, conditional ones included
+    int draw(const std::vector<OcclusionCandidate> &candidates, const std::function<void(int)> &drawItem,
+             Shader &passShader, const glm::mat4 &viewProjection, const glm::vec3 &cameraPosition);
+
+    const Stats &stats() const { return frameStats; }
+
+private:
+    enum class Mode
+    {
+        Draw,
+        DrawQueried,
+        BoxQueried,
+    };
+
+    struct Object
+    {
+        std::array<GLuint, kQueriesPerObject> queries{};
+        std::array<int, kQueriesPerObject> issuedFrame{-1, -1}; // -1: free
+        std::array<bool, kQueriesPerObject> boxQuery{};
+        int resultFrame = -1; // frame of the newest result read
+        bool visible = false; // new objects get a box test first
+        int lastTest = -1;
+        int decidedFrame = -1;
+        Mode mode = Mode::Draw;
+        int slot = -1; // query of this frame's test
+    };
+
+    // Ids past the last reset (before the next one) are drawn untested
+    bool tracked(const OcclusionCandidate &candidate) const
+    {
+        return candidate.id >= 0 && candidate.id < static_cast<int>(objects.size());
+    }
+    void readResults(Object &object);
+    int issue(const std::vector<OcclusionCandidate> &candidates, const std::function<void(int)> &drawItem,
+              Shader &passShader, const glm::mat4 &viewProjection, const glm::vec3 &cameraPosition);
+    void drawBox(const Aabb &bounds) const;
+
+    std::unique_ptr<Shader> boxShader;
+    GLuint boxVao = 0;
+    GLuint boxVbo = 0;
+    GLuint boxEbo = 0;
+
+    std::vector<Object> objects;
+    std::vector<const OcclusionCandidate *> hiddenScratch;
+    OcclusionQuerySettings frameSettings;
+    int frame = 0;
+    bool frameIssued = false;
+    Stats frameStats;
+};
@@ -0,0 +1,129 @@
+#include "render/post_process.hpp"
+
+#include <algorithm>
+
+namespace
+{
+    constexpr int kWarmupFrames = 8;      // timer results lag a few frames behind
+    constexpr int kFramesPerStage = 60;
+}
+
+bool PostProcess::init(const std::filesystem::path &shaderRoot)
+{
+    shader = loadFullscreenShader(shaderRoot, "post_process.frag");
+    triangle.init();
+    return shader && shader->ID != 0;
+}
+
+void PostProcess::shutdown()
+{
+    triangle.shutdown();
+    shader.reset();
+}
+
+void PostProcess::apply(const PostProcessInput &input, const SkyboxSettings &tone) const
+{
+    glDisable(GL_DEPTH_TEST);
+    shader->use();
+    shader->setInt("sceneTexture", 0);
+    shader->setInt("bloomTexture", 1);
+    shader->setVec2("uvScale", input.uvScale);
+    shader->setVec2("texelSize", 1.0f / input.textureSize);
+    shader->setFloat("bloomIntensity", input.bloomTexture != 0 ? input.bloomIntensity : 0.0f);
+    shader->setBool("enableTonemap", settings.tonemap);
+    shader->setBool("enableGamma", settings.gammaCorrect);
+    shader->setBool("enableFxaa", settings.fxaa);
+    shader->setFloat("exposure", tone.exposure);
+    shader->setFloat("gamma", tone.gamma);
+    shader->setFloat("sharpness", settings.sharpen ? input.sharpness : 0.0f);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, input.bloomTexture);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, input.texture);
+    triangle.draw();
+    glEnable(GL_DEPTH_TEST);
+}
+
+void PostProcess::startCostMeasurement()
+{
+    if (isMeasuring())
+        return;
+
+    savedSettings = settings;
+    measureStage = 0;
+    measureFrame = 0;
+    measureSum = 0.0f;
+    measureSamples = 0;
+    stageTotals.fill(0.0f);
+    applyStageOverrides();
+}
+
+void PostProcess::applyStageOverrides()
+{
+    // Stage N enables every effect up to and including N
+    settings.tonemap = measureStage >= Tonemap;
+    settings.gammaCorrect = measureStage >= Gamma;
+    settings.fxaa = measureStage >= Fxaa;
+    settings.sharpen = measureStage >= Sharpen;
+}
+
+void PostProcess::updateCostMeasurement(float postGpuMs)
+{
+    if (!isMeasuring())
+        return;
+
+    if (measureFrame >= kWarmupFrames)
+    {
+        measureSum += postGpuMs;
+        ++measureSamples;
+    }
+
+    if (++measureFrame < kFramesPerStage)
+        return;
+
+    stageTotals[measureStage] = measureSamples > 0 ? measureSum / static_cast<float>(measureSamples) : 0.0f;
+    measureFrame = 0;
+    measureSum = 0.0f;
+    measureSamples = 0;
+
+    if (++measureStage < EffectCount)
+    {
+        applyStageOverrides();
+        return;
+    }
+
+    effectCosts[Passthrough] = stageTotals[Passthrough];
+    for (int i = 1; i < EffectCount; ++i)
+        effectCosts[i] = std::max(0.0f, stageTotals[i] - stageTotals[i - 1]);
+
+    measureStage = -1;
+    settings = savedSettings;
+}
+
+float PostProcess::measurementProgress() const
+{
+    if (!isMeasuring())
+        return 1.0f;
+    const float done = static_cast<float>(measureStage * kFramesPerStage + measureFrame);
+    return done / static_cast<float>(EffectCount * kFramesPerStage);
+}
+
+const char *PostProcess::effectName(int effect)
+{
+    switch (effect)
+    {
+    case Passthrough:
+        return "Base pass";
+    case Tonemap:
+        return "Exposure + Tonemap";
+    case Gamma:
+        return "Gamma";
+    case Fxaa:
+        return "FXAA";
+    case Sharpen:
+        return "Sharpen";
+    default:
+        return "?";
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <filesystem>
+#include <memory>
+
+#include <glm/glm.hpp>
+
+#include "shader.hpp"
+#include "effects/water.hpp"
+#include "render/fullscreen_pass.hpp"
+
+struct PostProcessSettings
+{
+    bool tonemap = true;
+    bool gammaCorrect = true;
+    bool fxaa = true;
+    bool sharpen = true;     // only meaningful after temporal upscaling
+    float budgetMs = 0.5f;   // fixed GPU budget for the whole post stage
+};
+
+struct PostProcessInput
+{
+    unsigned int texture = 0;        // HDR scene or resolved temporal history
+    glm::vec2 uvScale{1.0f};         // used sub-rect of `texture`
+    glm::vec2 textureSize{1.0f};     // full allocated size of `texture`
+    float sharpness = 0.0f;
+    unsigned int bloomTexture = 0;   // 0 disables the bloom composite
+    float bloomIntensity = 0.0f;
+};
+
+// Single fullscreen pass turning the HDR scene into the final LDR image.
+// Each effect is a uniform toggle inside one shader rather than its own
+// pass, so the cost of the chain is one HDR read and one backbuffer write.
+//
+// Because the effects share a pass, their individual GPU costs are found by
+// measurement: the cost sampler steps through cumulative configurations
+// (passthrough, +tonemap, +gamma, +FXAA, +sharpen) for a fixed number of
+// frames each and reports the per-step difference in the "Post" timer.
+class PostProcess
+{
+public:
+    enum Effect
+    {
+        Passthrough,
+        Tonemap,
+        Gamma,
+        Fxaa,
+        Sharpen,
+        EffectCount,
+    };
+
+    PostProcessSettings settings;
+
+    bool init(const std::filesystem::path &shaderRoot);
+    void shutdown();
+
+    // Draws the input into the bound framebuffer
+    void apply(const PostProcessInput &input, const SkyboxSettings &tone) const;
+
+    void startCostMeasurement();
+    // Feed the latest "Post" GPU time once per frame
+    void updateCostMeasurement(float postGpuMs);
+    bool isMeasuring() const { return measureStage >= 0; }
+    float measurementProgress() const;
+    const std::array<float, EffectCount> &effectCostsMs() const { return effectCosts; }
+    static const char *effectName(int effect);
+
+private:
+    void applyStageOverrides();
+
+    std::unique_ptr<Shader> shader;
+    FullscreenTriangle triangle;
+
+    int measureStage = -1;
+    int measureFrame = 0;
+    float measureSum = 0.0f;
+    int measureSamples = 0;
+    PostProcessSettings savedSettings{};
+    std::array<float, EffectCount> stageTotals{};
+    std::array<float, EffectCount> effectCosts{};
+};
@@ -0,0 +1,88 @@
+#include "render/probe_grid.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include <glad/glad.h>
+
+bool ProbeGrid::upload(const ProbeGridData &data)
+{
+    constexpr int kTexels = ProbeGridData::kTexels;
+    const glm::ivec3 size = data.size;
+    const std::size_t probeCount = static_cast<std::size_t>(data.probeCount());
+    if (probeCount == 0 || data.coefficients.size() != probeCount * ProbeGridData::kCoefficients)
+        return false;
+
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &maxSize);
+    if (std::max(size.x, std::max(size.y * kTexels, size.z)) > maxSize)
+    {
+        std::cerr << "Probe grid " << size.x << "x" << size.y << "x" << size.z << " exceeds the 3D texture limit " << maxSize
+                  << std::endl;
+        return false;
+    }
+
+    // Texel (x, k * ny + y, z) holds floats 4k..4k+3 of probe (x, y, z)
+    std::vector<float> texels(probeCount * kTexels * 4, 0.0f);
+    const float *source = &data.coefficients[0].x;
+    for (int z = 0; z < size.z; z++)
+    {
+        for (int y = 0; y < size.y; y++)
+        {
+            for (int x = 0; x < size.x; x++)
+            {
+                const std::size_t probe = static_cast<std::size_t>(x) + size.x * (y + static_cast<std::size_t>(size.y) * z);
+                const float *floats = source + probe * ProbeGridData::kCoefficients * 3;
+                for (int k = 0; k < kTexels; k++)
+                {
+                    const std::size_t row = static_cast<std::size_t>(k) * size.y + y;
+                    float *texel = &texels[(static_cast<std::size_t>(x) + size.x * (row + static_cast<std::size_t>(size.y) * kTexels * z)) * 4];
+                    for (int c = 0; c < 4 && k * 4 + c < ProbeGridData::kCoefficients * 3; c++)
+                        texel[c] = floats[k * 4 + c];
+                }
+            }
+        }
+    }
+
+    if (texture == 0)
+        glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_3D, texture);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F, size.x, size.y * kTexels, size.z, 0, GL_RGBA, GL_FLOAT, texels.data());
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    gridSize = size;
+    gridOrigin = data.origin;
+    gridSpacing = data.spacing;
+    bytes = probeCount * kTexels * 8;
+    return true;
+}
+
+void ProbeGrid::shutdown()
+{
+    if (texture != 0)
+        glDeleteTextures(1, &texture);
+    texture = 0;
+    gridSize = glm::ivec3(0);
+    bytes = 0;
+}
+
+void ProbeGrid::bindForShading(Shader &shader, bool enabled) const
+{
+    shader.setBool("probesEnabled", enabled && ready());
+    shader.setInt("probeGrid", kTextureUnit);
+    shader.setVec3("probeGridOrigin", gridOrigin);
+    shader.setVec3("probeGridInvSpacing", 1.0f / gridSpacing);
+    shader.setVec3("probeGridSize", glm::vec3(gridSize));
+    // Lookups move half a cell off the surface so walls do not read the probes behind them
+    shader.setFloat("probeNormalBias", 0.5f * std::min(gridSpacing.x, std::min(gridSpacing.y, gridSpacing.z)));
+
+    glActiveTexture(GL_TEXTURE0 + kTextureUnit);
+    glBindTexture(GL_TEXTURE_3D, texture);
+    glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+#include "shader.hpp"
+#include "bake/probe_baker.hpp"
+
+// GPU side of the irradiance probe grid: one RGBA16F 3D texture holding the
+// seven coefficient texels of every probe as seven slabs stacked along the
+// texture's height, so the shader does seven trilinear fetches (clamped inside
+// each slab) and evaluates the L2 SH at the surface normal.
+class ProbeGrid
+{
+public:
+    static constexpr int kTextureUnit = 12;
+
+    bool upload(const ProbeGridData &data);
+    void shutdown();
+    bool ready() const { return texture != 0; }
+    glm::ivec3 size() const { return gridSize; }
+    glm::vec3 spacing() const { return gridSpacing; }
+    std::size_t memoryBytes() const { return bytes; }
+
+    // Binds the grid and sets its uniforms on shader.frag; the shader only
+    // uses it on fragments without a lightmap sky term
+    void bindForShading(Shader &shader, bool enabled) const;
+
+private:
+    unsigned int texture = 0;
+    glm::ivec3 gridSize{0};
+    glm::vec3 gridOrigin{0.0f};
+    glm::vec3 gridSpacing{1.0f};
+    std::size_t bytes = 0;
+};
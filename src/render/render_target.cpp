@@ -0,0 +1,124 @@
+#include "render/render_target.hpp"
+
+#include <iostream>
+
+namespace
+{
+    GLenum pixelTypeFor(GLenum internalFormat)
+    {
+        switch (internalFormat)
+        {
+        case GL_RGBA16F:
+        case GL_RGB16F:
+        case GL_RG16F:
+        case GL_R16F:
+        case GL_R11F_G11F_B10F:
+            return GL_HALF_FLOAT;
+        case GL_RGBA32F:
+        case GL_RG32F:
+        case GL_R32F:
+            return GL_FLOAT;
+        default:
+            return GL_UNSIGNED_BYTE;
+        }
+    }
+
+    GLenum pixelFormatFor(GLenum internalFormat)
+    {
+        switch (internalFormat)
+        {
+        case GL_R8:
+        case GL_R16F:
+        case GL_R32F:
+            return GL_RED;
+        case GL_RG8:
+        case GL_RG16F:
+        case GL_RG32F:
+            return GL_RG;
+        case GL_RGB8:
+        case GL_RGB16F:
+        case GL_R11F_G11F_B10F:
+            return GL_RGB;
+        default:
+            return GL_RGBA;
+        }
+    }
+}
+
+bool RenderTarget::init(int width, int height, GLenum colorFormat, bool withDepth)
+{
+    format = colorFormat;
+    hasDepth = withDepth;
+    return resize(width, height);
+}
+
+bool RenderTarget::resize(int width, int height)
+{
+    if (width <= 0 || height <= 0)
+        return false;
+    if (fbo != 0 && width == targetWidth && height == targetHeight)
+        return true;
+
+    shutdown();
+    targetWidth = width;
+    targetHeight = height;
+
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+    glGenTextures(1, &colorTex);
+    glBindTexture(GL_TEXTURE_2D, colorTex);
+    glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(format), width, height, 0,
+                 pixelFormatFor(format), pixelTypeFor(format), nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTex, 0);
+
+    if (hasDepth)
+    {
+        glGenTextures(1, &depthTex);
+        glBindTexture(GL_TEXTURE_2D, depthTex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0,
+                     GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTex, 0);
+    }
+
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cerr << "RenderTarget incomplete (status 0x" << std::hex << status << std::dec << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void RenderTarget::shutdown()
+{
+    if (depthTex != 0)
+        glDeleteTextures(1, &depthTex);
+    if (colorTex != 0)
+        glDeleteTextures(1, &colorTex);
+    if (fbo != 0)
+        glDeleteFramebuffers(1, &fbo);
+    fbo = colorTex = depthTex = 0;
+    targetWidth = targetHeight = 0;
+}
+
+void RenderTarget::bind() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+}
+
+void RenderTarget::bindDefault()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Offscreen framebuffer with one sampled color texture and a sampled depth
+// texture. Passes that render at a reduced resolution keep the target at its
+// full allocated size and only draw into the lower-left viewport sub-rect,
+// so changing the resolution scale never reallocates GPU memory.
+class RenderTarget
+{
+public:
+    bool init(int width, int height, GLenum colorFormat = GL_RGBA8, bool withDepth = true);
+    bool resize(int width, int height);
+    void shutdown();
+
+    void bind() const;
+    static void bindDefault();
+
+    unsigned int framebuffer() const { return fbo; }
+    unsigned int colorTexture() const { return colorTex; }
+    unsigned int depthTexture() const { return depthTex; }
+    int width() const { return targetWidth; }
+    int height() const { return targetHeight; }
+    GLenum colorFormat() const { return format; }
+
+private:
+    unsigned int fbo = 0;
+    unsigned int colorTex = 0;
+    unsigned int depthTex = 0;
+    int targetWidth = 0;
+    int targetHeight = 0;
+    GLenum format = GL_RGBA8;
+    bool hasDepth = true;
+};
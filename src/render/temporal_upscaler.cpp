@@ -0,0 +1,140 @@
+#include "render/temporal_upscaler.hpp"
+
+#include <algorithm>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace
+{
+    // Radical inverse in the given base; index starts at 1 so (0,0) is never used
+    float halton(unsigned int index, unsigned int base)
+    {
+        float result = 0.0f;
+        float fraction = 1.0f / static_cast<float>(base);
+        while (index > 0)
+        {
+            result += static_cast<float>(index % base) * fraction;
+            index /= base;
+            fraction /= static_cast<float>(base);
+        }
+        return result;
+    }
+}
+
+bool TemporalUpscaler::init(const std::filesystem::path &shaderRoot, int width, int height)
+{
+    velocityShader = loadFullscreenShader(shaderRoot, "taa_velocity.frag");
+    resolveShader = loadFullscreenShader(shaderRoot, "taa_resolve.frag");
+    triangle.init();
+
+    outputWidth = width;
+    outputHeight = height;
+    bool ok = velocity.init(width, height, GL_RG16F, false);
+    ok = history[0].init(width, height, GL_RGBA16F, false) && ok;
+    ok = history[1].init(width, height, GL_RGBA16F, false) && ok;
+    historyValid = false;
+    return ok;
+}
+
+void TemporalUpscaler::resize(int width, int height)
+{
+    if (width == outputWidth && height == outputHeight)
+        return;
+
+    outputWidth = width;
+    outputHeight = height;
+    velocity.resize(width, height);
+    history[0].resize(width, height);
+    history[1].resize(width, height);
+    historyValid = false;
+}
+
+void TemporalUpscaler::shutdown()
+{
+    velocity.shutdown();
+    history[0].shutdown();
+    history[1].shutdown();
+    triangle.shutdown();
+    velocityShader.reset();
+    resolveShader.reset();
+}
+
+void TemporalUpscaler::beginFrame(int width, int height)
+{
+    renderWidth = std::max(width, 1);
+    renderHeight = std::max(height, 1);
+
+    // More phases are needed to cover each output pixel as the upscale ratio grows
+    const float ratio = static_cast<float>(outputWidth) / static_cast<float>(renderWidth);
+    const unsigned int phaseCount = static_cast<unsigned int>(std::clamp(8.0f * ratio * ratio, 8.0f, 64.0f));
+
+    const unsigned int index = (frameIndex++ % phaseCount) + 1;
+    jitter = glm::vec2(halton(index, 2) - 0.5f, halton(index, 3) - 0.5f);
+}
+
+glm::mat4 TemporalUpscaler::jitterProjection(const glm::mat4 &projection) const
+{
+    // Shift in NDC after projection, so it works for any projection matrix
+    const glm::vec3 offset(2.0f * jitter.x / static_cast<float>(renderWidth),
+                           2.0f * jitter.y / static_cast<float>(renderHeight), 0.0f);
+    return glm::translate(glm::mat4(1.0f), offset) * projection;
+}
+
+unsigned int TemporalUpscaler::resolve(const RenderTarget &scene, const glm::mat4 &view,
+                                       const glm::mat4 &projection, const glm::mat4 &jitteredProjection)
+{
+    const glm::mat4 currViewProj = projection * view;
+    if (!historyValid)
+        prevViewProj = currViewProj;
+
+    glDisable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+
+    // 1. Camera motion vectors at render resolution
+    velocity.bind();
+    glViewport(0, 0, renderWidth, renderHeight);
+    velocityShader->use();
+    velocityShader->setInt("depthTexture", 0);
+    velocityShader->setVec2("uvScale", glm::vec2(static_cast<float>(renderWidth) / static_cast<float>(scene.width()),
+                                                 static_cast<float>(renderHeight) / static_cast<float>(scene.height())));
+    velocityShader->setMat4("invViewProj", glm::inverse(jitteredProjection * view));
+    velocityShader->setMat4("currViewProj", currViewProj);
+    velocityShader->setMat4("prevViewProj", prevViewProj);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, scene.depthTexture());
+    triangle.draw();
+
+    // 2. Accumulate into the output-resolution history
+    const int previous = currentHistory;
+    currentHistory = 1 - currentHistory;
+    history[currentHistory].bind();
+    glViewport(0, 0, outputWidth, outputHeight);
+    resolveShader->use();
+    resolveShader->setInt("sceneColor", 0);
+    resolveShader->setInt("sceneDepth", 1);
+    resolveShader->setInt("velocityTexture", 2);
+    resolveShader->setInt("historyTexture", 3);
+    resolveShader->setVec2("renderSize", glm::vec2(static_cast<float>(renderWidth), static_cast<float>(renderHeight)));
+    resolveShader->setVec2("outputSize", glm::vec2(static_cast<float>(outputWidth), static_cast<float>(outputHeight)));
+    resolveShader->setVec2("jitter", jitter);
+    resolveShader->setBool("historyValid", historyValid);
+    resolveShader->setFloat("feedbackMin", settings.feedbackMin);
+    resolveShader->setFloat("feedbackMax", settings.feedbackMax);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, scene.colorTexture());
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, scene.depthTexture());
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, velocity.colorTexture());
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, history[previous].colorTexture());
+    triangle.draw();
+    glActiveTexture(GL_TEXTURE0);
+
+    glDepthMask(GL_TRUE);
+    glEnable(GL_DEPTH_TEST);
+
+    prevViewProj = currViewProj;
+    historyValid = true;
+    return history[currentHistory].colorTexture();
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+
+#include <glm/glm.hpp>
+
+#include "shader.hpp"
+#include "render/fullscreen_pass.hpp"
+#include "render/render_target.hpp"
+
+struct TemporalUpscalerSettings
+{
+    float feedbackMin = 0.85f; // history weight when the jittered sample hits the pixel center
+    float feedbackMax = 0.96f; // history weight when it lands far away (upscaled pixels)
+    float sharpness = 0.5f;    // applied by PostProcess on the resolved history
+};
+
+// Temporal upsampling: the scene is rendered at a reduced resolution with a
+// sub-pixel Halton jitter, and each frame's samples are reprojected into a
+// history buffer at output resolution using camera motion vectors. History
+// is clamped to the current neighborhood (YCoCg min/max) to reject stale
+// data. Sharpening of the resolved image is fused into the post-process pass.
+class TemporalUpscaler
+{
+public:
+    TemporalUpscalerSettings settings;
+
+    bool init(const std::filesystem::path &shaderRoot, int outputWidth, int outputHeight);
+    void resize(int outputWidth, int outputHeight);
+    void shutdown();
+
+    // Advances the jitter sequence; call once per frame before rendering
+    void beginFrame(int renderWidth, int renderHeight);
+    // Adds this frame's jitter to a projection matrix
+    glm::mat4 jitterProjection(const glm::mat4 &projection) const;
+    glm::vec2 jitterPixels() const { return jitter; }
+
+    // Motion vectors + history resolve. `scene` holds the jittered frame in its
+    // lower-left renderWidth x renderHeight sub-rect. Returns the resolved
+    // output-resolution HDR texture.
+    unsigned int resolve(const RenderTarget &scene, const glm::mat4 &view,
+                         const glm::mat4 &projection, const glm::mat4 &jitteredProjection);
+
+    void invalidateHistory() { historyValid = false; }
+    unsigned int outputTexture() const { return history[currentHistory].colorTexture(); }
+
+private:
+    std::unique_ptr<Shader> velocityShader;
+    std::unique_ptr<Shader> resolveShader;
+    FullscreenTriangle triangle;
+
+    RenderTarget velocity;
+    RenderTarget history[2];
+    int currentHistory = 0;
+    bool historyValid = false;
+
+    int renderWidth = 1;
+    int renderHeight = 1;
+    int outputWidth = 1;
+    int outputHeight = 1;
+    unsigned int frameIndex = 0;
+    glm::vec2 jitter{0.0f};
+    glm::mat4 prevViewProj{1.0f};
+};
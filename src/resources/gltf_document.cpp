@@ -0,0 +1,688 @@
+#include "resources/gltf_document.hpp"
+
+#include "core/json_sax.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace
+{
+    constexpr int kByte = 5120;
+    constexpr int kUnsignedByte = 5121;
+    constexpr int kShort = 5122;
+    constexpr int kUnsignedShort = 5123;
+    constexpr int kUnsignedInt = 5125;
+    constexpr int kFloat = 5126;
+    constexpr int kTriangles = 4;
+
+    constexpr std::uint32_t kGlbMagic = 0x46546C67; // "glTF"
+    constexpr std::uint32_t kGlbJsonChunk = 0x4E4F534A;
+    constexpr std::uint32_t kGlbBinChunk = 0x004E4942;
+
+    std::size_t componentSize(int componentType)
+    {
+        switch (componentType)
+        {
+        case kByte:
+        case kUnsignedByte:
+            return 1;
+        case kShort:
+        case kUnsignedShort:
+            return 2;
+        case kUnsignedInt:
+        case kFloat:
+            return 4;
+        default:
+            return 0;
+        }
+    }
+
+    int typeComponents(std::string_view type)
+    {
+        if (type == "SCALAR")
+            return 1;
+        if (type == "VEC2")
+            return 2;
+        if (type == "VEC3")
+            return 3;
+        if (type == "VEC4" || type == "MAT2")
+            return 4;
+        if (type == "MAT3")
+            return 9;
+        if (type == "MAT4")
+            return 16;
+        return 0;
+    }
+
+    // URIs name files relative to the document, with %XX escapes
+    std::string decodeUri(std::string_view uri)
+    {
+        std::string decoded;
+        decoded.reserve(uri.size());
+        for (std::size_t i = 0; i < uri.size(); i++)
+        {
+            if (uri[i] == '%' && i + 2 < uri.size())
+            {
+                const char hex[3] = {uri[i + 1], uri[i + 2], '\0'};
+                char *end = nullptr;
+                const long value = std::strtol(hex, &end, 16);
+                if (end == hex + 2)
+                {
+                    decoded.push_back(static_cast<char>(value));
+                    i += 2;
+                    continue;
+                }
+            }
+            decoded.push_back(uri[i]);
+        }
+        return decoded;
+    }
+
+    // A member or element below `prefix`, whose container was entered (and created)
+    bool under(std::string_view path, std::string_view prefix)
+    {
+        return path.size() > prefix.size() && path.substr(0, prefix.size()) == prefix && path[prefix.size()] == '.';
+    }
+
+    bool isDataUri(std::string_view uri)
+    {
+        return uri.substr(0, 5) == "data:";
+    }
+
+    // Builds the document from the parse events. Every container on the
+    // stack adds its place to a dotted path ("meshes.*.primitives.*"), so a
+    // value is recognized by the path it arrives at; the indices of the array
+    // elements along the path pick the object it belongs to.
+    class GltfReader : public JsonHandler
+    {
+    public:
+        explicit GltfReader(GltfDocument &target) : document(target) {}
+
+        bool beginObject() override { return enter(false); }
+        bool beginArray() override { return enter(true); }
+        bool endObject() override { return leave(); }
+        bool endArray() override { return leave(); }
+        bool key(std::string_view name) override
+        {
+            pendingKey.assign(name.data(), name.size());
+            return true;
+        }
+        bool string(std::string_view value) override;
+        bool number(double value) override;
+        bool boolean(bool value) override;
+        bool null() override
+        {
+            endScalar(place());
+            return true;
+        }
+
+        std::string error;
+
+    private:
+        struct Frame
+        {
+            bool array = false;
+            int next = 0;               // index of the next element, for arrays
+            std::size_t pathLength = 0; // path with this container, before its members
+        };
+
+        // Appends the next value's place to the path and returns its array
+        // index (-1 for object members and the root)
+        int place()
+        {
+            if (frames.empty())
+                return -1;
+            Frame &top = frames.back();
+            if (top.array)
+            {
+                path += ".*";
+                indices.push_back(top.next);
+                return top.next++;
+            }
+            path += '.';
+            path += pendingKey;
+            return -1;
+        }
+        bool enter(bool array);
+        bool leave()
+        {
+            frames.pop_back();
+            if (!frames.empty())
+            {
+                path.resize(frames.back().pathLength);
+                if (frames.back().array)
+                    indices.pop_back();
+            }
+            return true;
+        }
+        // The scalar's path, dropped again once it is handled
+        void endScalar(int index)
+        {
+            path.resize(frames.empty() ? 0 : frames.back().pathLength);
+            if (index >= 0)
+                indices.pop_back();
+        }
+        bool toIndex(double value, int &out)
+        {
+            if (value < 0.0 || value != std::floor(value) || value > 2147483647.0)
+            {
+                error = "expected an index at " + path;
+                return false;
+            }
+            out = static_cast<int>(value);
+            return true;
+        }
+        bool toSize(double value, std::size_t &out)
+        {
+            if (value < 0.0 || value != std::floor(value) || value > 9.0e15)
+            {
+                error = "expected a non-negative integer at " + path;
+                return false;
+            }
+            out = static_cast<std::size_t>(value);
+            return true;
+        }
+        // Element of the current path's n-th array level
+        int at(std::size_t level) const { return indices[level]; }
+
+        GltfDocument &document;
+        std::vector<Frame> frames;
+        std::vector<int> indices; // of the array elements along the path
+        std::string path;         // e.g. ".meshes.*.primitives.*.attributes.POSITION"
+        std::string pendingKey;
+    };
+
+    bool GltfReader::enter(bool array)
+    {
+        place();
+        frames.push_back(Frame{array, 0, path.size()});
+        // New elements of the arrays this reader keeps
+        if (path == ".buffers.*")
+            document.buffers.emplace_back();
+        else if (path == ".bufferViews.*")
+            document.bufferViews.emplace_back();
+        else if (path == ".accessors.*")
+            document.accessors.emplace_back();
+        else if (path == ".accessors.*.sparse")
+            document.accessors[at(0)].sparse = true;
+        else if (path == ".meshes.*")
+            document.meshes.emplace_back();
+        else if (path == ".meshes.*.primitives.*")
+            document.meshes[at(0)].primitives.emplace_back();
+        else if (path == ".materials.*")
+            document.materials.emplace_back();
+        else if (path == ".materials.*.extensions.KHR_materials_specular")
+            document.materials[at(0)].hasSpecular = true;
+        else if (path == ".textures.*")
+            document.textures.push_back(-1);
+        else if (path == ".images.*")
+            document.images.emplace_back();
+        else if (path == ".nodes.*")
+            document.nodes.emplace_back();
+        else if (path == ".scenes.*")
+            document.scenes.emplace_back();
+        return true;
+    }
+
+    bool GltfReader::string(std::string_view value)
+    {
+        const int index = place();
+        if (path == ".buffers.*.uri")
+        {
+            if (isDataUri(value))
+                error = "embedded (data URI) buffers";
+            document.buffers[at(0)].uri = decodeUri(value);
+        }
+        else if (path == ".images.*.uri")
+        {
+            if (isDataUri(value))
+                error = "embedded (data URI) images";
+            document.images[at(0)].uri = decodeUri(value);
+        }
+        else if (path == ".accessors.*.type")
+        {
+            document.accessors[at(0)].components = typeComponents(value);
+        }
+        else if (path == ".extensionsRequired.*")
+        {
+            document.extensionsRequired.emplace_back(value);
+        }
+        endScalar(index);
+        return error.empty();
+    }
+
+    bool GltfReader::number(double value)
+    {
+        const int index = place();
+        bool ok = true;
+        const std::string_view p = path;
+        if (p == ".scene")
+        {
+            ok = toIndex(value, document.scene);
+        }
+        else if (under(p, ".buffers.*"))
+        {
+            if (p == ".buffers.*.byteLength")
+                ok = toSize(value, document.buffers[at(0)].byteLength);
+        }
+        else if (under(p, ".bufferViews.*"))
+        {
+            GltfBufferView &view = document.bufferViews[at(0)];
+            if (p == ".bufferViews.*.buffer")
+                ok = toIndex(value, view.buffer);
+            else if (p == ".bufferViews.*.byteOffset")
+                ok = toSize(value, view.byteOffset);
+            else if (p == ".bufferViews.*.byteLength")
+                ok = toSize(value, view.byteLength);
+            else if (p == ".bufferViews.*.byteStride")
+                ok = toSize(value, view.byteStride);
+        }
+        else if (under(p, ".accessors.*"))
+        {
+            GltfAccessor &accessor = document.accessors[at(0)];
+            if (p == ".accessors.*.bufferView")
+                ok = toIndex(value, accessor.bufferView);
+            else if (p == ".accessors.*.byteOffset")
+                ok = toSize(value, accessor.byteOffset);
+            else if (p == ".accessors.*.componentType")
+                ok = toIndex(value, accessor.componentType);
+            else if (p == ".accessors.*.count")
+                ok = toSize(value, accessor.count);
+        }
+        else if (under(p, ".meshes.*.primitives.*"))
+        {
+            GltfPrimitive &primitive = document.meshes[at(0)].primitives[at(1)];
+            if (p == ".meshes.*.primitives.*.attributes.POSITION")
+                ok = toIndex(value, primitive.position);
+            else if (p == ".meshes.*.primitives.*.attributes.NORMAL")
+                ok = toIndex(value, primitive.normal);
+            else if (p == ".meshes.*.primitives.*.attributes.TEXCOORD_0")
+                ok = toIndex(value, primitive.texcoord);
+            else if (p == ".meshes.*.primitives.*.indices")
+                ok = toIndex(value, primitive.indices);
+            else if (p == ".meshes.*.primitives.*.material")
+                ok = toIndex(value, primitive.material);
+            else if (p == ".meshes.*.primitives.*.mode")
+                ok = toIndex(value, primitive.mode);
+        }
+        else if (under(p, ".materials.*"))
+        {
+            GltfMaterial &material = document.materials[at(0)];
+            if (p == ".materials.*.pbrMetallicRoughness.baseColorTexture.index")
+                ok = toIndex(value, material.baseColorTexture);
+            else if (p == ".materials.*.extensions.KHR_materials_specular.specularFactor")
+                material.specularFactor = static_cast<float>(value);
+            else if (p == ".materials.*.extensions.KHR_materials_specular.specularColorFactor.*" && at(1) < 3)
+                material.specularColorFactor[at(1)] = static_cast<float>(value);
+            else if (p == ".materials.*.extensions.KHR_materials_specular.specularColorTexture.index")
+                ok = toIndex(value, material.specularColorTexture);
+        }
+        else if (p == ".textures.*.source")
+        {
+            ok = toIndex(value, document.textures[at(0)]);
+        }
+        else if (p == ".images.*.bufferView")
+        {
+            ok = toIndex(value, document.images[at(0)].bufferView);
+        }
+        else if (under(p, ".nodes.*"))
+        {
+            GltfNode &node = document.nodes[at(0)];
+            const float component = static_cast<float>(value);
+            if (p == ".nodes.*.mesh")
+            {
+                ok = toIndex(value, node.mesh);
+            }
+            else if (p == ".nodes.*.children.*")
+            {
+                node.children.push_back(-1);
+                ok = toIndex(value, node.children.back());
+            }
+            else if (p == ".nodes.*.matrix.*" && at(1) < 16)
+            {
+                // Column-major, as glm
+                node.matrix[at(1) / 4][at(1) % 4] = component;
+                node.hasMatrix = true;
+            }
+            else if (p == ".nodes.*.translation.*" && at(1) < 3)
+            {
+                node.translation[at(1)] = component;
+            }
+            else if (p == ".nodes.*.rotation.*" && at(1) < 4)
+            {
+                node.rotation[at(1)] = component;
+            }
+            else if (p == ".nodes.*.scale.*" && at(1) < 3)
+            {
+                node.scale[at(1)] = component;
+            }
+        }
+        else if (p == ".scenes.*.nodes.*")
+        {
+            document.scenes[at(0)].push_back(-1);
+            ok = toIndex(value, document.scenes[at(0)].back());
+        }
+        endScalar(index);
+        return ok;
+    }
+
+    bool GltfReader::boolean(bool value)
+    {
+        const int index = place();
+        if (path == ".accessors.*.normalized")
+            document.accessors[at(0)].normalized = value;
+        endScalar(index);
+        return true;
+    }
+
+    std::uint32_t readU32(const unsigned char *bytes)
+    {
+        std::uint32_t value;
+        std::memcpy(&value, bytes, sizeof(value));
+        return value; // little-endian, as glTF and every supported target
+    }
+}
+
+glm::mat4 GltfNode::local() const
+{
+    if (hasMatrix)
+        return matrix;
+    const glm::quat orientation(rotation.w, rotation.x, rotation.y, rotation.z);
+    return glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(orientation) *
+           glm::scale(glm::mat4(1.0f), scale);
+}
+
+bool GltfDocument::handles(const std::filesystem::path &path)
+{
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension == ".gltf" || extension == ".glb";
+}
+
+bool GltfDocument::load(const std::filesystem::path &path, std::string &error)
+{
+    *this = GltfDocument();
+    files.emplace_back();
+    if (!files[0].open(path))
+    {
+        error = "can't open " + path.string();
+        return false;
+    }
+
+    // A .glb holds the JSON and the first buffer in one file
+    std::string_view json(reinterpret_cast<const char *>(files[0].data()), files[0].size());
+    const unsigned char *binary = nullptr;
+    std::size_t binaryLength = 0;
+    if (files[0].size() >= 12 && readU32(files[0].data()) == kGlbMagic)
+    {
+        const unsigned char *bytes = files[0].data();
+        const std::size_t size = std::min<std::size_t>(readU32(bytes + 8), files[0].size());
+        std::size_t offset = 12;
+        json = std::string_view();
+        while (offset + 8 <= size)
+        {
+            const std::size_t chunkLength = readU32(bytes + offset);
+            const std::uint32_t chunkType = readU32(bytes + offset + 4);
+            if (chunkLength > size - offset - 8)
+                break;
+            if (chunkType == kGlbJsonChunk && json.empty())
+                json = std::string_view(reinterpret_cast<const char *>(bytes + offset + 8), chunkLength);
+            else if (chunkType == kGlbBinChunk && !binary)
+            {
+                binary = bytes + offset + 8;
+                binaryLength = chunkLength;
+            }
+            offset += 8 + ((chunkLength + 3) & ~std::size_t(3));
+        }
+        if (json.empty())
+        {
+            error = "no JSON chunk in the .glb";
+            return false;
+        }
+    }
+
+    GltfReader reader(*this);
+    std::string parseError;
+    if (!parseJson(json, reader, parseError))
+    {
+        error = reader.error.empty() ? "invalid JSON: " + parseError : reader.error;
+        return false;
+    }
+
+    const std::filesystem::path directory = path.parent_path();
+    for (GltfBuffer &buffer : buffers)
+    {
+        if (buffer.uri.empty())
+        {
+            if (!binary || binaryLength < buffer.byteLength)
+            {
+                error = "buffer without a URI or .glb binary chunk";
+                return false;
+            }
+            buffer.data = binary;
+            continue;
+        }
+        files.emplace_back();
+        if (!files.back().open(directory / buffer.uri) || files.back().size() < buffer.byteLength)
+        {
+            error = "can't map buffer " + buffer.uri;
+            return false;
+        }
+        buffer.data = files.back().data();
+    }
+    return validate(error);
+}
+
+bool GltfDocument::validAccessor(int accessor, std::string &error) const
+{
+    if (accessor < 0 || accessor >= static_cast<int>(accessors.size()))
+    {
+        error = "accessor out of range";
+        return false;
+    }
+    const GltfAccessor &a = accessors[accessor];
+    if (a.sparse)
+    {
+        error = "sparse accessors";
+        return false;
+    }
+    const std::size_t elementSize = componentSize(a.componentType) * static_cast<std::size_t>(a.components);
+    if (elementSize == 0)
+    {
+        error = "accessor of unknown type";
+        return false;
+    }
+    if (a.bufferView < 0 || a.bufferView >= static_cast<int>(bufferViews.size()))
+    {
+        error = "accessor without a buffer view";
+        return false;
+    }
+    const GltfBufferView &v = bufferViews[a.bufferView];
+    if (v.buffer < 0 || v.buffer >= static_cast<int>(buffers.size()) || v.byteOffset > buffers[v.buffer].byteLength ||
+        v.byteLength > buffers[v.buffer].byteLength - v.byteOffset)
+    {
+        error = "buffer view outside its buffer";
+        return false;
+    }
+    // The spec's limits; a stride below the element size would overlap elements
+    if (v.byteStride != 0 && (v.byteStride < 4 || v.byteStride > 252 || v.byteStride % 4 != 0 ||
+                              v.byteStride < elementSize))
+    {
+        error = "invalid buffer view stride";
+        return false;
+    }
+    const std::size_t stride = v.byteStride ? v.byteStride : elementSize;
+    if (a.count > 0 && (a.byteOffset > v.byteLength || (a.count - 1) > (v.byteLength - a.byteOffset) / stride ||
+                        (a.count - 1) * stride + elementSize > v.byteLength - a.byteOffset))
+    {
+        error = "accessor outside its buffer view";
+        return false;
+    }
+    return true;
+}
+
+bool GltfDocument::validate(std::string &error) const
+{
+    for (const std::string &extension : extensionsRequired)
+    {
+        if (extension != "KHR_materials_specular")
+        {
+            error = "required extension " + extension;
+            return false;
+        }
+    }
+    const int meshCount = static_cast<int>(meshes.size());
+    const int nodeCount = static_cast<int>(nodes.size());
+    for (const GltfMesh &mesh : meshes)
+    {
+        for (const GltfPrimitive &primitive : mesh.primitives)
+        {
+            if (primitive.mode != kTriangles)
+            {
+                error = "primitives other than triangle lists";
+                return false;
+            }
+            if (primitive.normal < 0)
+            {
+                error = "primitives without normals";
+                return false;
+            }
+            if (primitive.material >= static_cast<int>(materials.size()))
+            {
+                error = "material out of range";
+                return false;
+            }
+            auto floatAttribute = [&](int attribute, int components) {
+                if (!validAccessor(attribute, error))
+                    return false;
+                const GltfAccessor &a = accessors[attribute];
+                if (a.componentType != kFloat || a.components != components ||
+                    a.count != accessors[primitive.position].count)
+                {
+                    error = "vertex attributes other than float positions, normals and UVs";
+                    return false;
+                }
+                return true;
+            };
+            if (!floatAttribute(primitive.position, 3) || !floatAttribute(primitive.normal, 3) ||
+                (primitive.texcoord >= 0 && !floatAttribute(primitive.texcoord, 2)))
+                return false;
+            if (primitive.indices >= 0)
+            {
+                if (!validAccessor(primitive.indices, error))
+                    return false;
+                const GltfAccessor &a = accessors[primitive.indices];
+                if (a.components != 1 ||
+                    (a.componentType != kUnsignedByte && a.componentType != kUnsignedShort && a.componentType != kUnsignedInt))
+                {
+                    error = "indices other than unsigned integers";
+                    return false;
+                }
+                // Out-of-range indices would be read past the vertices later on
+                const GltfAccessorView indexView = view(primitive.indices);
+                const std::size_t vertexCount = accessors[primitive.position].count;
+                for (std::size_t i = 0; i < indexView.count; i++)
+                {
+                    const unsigned char *element = indexView.data + i * indexView.stride;
+                    std::size_t index = element[0];
+                    if (a.componentType == kUnsignedShort)
+                    {
+                        std::uint16_t value;
+                        std::memcpy(&value, element, sizeof(value));
+                        index = value;
+                    }
+                    else if (a.componentType == kUnsignedInt)
+                    {
+                        index = readU32(element);
+                    }
+                    if (index >= vertexCount)
+                    {
+                        error = "index out of range";
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    for (const GltfMaterial &material : materials)
+    {
+        for (int texture : {material.baseColorTexture, material.specularColorTexture})
+        {
+            if (texture < 0)
+                continue;
+            if (texture >= static_cast<int>(textures.size()) || textures[texture] < 0 ||
+                textures[texture] >= static_cast<int>(images.size()))
+            {
+                error = "texture out of range";
+                return false;
+            }
+            if (images[textures[texture]].uri.empty())
+            {
+                error = "images stored in buffers";
+                return false;
+            }
+        }
+    }
+    // A tree: every node has at most one parent and no root is a child
+    std::vector<int> parents(nodes.size(), 0);
+    for (const GltfNode &node : nodes)
+    {
+        if (node.mesh >= meshCount)
+        {
+            error = "mesh out of range";
+            return false;
+        }
+        for (int child : node.children)
+        {
+            if (child < 0 || child >= nodeCount || ++parents[child] > 1)
+            {
+                error = "node hierarchy is not a tree";
+                return false;
+            }
+        }
+    }
+    if (scene >= static_cast<int>(scenes.size()))
+    {
+        error = "scene out of range";
+        return false;
+    }
+    for (int root : rootNodes())
+    {
+        if (root < 0 || root >= nodeCount || parents[root] != 0)
+        {
+            error = "invalid scene root";
+            return false;
+        }
+    }
+    return true;
+}
+
+GltfAccessorView GltfDocument::view(int accessor) const
+{
+    const GltfAccessor &a = accessors[accessor];
+    const GltfBufferView &v = bufferViews[a.bufferView];
+    GltfAccessorView result;
+    result.data = buffers[v.buffer].data + v.byteOffset + a.byteOffset;
+    result.stride = v.byteStride ? v.byteStride : componentSize(a.componentType) * static_cast<std::size_t>(a.components);
+    result.count = a.count;
+    result.componentType = a.componentType;
+    result.components = a.components;
+    return result;
+}
+
+const std::vector<int> &GltfDocument::rootNodes() const
+{
+    static const std::vector<int> none;
+    if (scenes.empty())
+        return none;
+    return scenes[scene >= 0 ? scene : 0];
+}
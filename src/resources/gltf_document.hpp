@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "core/platform.hpp"
+
+// The parts of a glTF 2.0 file (.gltf with external buffers, or .glb) that
+// the model importer reads. Indices are into the document's arrays, -1 when absent.
+struct GltfBuffer
+{
+    std::string uri; // decoded; empty for a .glb's binary chunk
+    std::size_t byteLength = 0;
+    const unsigned char *data = nullptr; // mapped, set by load
+};
+
+struct GltfBufferView
+{
+    int buffer = -1;
+    std::size_t byteOffset = 0;
+    std::size_t byteLength = 0;
+    std::size_t byteStride = 0; // 0 = tightly packed
+};
+
+struct GltfAccessor
+{
+    int bufferView = -1;
+    std::size_t byteOffset = 0;
+    int componentType = 0; // GL enum, e.g. GL_FLOAT
+    int components = 0;    // from the type: SCALAR = 1 ... MAT4 = 16
+    std::size_t count = 0;
+    bool normalized = false;
+    bool sparse = false;
+};
+
+// An accessor's elements in place: element i starts at data + i * stride
+struct GltfAccessorView
+{
+    const unsigned char *data = nullptr;
+    std::size_t stride = 0;
+    std::size_t count = 0;
+    int componentType = 0;
+    int components = 0;
+};
+
+struct GltfPrimitive
+{
+    int position = -1;
+    int normal = -1;
+    int texcoord = -1; // TEXCOORD_0
+    int indices = -1;
+    int material = -1;
+    int mode = 4; // triangles
+};
+
+struct GltfMesh
+{
+    std::vector<GltfPrimitive> primitives;
+};
+
+struct GltfMaterial
+{
+    int baseColorTexture = -1;
+    // KHR_materials_specular
+    bool hasSpecular = false;
+    float specularFactor = 1.0f;
+    glm::vec3 specularColorFactor{1.0f};
+    int specularColorTexture = -1;
+};
+
+struct GltfImage
+{
+    std::string uri; // decoded, relative to the file; empty when embedded
+    int bufferView = -1;
+};
+
+struct GltfNode
+{
+    std::vector<int> children;
+    int mesh = -1;
+    glm::mat4 matrix{1.0f};
+    bool hasMatrix = false;
+    glm::vec3 translation{0.0f};
+    glm::vec4 rotation{0.0f, 0.0f, 0.0f, 1.0f}; // quaternion, x y z w
+    glm::vec3 scale{1.0f};
+
+    // Matrix, or translation * rotation * scale
+    glm::mat4 local() const;
+};
+
+class GltfDocument
+{
+public:
+    std::vector<GltfBuffer> buffers;
+    std::vector<GltfBufferView> bufferViews;
+    std::vector<GltfAccessor> accessors;
+    std::vector<GltfMesh> meshes;
+    std::vector<GltfMaterial> materials;
+    std::vector<int> textures; // image of each texture
+    std::vector<GltfImage> images;
+    std::vector<GltfNode> nodes;
+    std::vector<std::vector<int>> scenes; // root nodes of each scene
+    int scene = -1;
+    std::vector<std::string> extensionsRequired;
+
+    // .gltf and .glb
+    static bool handles(const std::filesystem::path &path);
+    // Maps the file and its buffers, parses the JSON in one pass and checks
+    // every reference and every accessor a primitive reads. Fails, with the
+    // reason, on a broken file and on anything this reader leaves to Assimp:
+    // embedded (data URI) buffers or images, sparse or non-float vertex
+    // accessors, primitives other than triangle lists, missing normals and
+    // required extensions other than KHR_materials_specular.
+    bool load(const std::filesystem::path &path, std::string &error);
+
+    // Valid for every accessor a primitive uses once load succeeded
+    GltfAccessorView view(int accessor) const;
+    // The scene to show: `scene`, or the first one
+    const std::vector<int> &rootNodes() const;
+
+private:
+    bool validate(std::string &error) const;
+    bool validAccessor(int accessor, std::string &error) const;
+
+    std::vector<MappedFile> files; // the document (kept for a .glb) and its buffer files
+};
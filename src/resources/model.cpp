@@ -1,8 +1,21 @@
 #include "model.hpp"
 #include "texture.hpp"
+#include "core/job_system.hpp"
+#include "resources/gltf_document.hpp"
 
-#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <filesystem>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <unordered_map>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
 
 Model::Model(std::string path, bool gamma) : gammaCorrection(gamma)
 {
@@ -12,11 +25,555 @@ Model::Model(std::string path, bool gamma) : gammaCorrection(gamma)
 void Model::Draw(Shader &shader)
 {
     for(unsigned int i = 0; i < meshes.size(); i++)
-        meshes[i].Draw(shader);
+    {
+        for(const Placement &placement : placements[i])
+        {
+            shader.setMat4("model", placementWorld(placement));
+            meshes[i].Draw(shader);
+        }
+    }
+}
+
+glm::mat4 Model::placementWorld(const Placement &placement) const
+{
+    return glm::translate(nodes.world(placement.node), placement.offset);
+}
+
+Aabb Model::placementBounds(unsigned int mesh, const Placement &placement) const
+{
+    return Aabb{meshes[mesh].boundsMin, meshes[mesh].boundsMax}.transformed(placementWorld(placement));
+}
+
+namespace
+{
+    constexpr float kMatchTolerance = 1e-4f; // model units; also the hash quantization step
+    constexpr float kDielectricF0 = 0.04f;   // reflectance KHR_materials_specular tints and scales
+    constexpr std::size_t kBatchMeshesPerThread = 4;
+    constexpr std::size_t kReportedSlowMeshes = 5;
+
+    float millisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::uint64_t fnv1a(std::uint64_t hash, const void *data, std::size_t bytes)
+    {
+        const auto *p = static_cast<const unsigned char *>(data);
+        for (std::size_t i = 0; i < bytes; i++)
+        {
+            hash ^= p[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    std::uint64_t hashQuantized(std::uint64_t hash, float value)
+    {
+        const auto quantized = static_cast<std::int64_t>(std::llround(value / kMatchTolerance));
+        return fnv1a(hash, &quantized, sizeof(quantized));
+    }
+
+    glm::mat4 toGlm(const aiMatrix4x4 &m)
+    {
+        // Assimp is row-major, glm column-major
+        return glm::transpose(glm::make_mat4(&m.a1));
+    }
+
+    // Geometry, material and the translation that moves it onto its anchor
+    struct SourceMesh
+    {
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        unsigned int material = 0;
+        glm::vec3 anchor{0.0f}; // bounds minimum
+        std::uint64_t hash = 0;
+        int unique = -1;        // GPU mesh it was merged into
+        ModelImportStats::MeshTiming timing;
+    };
+
+    // Content hash of the anchored vertex data, indices and material
+    std::uint64_t contentHash(const SourceMesh &source)
+    {
+        std::uint64_t hash = 14695981039346656037ull;
+        hash = fnv1a(hash, &source.material, sizeof(source.material));
+        for (const Vertex &vertex : source.vertices)
+        {
+            const glm::vec3 position = vertex.Position - source.anchor;
+            for (int k = 0; k < 3; k++)
+                hash = hashQuantized(hash, position[k]);
+            for (int k = 0; k < 3; k++)
+                hash = hashQuantized(hash, vertex.Normal[k]);
+            for (int k = 0; k < 2; k++)
+                hash = hashQuantized(hash, vertex.TexCoords[k]);
+        }
+        return fnv1a(hash, source.indices.data(), source.indices.size() * sizeof(unsigned int));
+    }
+
+    // Hash collisions and quantization edges are settled by comparing the data
+    bool sameContent(const SourceMesh &a, const SourceMesh &b)
+    {
+        if (a.material != b.material || a.vertices.size() != b.vertices.size() || a.indices != b.indices)
+            return false;
+        for (std::size_t i = 0; i < a.vertices.size(); i++)
+        {
+            const Vertex &va = a.vertices[i];
+            const Vertex &vb = b.vertices[i];
+            const glm::vec3 positionDelta = glm::abs((va.Position - a.anchor) - (vb.Position - b.anchor));
+            const glm::vec3 normalDelta = glm::abs(va.Normal - vb.Normal);
+            const glm::vec2 uvDelta = glm::abs(va.TexCoords - vb.TexCoords);
+            const glm::vec3 delta = glm::max(glm::max(positionDelta, normalDelta), glm::vec3(uvDelta, 0.0f));
+            if (std::max(delta.x, std::max(delta.y, delta.z)) > kMatchTolerance)
+                return false;
+        }
+        return true;
+    }
+
+    // A file as the merge sees it, whichever reader read it: the node tree,
+    // the nodes placing each source mesh, and the meshes converted on request
+    struct ImportSource
+    {
+        TransformHierarchy tree;
+        std::vector<std::vector<int>> meshNodes; // per source mesh
+        std::function<void(unsigned int mesh, SourceMesh &source)> convert; // vertices, indices and material
+        std::function<std::vector<TextureRequest>(unsigned int mesh)> textures;
+    };
+
+    // Geometry, anchor and content hash of one source mesh; on any worker
+    void prepareSource(const ImportSource &file, unsigned int mesh, SourceMesh &source)
+    {
+        const auto convertStart = std::chrono::steady_clock::now();
+        file.convert(mesh, source);
+        const auto hashStart = std::chrono::steady_clock::now();
+        source.timing.convertMs = std::chrono::duration<float, std::milli>(hashStart - convertStart).count();
+        source.timing.vertices = static_cast<int>(source.vertices.size());
+        source.timing.triangles = static_cast<int>(source.indices.size() / 3);
+        if (!source.vertices.empty())
+        {
+            source.anchor = source.vertices[0].Position;
+            for (const Vertex &vertex : source.vertices)
+                source.anchor = glm::min(source.anchor, vertex.Position);
+        }
+        source.hash = contentHash(source);
+        source.timing.hashMs = millisecondsSince(hashStart);
+    }
+
+    // Merge meshes whose content matches up to a translation; only the first
+    // copy is uploaded and the others become placements of it. The meshes
+    // go through in batches: converted and hashed in parallel, merged in
+    // file order (so the result doesn't depend on the thread count), new
+    // ones split into meshlets in parallel, then handed to the sink in file
+    // order. Batches of a few meshes per thread keep every thread busy and
+    // still let the first meshes reach the sink early.
+    bool mergeInto(const std::string &path, ImportSource &file, unsigned int threads,
+                   std::chrono::steady_clock::time_point importStart, ModelImportStats &stats, ModelImportSink &sink)
+    {
+        // 0 workers would mean one per hardware thread to the job system
+        JobSystem jobs(threads == 0 ? 0 : std::max(threads, 2u) - 1);
+        jobs.setMaxThreads(threads);
+        stats.threads = static_cast<int>(jobs.activeThreads());
+
+        const auto meshCount = static_cast<unsigned int>(file.meshNodes.size());
+        std::vector<unsigned int> referenced;
+        for (unsigned int i = 0; i < meshCount; i++)
+        {
+            if (!file.meshNodes[i].empty())
+                referenced.push_back(i);
+            stats.placements += static_cast<int>(file.meshNodes[i].size());
+        }
+        stats.sourceMeshes = static_cast<int>(referenced.size());
+        // Use filesystem to correctly get parent directory (handles both / and \)
+        sink.onNodes(std::move(file.tree), std::filesystem::path(path).parent_path().string(), stats.sourceMeshes);
+
+        std::vector<SourceMesh> sources(meshCount);
+        std::unordered_multimap<std::uint64_t, unsigned int> uniqueByHash;
+        std::vector<unsigned int> uniqueSource; // source mesh of every GPU mesh
+        const std::size_t batchSize = kBatchMeshesPerThread * static_cast<std::size_t>(stats.threads);
+        for (std::size_t first = 0; first < referenced.size(); first += batchSize)
+        {
+            if (sink.cancelled())
+                return false;
+            const std::size_t count = std::min(batchSize, referenced.size() - first);
+            const unsigned int *batch = referenced.data() + first;
+            jobs.parallelFor(count, 1, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t k = begin; k < end; k++)
+                    prepareSource(file, batch[k], sources[batch[k]]);
+            });
+
+            std::vector<std::size_t> added; // batch entries that become GPU meshes
+            for (std::size_t k = 0; k < count; k++)
+            {
+                SourceMesh &source = sources[batch[k]];
+                const auto compareStart = std::chrono::steady_clock::now();
+                const auto range = uniqueByHash.equal_range(source.hash);
+                for (auto it = range.first; it != range.second && source.unique < 0; ++it)
+                {
+                    if (sameContent(sources[uniqueSource[it->second]], source))
+                        source.unique = static_cast<int>(it->second);
+                }
+                source.timing.hashMs += millisecondsSince(compareStart);
+                if (source.unique >= 0)
+                    continue;
+                source.unique = static_cast<int>(uniqueSource.size());
+                uniqueByHash.emplace(source.hash, source.unique);
+                uniqueSource.push_back(batch[k]);
+                added.push_back(k);
+            }
+
+            // The sink gets a copy: later duplicates are still compared against
+            // the source. Meshlets reorder the indices, so before the upload.
+            std::vector<ImportedMesh> meshes(added.size());
+            jobs.parallelFor(added.size(), 1, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t a = begin; a < end; a++)
+                {
+                    SourceMesh &source = sources[batch[added[a]]];
+                    const auto meshletStart = std::chrono::steady_clock::now();
+                    meshes[a].vertices = source.vertices;
+                    meshes[a].indices = source.indices;
+                    meshes[a].meshlets = buildMeshlets(meshes[a].vertices, meshes[a].indices);
+                    source.timing.meshletMs = millisecondsSince(meshletStart);
+                }
+            });
+
+            std::size_t nextAdded = 0;
+            for (std::size_t k = 0; k < count; k++)
+            {
+                const unsigned int i = batch[k];
+                SourceMesh &source = sources[i];
+                if (nextAdded < added.size() && added[nextAdded] == k)
+                {
+                    ImportedMesh &mesh = meshes[nextAdded++];
+                    stats.meshlets += static_cast<int>(mesh.meshlets.count);
+                    mesh.textures = file.textures(i);
+                    for (int node : file.meshNodes[i])
+                        mesh.placements.push_back({node, glm::vec3(0.0f)});
+                    sink.onMesh(std::move(mesh));
+                    continue;
+                }
+                const glm::vec3 offset = source.anchor - sources[uniqueSource[source.unique]].anchor;
+                std::vector<Model::Placement> merged;
+                for (int node : file.meshNodes[i])
+                    merged.push_back({node, offset});
+                sink.onPlacements(source.unique, std::move(merged));
+                stats.savedBytes += source.vertices.size() * sizeof(Vertex) + source.indices.size() * sizeof(unsigned int);
+                // Only GPU meshes are compared against from here on
+                std::vector<Vertex>().swap(source.vertices);
+                std::vector<unsigned int>().swap(source.indices);
+            }
+        }
+
+        stats.uniqueMeshes = static_cast<int>(uniqueSource.size());
+        std::vector<std::size_t> placementCounts(uniqueSource.size(), 0);
+        for (unsigned int i : referenced)
+            placementCounts[sources[i].unique] += file.meshNodes[i].size();
+        for (std::size_t count : placementCounts)
+            stats.instancedMeshes += count > 1 ? 1 : 0;
+        stats.meshTimings.resize(meshCount);
+        for (unsigned int i = 0; i < meshCount; i++)
+        {
+            stats.meshTimings[i] = sources[i].timing;
+            stats.convertMs += sources[i].timing.convertMs;
+            stats.hashMs += sources[i].timing.hashMs;
+            stats.meshletMs += sources[i].timing.meshletMs;
+        }
+        stats.wallMs = millisecondsSince(importStart);
+        sink.onFinished(stats);
+
+        std::cout << "[Model] " << std::filesystem::path(path).filename().string() << ": " << stats.sourceMeshes
+                  << " meshes -> " << stats.uniqueMeshes << " GPU meshes (" << stats.sourceMeshes - stats.uniqueMeshes
+                  << " merged, " << stats.instancedMeshes << " instanced), " << stats.savedBytes / 1024 << " KB GPU memory saved, "
+                  << stats.placements << " -> " << stats.uniqueMeshes << " draw calls, " << stats.meshlets
+                  << " meshlets; imported in " << stats.wallMs << " ms on " << stats.threads
+                  << (stats.threads == 1 ? " thread" : " threads") << " (read by "
+                  << (stats.nativeGltf ? "glTF reader" : "Assimp") << " in " << stats.readMs << " ms; thread time: converted "
+                  << stats.convertMs << " ms, hashed " << stats.hashMs << " ms, meshlets " << stats.meshletMs << " ms)"
+                  << std::endl;
+
+        std::vector<unsigned int> slowest = referenced;
+        const auto total = [&](unsigned int i) {
+            const ModelImportStats::MeshTiming &t = stats.meshTimings[i];
+            return t.convertMs + t.hashMs + t.meshletMs;
+        };
+        const std::size_t reported = std::min(kReportedSlowMeshes, slowest.size());
+        std::partial_sort(slowest.begin(), slowest.begin() + static_cast<std::ptrdiff_t>(reported), slowest.end(),
+                          [&](unsigned int a, unsigned int b) { return total(a) > total(b); });
+        if (reported > 0)
+        {
+            std::cout << "[Model] Slowest meshes:";
+            for (std::size_t r = 0; r < reported; r++)
+            {
+                const ModelImportStats::MeshTiming &t = stats.meshTimings[slowest[r]];
+                std::cout << (r == 0 ? " #" : ", #") << slowest[r] << ' ' << total(slowest[r]) << " ms (" << t.vertices
+                          << " vertices: convert " << t.convertMs << ", hash " << t.hashMs << ", meshlets " << t.meshletMs
+                          << ')';
+            }
+            std::cout << std::endl;
+        }
+        return true;
+    }
+
+    // Depth-first, as Assimp walks its nodes, so both readers number the nodes alike
+    void addGltfNode(const GltfDocument &gltf, int node, int parent, const std::vector<unsigned int> &firstPrimitive,
+                     ImportSource &file)
+    {
+        const GltfNode &source = gltf.nodes[node];
+        const int index = file.tree.add(parent, source.local());
+        if (source.mesh >= 0)
+        {
+            // Every primitive is a source mesh of its own, as Assimp splits them
+            for (std::size_t p = 0; p < gltf.meshes[source.mesh].primitives.size(); p++)
+                file.meshNodes[firstPrimitive[source.mesh] + p].push_back(index);
+        }
+        for (int child : source.children)
+            addGltfNode(gltf, child, index, firstPrimitive, file);
+    }
+
+    // Straight from the mapped buffers: strided attribute reads into the
+    // vertices and, for 32-bit indices, one copy of the index range
+    void readGltfPrimitive(const GltfDocument &gltf, const GltfPrimitive &primitive, SourceMesh &source)
+    {
+        const GltfAccessorView positions = gltf.view(primitive.position);
+        const GltfAccessorView normals = gltf.view(primitive.normal);
+        source.vertices.resize(positions.count);
+        for (std::size_t i = 0; i < positions.count; i++)
+        {
+            Vertex &vertex = source.vertices[i];
+            std::memcpy(&vertex.Position, positions.data + i * positions.stride, sizeof(glm::vec3));
+            std::memcpy(&vertex.Normal, normals.data + i * normals.stride, sizeof(glm::vec3));
+        }
+        if (primitive.texcoord >= 0)
+        {
+            const GltfAccessorView uvs = gltf.view(primitive.texcoord);
+            for (std::size_t i = 0; i < uvs.count; i++)
+            {
+                glm::vec2 &uv = source.vertices[i].TexCoords;
+                std::memcpy(&uv, uvs.data + i * uvs.stride, sizeof(glm::vec2));
+                // glTF's V runs down the image; flipped as Assimp does, since textures load bottom row first
+                uv.y = 1.0f - uv.y;
+            }
+        }
+
+        if (primitive.indices < 0)
+        {
+            source.indices.resize(positions.count);
+            std::iota(source.indices.begin(), source.indices.end(), 0u);
+        }
+        else
+        {
+            const GltfAccessorView indices = gltf.view(primitive.indices);
+            source.indices.resize(indices.count);
+            if (indices.componentType == GL_UNSIGNED_INT && indices.stride == sizeof(unsigned int))
+            {
+                std::memcpy(source.indices.data(), indices.data, indices.count * sizeof(unsigned int));
+            }
+            else
+            {
+                for (std::size_t i = 0; i < indices.count; i++)
+                {
+                    const unsigned char *element = indices.data + i * indices.stride;
+                    if (indices.componentType == GL_UNSIGNED_BYTE)
+                    {
+                        source.indices[i] = element[0];
+                    }
+                    else if (indices.componentType == GL_UNSIGNED_SHORT)
+                    {
+                        std::uint16_t index;
+                        std::memcpy(&index, element, sizeof(index));
+                        source.indices[i] = index;
+                    }
+                    else
+                    {
+                        std::memcpy(&source.indices[i], element, sizeof(unsigned int));
+                    }
+                }
+            }
+        }
+        // Primitives without a material share Assimp's default one, after the file's
+        source.material = primitive.material >= 0 ? static_cast<unsigned int>(primitive.material)
+                                                  : static_cast<unsigned int>(gltf.materials.size());
+    }
+
+    std::vector<TextureRequest> gltfTextures(const GltfDocument &gltf, const GltfPrimitive &primitive)
+    {
+        std::vector<TextureRequest> textures;
+        if (primitive.material < 0)
+            return textures;
+        const GltfMaterial &material = gltf.materials[primitive.material];
+        if (material.baseColorTexture >= 0)
+            textures.push_back({"texture_diffuse", gltf.images[gltf.textures[material.baseColorTexture]].uri});
+        if (material.hasSpecular)
+        {
+            if (material.specularColorTexture >= 0)
+            {
+                textures.push_back({"texture_specular", gltf.images[gltf.textures[material.specularColorTexture]].uri});
+            }
+            else
+            {
+                // The extension's F0: the dielectric reflectance, tinted by the color and scaled by the factor
+                const glm::vec3 f0 = glm::clamp(kDielectricF0 * material.specularColorFactor, 0.0f, 1.0f) *
+                                     glm::clamp(material.specularFactor, 0.0f, 1.0f);
+                const unsigned char rgba[4] = {static_cast<unsigned char>(std::lround(f0.r * 255.0f)),
+                                               static_cast<unsigned char>(std::lround(f0.g * 255.0f)),
+                                               static_cast<unsigned char>(std::lround(f0.b * 255.0f)), 255};
+                textures.push_back({"texture_specular", solidColorKey(rgba)});
+            }
+        }
+        return textures;
+    }
+
+    // The glTF scene with every primitive as a source mesh, in file order
+    ImportSource gltfSource(const GltfDocument &gltf)
+    {
+        ImportSource file;
+        std::vector<unsigned int> firstPrimitive;
+        std::vector<const GltfPrimitive *> primitives;
+        for (const GltfMesh &mesh : gltf.meshes)
+        {
+            firstPrimitive.push_back(static_cast<unsigned int>(primitives.size()));
+            for (const GltfPrimitive &primitive : mesh.primitives)
+                primitives.push_back(&primitive);
+        }
+        file.meshNodes.resize(primitives.size());
+
+        file.tree.add(TransformHierarchy::kNoParent, glm::mat4(1.0f)); // Model::kRootNode
+        // A single scene root is the file's root node, several get a common parent (as in Assimp)
+        const std::vector<int> &roots = gltf.rootNodes();
+        if (roots.size() == 1)
+        {
+            addGltfNode(gltf, roots[0], Model::kRootNode, firstPrimitive, file);
+        }
+        else
+        {
+            const int root = file.tree.add(Model::kRootNode, glm::mat4(1.0f));
+            for (int node : roots)
+                addGltfNode(gltf, node, root, firstPrimitive, file);
+        }
+
+        file.convert = [&gltf, primitives](unsigned int mesh, SourceMesh &source) {
+            readGltfPrimitive(gltf, *primitives[mesh], source);
+        };
+        file.textures = [&gltf, primitives](unsigned int mesh) { return gltfTextures(gltf, *primitives[mesh]); };
+        return file;
+    }
+
+    // Synchronous import: every mesh is uploaded as it arrives, textures are loaded on first use
+    class DirectSink : public ModelImportSink
+    {
+    public:
+        explicit DirectSink(Model &target) : model(target) {}
+
+        void onNodes(TransformHierarchy tree, const std::string &directory, int sourceMeshes) override
+        {
+            model.setNodes(std::move(tree), directory);
+            model.meshes.reserve(static_cast<std::size_t>(sourceMeshes));
+        }
+        void onMesh(ImportedMesh mesh) override
+        {
+            std::vector<Texture> textures = model.loadTextures(mesh.textures);
+            model.addMesh(std::move(mesh), std::move(textures));
+        }
+        void onPlacements(int mesh, std::vector<Model::Placement> placements) override
+        {
+            model.addPlacements(mesh, placements);
+        }
+        void onFinished(const ModelImportStats &stats) override { model.importStats = stats; }
+
+    private:
+        Model &model;
+    };
 }
 
 void Model::loadModel(std::string path)
 {
+    nodes.clear();
+    nodes.add(TransformHierarchy::kNoParent, glm::mat4(1.0f)); // kRootNode, even if loading fails
+    DirectSink sink(*this);
+    importFile(path, sink);
+    nodes.update();
+}
+
+void Model::setNodes(TransformHierarchy tree, std::string fileDirectory)
+{
+    // The root keeps the transform its owner gave it
+    if (nodes.size() > 0 && tree.size() > 0)
+        tree.setLocal(kRootNode, nodes.local(kRootNode));
+    nodes = std::move(tree);
+    directory = std::move(fileDirectory);
+}
+
+int Model::addMesh(ImportedMesh &&mesh, std::vector<Texture> textures)
+{
+    meshes.emplace_back(std::move(mesh.vertices), std::move(mesh.indices), std::move(textures));
+    meshes.back().meshlets = std::move(mesh.meshlets);
+    placements.emplace_back();
+    const int index = static_cast<int>(meshes.size()) - 1;
+    addPlacements(index, mesh.placements);
+    return index;
+}
+
+void Model::addPlacements(int mesh, const std::vector<Placement> &added)
+{
+    const Mesh &target = meshes[mesh];
+    for (const Placement &placement : added)
+    {
+        placements[mesh].push_back(placement);
+        Aabb bounds = nodes.localBoundsOf(placement.node);
+        bounds.expand(Aabb{target.boundsMin + placement.offset, target.boundsMax + placement.offset});
+        nodes.setLocalBounds(placement.node, bounds);
+    }
+}
+
+std::vector<Texture> Model::loadTextures(const std::vector<TextureRequest> &requests)
+{
+    std::vector<Texture> textures;
+    for (const TextureRequest &request : requests)
+    {
+        // Only color maps are stored as sRGB; specular, normal and height maps are linear data
+        const bool srgb = gammaCorrection && request.type == "texture_diffuse";
+        // check if texture was loaded before and if so, skip loading a new texture
+        const auto loaded = std::find_if(textures_loaded.begin(), textures_loaded.end(), [&](const Texture &texture) {
+            return texture.path == request.path && (gammaCorrection && texture.type == "texture_diffuse") == srgb;
+        });
+        if (loaded != textures_loaded.end())
+        {
+            Texture texture = *loaded;
+            texture.type = request.type;
+            textures.push_back(texture);
+            continue;
+        }
+        // Use filesystem to properly join paths (handles mixed separators)
+        Texture texture;
+        unsigned char color[4];
+        if (parseSolidColorKey(request.path, color))
+            texture.id = createTextureFromData(1, 1, color);
+        else
+            texture.id = loadTexture2D(std::filesystem::path(directory) / request.path, srgb);
+        texture.type = request.type;
+        texture.path = request.path;
+        textures.push_back(texture);
+        textures_loaded.push_back(texture); // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+    }
+    return textures;
+}
+
+bool Model::importFile(const std::string &path, ModelImportSink &sink, const ModelImportOptions &options)
+{
+    const auto readStart = std::chrono::steady_clock::now();
+    if (options.nativeGltf && GltfDocument::handles(path))
+    {
+        GltfDocument gltf;
+        std::string reason;
+        if (gltf.load(path, reason))
+        {
+            ModelImportStats stats;
+            stats.nativeGltf = true;
+            stats.readMs = millisecondsSince(readStart);
+            ImportSource file = gltfSource(gltf);
+            return mergeInto(path, file, options.threads, readStart, stats, sink);
+        }
+        std::cout << "[Model] " << std::filesystem::path(path).filename().string() << ": " << reason
+                  << ", reading it with Assimp" << std::endl;
+    }
+
     Assimp::Importer importer;
     // Note: Do NOT use aiProcess_FlipUVs for glTF models as they already use OpenGL's coordinate system
     const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace);
@@ -24,136 +581,99 @@ void Model::loadModel(std::string path)
     if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) 
     {
         std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
-        return;
+        return false;
     }
-    // Use filesystem to correctly get parent directory (handles both / and \)
-    directory = std::filesystem::path(path).parent_path().string();
+    ModelImportStats stats;
+    stats.readMs = millisecondsSince(readStart);
 
-    processNode(scene->mRootNode, scene);
+    ImportSource file;
+    file.tree.add(TransformHierarchy::kNoParent, glm::mat4(1.0f)); // kRootNode
+    std::vector<MeshPlacement> nodePlacements;
+    processNode(scene->mRootNode, kRootNode, file.tree, nodePlacements);
+    file.meshNodes.resize(scene->mNumMeshes);
+    for (const MeshPlacement &placement : nodePlacements)
+        file.meshNodes[placement.sourceMesh].push_back(placement.node);
+    file.convert = [scene](unsigned int mesh, SourceMesh &source) {
+        processMesh(scene->mMeshes[mesh], source.vertices, source.indices);
+        source.material = scene->mMeshes[mesh]->mMaterialIndex;
+    };
+    file.textures = [scene](unsigned int mesh) { return meshTextures(scene->mMeshes[mesh], scene); };
+    return mergeInto(path, file, options.threads, readStart, stats, sink);
 }
 
-void Model::processNode(aiNode *node, const aiScene *scene)
+void Model::processNode(aiNode *node, int parent, TransformHierarchy &tree, std::vector<MeshPlacement> &nodePlacements)
 {
+    // Depth-first, so every node is added after its parent
+    const int index = tree.add(parent, toGlm(node->mTransformation));
     for(unsigned int i = 0; i < node->mNumMeshes; i++)
     {
-        aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        meshes.push_back(processMesh(mesh, scene));
+        nodePlacements.push_back({node->mMeshes[i], index});
     }
     for(unsigned int i = 0; i < node->mNumChildren; i++)
     {
-        processNode(node->mChildren[i], scene);
+        processNode(node->mChildren[i], index, tree, nodePlacements);
     }
 }
 
-Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene)
+void Model::processMesh(aiMesh *mesh, std::vector<Vertex> &vertices, std::vector<unsigned int> &indices)
 {
-    std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
-    std::vector<Texture> textures;
-
+    // Sized once and written in place; runs on the import's worker threads
+    vertices.resize(mesh->mNumVertices);
+    const bool hasNormals = mesh->HasNormals();
+    // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't
+    // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
+    const aiVector3D *texCoords = mesh->mTextureCoords[0];
     for(unsigned int i = 0; i < mesh->mNumVertices; i++)
     {
-        Vertex vertex;
-        glm::vec3 vector; 
-        
-        // positions
-        vector.x = mesh->mVertices[i].x;
-        vector.y = mesh->mVertices[i].y;
-        vector.z = mesh->mVertices[i].z;
-        vertex.Position = vector;
-        
-        // normals
-        if (mesh->HasNormals())
-        {
-            vector.x = mesh->mNormals[i].x;
-            vector.y = mesh->mNormals[i].y;
-            vector.z = mesh->mNormals[i].z;
-            vertex.Normal = vector;
-        }
-
-        // texture coordinates
-        if(mesh->mTextureCoords[0]) 
-        {
-            glm::vec2 vec;
-            // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't 
-            // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
-            vec.x = mesh->mTextureCoords[0][i].x; 
-            vec.y = mesh->mTextureCoords[0][i].y;
-            vertex.TexCoords = vec;
-        }
-        else
-            vertex.TexCoords = glm::vec2(0.0f, 0.0f);
-
-        vertices.push_back(vertex);
+        Vertex &vertex = vertices[i];
+        vertex.Position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+        if (hasNormals)
+            vertex.Normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
+        if (texCoords)
+            vertex.TexCoords = glm::vec2(texCoords[i].x, texCoords[i].y);
     }
-    
+
+    std::size_t indexCount = 0;
+    for(unsigned int i = 0; i < mesh->mNumFaces; i++)
+        indexCount += mesh->mFaces[i].mNumIndices;
+    indices.resize(indexCount);
+    unsigned int *out = indices.data();
     for(unsigned int i = 0; i < mesh->mNumFaces; i++)
     {
-        aiFace face = mesh->mFaces[i];
-        for(unsigned int j = 0; j < face.mNumIndices; j++)
-            indices.push_back(face.mIndices[j]);
+        const aiFace &face = mesh->mFaces[i];
+        out = std::copy_n(face.mIndices, face.mNumIndices, out);
     }
-    
+}
+
+std::vector<TextureRequest> Model::meshTextures(aiMesh *mesh, const aiScene *scene)
+{
+    std::vector<TextureRequest> textures;
     aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];    
 
     // 1. diffuse maps
-    std::vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-    textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+    materialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", textures);
     
     // 1b. For glTF models, baseColor is stored as aiTextureType_BASE_COLOR
-    if (diffuseMaps.empty()) {
-        std::vector<Texture> baseColorMaps = loadMaterialTextures(material, aiTextureType_BASE_COLOR, "texture_diffuse");
-        textures.insert(textures.end(), baseColorMaps.begin(), baseColorMaps.end());
-    }
+    if (textures.empty())
+        materialTextures(material, aiTextureType_BASE_COLOR, "texture_diffuse", textures);
     
     // 2. specular maps
-    std::vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-    textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+    materialTextures(material, aiTextureType_SPECULAR, "texture_specular", textures);
     // 3. normal maps
-    std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-    textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+    materialTextures(material, aiTextureType_HEIGHT, "texture_normal", textures);
     // 4. height maps
-    std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-    textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
+    materialTextures(material, aiTextureType_AMBIENT, "texture_height", textures);
         
-    return Mesh(vertices, indices, textures);
+    return textures;
 }
 
-std::vector<Texture> Model::loadMaterialTextures(aiMaterial *mat, aiTextureType type, std::string typeName)
+void Model::materialTextures(aiMaterial *mat, aiTextureType type, const std::string &typeName,
+                             std::vector<TextureRequest> &requests)
 {
-    std::vector<Texture> textures;
     for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
     {
         aiString str;
         mat->GetTexture(type, i, &str);
-        // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-        bool skip = false;
-        for(unsigned int j = 0; j < textures_loaded.size(); j++)
-        {
-            if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-            {
-                textures.push_back(textures_loaded[j]);
-                skip = true; 
-                break;
-            }
-        }
-        if(!skip)
-        {   // if texture hasn't been loaded already, load it
-            Texture texture;
-            std::string filename = std::string(str.C_Str());
-            
-            // Use filesystem to properly join paths (handles mixed separators)
-            std::filesystem::path texturePath = std::filesystem::path(directory) / filename;
-            std::string fullPath = texturePath.string();
-            
-            // We use the existing Texture loading utility
-            texture.id = loadTexture2D(fullPath.c_str()); 
-            
-            texture.type = typeName;
-            texture.path = str.C_Str();
-            textures.push_back(texture);
-            textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
-        }
+        requests.push_back({typeName, str.C_Str()});
     }
-    return textures;
 }
@@ -1,42 +1,60 @@
 #include "texture.hpp"
 
 #include <glad/glad.h>
+#include <cmath>
 #include <iostream>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
-unsigned int loadTexture2D(const std::filesystem::path &path)
+void DecodedImage::Free::operator()(unsigned char *pixels) const
 {
+    stbi_image_free(pixels);
+}
+
+DecodedImage decodeImage(const std::filesystem::path &path, bool flip)
+{
+    // The per-thread flag: decodes run on the loader's workers at the same time
+    stbi_set_flip_vertically_on_load_thread(flip ? 1 : 0);
+    DecodedImage image;
+    image.pixels.reset(stbi_load(path.string().c_str(), &image.width, &image.height, &image.channels, 0));
+    return image;
+}
+
+unsigned int loadTexture2D(const std::filesystem::path &path, bool srgb)
+{
+    const DecodedImage image = decodeImage(path, true);
+    if (!image.valid())
+    {
+        std::cerr << "Failed to load texture: " << path << '\n';
+        return 0;
+    }
+
     unsigned int texId = 0;
     glGenTextures(1, &texId);
-    glBindTexture(GL_TEXTURE_2D, texId);
+    uploadTexture2D(texId, image, srgb);
+    return texId;
+}
+
+void uploadTexture2D(unsigned int texture, const DecodedImage &image, bool srgb)
+{
+    glBindTexture(GL_TEXTURE_2D, texture);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    stbi_set_flip_vertically_on_load(true);
-    int width = 0;
-    int height = 0;
-    int channels = 0;
-    unsigned char *data = stbi_load(path.string().c_str(), &width, &height, &channels, 0);
-    if (!data)
-    {
-        std::cerr << "Failed to load texture: " << path << '\n';
-        return 0;
-    }
-
-    const GLenum format = (channels == 4) ? GL_RGBA : GL_RGB;
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+    const GLenum format = (image.channels == 4) ? GL_RGBA : GL_RGB;
+    GLenum internalFormat = format;
+    if (srgb)
+        internalFormat = (image.channels == 4) ? GL_SRGB8_ALPHA8 : GL_SRGB8;
+    glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(internalFormat), image.width, image.height, 0, format,
+                 GL_UNSIGNED_BYTE, image.pixels.get());
     glGenerateMipmap(GL_TEXTURE_2D);
-
-    stbi_image_free(data);
-    return texId;
 }
 
-unsigned int createTextureFromData(int width, int height, const unsigned char *data)
+unsigned int createTextureFromData(int width, int height, const unsigned char *data, bool srgb)
 {
     unsigned int texId = 0;
     glGenTextures(1, &texId);
@@ -47,41 +65,107 @@ unsigned int createTextureFromData(int width, int height, const unsigned char *d
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    const GLint internalFormat = srgb ? GL_SRGB8_ALPHA8 : GL_RGBA;
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
 
     // No mipmaps needed for a palette texture usually, and small size
 
     return texId;
 }
 
+std::string solidColorKey(const unsigned char rgba[4])
+{
+    static const char kHex[] = "0123456789abcdef";
+    std::string key = "#";
+    for (int i = 0; i < 4; i++)
+    {
+        key += kHex[rgba[i] >> 4];
+        key += kHex[rgba[i] & 15];
+    }
+    return key;
+}
+
+bool parseSolidColorKey(const std::string &key, unsigned char rgba[4])
+{
+    if (key.size() != 9 || key[0] != '#')
+        return false;
+    for (int i = 0; i < 4; i++)
+    {
+        int value = 0;
+        for (int k = 0; k < 2; k++)
+        {
+            const char c = key[1 + i * 2 + k];
+            int digit = -1;
+            if (c >= '0' && c <= '9')
+                digit = c - '0';
+            else if (c >= 'a' && c <= 'f')
+                digit = c - 'a' + 10;
+            if (digit < 0)
+                return false;
+            value = value * 16 + digit;
+        }
+        rgba[i] = static_cast<unsigned char>(value);
+    }
+    return true;
+}
+
 unsigned int loadSkyboxTexture(const std::filesystem::path &path)
 {
+    const DecodedImage image = decodeImage(path, false);
+    if (!image.valid())
+    {
+        std::cerr << "Failed to load skybox texture: " << path << '\n';
+        return 0;
+    }
+
     unsigned int texId = 0;
     glGenTextures(1, &texId);
-    glBindTexture(GL_TEXTURE_2D, texId);
+    uploadSkyboxTexture(texId, image);
+    return texId;
+}
+
+void uploadSkyboxTexture(unsigned int texture, const DecodedImage &image)
+{
+    glBindTexture(GL_TEXTURE_2D, texture);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    stbi_set_flip_vertically_on_load(false);
-    int width = 0;
-    int height = 0;
+    // The HDRI is stored tonemapped in sRGB; decode to linear for the HDR pipeline
+    const GLenum format = (image.channels == 4) ? GL_RGBA : GL_RGB;
+    const GLenum internalFormat = (image.channels == 4) ? GL_SRGB8_ALPHA8 : GL_SRGB8;
+    glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(internalFormat), image.width, image.height, 0, format,
+                 GL_UNSIGNED_BYTE, image.pixels.get());
+
+    // Disable mipmaps for skybox
+    // glGenerateMipmap(GL_TEXTURE_2D);
+}
+
+std::vector<float> loadImageLinear(const std::filesystem::path &path, int &width, int &height)
+{
+    stbi_set_flip_vertically_on_load_thread(0);
     int channels = 0;
-    unsigned char *data = stbi_load(path.string().c_str(), &width, &height, &channels, 0);
+    unsigned char *data = stbi_load(path.string().c_str(), &width, &height, &channels, 3);
     if (!data)
     {
-        std::cerr << "Failed to load skybox texture: " << path << '\n';
-        return 0;
+        std::cerr << "Failed to load image: " << path << '\n';
+        width = 0;
+        height = 0;
+        return {};
     }
 
-    const GLenum format = (channels == 4) ? GL_RGBA : GL_RGB;
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-
-    // Disable mipmaps for skybox
-    // glGenerateMipmap(GL_TEXTURE_2D);
+    float decode[256];
+    for (int i = 0; i < 256; i++)
+    {
+        const float c = static_cast<float>(i) / 255.0f;
+        decode[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+    std::vector<float> pixels(static_cast<std::size_t>(width) * height * 3);
+    for (std::size_t i = 0; i < pixels.size(); i++)
+        pixels[i] = decode[data[i]];
 
     stbi_image_free(data);
-    return texId;
+    return pixels;
 }
@@ -0,0 +1,100 @@
+#include "scene/camera_path.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+bool CameraPath::load(const std::filesystem::path &file)
+{
+    std::ifstream in(file);
+    if (!in)
+    {
+        std::cerr << "Failed to open camera path: " << file << '\n';
+        return false;
+    }
+
+    keys.clear();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line))
+    {
+        lineNumber++;
+        const std::size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#')
+            continue;
+        std::istringstream fields(line);
+        Key key;
+        if (!(fields >> key.time >> key.position.x >> key.position.y >> key.position.z >> key.yaw >> key.pitch) ||
+            (!keys.empty() && key.time <= keys.back().time))
+        {
+            std::cerr << file.filename().string() << ':' << lineNumber << ": skipped \"" << line << "\"\n";
+            continue;
+        }
+        keys.push_back(key);
+    }
+    if (empty())
+    {
+        std::cerr << "Camera path needs at least two keys: " << file << '\n';
+        return false;
+    }
+    return true;
+}
+
+std::size_t CameraPath::segment(float time, float &fraction) const
+{
+    time = glm::clamp(time, keys.front().time, keys.back().time);
+    std::size_t i = 0;
+    while (i + 2 < keys.size() && keys[i + 1].time <= time)
+        i++;
+    fraction = (time - keys[i].time) / (keys[i + 1].time - keys[i].time);
+    return i;
+}
+
+glm::vec3 CameraPath::position(float time) const
+{
+    if (keys.empty())
+        return glm::vec3(0.0f);
+    if (empty())
+        return keys.front().position;
+    float t = 0.0f;
+    const std::size_t i = segment(time, t);
+    // End keys are repeated so the spline still passes through them
+    const glm::vec3 &p0 = keys[i > 0 ? i - 1 : i].position;
+    const glm::vec3 &p1 = keys[i].position;
+    const glm::vec3 &p2 = keys[i + 1].position;
+    const glm::vec3 &p3 = keys[std::min(i + 2, keys.size() - 1)].position;
+    const float t2 = t * t;
+    const float t3 = t2 * t;
+    return 0.5f * (2.0f * p1 + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+                   (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+}
+
+glm::vec3 CameraPath::front(float time) const
+{
+    if (keys.empty())
+        return glm::vec3(0.0f, 0.0f, -1.0f);
+    float yaw = keys.front().yaw;
+    float pitch = keys.front().pitch;
+    if (!empty())
+    {
+        float t = 0.0f;
+        const std::size_t i = segment(time, t);
+        yaw = glm::mix(keys[i].yaw, keys[i + 1].yaw, t);
+        pitch = glm::mix(keys[i].pitch, keys[i + 1].pitch, t);
+    }
+    // Same convention as Camera::updateCameraVectors
+    return glm::normalize(glm::vec3(std::cos(glm::radians(yaw)) * std::cos(glm::radians(pitch)),
+                                    std::sin(glm::radians(pitch)),
+                                    std::sin(glm::radians(yaw)) * std::cos(glm::radians(pitch))));
+}
+
+glm::mat4 CameraPath::view(float time) const
+{
+    const glm::vec3 eye = position(time);
+    return glm::lookAt(eye, eye + front(time), glm::vec3(0.0f, 1.0f, 0.0f));
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Scripted fly-through for repeatable measurements (see
+// resource/camera_paths/city_flythrough.txt). Keys hold a time, a position
+// and Camera-style yaw/pitch in degrees; positions follow a Catmull-Rom
+// spline through the keys, angles are interpolated linearly.
+class CameraPath
+{
+public:
+    struct Key
+    {
+        float time = 0.0f; // seconds, increasing
+        glm::vec3 position{0.0f};
+        float yaw = -90.0f;
+        float pitch = 0.0f;
+    };
+
+    bool load(const std::filesystem::path &file);
+    bool empty() const { return keys.size() < 2; }
+    float duration() const { return keys.empty() ? 0.0f : keys.back().time; }
+
+    // Sampled at `time`, clamped to the path
+    glm::vec3 position(float time) const;
+    glm::vec3 front(float time) const;
+    glm::mat4 view(float time) const;
+
+private:
+    // Key before `time` and the fraction towards the next one
+    std::size_t segment(float time, float &fraction) const;
+
+    std::vector<Key> keys;
+};
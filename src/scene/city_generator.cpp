@@ -0,0 +1,142 @@
+#include "scene/city_generator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "core/random.hpp"
+
+namespace
+{
+    constexpr float kCurbInset = 0.6f; // lamps stand this far inside the road edge
+    constexpr float kLotFill = 0.85f;  // share of a lot a building may cover
+
+    // Per-block stream from the seed and the block's grid coordinates
+    std::mt19937 blockRng(unsigned int seed, int gx, int gz)
+    {
+        std::uint64_t h = 0x9e3779b97f4a7c15ull ^ seed;
+        for (std::uint64_t v : {static_cast<std::uint64_t>(static_cast<std::uint32_t>(gx)),
+                                static_cast<std::uint64_t>(static_cast<std::uint32_t>(gz))})
+        {
+            h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+            h *= 0xbf58476d1ce4e5b9ull;
+            h ^= h >> 31;
+        }
+        return std::mt19937(static_cast<std::mt19937::result_type>(h ^ (h >> 32)));
+    }
+
+    glm::mat4 quarterTurn(int turns)
+    {
+        return glm::rotate(glm::mat4(1.0f), glm::radians(90.0f * static_cast<float>(turns)), glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+}
+
+DistrictLayout generateDistrict(const CityGeneratorSettings &settings, const Aabb &cityBounds,
+                                const std::vector<DistrictBuildingSource> &buildings)
+{
+    DistrictLayout layout;
+    if (cityBounds.isEmpty())
+        return layout;
+
+    const int n = std::max(settings.blocksPerSide, 1);
+    const int lo = -(n / 2);
+    const int hi = n - 1 + lo;
+    const glm::vec3 extent = cityBounds.max - cityBounds.min;
+    const glm::vec3 center(0.5f * (cityBounds.min.x + cityBounds.max.x), 0.0f,
+                           0.5f * (cityBounds.min.z + cityBounds.max.z));
+    const float road = std::max(settings.roadWidth, 0.0f);
+    const float block = std::max(extent.x, extent.z);
+    layout.blocks = n * n;
+    layout.blockSize = block;
+    layout.pitch = block + road;
+    layout.center = center;
+
+    const int lots = std::max(settings.lotsPerSide, 1);
+    const float lotSize = block / static_cast<float>(lots);
+    for (int gz = lo; gz <= hi; gz++)
+    {
+        for (int gx = lo; gx <= hi; gx++)
+        {
+            const glm::vec3 blockCenter = layout.blockOrigin(glm::ivec2(gx, gz));
+            std::mt19937 rng = blockRng(settings.seed, gx, gz);
+            if (settings.mode == DistrictMode::TileCity)
+            {
+                if (gx == 0 && gz == 0)
+                    continue; // the imported city itself
+                const int turns = settings.rotateBlocks ? static_cast<int>(rng() % 4u) : 0;
+                DistrictTile tile;
+                tile.cell = glm::ivec2(gx, gz);
+                tile.origin = blockCenter;
+                tile.local = quarterTurn(turns) * glm::translate(glm::mat4(1.0f), -center);
+                layout.tiles.push_back(tile);
+                continue;
+            }
+
+            if (buildings.empty())
+                continue;
+            for (int lz = 0; lz < lots; lz++)
+            {
+                for (int lx = 0; lx < lots; lx++)
+                {
+                    // Every lot draws the same numbers, built on or not
+                    const bool empty = unitFloat(rng) < settings.emptyLotChance;
+                    const int source = uniformIndex(rng, static_cast<int>(buildings.size()));
+                    const int turns = settings.rotateBlocks ? static_cast<int>(rng() % 4u) : 0;
+                    const float jitter = 1.0f + settings.scaleJitter * (2.0f * unitFloat(rng) - 1.0f);
+                    if (empty)
+                        continue;
+
+                    const DistrictBuildingSource &building = buildings[source];
+                    const glm::vec3 size = building.bounds.max - building.bounds.min;
+                    const float footprint = std::max(std::max(size.x, size.z), 1e-3f);
+                    const float scale = std::min(jitter, lotSize * kLotFill / footprint);
+                    const glm::vec3 base(0.5f * (building.bounds.min.x + building.bounds.max.x), building.bounds.min.y,
+                                         0.5f * (building.bounds.min.z + building.bounds.max.z));
+                    const glm::vec3 lot((static_cast<float>(lx) + 0.5f) * lotSize - 0.5f * block, 0.0f,
+                                        (static_cast<float>(lz) + 0.5f) * lotSize - 0.5f * block);
+                    DistrictBuilding placed;
+                    placed.source = source;
+                    placed.cell = glm::ivec2(gx, gz);
+                    placed.local = glm::translate(glm::mat4(1.0f), lot) * quarterTurn(turns) *
+                                   glm::scale(glm::mat4(1.0f), glm::vec3(scale)) *
+                                   glm::translate(glm::mat4(1.0f), -base) * building.orientation;
+                    placed.world = glm::translate(glm::mat4(1.0f), blockCenter) * placed.local;
+                    layout.buildings.push_back(placed);
+                }
+            }
+        }
+    }
+
+    // Roads run between all blocks and around the grid; lamps line both
+    // sides of every road along each block, none on the crossings
+    const int lampsPerBlock =
+        std::max(1, static_cast<int>(block / std::max(settings.lampSpacing, 1.0f)));
+    const float side = std::max(0.5f * road - kCurbInset, 0.0f);
+    for (int line = lo - 1; line <= hi; line++)
+    {
+        const float across = (static_cast<float>(line) + 0.5f) * layout.pitch;
+        for (int g = lo; g <= hi; g++)
+        {
+            for (int k = 0; k < lampsPerBlock; k++)
+            {
+                const float along = static_cast<float>(g) * layout.pitch - 0.5f * block +
+                                    (static_cast<float>(k) + 0.5f) * block / static_cast<float>(lampsPerBlock);
+                // Roads along z, then along x; each lamp faces the road
+                layout.lamps.emplace_back(center.x + across - side, 0.0f, center.z + along, 90.0f);
+                layout.lamps.emplace_back(center.x + across + side, 0.0f, center.z + along, -90.0f);
+                layout.lamps.emplace_back(center.x + along, 0.0f, center.z + across - side, 0.0f);
+                layout.lamps.emplace_back(center.x + along, 0.0f, center.z + across + side, 180.0f);
+            }
+        }
+    }
+
+    const float reach = 0.5f * block + road;
+    layout.bounds = Aabb{center + glm::vec3(static_cast<float>(lo) * layout.pitch - reach, 0.0f,
+                                            static_cast<float>(lo) * layout.pitch - reach),
+                         center + glm::vec3(static_cast<float>(hi) * layout.pitch + reach, 0.0f,
+                                            static_cast<float>(hi) * layout.pitch + reach)};
+    return layout;
+}
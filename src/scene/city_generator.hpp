@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "render/frustum.hpp"
+
+enum class DistrictMode
+{
+    TileCity,         // every block is a copy of the imported city
+    PermuteBuildings, // every block is a grid of lots, each holding one of the city's building meshes
+};
+
+struct CityGeneratorSettings
+{
+    bool enabled = false; // off: the imported city as authored
+    DistrictMode mode = DistrictMode::TileCity;
+    int blocksPerSide = 4;      // N x N blocks
+    float roadWidth = 8.0f;     // between blocks, world units
+    bool rotateBlocks = true;   // quarter turns per block (tiles) or per lot (buildings)
+    int lotsPerSide = 2;        // PermuteBuildings: lots along a block side
+    int buildingPool = 16;      // PermuteBuildings: tallest distinct meshes to pick from
+    float scaleJitter = 0.15f;  // PermuteBuildings: +- relative building scale
+    float emptyLotChance = 0.1f; // PermuteBuildings: lots left open as plazas
+    float lampSpacing = 12.0f;  // street lamps along both sides of every road
+    unsigned int seed = 1u;
+};
+
+// A building mesh for the permuted blocks, as first placed in the imported city
+struct DistrictBuildingSource
+{
+    int mesh = -1;
+    glm::mat4 orientation{1.0f}; // world rotation and scale of that placement
+    Aabb bounds;                 // mesh bounds under `orientation`
+};
+
+// A rotated copy of the imported city; world = translate(origin) * local
+struct DistrictTile
+{
+    glm::ivec2 cell{0};
+    glm::vec3 origin{0.0f}; // block center on the ground
+    glm::mat4 local{1.0f};
+};
+
+struct DistrictBuilding
+{
+    int source = 0; // into the building sources
+    glm::ivec2 cell{0};
+    glm::mat4 local{1.0f}; // relative to its block's center, blockOrigin(cell)
+    glm::mat4 world{1.0f};
+};
+
+// Blocks on a square grid around the imported city's block (grid cell 0, 0),
+// separated by roads; all positions in world space
+struct DistrictLayout
+{
+    int blocks = 0;
+    float blockSize = 0.0f; // square footprint; the city's larger side
+    float pitch = 0.0f;     // block + road
+    glm::vec3 center{0.0f}; // center of block (0, 0) on the ground
+    std::vector<DistrictTile> tiles;         // TileCity: the copies (the authored block is not listed)
+    std::vector<DistrictBuilding> buildings; // PermuteBuildings
+    std::vector<glm::vec4> lamps;            // position, yaw in degrees
+    Aabb bounds;                             // footprint of blocks and outer roads, at y = 0
+
+    glm::vec3 blockOrigin(const glm::ivec2 &cell) const
+    {
+        return center + glm::vec3(static_cast<float>(cell.x), 0.0f, static_cast<float>(cell.y)) * pitch;
+    }
+};
+
+// Deterministic: a block's content depends only on the seed and its grid
+// coordinates, so blocks keep their layout as the grid grows and benchmarks
+// repeat exactly
+DistrictLayout generateDistrict(const CityGeneratorSettings &settings, const Aabb &cityBounds,
+                                const std::vector<DistrictBuildingSource> &buildings);
@@ -0,0 +1,336 @@
+#include "scene/city_loader.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <iterator>
+#include <utility>
+
+namespace
+{
+    constexpr unsigned int kMaxDecodeThreads = 4;
+    constexpr unsigned int kMinDecodeThreads = 2; // the import holds one for its whole run
+
+    // 1x1 content until the image is decoded: neutral for every sampler
+    const unsigned char kPlaceholderDiffuse[4] = {128, 128, 128, 255};
+    const unsigned char kPlaceholderNormal[4] = {128, 128, 255, 255};
+    const unsigned char kPlaceholderBlack[4] = {0, 0, 0, 255};
+
+    float millisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+// Runs on the import's worker: every event goes out as soon as it is known
+class CityLoader::Sink : public ModelImportSink
+{
+public:
+    explicit Sink(CityLoader &target) : loader(target), start(std::chrono::steady_clock::now()) {}
+
+    void onNodes(TransformHierarchy tree, const std::string &directory, int sourceMeshes) override
+    {
+        fileDirectory = directory;
+        Event event;
+        event.kind = Event::Kind::Nodes;
+        event.nodes = std::move(tree);
+        event.directory = directory;
+        event.count = sourceMeshes;
+        loader.pushEvent(std::move(event));
+    }
+    void onMesh(ImportedMesh mesh) override
+    {
+        unsigned char color[4];
+        for (const TextureRequest &request : mesh.textures)
+        {
+            // Solid colors are made on the GL thread, nothing to decode
+            if (!parseSolidColorKey(request.path, color))
+                loader.requestTexture(fileDirectory, request.path, request.type);
+        }
+        Event event;
+        event.kind = Event::Kind::Mesh;
+        event.mesh = std::move(mesh);
+        loader.pushEvent(std::move(event));
+    }
+    void onPlacements(int mesh, std::vector<Model::Placement> placements) override
+    {
+        Event event;
+        event.kind = Event::Kind::Placements;
+        event.count = mesh;
+        event.placements = std::move(placements);
+        loader.pushEvent(std::move(event));
+    }
+    void onFinished(const ModelImportStats &stats) override
+    {
+        Event event;
+        event.kind = Event::Kind::Finished;
+        event.importStats = stats;
+        event.importMs = millisecondsSince(start);
+        loader.pushEvent(std::move(event));
+    }
+    // A shutdown waits only for the batch in progress
+    bool cancelled() const override
+    {
+        std::lock_guard<std::mutex> lock(loader.mutex);
+        return loader.stopping;
+    }
+
+private:
+    CityLoader &loader;
+    std::chrono::steady_clock::time_point start;
+    std::string fileDirectory;
+};
+
+CityLoader::~CityLoader()
+{
+    shutdown();
+}
+
+void CityLoader::start(const std::filesystem::path &modelPath, const std::filesystem::path &skyPath, bool srgbTextures,
+                       const CityLoadSettings &settings)
+{
+    shutdown();
+    srgb = srgbTextures;
+    loadStats = Stats{};
+    decodesOutstanding = 1;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = false;
+        decodesQueued = 1; // the sky
+    }
+
+    unsigned int threads = settings.decodeThreads;
+    if (threads == 0)
+    {
+        const unsigned int hardware = std::thread::hardware_concurrency();
+        threads = std::clamp(hardware > 1 ? hardware - 1 : 1u, kMinDecodeThreads, kMaxDecodeThreads);
+    }
+    for (unsigned int i = 0; i < threads; i++)
+        workers.emplace_back(&CityLoader::workerLoop, this);
+
+    // The two roots of the graph; texture decodes are queued by the import
+    const std::string modelFile = modelPath.string();
+    ModelImportOptions importOptions;
+    importOptions.threads = settings.importThreads;
+    submit([this, modelFile, importOptions]() {
+        Sink sink(*this);
+        if (!Model::importFile(modelFile, sink, importOptions) && !sink.cancelled())
+            sink.onFinished(ModelImportStats{}); // an empty city, as the synchronous load leaves it
+    });
+    submit([this, skyPath]() {
+        const auto start = std::chrono::steady_clock::now();
+        Decoded sky;
+        sky.image = decodeImage(skyPath, false);
+        sky.decodeMs = millisecondsSince(start);
+        if (!sky.image.valid())
+            std::cerr << "Failed to load skybox texture: " << skyPath << '\n';
+        std::lock_guard<std::mutex> lock(mutex);
+        decoded.push_back(std::move(sky));
+        decodesQueued--;
+    });
+}
+
+void CityLoader::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        jobs.clear();
+    }
+    wakeWorkers.notify_all();
+    for (std::thread &worker : workers)
+        worker.join();
+    workers.clear();
+    jobs.clear(); // decodes a running import queued after the stop
+    workerEvents.clear();
+    decoded.clear();
+    requestedTextures.clear();
+    events.clear();
+    images.clear();
+    // The names belong to the model's meshes now
+    textureNames.clear();
+}
+
+void CityLoader::submit(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    wakeWorkers.notify_one();
+}
+
+void CityLoader::workerLoop()
+{
+    for (;;)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeWorkers.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (stopping)
+                return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
+
+void CityLoader::pushEvent(Event event)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    workerEvents.push_back(std::move(event));
+}
+
+void CityLoader::requestTexture(const std::string &directory, const std::string &path, const std::string &type)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!requestedTextures.emplace(path, type).second)
+            return;
+        decodesQueued++;
+    }
+    // Use filesystem to properly join paths (handles mixed separators)
+    const std::filesystem::path file = std::filesystem::path(directory) / path;
+    submit([this, file, path, type]() {
+        const auto start = std::chrono::steady_clock::now();
+        Decoded texture;
+        texture.path = path;
+        texture.type = type;
+        texture.image = decodeImage(file, true);
+        texture.decodeMs = millisecondsSince(start);
+        if (!texture.image.valid())
+            std::cerr << "Failed to load texture: " << file << '\n';
+        std::lock_guard<std::mutex> lock(mutex);
+        decoded.push_back(std::move(texture));
+        decodesQueued--;
+    });
+}
+
+unsigned int CityLoader::textureName(const std::string &path, const std::string &type)
+{
+    const auto found = textureNames.find({path, type});
+    if (found != textureNames.end())
+        return found->second;
+    unsigned char color[4];
+    if (parseSolidColorKey(path, color))
+    {
+        const unsigned int name = createTextureFromData(1, 1, color);
+        textureNames.emplace(std::make_pair(path, type), name);
+        return name;
+    }
+    const unsigned char *content = kPlaceholderBlack;
+    if (type == "texture_diffuse")
+        content = kPlaceholderDiffuse;
+    else if (type == "texture_normal")
+        content = kPlaceholderNormal;
+    const unsigned int name = createTextureFromData(1, 1, content, srgb && content == kPlaceholderDiffuse);
+    textureNames.emplace(std::make_pair(path, type), name);
+    return name;
+}
+
+bool CityLoader::pump(Model &model, Skybox &skybox, float budgetMs)
+{
+    const auto start = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::move(workerEvents.begin(), workerEvents.end(), std::back_inserter(events));
+        workerEvents.clear();
+        std::move(decoded.begin(), decoded.end(), std::back_inserter(images));
+        decoded.clear();
+        decodesOutstanding = decodesQueued;
+        loadStats.texturesRequested = static_cast<int>(requestedTextures.size());
+    }
+
+    // One mesh and one image per round, so neither starves the other; at
+    // least one round per frame, however long it takes
+    bool placed = false;
+    do
+    {
+        if (!events.empty())
+        {
+            Event event = std::move(events.front());
+            events.pop_front();
+            switch (event.kind)
+            {
+            case Event::Kind::Nodes:
+                model.setNodes(std::move(event.nodes), event.directory);
+                // Mesh objects keep their address once uploaded (the meshes are referenced by index elsewhere)
+                model.meshes.reserve(static_cast<std::size_t>(event.count));
+                loadStats.meshesExpected = event.count;
+                break;
+            case Event::Kind::Mesh:
+            {
+                std::vector<Texture> textures;
+                for (const TextureRequest &request : event.mesh.textures)
+                {
+                    Texture texture;
+                    texture.id = textureName(request.path, request.type);
+                    texture.type = request.type;
+                    texture.path = request.path;
+                    textures.push_back(texture);
+                    const bool known = std::any_of(model.textures_loaded.begin(), model.textures_loaded.end(),
+                                                   [&](const Texture &loaded) { return loaded.path == texture.path; });
+                    if (!known)
+                        model.textures_loaded.push_back(texture);
+                }
+                model.addMesh(std::move(event.mesh), std::move(textures));
+                loadStats.meshesUploaded++;
+                placed = true;
+                break;
+            }
+            case Event::Kind::Placements:
+                model.addPlacements(event.count, event.placements);
+                placed = true;
+                break;
+            case Event::Kind::Finished:
+                model.importStats = event.importStats;
+                loadStats.importMs = event.importMs;
+                loadStats.meshesExpected = static_cast<int>(model.meshes.size());
+                loadStats.importDone = true;
+                break;
+            }
+        }
+        if (!images.empty())
+        {
+            Decoded image = std::move(images.front());
+            images.pop_front();
+            loadStats.decodeMs += image.decodeMs;
+            if (image.path.empty())
+            {
+                if (image.image.valid())
+                    skybox.setTexture(image.image);
+                loadStats.skyDone = true;
+            }
+            else if (image.image.valid())
+            {
+                // Replaces the placeholder; only color maps are sRGB, the others hold linear data
+                uploadTexture2D(textureName(image.path, image.type), image.image,
+                                srgb && image.type == "texture_diffuse");
+                loadStats.texturesUploaded++;
+            }
+            else
+            {
+                loadStats.texturesFailed++;
+            }
+        }
+    } while ((!events.empty() || !images.empty()) && millisecondsSince(start) < budgetMs);
+
+    loadStats.lastPumpMs = millisecondsSince(start);
+    loadStats.uploadMs += loadStats.lastPumpMs;
+    loadStats.pumps++;
+    return placed;
+}
+
+float CityLoader::progress() const
+{
+    const int meshes = std::max(loadStats.meshesExpected, loadStats.meshesUploaded);
+    const int total = meshes + loadStats.texturesRequested + 1;
+    const int done = loadStats.meshesUploaded + loadStats.texturesUploaded + loadStats.texturesFailed +
+                     (loadStats.skyDone ? 1 : 0);
+    // The import's node tree comes first; until then nothing is known
+    if (meshes == 0 && !loadStats.importDone)
+        return loadStats.skyDone ? 0.05f : 0.0f;
+    return std::min(static_cast<float>(done) / static_cast<float>(total), 1.0f);
+}
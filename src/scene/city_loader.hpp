@@ -0,0 +1,133 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "model.hpp"
+#include "skybox.hpp"
+#include "texture.hpp"
+
+struct CityLoadSettings
+{
+    float uploadBudgetMs = 4.0f; // GL thread time per frame for mesh and texture uploads
+    unsigned int decodeThreads = 0; // 0 = one per hardware thread minus the GL thread, at most 4 and at least 2
+    unsigned int importThreads = 0; // the import's per-mesh work (ModelImportOptions::threads)
+};
+
+// Progressive load of the city model and the sky image as a small job graph:
+// the model import and the sky decode start together on a worker pool; the
+// import hands every GPU mesh over as soon as it is merged and queues a
+// decode job for every texture path the first time a mesh names it. The GL
+// thread pumps the finished work once per frame under a time budget: meshes
+// are uploaded and placed (drawing with placeholder textures), decoded images
+// replace the placeholders' content in place, so the meshes holding a texture
+// name never change.
+class CityLoader
+{
+public:
+    struct Stats
+    {
+        int meshesExpected = 0; // referenced by the file until the import finishes, then GPU meshes
+        int meshesUploaded = 0;
+        int texturesRequested = 0;
+        int texturesUploaded = 0;
+        int texturesFailed = 0;
+        bool importDone = false;
+        bool skyDone = false;
+        float importMs = 0.0f;  // on its worker
+        float decodeMs = 0.0f;  // over all decode jobs
+        float uploadMs = 0.0f;  // GL thread, over all pumps
+        float lastPumpMs = 0.0f;
+        int pumps = 0;
+    };
+
+    CityLoader() = default;
+    ~CityLoader();
+    CityLoader(const CityLoader &) = delete;
+    CityLoader &operator=(const CityLoader &) = delete;
+
+    // `srgbTextures` as the model's gamma correction
+    void start(const std::filesystem::path &modelPath, const std::filesystem::path &skyPath, bool srgbTextures,
+               const CityLoadSettings &settings);
+    // GL thread, once per frame: applies finished work to the model (empty
+    // when started) and the sky; returns true when meshes or placements were added
+    bool pump(Model &model, Skybox &skybox, float budgetMs);
+    // Everything imported, decoded and uploaded
+    bool finished() const
+    {
+        return loadStats.importDone && loadStats.skyDone && decodesOutstanding == 0 && events.empty() && images.empty();
+    }
+    // 0-1 over the meshes, textures and the sky known so far
+    float progress() const;
+    // Waits for the workers (a running import finishes first); the jobs still queued are dropped
+    void shutdown();
+
+    const Stats &stats() const { return loadStats; }
+
+private:
+    struct Event
+    {
+        enum class Kind
+        {
+            Nodes,
+            Mesh,
+            Placements,
+            Finished,
+        };
+        Kind kind = Kind::Mesh;
+        TransformHierarchy nodes;
+        std::string directory;
+        int count = 0; // Nodes: meshes referenced; Placements: the mesh
+        ImportedMesh mesh;
+        std::vector<Model::Placement> placements;
+        ModelImportStats importStats;
+        float importMs = 0.0f;
+    };
+
+    struct Decoded
+    {
+        std::string path; // as the model names it; empty for the sky
+        std::string type; // the sampler it feeds, e.g. "texture_diffuse"
+        DecodedImage image;
+        float decodeMs = 0.0f;
+    };
+
+    class Sink;
+
+    void submit(std::function<void()> job);
+    void workerLoop();
+    void pushEvent(Event event);
+    void requestTexture(const std::string &directory, const std::string &path, const std::string &type);
+    // The texture's GL name per path and type, created with 1x1 placeholder
+    // content on first use (or the color itself, for a solid color key)
+    unsigned int textureName(const std::string &path, const std::string &type);
+
+    // Workers: jobs in, events and decoded images out
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wakeWorkers;
+    std::deque<std::function<void()>> jobs;
+    std::deque<Event> workerEvents;
+    std::deque<Decoded> decoded;
+    std::set<std::pair<std::string, std::string>> requestedTextures; // (path, type) a decode job was queued for
+    int decodesQueued = 0;                // queued or running, the sky's included
+    bool stopping = false;
+
+    // GL thread
+    std::deque<Event> events;    // taken from workerEvents, applied in order
+    std::deque<Decoded> images;  // taken from decoded, uploaded in any order
+    int decodesOutstanding = 1;  // decodesQueued as of the last pump
+    std::map<std::pair<std::string, std::string>, unsigned int> textureNames; // by (path, type)
+    bool srgb = false;
+    Stats loadStats;
+};
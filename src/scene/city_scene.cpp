@@ -2,26 +2,114 @@
 
 #include "city_scene.hpp"
 
+#include <algorithm>
 #include <array>
+#include <chrono>
 #include <cmath>
+#include <cstdint>
 #include <filesystem>
 #include <iostream>
+#include <map>
+#include <utility>
 #include <vector>
 
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "texture.hpp"
+#include "core/platform.hpp"
+
+namespace
+{
+    constexpr float kGroundHalfSize = 30.0f;  // ground quad of the authored city
+    constexpr int kLightmapPadding = 1;       // texels around every chart, filled by dilation
+    constexpr float kDefaultAlbedo = 0.5f;    // meshes without a diffuse texture
+    constexpr float kProbeGroundClearance = 0.5f; // world units
+    constexpr float kMaxAlbedo = 0.9f;
+    constexpr float kLampHeadEmission = 4.0f;
+    constexpr float kReportViewStep = 0.25f;  // seconds between camera path samples
+    constexpr std::array<float, 6> kReportChunkSizes = {4.0f, 8.0f, 16.0f, 32.0f, 64.0f, 128.0f};
+    // Pre-transformed copies beyond this stay unbatched (large generated districts)
+    constexpr std::size_t kMaxBatchedTriangles = 8000000;
+    const glm::vec3 kDistrictLampColor(0.08f, 0.08f, 0.09f); // as the lamps in placements.txt
+
+    // Atlas layout and the GPU memory one impostor takes at a few view resolutions
+    void printImpostorReport(const ImpostorAtlasData &atlas, float bakeMs)
+    {
+        std::cout << "[Impostors] " << atlas.layers() << " buildings, " << atlas.frames << "x" << atlas.frames
+                  << " views of " << atlas.resolution << " px";
+        if (bakeMs > 0.0f)
+            std::cout << ", baked in " << bakeMs << " ms";
+        else
+            std::cout << ", from cache";
+        std::cout << "; per impostor:";
+        for (int resolution : {32, 64, 128, 256})
+            std::cout << ' ' << resolution << " px " << impostorBytes(resolution, atlas.frames) / 1024 << " KB";
+        std::cout << std::endl;
+    }
+
+    // Mean reflectance of a mesh's diffuse texture, read back from its smallest mip
+    float averageAlbedo(const Mesh &mesh)
+    {
+        for (const Texture &texture : mesh.textures)
+        {
+            if (texture.type != "texture_diffuse" || texture.id == 0)
+                continue;
+            glBindTexture(GL_TEXTURE_2D, texture.id);
+            GLint width = 0;
+            GLint height = 0;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+            int level = 0;
+            while ((std::max(width, height) >> (level + 1)) > 0)
+                level++;
+            // Textures without a mip chain are averaged at full size
+            GLint levelWidth = 0;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &levelWidth);
+            if (levelWidth == 0)
+                level = 0;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &width);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &height);
+            if (width <= 0 || height <= 0)
+                continue;
+            GLint internalFormat = 0;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+            const bool srgb = internalFormat == GL_SRGB8 || internalFormat == GL_SRGB8_ALPHA8;
+
+            std::vector<float> texels(static_cast<std::size_t>(width) * height * 4);
+            glGetTexImage(GL_TEXTURE_2D, level, GL_RGBA, GL_FLOAT, texels.data());
+            glBindTexture(GL_TEXTURE_2D, 0);
+            // glGetTexImage returns sRGB texels undecoded
+            glm::vec3 sum(0.0f);
+            for (std::size_t i = 0; i < texels.size(); i += 4)
+            {
+                const glm::vec3 color(texels[i], texels[i + 1], texels[i + 2]);
+                sum += srgb ? glm::pow(color, glm::vec3(2.2f)) : color;
+            }
+            const glm::vec3 mean = sum / static_cast<float>(width * height);
+            return std::min(kMaxAlbedo, glm::dot(mean, glm::vec3(0.2126f, 0.7152f, 0.0722f)));
+        }
+        return kDefaultAlbedo;
+    }
+}
 
 bool CityScene::init()
 {
     const std::filesystem::path texRoot = std::filesystem::path(TEXTURE_DIR);
+    loadStart = std::chrono::steady_clock::now();
+    loadStats = LoadStats{};
 
-    // Load CITY glTF model
-    std::string cityModelPath = (texRoot / "CITY" / "scene.gltf").string();
-    cityModel = std::make_unique<Model>(cityModelPath);
+    // The city and the sky image load on the loader's workers; the scene
+    // draws meanwhile with what has arrived
+    cityModel = std::make_unique<Model>(true);  // sRGB textures for the linear HDR pipeline
+    cityModel->nodes.add(TransformHierarchy::kNoParent, cityModelMatrix()); // kRootNode
+    cityModel->nodes.update();
+    skybox = std::make_unique<Skybox>();
+    skybox->initPlaceholder();
+    cityLoader.start(cityModelPath(), skyImagePath(), cityModel->gammaCorrection, loadSettings);
+    loadStage = LoadStage::Streaming;
 
     // Create ground plane (large flat quad)
-    const float groundSize = 30.0f;
+    const float groundSize = kGroundHalfSize;
     std::vector<Vertex> groundVertices = {
         // positions                          normals              texcoords
         {{-groundSize, 0.0f, -groundSize}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f}},
@@ -33,7 +121,7 @@ bool CityScene::init()
     
     // Create a dark gray texture for the ground (asphalt-like color)
     unsigned char groundColor[4] = {35, 35, 40, 255};  // Dark gray with slight blue tint
-    unsigned int groundTexId = createTextureFromData(1, 1, groundColor);
+    unsigned int groundTexId = createTextureFromData(1, 1, groundColor, true);
     
     std::vector<Texture> groundTextures;
     Texture groundTex;
@@ -44,14 +132,147 @@ bool CityScene::init()
     
     groundPlane = std::make_unique<Mesh>(groundVertices, groundIndices, groundTextures);
 
-    skybox = std::make_unique<Skybox>();
-    bool skyboxLoaded = skybox->init(texRoot / "NightSkyHDRI003_1K" / "NightSkyHDRI003_4K_TONEMAPPED.jpg");
+    // The city hangs below one root node; per-node world bounds drive the culling
+    groundBounds = Aabb{groundPlane->boundsMin, groundPlane->boundsMax}.transformed(groundModelMatrix());
+    indexCityPlacements();
+
+    // Props first: their lamps place the street lights the bakes and particles use
+    streetProps = std::make_unique<StreetProps>();
+    if (streetProps->init(texRoot / "props" / "placements.txt"))
+    {
+        for (int slot = 0; slot < StreetProps::kLightSlots; slot++)
+        {
+            if (streetProps->hasLight(slot))
+                streetLampPositions[slot] = streetProps->lightPosition(slot);
+        }
+    }
+
+    cameraPath.load(texRoot / "camera_paths" / "city_flythrough.txt");
+    // Without GL 4.3 this stays empty and the city draws on the 3.3 path
+    gpuDriven.init(std::filesystem::path(SHADER_DIR));
+    if (!occlusionQueries.init(std::filesystem::path(SHADER_DIR)))
+        occlusionSettings.enabled = false;
+    // The atlas follows once the city is loaded
+    if (!skyline.init(std::filesystem::path(SHADER_DIR)))
+        impostorSettings.enabled = false;
+
+    return true;
+}
+
+void CityScene::updateLoading()
+{
+    switch (loadStage)
+    {
+    case LoadStage::Streaming:
+        if (cityLoader.pump(*cityModel, *skybox, loadSettings.uploadBudgetMs))
+        {
+            cityModel->nodes.update();
+            indexCityPlacements();
+        }
+        if (cityLoader.finished())
+        {
+            cityLoader.shutdown();
+            loadStage = LoadStage::Unwrap;
+        }
+        break;
+    case LoadStage::Unwrap:
+        recordAuthoredCity();
+        indexCityPlacements();
+        // Lightmap UVs are regenerated on every start (deterministic); the bake is cached
+        unwrapLightmap();
+        loadStage = LoadStage::Lightmap;
+        break;
+    case LoadStage::Lightmap:
+    {
+        LightmapData cachedLightmap;
+        if (lightmapAtlas.texelsPerUnit > 0.0f &&
+            cachedLightmap.load(lightmapCachePath(), lightmapCacheKey(buildLightmapInput(), lightmapSettings)))
+        {
+            lightmap.upload(cachedLightmap);
+        }
+        else
+        {
+            std::cout << "Lightmap cache missing or stale, baking in the background" << std::endl;
+            startLightmapBake();
+        }
+        loadStage = LoadStage::Impostors;
+        break;
+    }
+    case LoadStage::Impostors:
+        if (impostorSettings.enabled && !updateImpostors(false))
+            impostorSettings.enabled = false;
+        loadStage = LoadStage::Probes;
+        break;
+    case LoadStage::Probes:
+    {
+        // A few seconds on all cores; ambient stays constant until it lands
+        startProbeBake();
+        loadStage = LoadStage::Done;
+        loadStats.totalMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+        const CityLoader::Stats &loader = cityLoader.stats();
+        std::cout << "[Loading] City loaded in " << loadStats.totalMs << " ms (first frame after "
+                  << loadStats.firstFrameMs << " ms): " << loader.meshesUploaded << " GPU meshes, "
+                  << loader.texturesUploaded << " textures (" << loader.texturesFailed << " failed), import "
+                  << loader.importMs << " ms, decode " << loader.decodeMs << " ms on the workers, uploads "
+                  << loader.uploadMs << " ms over " << loader.pumps << " frames" << std::endl;
+        break;
+    }
+    case LoadStage::Done:
+        break;
+    }
+}
 
-    return skyboxLoaded;
+void CityScene::notifyFramePresented()
+{
+    if (loadStats.framePresented)
+        return;
+    loadStats.framePresented = true;
+    loadStats.firstFrameMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+    std::cout << "[Loading] First frame after " << loadStats.firstFrameMs << " ms" << std::endl;
+}
+
+float CityScene::loadProgress() const
+{
+    // The uploads take most of the wall time; the steps after them one frame each
+    constexpr float kStreamingShare = 0.9f;
+    const float steps = static_cast<float>(LoadStage::Done) - static_cast<float>(LoadStage::Unwrap);
+    if (loadStage == LoadStage::Streaming)
+        return kStreamingShare * cityLoader.progress();
+    const float step = static_cast<float>(loadStage) - static_cast<float>(LoadStage::Unwrap);
+    return kStreamingShare + (1.0f - kStreamingShare) * step / steps;
+}
+
+const char *CityScene::loadStageName() const
+{
+    switch (loadStage)
+    {
+    case LoadStage::Streaming:
+        return "Loading city meshes and textures";
+    case LoadStage::Unwrap:
+        return "Unwrapping lightmap UVs";
+    case LoadStage::Lightmap:
+        return "Loading the lightmap";
+    case LoadStage::Impostors:
+        return "Loading skyline impostors";
+    case LoadStage::Probes:
+        return "Starting the probe bake";
+    case LoadStage::Done:
+        break;
+    }
+    return "Done";
 }
 
 void CityScene::update(float dt, float /*timeSeconds*/)
 {
+    // Only moved subtrees are recomputed; instance streams follow moved placements
+    if (cityModel && cityReady() && cityModel->nodes.update() > 0)
+    {
+        uploadCityInstances();
+        if (batchSettings.enabled)
+            rebuildStaticBatches();
+        rebuildGpuDriven();
+    }
+
     spin += dt * 20.0f;
     if (spin > 360.0f)
     {
@@ -59,7 +280,904 @@ void CityScene::update(float dt, float /*timeSeconds*/)
     }
 }
 
+void CityScene::updateBakes()
+{
+    ProbeGridData probes;
+    if (probeBaker.poll(probes))
+        probeGrid.upload(probes);
+
+    LightmapData baked;
+    if (!lightmapBaker.poll(baked) || !lightmap.upload(baked))
+        return;
+    if (!baked.save(lightmapCachePath()))
+        std::cerr << "Failed to write lightmap cache: " << lightmapCachePath() << '\n';
+}
+
+bool CityScene::startLightmapBake()
+{
+    if (lightmapBaker.isBaking() || districtApplied)
+        return false;
+    if (lightmapAtlas.size != lightmapSettings.atlasSize || unwrappedTexelsPerUnit != lightmapSettings.texelsPerUnit)
+    {
+        // The current lightmap no longer matches the UVs
+        lightmap.shutdown();
+        unwrapLightmap();
+    }
+    if (lightmapAtlas.texelsPerUnit <= 0.0f)
+        return false;
+    return lightmapBaker.start(buildLightmapInput(), lightmapSettings);
+}
+
+bool CityScene::startProbeBake()
+{
+    if (probeBaker.isBaking() || districtApplied)
+        return false;
+    return probeBaker.start(buildProbeInput(), probeSettings);
+}
+
+bool CityScene::startProbeBenchmark()
+{
+    if (probeBaker.isBaking() || districtApplied)
+        return false;
+    return probeBaker.startBenchmark(buildProbeInput(), probeSettings);
+}
+
+std::vector<Mesh *> CityScene::staticMeshes(std::vector<glm::mat4> *modelMatrices) const
+{
+    std::vector<Mesh *> meshes;
+    if (groundPlane)
+    {
+        meshes.push_back(groundPlane.get());
+        if (modelMatrices)
+            modelMatrices->push_back(groundModelMatrix());
+    }
+    if (cityModel)
+    {
+        for (std::size_t i = 0; i < cityModel->meshes.size(); i++)
+        {
+            if (cityModel->placements[i].size() != 1)
+                continue;
+            meshes.push_back(&cityModel->meshes[i]);
+            if (modelMatrices)
+                modelMatrices->push_back(cityModel->placementWorld(cityModel->placements[i].front()));
+        }
+    }
+    return meshes;
+}
+
+std::vector<LightmapInstancedMesh> CityScene::instancedMeshes() const
+{
+    std::vector<LightmapInstancedMesh> instanced;
+    if (!cityModel)
+        return instanced;
+    for (std::size_t i = 0; i < cityModel->meshes.size(); i++)
+    {
+        if (cityModel->placements[i].size() < 2)
+            continue;
+        LightmapInstancedMesh entry;
+        entry.mesh = &cityModel->meshes[i];
+        for (const Model::Placement &placement : cityModel->placements[i])
+            entry.modelMatrices.push_back(cityModel->placementWorld(placement));
+        instanced.push_back(std::move(entry));
+    }
+    return instanced;
+}
+
+void CityScene::unwrapLightmap()
+{
+    std::vector<glm::mat4> modelMatrices;
+    const std::vector<Mesh *> meshes = staticMeshes(&modelMatrices);
+    lightmapInstances = instancedMeshes();
+    lightmapAtlas = packLightmapUvs(meshes, modelMatrices, lightmapInstances, lightmapSettings.atlasSize,
+                                    lightmapSettings.texelsPerUnit, kLightmapPadding);
+    unwrappedTexelsPerUnit = lightmapSettings.texelsPerUnit;
+    for (Mesh *mesh : meshes)
+        mesh->refreshBuffers();
+    if (lightmapAtlas.texelsPerUnit <= 0.0f)
+        std::cerr << "Lightmap charts do not fit a " << lightmapAtlas.size << " atlas" << std::endl;
+
+    for (LightmapInstancedMesh &instanced : lightmapInstances)
+        instanced.mesh->refreshBuffers();
+    uploadCityInstances();
+    // Batches and GPU draw records copy the lightmap UVs, so they follow every unwrap
+    rebuildStaticBatches();
+    rebuildGpuDriven();
+}
+
+void CityScene::uploadCityInstances()
+{
+    // One instance stream per merged mesh: its placements' current world
+    // matrices and their blocks in the lightmap atlas
+    instancedBounds.assign(lightmapInstances.size(), Aabb::empty());
+    for (std::size_t i = 0; i < cityModel->meshes.size(); i++)
+    {
+        const int group = cityInstanceGroup[i];
+        if (group < 0)
+            continue;
+        LightmapInstancedMesh &instanced = lightmapInstances[group];
+        const std::vector<Model::Placement> &meshPlacements = cityModel->placements[i];
+        std::vector<InstanceData> instances(meshPlacements.size());
+        for (std::size_t p = 0; p < instances.size(); p++)
+        {
+            instances[p].model = cityModel->placementWorld(meshPlacements[p]);
+            instanced.modelMatrices[p] = instances[p].model;
+            if (p < instanced.scaleOffsets.size())
+                instances[p].lightmapScaleOffset = instanced.scaleOffsets[p];
+            instancedBounds[group].expand(cityModel->placementBounds(static_cast<unsigned int>(i), meshPlacements[p]));
+        }
+        instanced.mesh->setInstances(instances);
+    }
+}
+
+std::vector<StaticBatchSource> CityScene::staticBatchSources() const
+{
+    std::vector<StaticBatchSource> sources;
+    if (!cityModel)
+        return sources;
+    for (std::size_t i = 0; i < cityModel->meshes.size(); i++)
+    {
+        const int group = cityInstanceGroup[i];
+        const std::vector<Model::Placement> &meshPlacements = cityModel->placements[i];
+        for (std::size_t p = 0; p < meshPlacements.size(); p++)
+        {
+            StaticBatchSource source;
+            source.mesh = &cityModel->meshes[i];
+            source.world = cityModel->placementWorld(meshPlacements[p]);
+            // Merged duplicates share UVs; each placement has its own atlas block
+            if (group >= 0 && p < lightmapInstances[group].scaleOffsets.size())
+                source.lightmapScaleOffset = lightmapInstances[group].scaleOffsets[p];
+            sources.push_back(source);
+        }
+    }
+    return sources;
+}
+
+void CityScene::rebuildStaticBatches()
+{
+    staticBatches.shutdown();
+    if (batchSettings.enabled && cityModel)
+    {
+        const std::vector<StaticBatchSource> sources = staticBatchSources();
+        std::size_t triangles = 0;
+        for (const StaticBatchSource &source : sources)
+            triangles += source.mesh->indices.size() / 3;
+        if (triangles <= kMaxBatchedTriangles)
+            staticBatches.build(sources, batchSettings.chunkSize);
+        else
+            std::cout << "[Batching] " << triangles << " triangles exceed the " << kMaxBatchedTriangles
+                      << " triangle limit, drawing unbatched" << std::endl;
+    }
+    rebuildHlod();
+    occlusionQueries.reset(0); // chunk ids no longer match
+}
+
+void CityScene::rebuildHlod()
+{
+    if (hlodSettings.enabled && !staticBatches.empty())
+        hlod.build(staticBatchSources(), staticBatches, hlodSettings);
+    else
+        hlod.shutdown();
+}
+
+void CityScene::loadCityModel()
+{
+    cityModel = std::make_unique<Model>(cityModelPath().string(), true);  // sRGB textures for the linear HDR pipeline
+    cityModel->nodes.setLocal(Model::kRootNode, cityModelMatrix());
+    recordAuthoredCity();
+}
+
+void CityScene::recordAuthoredCity()
+{
+    cityModel->nodes.update();
+    authoredPlacements = cityModel->placements;
+    authoredNodeCount = cityModel->nodes.size();
+    authoredBounds = cityModel->nodes.subtreeBounds(Model::kRootNode);
+}
+
+void CityScene::indexCityPlacements()
+{
+    cityInstanceGroup.assign(cityModel->meshes.size(), -1);
+    cityDrawables = 1;
+    int groups = 0;
+    for (std::size_t i = 0; i < cityModel->meshes.size(); i++)
+    {
+        const std::size_t placementCount = cityModel->placements[i].size();
+        if (placementCount > 1)
+            cityInstanceGroup[i] = groups++;
+        cityDrawables += placementCount > 1 ? 1 : static_cast<int>(placementCount);
+    }
+}
+
+std::vector<int> CityScene::tallestCityMeshes(int count) const
+{
+    // Ranked as authored, so generated districts do not change the pick
+    std::vector<std::pair<float, int>> ranked;
+    for (std::size_t i = 0; i < cityModel->meshes.size(); i++)
+    {
+        if (authoredPlacements[i].empty())
+            continue;
+        const Aabb bounds = cityModel->placementBounds(static_cast<unsigned int>(i), authoredPlacements[i].front());
+        ranked.emplace_back(bounds.max.y - bounds.min.y, static_cast<int>(i));
+    }
+    // Stable, so equal heights keep the model's order and cache keys hold
+    std::stable_sort(ranked.begin(), ranked.end(), [](const auto &a, const auto &b) { return a.first > b.first; });
+    ranked.resize(std::min(ranked.size(), static_cast<std::size_t>(std::max(count, 0))));
+    std::vector<int> meshes;
+    for (const auto &entry : ranked)
+        meshes.push_back(entry.second);
+    return meshes;
+}
+
+void CityScene::regenerateDistrict()
+{
+    if (!cityModel || isLoading())
+        return;
+    const auto start = std::chrono::steady_clock::now();
+
+    // Back to the imported city, then grow the district from it. The loader
+    // reads the meshes, so it stops before anything is unwrapped again.
+    worldStreamer.shutdown();
+    TransformHierarchy &nodes = cityModel->nodes;
+    nodes.truncate(authoredNodeCount);
+    cityModel->placements = authoredPlacements;
+    nodes.update();
+    districtApplied = false;
+    districtStats = DistrictStats{};
+    groundCenter = glm::vec2(0.0f);
+    groundScale = 1.0f;
+    std::vector<glm::vec4> lamps;
+    std::vector<StreamTileDesc> streamTiles;
+
+    if (districtSettings.enabled)
+    {
+        std::vector<DistrictBuildingSource> buildings;
+        for (int mesh : tallestCityMeshes(districtSettings.buildingPool))
+        {
+            DistrictBuildingSource source;
+            source.mesh = mesh;
+            source.orientation = cityModel->placementWorld(authoredPlacements[mesh].front());
+            source.orientation[3] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+            source.bounds = Aabb{cityModel->meshes[mesh].boundsMin, cityModel->meshes[mesh].boundsMax}.transformed(
+                source.orientation);
+            buildings.push_back(source);
+        }
+        const DistrictLayout layout = generateDistrict(districtSettings, authoredBounds, buildings);
+
+        // Generated nodes hang flat below the root, so their locals undo its
+        // transform; streamed blocks become tiles instead of nodes
+        const glm::mat4 rootInverse = glm::inverse(nodes.world(Model::kRootNode));
+        const bool streamed = streamingSettings.enabled;
+        if (streamed && districtSettings.mode == DistrictMode::TileCity)
+        {
+            for (const DistrictTile &districtTile : layout.tiles)
+            {
+                StreamTileDesc desc;
+                desc.cell = districtTile.cell;
+                desc.origin = districtTile.origin;
+                for (std::size_t i = 0; i < cityModel->meshes.size(); i++)
+                {
+                    for (const Model::Placement &placement : authoredPlacements[i])
+                        desc.parts.push_back({static_cast<int>(i), districtTile.local * cityModel->placementWorld(placement)});
+                }
+                streamTiles.push_back(std::move(desc));
+            }
+        }
+        else if (streamed)
+        {
+            for (std::vector<Model::Placement> &meshPlacements : cityModel->placements)
+                meshPlacements.clear();
+            std::map<std::pair<int, int>, std::size_t> tileOfCell;
+            for (const DistrictBuilding &building : layout.buildings)
+            {
+                const auto [entry, added] = tileOfCell.try_emplace({building.cell.x, building.cell.y}, streamTiles.size());
+                if (added)
+                {
+                    StreamTileDesc desc;
+                    desc.cell = building.cell;
+                    desc.origin = layout.blockOrigin(building.cell);
+                    streamTiles.push_back(std::move(desc));
+                }
+                streamTiles[entry->second].parts.push_back({buildings[building.source].mesh, building.local});
+            }
+        }
+        else if (districtSettings.mode == DistrictMode::TileCity)
+        {
+            std::vector<int> copies(authoredNodeCount, -1);
+            for (const DistrictTile &districtTile : layout.tiles)
+            {
+                const glm::mat4 tile = glm::translate(glm::mat4(1.0f), districtTile.origin) * districtTile.local;
+                std::fill(copies.begin(), copies.end(), -1);
+                for (std::size_t i = 0; i < cityModel->meshes.size(); i++)
+                {
+                    for (const Model::Placement &placement : authoredPlacements[i])
+                    {
+                        int &copy = copies[placement.node];
+                        if (copy < 0)
+                        {
+                            copy = nodes.add(Model::kRootNode, rootInverse * tile * nodes.world(placement.node));
+                            nodes.setLocalBounds(copy, nodes.localBoundsOf(placement.node));
+                        }
+                        cityModel->placements[i].push_back({copy, placement.offset});
+                    }
+                }
+            }
+        }
+        else
+        {
+            for (std::vector<Model::Placement> &meshPlacements : cityModel->placements)
+                meshPlacements.clear();
+            for (const DistrictBuilding &building : layout.buildings)
+            {
+                const int mesh = buildings[building.source].mesh;
+                const int node = nodes.add(Model::kRootNode, rootInverse * building.world);
+                nodes.setLocalBounds(node, Aabb{cityModel->meshes[mesh].boundsMin, cityModel->meshes[mesh].boundsMax});
+                cityModel->placements[mesh].push_back({node, glm::vec3(0.0f)});
+            }
+        }
+        nodes.update();
+
+        lamps = layout.lamps;
+        const glm::vec3 groundExtent = layout.bounds.max - layout.bounds.min;
+        groundCenter = glm::vec2(0.5f * (layout.bounds.min.x + layout.bounds.max.x),
+                                 0.5f * (layout.bounds.min.z + layout.bounds.max.z));
+        groundScale = 0.5f * std::max(groundExtent.x, groundExtent.z) / kGroundHalfSize;
+        districtFootprint = layout.bounds;
+        districtApplied = true;
+        districtStats.blocks = layout.blocks;
+        districtStats.lamps = static_cast<int>(lamps.size());
+    }
+
+    groundBounds = Aabb{groundPlane->boundsMin, groundPlane->boundsMax}.transformed(groundModelMatrix());
+    indexCityPlacements();
+    if (districtApplied)
+    {
+        // The lightmap covers the authored city only: no unwrap, placements keep the UVs they have
+        lightmapInstances = instancedMeshes();
+        uploadCityInstances();
+        rebuildStaticBatches();
+        rebuildGpuDriven();
+    }
+    else
+    {
+        unwrapLightmap();
+    }
+    if (streetProps)
+        streetProps->setGeneratedInstances("lamp", lamps, kDistrictLampColor);
+    placeSkyline();
+
+    districtStats.nodes = static_cast<int>(nodes.size());
+    for (std::size_t i = 0; i < cityModel->meshes.size(); i++)
+    {
+        districtStats.placements += static_cast<int>(cityModel->placements[i].size());
+        districtStats.triangles += cityModel->placements[i].size() * (cityModel->meshes[i].indices.size() / 3);
+    }
+    districtStats.streamedTiles = static_cast<int>(streamTiles.size());
+    for (const StreamTileDesc &tile : streamTiles)
+    {
+        for (const StreamTilePart &part : tile.parts)
+            districtStats.triangles += cityModel->meshes[part.mesh].indices.size() / 3;
+    }
+    worldStreamer.setTiles(&cityModel->meshes, std::move(streamTiles), tileCachePath());
+    districtStats.generateMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (districtApplied)
+        std::cout << "[District] " << districtStats.blocks << " blocks (seed " << districtSettings.seed << "), "
+                  << districtStats.streamedTiles << " streamed tiles, "
+                  << districtStats.placements << " placements, " << districtStats.nodes << " nodes, "
+                  << districtStats.triangles << " triangles, " << districtStats.lamps << " lamps in "
+                  << districtStats.generateMs << " ms" << std::endl;
+}
+
+std::vector<ImpostorSource> CityScene::impostorSources() const
+{
+    // As first placed in the imported city
+    std::vector<ImpostorSource> sources;
+    for (int mesh : tallestCityMeshes(std::clamp(impostorSettings.buildings, 1, Skyline::kMaxLayers)))
+    {
+        ImpostorSource source;
+        source.mesh = &cityModel->meshes[mesh];
+        source.orientation = glm::mat3(cityModel->placementWorld(authoredPlacements[mesh].front()));
+        sources.push_back(source);
+    }
+    return sources;
+}
+
+bool CityScene::updateImpostors(bool rebake)
+{
+    if (!cityModel)
+        return false;
+    const std::vector<ImpostorSource> sources = impostorSources();
+    ImpostorAtlasData atlas;
+    float bakeMs = 0.0f;
+    if (rebake || !atlas.load(impostorCachePath(), impostorCacheKey(sources, impostorSettings)))
+    {
+        const auto start = std::chrono::steady_clock::now();
+        if (!bakeImpostors(sources, impostorSettings, std::filesystem::path(SHADER_DIR), atlas))
+        {
+            std::cerr << "Failed to bake impostors" << std::endl;
+            return false;
+        }
+        bakeMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (!atlas.save(impostorCachePath()))
+            std::cerr << "Failed to write impostor cache: " << impostorCachePath() << '\n';
+    }
+    if (!skyline.upload(atlas, bakeMs))
+        return false;
+    placeSkyline();
+    printImpostorReport(atlas, bakeMs);
+    return true;
+}
+
+void CityScene::placeSkyline()
+{
+    // The ring is centered on the city's footprint and moves out with a generated district's edge
+    const Aabb bounds = districtApplied ? districtFootprint
+                                        : (cityModel ? cityModel->nodes.subtreeBounds(Model::kRootNode) : groundBounds);
+    const glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+    ImpostorSettings ring = impostorSettings;
+    if (districtApplied)
+    {
+        const auto halfWidth = [](const Aabb &box) { return 0.5f * std::max(box.max.x - box.min.x, box.max.z - box.min.z); };
+        const float growth = std::max(halfWidth(bounds) - halfWidth(authoredBounds), 0.0f);
+        ring.innerRadius += growth;
+        ring.outerRadius += growth;
+    }
+    skyline.place(ring, glm::vec2(center.x, center.z));
+}
+
+bool CityScene::cookImpostors()
+{
+    loadCityModel();
+    ImpostorAtlasData atlas;
+    const auto start = std::chrono::steady_clock::now();
+    if (!bakeImpostors(impostorSources(), impostorSettings, std::filesystem::path(SHADER_DIR), atlas))
+        return false;
+    printImpostorReport(atlas,
+                        std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count());
+    if (!atlas.save(impostorCachePath()))
+    {
+        std::cerr << "Failed to write impostor cache: " << impostorCachePath() << '\n';
+        return false;
+    }
+    std::cout << "[Impostors] Wrote " << impostorCachePath().string() << std::endl;
+    return true;
+}
+
+bool CityScene::benchmarkImport(const ModelImportOptions &options)
+{
+    // Holds what a load holds once the meshes are uploaded: their CPU copies
+    class KeepingSink : public ModelImportSink
+    {
+    public:
+        void onNodes(TransformHierarchy tree, const std::string &, int sourceMeshes) override
+        {
+            nodes = std::move(tree);
+            meshes.reserve(static_cast<std::size_t>(sourceMeshes));
+        }
+        void onMesh(ImportedMesh mesh) override { meshes.push_back(std::move(mesh)); }
+        void onPlacements(int mesh, std::vector<Model::Placement> placements) override
+        {
+            meshes[mesh].placements.insert(meshes[mesh].placements.end(), placements.begin(), placements.end());
+        }
+        void onFinished(const ModelImportStats &stats) override { threads = stats.threads; }
+
+        TransformHierarchy nodes;
+        int threads = 0;
+        std::vector<ImportedMesh> meshes;
+    };
+
+    const std::size_t peakBefore = peakResidentBytes();
+    const auto start = std::chrono::steady_clock::now();
+    KeepingSink sink;
+    if (!Model::importFile(cityModelPath().string(), sink, options))
+        return false;
+    const float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    const double toMB = 1.0 / (1024.0 * 1024.0);
+    std::cout << "[Import] " << (options.nativeGltf ? "glTF reader" : "Assimp") << ": " << sink.meshes.size()
+              << " GPU meshes in " << ms << " ms on " << sink.threads << (sink.threads == 1 ? " thread" : " threads")
+              << ", peak resident " << static_cast<double>(peakResidentBytes()) * toMB << " MB ("
+              << static_cast<double>(peakBefore) * toMB << " MB before the import)" << std::endl;
+    return true;
+}
+
+void CityScene::updateStreaming(const glm::vec3 &cameraPosition, const glm::vec3 &cameraVelocity)
+{
+    worldStreamer.update(streamingSettings, cameraPosition, cameraVelocity);
+}
+
+std::filesystem::path CityScene::tileCachePath()
+{
+    return std::filesystem::path(TEXTURE_DIR) / "CITY" / "tiles";
+}
+
+std::filesystem::path CityScene::impostorCachePath()
+{
+    return std::filesystem::path(TEXTURE_DIR) / "CITY" / "impostors.cache";
+}
+
+void CityScene::rebuildGpuDriven()
+{
+    if (cityModel)
+        gpuDriven.build(staticBatchSources());
+}
+
+void CityScene::prepareFrame(const glm::mat4 &view, const glm::mat4 &projection)
+{
+    if (gpuDrivenActive())
+        gpuDriven.cull(projection * view, gpuDrivenSettings);
+    if (hlodActive())
+        hlod.select(glm::vec3(glm::inverse(view)[3]), projection, hlodSettings);
+    if (!occlusionQueriesActive())
+        return;
+    // Ids change meaning with the mode and the batch layout: start over then
+    const bool batched = batchSettings.enabled && !staticBatches.empty();
+    const int objects = occlusionObjectCount();
+    if (batched != occlusionBatched || objects != occlusionQueries.objectCount())
+    {
+        occlusionQueries.reset(objects);
+        occlusionBatched = batched;
+    }
+    occlusionQueries.beginFrame(occlusionSettings);
+}
+
+int CityScene::occlusionObjectCount() const
+{
+    if (batchSettings.enabled && !staticBatches.empty())
+        return staticBatches.chunkCount();
+    int objects = static_cast<int>(instancedBounds.size());
+    for (std::size_t i = 0; i < cityModel->meshes.size(); i++)
+    {
+        if (cityInstanceGroup[i] < 0)
+            objects += static_cast<int>(cityModel->placements[i].size());
+    }
+    return objects;
+}
+
+void CityScene::updateGpuOcclusion(const RenderTarget &scene, int renderWidth, int renderHeight,
+                                   const glm::mat4 &view, const glm::mat4 &projection)
+{
+    if (gpuDrivenActive() && gpuDrivenSettings.occlusionCulling)
+        gpuDriven.updateOcclusion(scene, renderWidth, renderHeight, projection * view);
+}
+
+bool CityScene::runStaticBatchReport(const glm::mat4 &projection)
+{
+    if (!cityModel || cameraPath.empty())
+        return false;
+
+    std::vector<Frustum> views;
+    for (float time = 0.0f; time <= cameraPath.duration(); time += kReportViewStep)
+        views.push_back(Frustum::fromMatrix(projection * cameraPath.view(time)));
+
+    // Reference: every triangle culled on its own, the least any scheme can submit
+    const std::vector<StaticBatchSource> sources = staticBatchSources();
+    std::vector<Aabb> triangleBounds;
+    for (const StaticBatchSource &source : sources)
+    {
+        const Mesh &mesh = *source.mesh;
+        for (std::size_t t = 0; t + 2 < mesh.indices.size(); t += 3)
+        {
+            Aabb bounds = Aabb::empty();
+            for (std::size_t corner = 0; corner < 3; corner++)
+            {
+                const glm::vec3 &local = mesh.vertices[mesh.indices[t + corner]].Position;
+                const glm::vec3 position = glm::vec3(source.world * glm::vec4(local, 1.0f));
+                bounds.expand(Aabb{position, position});
+            }
+            triangleBounds.push_back(bounds);
+        }
+    }
+    double referenceTriangles = 0.0;
+    for (const Frustum &view : views)
+    {
+        for (const Aabb &bounds : triangleBounds)
+            referenceTriangles += view.intersects(bounds) ? 1.0 : 0.0;
+    }
+
+    struct Row
+    {
+        float chunkSize = 0.0f; // 0: unbatched meshes
+        int chunks = 0;
+        int draws = 0;
+        double visibleDraws = 0.0;
+        int maxDraws = 0;
+        double triangles = 0.0;
+        float buildMs = 0.0f;
+        std::size_t gpuBytes = 0;
+    };
+    std::vector<Row> rows;
+
+    // Unbatched: the per-mesh draws drawGeometry issues
+    Row meshes;
+    meshes.draws = cityDrawables - 1;
+    const TransformHierarchy &nodes = cityModel->nodes;
+    for (const Frustum &view : views)
+    {
+        int draws = 0;
+        for (std::size_t i = 0; i < cityModel->meshes.size(); i++)
+        {
+            const std::size_t meshTriangles = cityModel->meshes[i].indices.size() / 3;
+            const int group = cityInstanceGroup[i];
+            if (group >= 0)
+            {
+                if (view.intersects(instancedBounds[group]))
+                {
+                    draws++;
+                    meshes.triangles += static_cast<double>(meshTriangles * cityModel->placements[i].size());
+                }
+                continue;
+            }
+            for (const Model::Placement &placement : cityModel->placements[i])
+            {
+                if (!view.intersects(nodes.worldBounds(placement.node)))
+                    continue;
+                draws++;
+                meshes.triangles += static_cast<double>(meshTriangles);
+            }
+        }
+        meshes.visibleDraws += draws;
+        meshes.maxDraws = std::max(meshes.maxDraws, draws);
+    }
+    rows.push_back(meshes);
+
+    for (float chunkSize : kReportChunkSizes)
+    {
+        staticBatches.build(sources, chunkSize);
+        Row row;
+        row.chunkSize = chunkSize;
+        row.chunks = staticBatches.stats().chunks;
+        row.draws = staticBatches.stats().batches;
+        row.buildMs = staticBatches.stats().buildMs;
+        row.gpuBytes = staticBatches.stats().gpuBytes;
+        for (const Frustum &view : views)
+        {
+            const StaticBatcher::Visibility visible = staticBatches.visibility(view);
+            row.visibleDraws += visible.draws;
+            row.maxDraws = std::max(row.maxDraws, visible.draws);
+            row.triangles += static_cast<double>(visible.triangles);
+        }
+        rows.push_back(row);
+    }
+    rebuildStaticBatches();
+
+    const double viewCount = static_cast<double>(views.size());
+    std::cout << "[Batches] Report: " << views.size() << " views along a " << cameraPath.duration()
+              << " s camera path, " << triangleBounds.size() << " city triangles, "
+              << referenceTriangles / viewCount / 1000.0 << "k visible per view with per-triangle culling\n";
+    for (const Row &row : rows)
+    {
+        const double efficiency = row.triangles > 0.0 ? 100.0 * referenceTriangles / row.triangles : 100.0;
+        if (row.chunkSize > 0.0f)
+            std::cout << "[Batches] chunk " << row.chunkSize << ": " << row.chunks << " chunks, ";
+        else
+            std::cout << "[Batches] per mesh: ";
+        std::cout << row.draws << " draws unculled, " << row.visibleDraws / viewCount << " avg / " << row.maxDraws
+                  << " max after culling, " << row.triangles / viewCount / 1000.0 << "k triangles submitted, "
+                  << efficiency << "% culling efficiency";
+        if (row.chunkSize > 0.0f)
+            std::cout << ", built in " << row.buildMs << " ms, "
+                      << static_cast<float>(row.gpuBytes) / (1024.0f * 1024.0f) << " MB";
+        std::cout << '\n';
+    }
+    std::cout << std::flush;
+    return true;
+}
+
+bool CityScene::runMeshletReport(const glm::mat4 &projection)
+{
+    if (!cityModel || cameraPath.empty())
+        return false;
+
+    // Every placement of every city mesh, whole meshes culled first as the
+    // unbatched path does; meshlets then trim the survivors
+    const std::vector<StaticBatchSource> sources = staticBatchSources();
+    std::vector<Aabb> sourceBounds;
+    std::size_t meshletCount = 0;
+    for (const StaticBatchSource &source : sources)
+    {
+        sourceBounds.push_back(Aabb{source.mesh->boundsMin, source.mesh->boundsMax}.transformed(source.world));
+        meshletCount += source.mesh->meshlets.count;
+    }
+
+    std::size_t views = 0;
+    double allTriangles = 0.0;
+    MeshletCullStats total;
+    MeshletCuller culler;
+    for (float time = 0.0f; time <= cameraPath.duration(); time += kReportViewStep)
+    {
+        const MeshletView view = MeshletView::fromMatrices(cameraPath.view(time), projection, meshletSettings.viewportHeight);
+        culler.begin(view, meshletSettings);
+        for (std::size_t i = 0; i < sources.size(); i++)
+        {
+            const std::size_t triangles = sources[i].mesh->indices.size() / 3;
+            allTriangles += static_cast<double>(triangles);
+            if (view.frustum.intersects(sourceBounds[i]))
+                culler.cull(sources[i].mesh->meshlets, sources[i].world);
+        }
+        total.add(culler.stats());
+        views++;
+    }
+
+    const double viewCount = static_cast<double>(views);
+    const auto percent = [](double part, double whole) { return whole > 0.0 ? 100.0 * part / whole : 0.0; };
+    const double tested = static_cast<double>(total.triangles);
+    const double rejected = static_cast<double>(total.trianglesRejected);
+    const double meshlets = static_cast<double>(total.meshlets);
+    std::cout << "[Meshlets] Report: " << views << " views along a " << cameraPath.duration() << " s camera path, "
+              << meshletCount << " meshlets over " << sources.size() << " placed meshes\n";
+    std::cout << "[Meshlets] Per view: " << allTriangles / viewCount / 1000.0 << "k triangles, "
+              << tested / viewCount / 1000.0 << "k in meshes inside the frustum, "
+              << (tested - rejected) / viewCount / 1000.0 << "k after meshlet culling, "
+              << total.cullMs / viewCount << " ms culling\n";
+    std::cout << "[Meshlets] Rejected " << percent(rejected, tested) << "% of the triangles in visible meshes ("
+              << percent(rejected + allTriangles - tested, allTriangles) << "% overall); meshlets rejected by frustum "
+              << percent(static_cast<double>(total.frustumRejected), meshlets) << "%, backfacing "
+              << percent(static_cast<double>(total.coneRejected), meshlets) << "%, small "
+              << percent(static_cast<double>(total.smallRejected), meshlets) << "%" << std::endl;
+    return true;
+}
+
+LightmapBakeInput CityScene::buildLightmapInput() const
+{
+    LightmapBakeInput input;
+    input.atlasSize = lightmapAtlas.size;
+    input.texelsPerUnit = lightmapAtlas.texelsPerUnit;
+    input.lampPositions = streetLampPositions;
+    input.lampAttenuation = glm::vec3(1.0f, kStreetLampLinear, kStreetLampQuadratic);
+
+    std::vector<glm::mat4> modelMatrices;
+    const std::vector<Mesh *> meshes = staticMeshes(&modelMatrices);
+    std::size_t triangleCount = 0;
+    for (const Mesh *mesh : meshes)
+        triangleCount += mesh->indices.size() / 3;
+    for (const LightmapInstancedMesh &instanced : lightmapInstances)
+        triangleCount += instanced.mesh->indices.size() / 3 * instanced.modelMatrices.size();
+    input.positions.reserve(triangleCount * 3);
+    input.normals.reserve(triangleCount * 3);
+    input.uvs.reserve(triangleCount * 3);
+    input.albedo.reserve(triangleCount);
+
+    for (std::size_t m = 0; m < meshes.size(); m++)
+    {
+        const Mesh &mesh = *meshes[m];
+        const glm::mat4 &model = modelMatrices[m];
+        const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+        const float albedo = averageAlbedo(mesh);
+        for (std::size_t i = 0; i < mesh.indices.size(); i++)
+        {
+            const Vertex &vertex = mesh.vertices[mesh.indices[i]];
+            input.positions.push_back(glm::vec3(model * glm::vec4(vertex.Position, 1.0f)));
+            const glm::vec3 normal = normalMatrix * vertex.Normal;
+            input.normals.push_back(glm::dot(normal, normal) > 0.0f ? glm::normalize(normal) : normal);
+            input.uvs.push_back(vertex.LightmapUV);
+        }
+        input.albedo.insert(input.albedo.end(), mesh.indices.size() / 3, albedo);
+    }
+
+    // Merged meshes once per placement, with the placement's block of the atlas
+    for (const LightmapInstancedMesh &instanced : lightmapInstances)
+    {
+        const Mesh &mesh = *instanced.mesh;
+        const float albedo = averageAlbedo(mesh);
+        for (std::size_t p = 0; p < instanced.modelMatrices.size(); p++)
+        {
+            const glm::mat4 &model = instanced.modelMatrices[p];
+            const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+            const glm::vec4 scaleOffset = p < instanced.scaleOffsets.size() ? instanced.scaleOffsets[p] : glm::vec4(0.0f);
+            for (std::size_t i = 0; i < mesh.indices.size(); i++)
+            {
+                const Vertex &vertex = mesh.vertices[mesh.indices[i]];
+                input.positions.push_back(glm::vec3(model * glm::vec4(vertex.Position, 1.0f)));
+                const glm::vec3 normal = normalMatrix * vertex.Normal;
+                input.normals.push_back(glm::dot(normal, normal) > 0.0f ? glm::normalize(normal) : normal);
+                input.uvs.push_back(vertex.LightmapUV * glm::vec2(scaleOffset) + glm::vec2(scaleOffset.z, scaleOffset.w));
+            }
+            input.albedo.insert(input.albedo.end(), mesh.indices.size() / 3, albedo);
+        }
+    }
+    return input;
+}
+
+std::filesystem::path CityScene::lightmapCachePath()
+{
+    return std::filesystem::path(TEXTURE_DIR) / "CITY" / "lightmap.cache";
+}
+
+std::filesystem::path CityScene::cityModelPath()
+{
+    return std::filesystem::path(TEXTURE_DIR) / "CITY" / "scene.gltf";
+}
+
+std::filesystem::path CityScene::skyImagePath()
+{
+    return std::filesystem::path(TEXTURE_DIR) / "NightSkyHDRI003_1K" / "NightSkyHDRI003_4K_TONEMAPPED.jpg";
+}
+
+ProbeBakeInput CityScene::buildProbeInput() const
+{
+    ProbeBakeInput input;
+    if (groundPlane)
+    {
+        Aabb bounds = groundBounds;
+        if (cityModel)
+            bounds.expand(cityModel->nodes.subtreeBounds(Model::kRootNode));
+        input.boundsMin = bounds.min;
+        input.boundsMax = bounds.max;
+        // The lowest layer floats above the ground instead of lying in it
+        input.boundsMin.y += kProbeGroundClearance;
+        input.boundsMax.y = std::max(input.boundsMax.y, input.boundsMin.y);
+    }
+
+    // Same flattened geometry and albedo as the lightmap bake, one front normal per triangle
+    LightmapBakeInput geometry = buildLightmapInput();
+    const std::size_t triangleCount = geometry.positions.size() / 3;
+    input.normals.resize(triangleCount);
+    for (std::size_t t = 0; t < triangleCount; t++)
+    {
+        const glm::vec3 *p = &geometry.positions[t * 3];
+        const glm::vec3 *n = &geometry.normals[t * 3];
+        const glm::vec3 vertexNormal = n[0] + n[1] + n[2];
+        const glm::vec3 faceNormal = glm::cross(p[1] - p[0], p[2] - p[0]);
+        const glm::vec3 normal = glm::dot(vertexNormal, vertexNormal) > 0.0f ? vertexNormal : faceNormal;
+        input.normals[t] = glm::dot(normal, normal) > 0.0f ? glm::normalize(normal) : glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+    input.positions = std::move(geometry.positions);
+    input.albedo = std::move(geometry.albedo);
+
+    // The 1K copy of the skybox image: same sky, fewer pixels to project
+    const std::vector<float> sky = loadImageLinear(std::filesystem::path(TEXTURE_DIR) / "NightSkyHDRI003_1K" / "NightSkyHDRI003_1K_TONEMAPPED.jpg",
+                                                   input.skyWidth, input.skyHeight);
+    input.skyRadiance.resize(sky.size() / 3);
+    for (std::size_t i = 0; i < input.skyRadiance.size(); i++)
+        input.skyRadiance[i] = glm::vec3(sky[i * 3], sky[i * 3 + 1], sky[i * 3 + 2]);
+    return input;
+}
+
 void CityScene::renderScene(Shader &shader, const glm::mat4 &view, const glm::mat4 &projection) const
+{
+    setLightingUniforms(shader, view, projection);
+    MeshletCuller *meshlets = nullptr;
+    if (meshletSettings.enabled)
+    {
+        meshletCuller.begin(MeshletView::fromMatrices(view, projection, meshletSettings.viewportHeight), meshletSettings);
+        meshlets = &meshletCuller;
+    }
+    const OcclusionView occlusion{projection * view, glm::vec3(glm::inverse(view)[3])};
+    const Frustum frustum = Frustum::fromMatrix(projection * view);
+    drawGeometry(shader, &frustum, meshlets, occlusionQueriesActive() ? &occlusion : nullptr, true);
+    // Streamed tiles and props are not in the lightmap; they take the probe ambient and per-pixel lamps
+    shader.setBool("lightmapEnabled", false);
+    worldStreamer.draw(shader, &frustum);
+    if (streetProps->settings.enabled)
+    {
+        streetProps->cull(frustum, streetLampEnabled);
+        streetProps->drawLit(shader);
+    }
+}
+
+int CityScene::renderSceneCulled(Shader &shader, const glm::mat4 &view, const glm::mat4 &projection,
+                                 const Frustum &cullFrustum) const
+{
+    setLightingUniforms(shader, view, projection);
+    // The mirrored camera sees the other side of things, so it gets its own pass
+    MeshletCuller reflectionMeshlets;
+    if (meshletSettings.enabled)
+    {
+        MeshletView meshletView = MeshletView::fromMatrices(view, projection, meshletSettings.viewportHeight);
+        meshletView.frustum = cullFrustum;
+        reflectionMeshlets.begin(meshletView, meshletSettings);
+    }
+    int drawn = drawGeometry(shader, &cullFrustum, meshletSettings.enabled ? &reflectionMeshlets : nullptr);
+    shader.setBool("lightmapEnabled", false);
+    drawn += worldStreamer.draw(shader, &cullFrustum);
+    if (streetProps->settings.enabled)
+    {
+        streetProps->cull(cullFrustum, streetLampEnabled);
+        streetProps->drawLit(shader);
+    }
+    return drawn;
+}
+
+void CityScene::setLightingUniforms(Shader &shader, const glm::mat4 &view, const glm::mat4 &projection) const
 {
     shader.use();
     shader.setInt("material.diffuse", 0);
@@ -76,22 +1194,10 @@ void CityScene::renderScene(Shader &shader, const glm::mat4 &view, const glm::ma
     // Directional light (Night/Moonlight) - cold blueish color
     shader.setVec3("dirLight.direction", moonDir);
     shader.setVec3("dirLight.ambient", 0.02f * moonIntensity, 0.02f * moonIntensity, 0.05f * moonIntensity);   // Very dark blueish ambient
-    shader.setVec3("dirLight.diffuse", 0.15f * moonIntensity, 0.15f * moonIntensity, 0.3f * moonIntensity);    // Cold blueish moonlight
+    shader.setVec3("dirLight.diffuse", getMoonColor());    // Cold blueish moonlight
     shader.setVec3("dirLight.specular", 0.3f * moonIntensity, 0.3f * moonIntensity, 0.4f * moonIntensity);     // Cold specular
 
     // Street lamp point lights (warm orange/yellow color)
-    // Positions along the main road in model space (scaled by 0.2)
-    const std::array<glm::vec3, 8> streetLampPositions = {{
-        glm::vec3(-8.0f, 3.5f, 15.0f),
-        glm::vec3(-8.0f, 3.5f, 5.0f),
-        glm::vec3(-8.0f, 3.5f, -5.0f),
-        glm::vec3(-8.0f, 3.5f, -15.0f),
-        glm::vec3(8.0f, 3.5f, 15.0f),
-        glm::vec3(8.0f, 3.5f, 5.0f),
-        glm::vec3(8.0f, 3.5f, -5.0f),
-        glm::vec3(8.0f, 3.5f, -15.0f),
-    }};
-
     // Count enabled lamps
     int enabledCount = 0;
     for (int i = 0; i < 8; i++) {
@@ -108,23 +1214,27 @@ void CityScene::renderScene(Shader &shader, const glm::mat4 &view, const glm::ma
         shader.setVec3(prefix + ".position", streetLampPositions[i]);
         // Warm street lamp color (orange-yellow)
         shader.setVec3(prefix + ".ambient", 0.1f, 0.07f, 0.02f);
-        shader.setVec3(prefix + ".diffuse", 1.0f, 0.7f, 0.3f);    // Warm orange
+        shader.setVec3(prefix + ".diffuse", streetLampColor);    // Warm orange
         shader.setVec3(prefix + ".specular", 1.0f, 0.8f, 0.5f);
         // Attenuation for ~50 unit range
         shader.setFloat(prefix + ".constant", 1.0f);
-        shader.setFloat(prefix + ".linear", 0.09f);
-        shader.setFloat(prefix + ".quadratic", 0.032f);
+        shader.setFloat(prefix + ".linear", kStreetLampLinear);
+        shader.setFloat(prefix + ".quadratic", kStreetLampQuadratic);
         lightIndex++;
     }
 
+    // Static meshes take the enabled lamps and the sky from the lightmap
+    lightmap.bindForShading(shader, streetLampEnabled, streetLampColor, lightmapSettings.enabled && !districtApplied);
+    probeGrid.bindForShading(shader, probeSettings.enabled);
+
     // Flashlight (spotlight from camera)
     shader.setBool("flashlightOn", flashlightOn);
     if (flashlightOn)
     {
         shader.setVec3("spotLight.position", flashlightPosition);
         shader.setVec3("spotLight.direction", flashlightDirection);
-        shader.setFloat("spotLight.cutOff", glm::cos(glm::radians(20.0f)));      // Inner cone: larger for wider bright area
-        shader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(35.0f))); // Outer cone: much larger for soft falloff
+        shader.setFloat("spotLight.cutOff", glm::cos(glm::radians(kFlashlightInnerAngle)));      // Inner cone: larger for wider bright area
+        shader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(kFlashlightOuterAngle))); // Outer cone: much larger for soft falloff
         shader.setVec3("spotLight.ambient", 0.05f, 0.05f, 0.05f);
         shader.setVec3("spotLight.diffuse", 1.0f, 1.0f, 0.9f);   // Warm white
         shader.setVec3("spotLight.specular", 1.0f, 1.0f, 1.0f);
@@ -138,14 +1248,62 @@ void CityScene::renderScene(Shader &shader, const glm::mat4 &view, const glm::ma
 
     shader.setMat4("view", view);
     shader.setMat4("projection", projection);
+}
+
+void CityScene::renderDepth(Shader &depthShader, const glm::mat4 &view, const glm::mat4 &projection) const
+{
+    depthShader.use();
+    depthShader.setMat4("view", view);
+    depthShader.setMat4("projection", projection);
+    // Same culling as the renderScene that follows, so its GL_LEQUAL test matches
+    MeshletCuller *meshlets = nullptr;
+    if (meshletSettings.enabled)
+    {
+        meshletCuller.begin(MeshletView::fromMatrices(view, projection, meshletSettings.viewportHeight), meshletSettings);
+        meshlets = &meshletCuller;
+    }
+    const OcclusionView occlusion{projection * view, glm::vec3(glm::inverse(view)[3])};
+    const Frustum frustum = Frustum::fromMatrix(projection * view);
+    drawGeometry(depthShader, &frustum, meshlets, occlusionQueriesActive() ? &occlusion : nullptr, true);
+    worldStreamer.draw(depthShader, &frustum);
+    if (streetProps->settings.enabled)
+    {
+        streetProps->cull(frustum, streetLampEnabled);
+        streetProps->drawDepth(depthShader);
+    }
+}
+
+void CityScene::renderEmissive(Shader &lampShader, const glm::mat4 &view, const glm::mat4 &projection) const
+{
+    if (!streetProps->settings.enabled)
+        return;
+    lampShader.use();
+    lampShader.setMat4("view", view);
+    lampShader.setMat4("projection", projection);
+    // Well above 1 so the lamp heads feed the bloom
+    lampShader.setVec3("lightColor", streetLampColor * kLampHeadEmission);
+    streetProps->drawEmissive(lampShader);
+}
+
+int CityScene::drawableCount() const
+{
+    if (batchSettings.enabled && !staticBatches.empty())
+        return 1 + staticBatches.stats().batches;
+    return cityDrawables;
+}
+
+int CityScene::drawGeometry(Shader &shader, const Frustum *cullFrustum, MeshletCuller *meshlets,
+                            const OcclusionView *occlusion, bool cameraView) const
+{
+    int drawn = 0;
+    const auto visible = [&](const Aabb &bounds) { return cullFrustum == nullptr || cullFrustum->intersects(bounds); };
 
     // Draw ground plane first
-    if (groundPlane)
+    if (groundPlane && visible(groundBounds))
     {
-        glm::mat4 groundModel = glm::mat4(1.0f);
-        groundModel = glm::translate(groundModel, glm::vec3(0.0f, -0.1f, 0.0f));  // Slightly below city
-        shader.setMat4("model", groundModel);
+        shader.setMat4("model", groundModelMatrix());
         groundPlane->Draw(shader);
+        drawn++;
     }
 
     // Draw CITY model
@@ -154,14 +1312,173 @@ void CityScene::renderScene(Shader &shader, const glm::mat4 &view, const glm::ma
         glActiveTexture(GL_TEXTURE1);
         glBindTexture(GL_TEXTURE_2D, 0);
 
-        // City model - grand cityscape
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));  // Fix orientation (Z-up to Y-up)
-        model = glm::scale(model, glm::vec3(0.2f));  // Large scale for grand cityscape
-        shader.setMat4("model", model);
-        cityModel->Draw(shader);
+        // GPU-driven: the commands the compute cull wrote for this frame's
+        // camera. Other views (the reflection) cull on the CPU below.
+        if (cameraView && gpuDrivenActive())
+            return drawn + gpuDriven.draw(shader);
+
+        // Occlusion queries: bounding boxes first, hidden objects conditionally
+        if (occlusion)
+            return drawn + drawOccluded(shader, meshlets, *occlusion);
+
+        // Static batches: one draw per (chunk, material), culled per chunk;
+        // distant blocks as HLOD proxies, drawn last as they turn lightmapping off
+        if (batchSettings.enabled && !staticBatches.empty())
+        {
+            if (!hlodActive())
+                return drawn + staticBatches.draw(shader, cullFrustum, meshlets);
+            drawn += staticBatches.draw(shader, cullFrustum, meshlets, &hlod.chunkMask());
+            return drawn + hlod.draw(shader, cullFrustum);
+        }
+
+        const TransformHierarchy &nodes = cityModel->nodes;
+        const std::vector<std::uint8_t> subtreeVisible =
+            cullFrustum ? visibleSubtrees(*cullFrustum) : std::vector<std::uint8_t>(nodes.size(), 1);
+
+        for (std::size_t i = 0; i < cityModel->meshes.size(); i++)
+        {
+            Mesh &mesh = cityModel->meshes[i];
+            const int group = cityInstanceGroup[i];
+            if (group >= 0 && mesh.instanceCount() > 0)
+            {
+                // Merged duplicates: one instanced draw for all placements
+                if (!visible(instancedBounds[group]))
+                    continue;
+                shader.setBool("instanced", true);
+                mesh.DrawInstanced(shader, mesh.instanceCount());
+                shader.setBool("instanced", false);
+                drawn++;
+                continue;
+            }
+            for (const Model::Placement &placement : cityModel->placements[i])
+            {
+                if (!subtreeVisible[placement.node] || !visible(nodes.worldBounds(placement.node)))
+                    continue;
+                const glm::mat4 world = cityModel->placementWorld(placement);
+                shader.setMat4("model", world);
+                if (meshlets && !mesh.meshlets.empty())
+                {
+                    // Sub-mesh culling: only the surviving meshlet ranges
+                    const MeshletDrawList &ranges = meshlets->cull(mesh.meshlets, world);
+                    if (ranges.counts.empty())
+                        continue;
+                    mesh.DrawRanges(shader, ranges);
+                }
+                else
+                    mesh.Draw(shader);
+                drawn++;
+            }
+        }
     }
+    return drawn;
+}
+
+std::vector<std::uint8_t> CityScene::visibleSubtrees(const Frustum &frustum) const
+{
+    // Hierarchical culling: a node's subtree is tested only if its parent's was visible
+    const TransformHierarchy &nodes = cityModel->nodes;
+    std::vector<std::uint8_t> subtreeVisible(nodes.size(), 0);
+    for (std::size_t n = 0; n < nodes.size(); n++)
+    {
+        const int parent = nodes.parent(static_cast<int>(n));
+        const Aabb &bounds = nodes.subtreeBounds(static_cast<int>(n));
+        subtreeVisible[n] = (parent == TransformHierarchy::kNoParent || subtreeVisible[parent]) &&
+                            !bounds.isEmpty() && frustum.intersects(bounds);
+    }
+    return subtreeVisible;
+}
+
+int CityScene::drawOccluded(Shader &shader, MeshletCuller *meshlets, const OcclusionView &occlusion) const
+{
+    const Frustum frustum = Frustum::fromMatrix(occlusion.viewProjection);
+    std::vector<OcclusionCandidate> candidates;
+    if (batchSettings.enabled && !staticBatches.empty())
+    {
+        const bool useHlod = hlodActive();
+        for (int chunk = 0; chunk < staticBatches.chunkCount(); chunk++)
+        {
+            const Aabb &bounds = staticBatches.chunkBounds(chunk);
+            if ((useHlod && !hlod.chunkMask()[chunk]) || !frustum.intersects(bounds))
+                continue;
+            candidates.push_back({chunk, bounds, chunk});
+        }
+        const auto drawChunk = [&](int chunk) { staticBatches.drawChunk(shader, chunk, meshlets); };
+        const int drawn = occlusionQueries.draw(candidates, drawChunk, shader, occlusion.viewProjection,
+                                                occlusion.cameraPosition);
+        return useHlod ? drawn + hlod.draw(shader, &frustum) : drawn;
+    }
+
+    // Single placements take the first ids, instance groups the ones after. A
+    // candidate's item indexes `items`; the matrix is resolved when it is drawn.
+    struct Item
+    {
+        Mesh *mesh;
+        const Model::Placement *placement; // null for an instance group
+    };
+    std::vector<Item> items;
+    const std::vector<std::uint8_t> subtreeVisible = visibleSubtrees(frustum);
+    int placementId = 0;
+    const int groupBase = occlusionObjectCount() - static_cast<int>(instancedBounds.size());
+    for (std::size_t i = 0; i < cityModel->meshes.size(); i++)
+    {
+        Mesh &mesh = cityModel->meshes[i];
+        const int group = cityInstanceGroup[i];
+        if (group >= 0)
+        {
+            if (mesh.instanceCount() > 0 && frustum.intersects(instancedBounds[group]))
+            {
+                candidates.push_back({groupBase + group, instancedBounds[group], static_cast<int>(items.size())});
+                items.push_back({&mesh, nullptr});
+            }
+            continue;
+        }
+        for (const Model::Placement &placement : cityModel->placements[i])
+        {
+            const int id = placementId++;
+            const Aabb &bounds = cityModel->nodes.worldBounds(placement.node);
+            if (!subtreeVisible[placement.node] || bounds.isEmpty() || !frustum.intersects(bounds))
+                continue;
+            candidates.push_back({id, bounds, static_cast<int>(items.size())});
+            items.push_back({&mesh, &placement});
+        }
+    }
+    const auto drawItem = [&](int index) {
+        Mesh &mesh = *items[index].mesh;
+        if (!items[index].placement)
+        {
+            shader.setBool("instanced", true);
+            mesh.DrawInstanced(shader, mesh.instanceCount());
+            shader.setBool("instanced", false);
+            return;
+        }
+        const glm::mat4 world = cityModel->placementWorld(*items[index].placement);
+        shader.setMat4("model", world);
+        if (meshlets && !mesh.meshlets.empty())
+        {
+            const MeshletDrawList &ranges = meshlets->cull(mesh.meshlets, world);
+            if (!ranges.counts.empty())
+                mesh.DrawRanges(shader, ranges);
+        }
+        else
+            mesh.Draw(shader);
+    };
+    return occlusionQueries.draw(candidates, drawItem, shader, occlusion.viewProjection, occlusion.cameraPosition);
+}
+
+glm::mat4 CityScene::groundModelMatrix() const
+{
+    // Slightly below city; stretched under a generated district
+    return glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(groundCenter.x, -0.1f, groundCenter.y)),
+                      glm::vec3(groundScale, 1.0f, groundScale));
+}
+
+glm::mat4 CityScene::cityModelMatrix()
+{
+    // City model root node - grand cityscape; the Z-up to Y-up fix comes from the glTF node transforms
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f));
+    model = glm::scale(model, glm::vec3(0.2f));  // Large scale for grand cityscape
+    return model;
 }
 
 void CityScene::renderSkybox(Shader &skyboxShader, const glm::mat4 &view, const glm::mat4 &projection) const
@@ -172,10 +1489,30 @@ void CityScene::renderSkybox(Shader &skyboxShader, const glm::mat4 &view, const
     }
 }
 
+void CityScene::renderSkyline(const glm::mat4 &view, const glm::mat4 &projection) const
+{
+    if (!impostorSettings.enabled)
+        return;
+    // Same moonlight as the dirLight in setLightingUniforms
+    skyline.draw(view, projection, getMoonDirection(), getMoonColor(),
+                 glm::vec3(0.02f, 0.02f, 0.05f) * moonIntensity);
+}
+
 void CityScene::shutdown() // NOLINT(readability-make-member-function-const)
 {
+    cityLoader.shutdown();
     if (skybox)
         skybox->shutdown();
+    lightmap.shutdown();
+    probeGrid.shutdown();
+    if (streetProps)
+        streetProps->shutdown();
+    staticBatches.shutdown();
+    gpuDriven.shutdown();
+    hlod.shutdown();
+    occlusionQueries.shutdown();
+    skyline.shutdown();
+    worldStreamer.shutdown();
 
     // Model and Mesh unique_ptrs clean up themselves via destructors
 }
@@ -0,0 +1,302 @@
+#include "scene/gpu_driven_renderer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <unordered_map>
+
+namespace
+{
+    constexpr GLuint kCullGroupSize = 64; // gpu_cull.comp local size
+
+    float elapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    GLuint createBuffer(GLenum target, std::size_t bytes, const void *data, GLenum usage)
+    {
+        GLuint buffer = 0;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(target, buffer);
+        glBufferData(target, static_cast<GLsizeiptr>(bytes), data, usage);
+        glBindBuffer(target, 0);
+        return buffer;
+    }
+}
+
+bool GpuDrivenRenderer::init(const std::filesystem::path &shaderRoot)
+{
+    if (!gl43::available())
+        return false;
+    cullShader = std::make_unique<Shader>((shaderRoot / "gpu_cull.comp").string().c_str());
+    // Allocated at the first updateOcclusion, once the scene size is known
+    hiZ.init(shaderRoot, 1, 1);
+    return true;
+}
+
+void GpuDrivenRenderer::build(const std::vector<StaticBatchSource> &sources)
+{
+    if (!cullShader)
+        return;
+    const auto start = std::chrono::steady_clock::now();
+    releaseBuffers();
+
+    // Placements grouped by mesh, meshes ordered by material
+    std::vector<const Mesh *> meshes;
+    std::vector<std::vector<const StaticBatchSource *>> placements;
+    std::unordered_map<const Mesh *, std::size_t> meshSlot;
+    for (const StaticBatchSource &source : sources)
+    {
+        if (!source.mesh || source.mesh->indices.empty())
+            continue;
+        const auto [it, inserted] = meshSlot.emplace(source.mesh, meshes.size());
+        if (inserted)
+        {
+            meshes.push_back(source.mesh);
+            placements.emplace_back();
+        }
+        placements[it->second].push_back(&source);
+    }
+    std::vector<int> meshMaterial(meshes.size());
+    for (std::size_t m = 0; m < meshes.size(); m++)
+    {
+        int material = 0;
+        while (material < static_cast<int>(materials.size()) && !sameMaterial(materials[material], meshes[m]->textures))
+            material++;
+        if (material == static_cast<int>(materials.size()))
+            materials.push_back(meshes[m]->textures);
+        meshMaterial[m] = material;
+    }
+    std::vector<std::size_t> order(meshes.size());
+    for (std::size_t m = 0; m < order.size(); m++)
+        order[m] = m;
+    std::stable_sort(order.begin(), order.end(),
+                     [&](std::size_t a, std::size_t b) { return meshMaterial[a] < meshMaterial[b]; });
+
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<DrawRecord> records;
+    std::vector<InstanceData> instances;
+    for (std::size_t m : order)
+    {
+        const Mesh &mesh = *meshes[m];
+        if (materialRanges.empty() || materialRanges.back().material != meshMaterial[m])
+        {
+            MaterialRange range;
+            range.material = meshMaterial[m];
+            range.firstCommand = static_cast<GLsizei>(commands.size());
+            materialRanges.push_back(range);
+        }
+        materialRanges.back().commandCount++;
+
+        DrawElementsIndirectCommand command;
+        command.count = static_cast<GLuint>(mesh.indices.size());
+        command.firstIndex = static_cast<GLuint>(indices.size());
+        command.baseVertex = static_cast<GLint>(vertices.size());
+        command.baseInstance = static_cast<GLuint>(records.size());
+        vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+        indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+
+        const Aabb localBounds{mesh.boundsMin, mesh.boundsMax};
+        for (const StaticBatchSource *source : placements[m])
+        {
+            const Aabb bounds = localBounds.transformed(source->world);
+            DrawRecord record;
+            record.boundsMin = bounds.min;
+            record.boundsMax = bounds.max;
+            record.command = static_cast<GLuint>(commands.size());
+            records.push_back(record);
+            InstanceData instance;
+            instance.model = source->world;
+            instance.lightmapScaleOffset = source->lightmapScaleOffset;
+            instances.push_back(instance);
+        }
+        commands.push_back(command);
+    }
+    if (commands.empty())
+        return;
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ebo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    // Same layout as Mesh, locations 0-3
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Normal));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, TexCoords));
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, LightmapUV));
+
+    // The compacted instances, read like Mesh::setInstances' stream; each
+    // command's baseInstance points at its block
+    glGenBuffers(1, &visibleInstanceBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, visibleInstanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(InstanceData), nullptr, GL_DYNAMIC_COPY);
+    for (GLuint column = 0; column < 4; column++)
+    {
+        glEnableVertexAttribArray(4 + column);
+        glVertexAttribPointer(4 + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (void *)(offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(4 + column, 1);
+    }
+    glEnableVertexAttribArray(8);
+    glVertexAttribPointer(8, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void *)offsetof(InstanceData, color));
+    glVertexAttribDivisor(8, 1);
+    glEnableVertexAttribArray(9);
+    glVertexAttribPointer(9, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void *)offsetof(InstanceData, lightmapScaleOffset));
+    glVertexAttribDivisor(9, 1);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    recordBuffer = createBuffer(GL_SHADER_STORAGE_BUFFER, records.size() * sizeof(DrawRecord), records.data(),
+                                GL_STATIC_DRAW);
+    instanceBuffer = createBuffer(GL_SHADER_STORAGE_BUFFER, instances.size() * sizeof(InstanceData),
+                                  instances.data(), GL_STATIC_DRAW);
+    const std::size_t commandBytes = commands.size() * sizeof(DrawElementsIndirectCommand);
+    commandTemplate = createBuffer(GL_COPY_READ_BUFFER, commandBytes, commands.data(), GL_STATIC_DRAW);
+    commandBuffer = createBuffer(GL_DRAW_INDIRECT_BUFFER, commandBytes, commands.data(), GL_DYNAMIC_COPY);
+    for (GLuint &counters : counterBuffers)
+        counters = createBuffer(GL_SHADER_STORAGE_BUFFER, sizeof(CullStats), nullptr, GL_DYNAMIC_READ);
+    counterFrame = 0;
+    countersWritten = 0;
+
+    buildStats.meshes = static_cast<int>(commands.size());
+    buildStats.records = static_cast<int>(records.size());
+    buildStats.materials = static_cast<int>(materialRanges.size());
+    buildStats.vertices = vertices.size();
+    buildStats.triangles = indices.size() / 3;
+    buildStats.gpuBytes = vertices.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned int) +
+                          records.size() * (sizeof(DrawRecord) + 2 * sizeof(InstanceData)) + 2 * commandBytes;
+    buildStats.buildMs = elapsedMs(start);
+    std::cout << "[GPU-Driven] " << buildStats.records << " placements of " << buildStats.meshes << " meshes -> "
+              << buildStats.materials << " indirect draws, " << buildStats.vertices << " vertices, built in "
+              << buildStats.buildMs << " ms" << std::endl;
+}
+
+void GpuDrivenRenderer::releaseBuffers()
+{
+    if (vao)
+        glDeleteVertexArrays(1, &vao);
+    for (GLuint *buffer : {&vbo, &ebo, &recordBuffer, &instanceBuffer, &visibleInstanceBuffer, &commandTemplate,
+                           &commandBuffer})
+    {
+        if (*buffer)
+            glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    for (GLuint &counters : counterBuffers)
+    {
+        if (counters)
+            glDeleteBuffers(1, &counters);
+        counters = 0;
+    }
+    vao = 0;
+    materials.clear();
+    materialRanges.clear();
+    buildStats = Stats{};
+    lastCullStats = CullStats{};
+}
+
+void GpuDrivenRenderer::shutdown()
+{
+    releaseBuffers();
+    hiZ.shutdown();
+    cullShader.reset();
+}
+
+void GpuDrivenRenderer::cull(const glm::mat4 &viewProjection, const GpuDrivenSettings &settings)
+{
+    if (!ready())
+        return;
+
+    // The oldest counters are kCounterFrames - 1 frames old, long finished
+    GLuint &counters = counterBuffers[counterFrame];
+    if (countersWritten >= kCounterFrames)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, counters);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(CullStats), &lastCullStats);
+    }
+    const CullStats zero;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counters);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(CullStats), &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // Every command starts the frame with no instances
+    glBindBuffer(GL_COPY_READ_BUFFER, commandTemplate);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, commandBuffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                        static_cast<GLsizeiptr>(buildStats.meshes * sizeof(DrawElementsIndirectCommand)));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    cullShader->use();
+    const Frustum frustum = Frustum::fromMatrix(viewProjection);
+    glm::vec4 planes[6];
+    for (int i = 0; i < 6; i++)
+        planes[i] = frustum.plane(i);
+    glUniform4fv(glGetUniformLocation(cullShader->ID, "frustumPlanes"), 6, &planes[0][0]);
+    glUniform1ui(glGetUniformLocation(cullShader->ID, "recordCount"), static_cast<GLuint>(buildStats.records));
+    const bool occlusion = settings.occlusionCulling && hiZ.levels() > 0;
+    cullShader->setBool("occlusionCulling", occlusion);
+    cullShader->setMat4("hizViewProjection", hiZViewProjection);
+    glUniform2i(glGetUniformLocation(cullShader->ID, "hizSourceSize"), hiZ.sourceSize().x, hiZ.sourceSize().y);
+    cullShader->setInt("hizLevels", hiZ.levels());
+    cullShader->setInt("hiz", 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, hiZ.texture());
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, recordBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, instanceBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, visibleInstanceBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, commandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, counters);
+    gl43::dispatchCompute((static_cast<GLuint>(buildStats.records) + kCullGroupSize - 1) / kCullGroupSize, 1, 1);
+    // Commands feed the indirect draws, instances the vertex attributes
+    gl43::memoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    for (GLuint binding = 0; binding < 5; binding++)
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    counterFrame = (counterFrame + 1) % kCounterFrames;
+    countersWritten = std::min(countersWritten + 1, kCounterFrames);
+}
+
+int GpuDrivenRenderer::draw(Shader &shader) const
+{
+    if (!ready())
+        return 0;
+    shader.setBool("instanced", true);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    for (const MaterialRange &range : materialRanges)
+    {
+        bindMeshTextures(shader, materials[range.material]);
+        gl43::multiDrawElementsIndirect(
+            GL_TRIANGLES, GL_UNSIGNED_INT,
+            (void *)(static_cast<std::size_t>(range.firstCommand) * sizeof(DrawElementsIndirectCommand)),
+            range.commandCount, 0);
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+    shader.setBool("instanced", false);
+    return static_cast<int>(materialRanges.size());
+}
+
+void GpuDrivenRenderer::updateOcclusion(const RenderTarget &scene, int renderWidth, int renderHeight,
+                                        const glm::mat4 &viewProjection)
+{
+    if (!ready())
+        return;
+    hiZ.resize(scene.width(), scene.height());
+    hiZ.build(scene.depthTexture(), renderWidth, renderHeight);
+    hiZViewProjection = viewProjection;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+#include "shader.hpp"
+#include "render/gl43.hpp"
+#include "render/hiz_pyramid.hpp"
+#include "render/render_target.hpp"
+#include "scene/static_batcher.hpp"
+
+struct GpuDrivenSettings
+{
+    bool enabled = true;          // used only when the context has GL 4.3
+    bool occlusionCulling = true; // Hi-Z test against the previous frame's depth
+};
+
+// GPU-driven path for placed meshes (GL 4.3). The unique meshes share one
+// vertex and one index buffer and get one DrawElementsIndirectCommand each,
+// sorted by material; every placement is a draw record (world bounds and its
+// InstanceData) in a shader storage buffer. Per frame a compute pass tests
+// all records against the frustum and the Hi-Z pyramid of the previous
+// frame's depth and appends the survivors to their mesh's command: its
+// instanceCount counts them and their instance data is compacted into the
+// command's block of the instance stream shader.vert/depth.vert read. One
+// glMultiDrawElementsIndirect per material then draws everything, so the CPU
+// cost of a pass does not depend on the number of placements. Occlusion is
+// judged against where things were last frame, so geometry uncovered by an
+// abrupt camera move can appear one frame late.
+class GpuDrivenRenderer
+{
+public:
+    struct Stats
+    {
+        int meshes = 0;  // indirect commands
+        int records = 0; // placements
+        int materials = 0;
+        std::size_t vertices = 0;
+        std::size_t triangles = 0;
+        std::size_t gpuBytes = 0;
+        float buildMs = 0.0f;
+    };
+
+    // Counted on the GPU; read back a few frames late so nothing waits
+    struct CullStats
+    {
+        GLuint frustumRejected = 0;
+        GLuint occlusionRejected = 0;
+        GLuint visible = 0;
+    };
+
+    // False without a GL 4.3 context; the caller keeps drawing on the 3.3 path
+    bool init(const std::filesystem::path &shaderRoot);
+    // Replaces the records; meshes must be loaded (CPU vertices kept)
+    void build(const std::vector<StaticBatchSource> &sources);
+    void shutdown();
+    bool ready() const { return cullShader && !materialRanges.empty(); }
+
+    // Fills this frame's commands for the camera; once per frame, before the
+    // passes that draw them
+    void cull(const glm::mat4 &viewProjection, const GpuDrivenSettings &settings);
+    // Indirect draws of the last cull through the shader's instanced path;
+    // returns draws issued
+    int draw(Shader &shader) const;
+    // Builds the pyramid the next cull tests against from the scene depth
+    // (lower-left renderWidth x renderHeight of `scene`), drawn with `viewProjection`
+    void updateOcclusion(const RenderTarget &scene, int renderWidth, int renderHeight,
+                         const glm::mat4 &viewProjection);
+
+    const Stats &stats() const { return buildStats; }
+    const CullStats &cullStats() const { return lastCullStats; }
+
+private:
+    static constexpr int kCounterFrames = 3;
+
+    // std430 layout of gpu_cull.comp's records
+    struct DrawRecord
+    {
+        glm::vec3 boundsMin{0.0f};
+        GLuint command = 0;
+        glm::vec3 boundsMax{0.0f};
+        GLuint padding = 0;
+    };
+
+    struct MaterialRange
+    {
+        int material = 0;
+        GLsizei firstCommand = 0;
+        GLsizei commandCount = 0;
+    };
+
+    void releaseBuffers();
+
+    std::unique_ptr<Shader> cullShader;
+    HiZPyramid hiZ;
+    glm::mat4 hiZViewProjection{1.0f};
+
+    std::vector<std::vector<Texture>> materials;
+    std::vector<MaterialRange> materialRanges;
+    GLuint vao = 0;
+    GLuint vbo = 0;
+    GLuint ebo = 0;
+    GLuint recordBuffer = 0;
+    GLuint instanceBuffer = 0;        // InstanceData per record
+    GLuint visibleInstanceBuffer = 0; // survivors, per command block; instanced attributes 4-9
+    GLuint commandTemplate = 0;       // commands with no instances, copied over each frame
+    GLuint commandBuffer = 0;
+    std::array<GLuint, kCounterFrames> counterBuffers{};
+    int counterFrame = 0;
+    int countersWritten = 0;
+
+    Stats buildStats;
+    CullStats lastCullStats;
+};
@@ -0,0 +1,493 @@
+#include "scene/hlod.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+namespace
+{
+    constexpr float kMaxResolution = 128.0f; // finest simplification grid: cells across the cluster's longest side
+    constexpr float kCellGrowth = 1.25f;     // per attempt until the proxy fits the budget
+    constexpr int kMaxAttempts = 32;
+    constexpr std::uint64_t kMaxGridCell = 0xffff;
+    constexpr std::uint64_t kMaxPaletteMaterial = (1u << 13) - 1;
+    constexpr unsigned int kMaxPackedVertex = 1u << 21; // triangle dedup packs three vertex ids into 64 bits
+    constexpr float kDefaultColor = 0.5f;               // materials without a diffuse texture
+
+    float elapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    int floorHalf(int value)
+    {
+        return value >= 0 ? value / 2 : -((-value + 1) / 2);
+    }
+
+    // World-space triangles of one batch chunk
+    struct ChunkGeometry
+    {
+        std::vector<glm::vec3> positions; // three per triangle
+        std::vector<glm::vec3> normals;
+        std::vector<int> materials; // one per triangle
+        Aabb bounds = Aabb::empty();
+    };
+
+    struct ProxyMesh
+    {
+        std::vector<Vertex> vertices;
+        std::vector<int> vertexMaterials;
+        std::vector<unsigned int> indices;
+        float error = 0.0f;
+    };
+
+    // A child's proxy as input for its parent
+    ChunkGeometry proxyGeometry(const ProxyMesh &proxy)
+    {
+        ChunkGeometry geometry;
+        for (std::size_t i = 0; i < proxy.indices.size(); i++)
+        {
+            const Vertex &vertex = proxy.vertices[proxy.indices[i]];
+            geometry.positions.push_back(vertex.Position);
+            geometry.normals.push_back(vertex.Normal);
+            geometry.bounds.expand(Aabb{vertex.Position, vertex.Position});
+            if (i % 3 == 0)
+                geometry.materials.push_back(proxy.vertexMaterials[proxy.indices[i]]);
+        }
+        return geometry;
+    }
+
+    // Mean linear color of a material's diffuse texture, read back from its smallest mip
+    glm::vec3 meanColor(const std::vector<Texture> &textures)
+    {
+        for (const Texture &texture : textures)
+        {
+            if (texture.type != "texture_diffuse" || texture.id == 0)
+                continue;
+            glBindTexture(GL_TEXTURE_2D, texture.id);
+            GLint width = 0;
+            GLint height = 0;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+            int level = 0;
+            while ((std::max(width, height) >> (level + 1)) > 0)
+                level++;
+            GLint levelWidth = 0;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &levelWidth);
+            if (levelWidth == 0)
+                level = 0;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &width);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &height);
+            if (width <= 0 || height <= 0)
+                continue;
+            GLint internalFormat = 0;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+            const bool srgb = internalFormat == GL_SRGB8 || internalFormat == GL_SRGB8_ALPHA8;
+
+            std::vector<float> texels(static_cast<std::size_t>(width) * height * 4);
+            glGetTexImage(GL_TEXTURE_2D, level, GL_RGBA, GL_FLOAT, texels.data());
+            glBindTexture(GL_TEXTURE_2D, 0);
+            glm::vec3 sum(0.0f);
+            for (std::size_t i = 0; i < texels.size(); i += 4)
+            {
+                const glm::vec3 color(texels[i], texels[i + 1], texels[i + 2]);
+                sum += srgb ? glm::pow(color, glm::vec3(2.2f)) : color;
+            }
+            return sum / static_cast<float>(width * height);
+        }
+        return glm::vec3(kDefaultColor);
+    }
+
+    // Dominant axis and sign of a normal, 0-5; vertices facing different ways are never merged
+    std::uint64_t normalBucket(const glm::vec3 &normal)
+    {
+        const glm::vec3 magnitude = glm::abs(normal);
+        const int axis = magnitude.x >= magnitude.y && magnitude.x >= magnitude.z ? 0 : (magnitude.y >= magnitude.z ? 1 : 2);
+        return static_cast<std::uint64_t>(axis * 2 + (normal[axis] < 0.0f ? 1 : 0));
+    }
+
+    // Vertex clustering: every vertex moves to the mean of the vertices in its
+    // grid cell (per facing and material); collapsed and repeated triangles go
+    ProxyMesh clusterVertices(const std::vector<const ChunkGeometry *> &chunks, const glm::vec3 &origin, float cell,
+                              int materialCount)
+    {
+        struct Accumulator
+        {
+            glm::vec3 position{0.0f};
+            glm::vec3 normal{0.0f};
+            int count = 0;
+            int material = 0;
+        };
+        std::unordered_map<std::uint64_t, unsigned int> lookup;
+        std::vector<Accumulator> merged;
+        std::unordered_set<std::uint64_t> triangles;
+        ProxyMesh proxy;
+        for (const ChunkGeometry *chunk : chunks)
+        {
+            for (std::size_t t = 0; t < chunk->materials.size(); t++)
+            {
+                const auto material = static_cast<std::uint64_t>(chunk->materials[t]);
+                std::array<unsigned int, 3> ids{};
+                for (int corner = 0; corner < 3; corner++)
+                {
+                    const glm::vec3 &position = chunk->positions[t * 3 + corner];
+                    const glm::vec3 &normal = chunk->normals[t * 3 + corner];
+                    const glm::vec3 scaled = glm::floor((position - origin) / cell);
+                    const auto x = static_cast<std::uint64_t>(glm::clamp(scaled.x, 0.0f, static_cast<float>(kMaxGridCell)));
+                    const auto y = static_cast<std::uint64_t>(glm::clamp(scaled.y, 0.0f, static_cast<float>(kMaxGridCell)));
+                    const auto z = static_cast<std::uint64_t>(glm::clamp(scaled.z, 0.0f, static_cast<float>(kMaxGridCell)));
+                    const std::uint64_t key = x | (y << 16) | (z << 32) | (normalBucket(normal) << 48) |
+                                              (std::min(material, kMaxPaletteMaterial) << 51);
+                    const auto [it, inserted] = lookup.emplace(key, static_cast<unsigned int>(merged.size()));
+                    if (inserted)
+                    {
+                        merged.emplace_back();
+                        merged.back().material = static_cast<int>(material);
+                    }
+                    Accumulator &vertex = merged[it->second];
+                    vertex.position += position;
+                    vertex.normal += normal;
+                    vertex.count++;
+                    ids[corner] = it->second;
+                }
+                if (ids[0] == ids[1] || ids[1] == ids[2] || ids[0] == ids[2])
+                    continue;
+                std::array<unsigned int, 3> sorted = ids;
+                std::sort(sorted.begin(), sorted.end());
+                if (sorted[2] < kMaxPackedVertex)
+                {
+                    const std::uint64_t key = static_cast<std::uint64_t>(sorted[0]) |
+                                              (static_cast<std::uint64_t>(sorted[1]) << 21) |
+                                              (static_cast<std::uint64_t>(sorted[2]) << 42);
+                    if (!triangles.insert(key).second)
+                        continue;
+                }
+                proxy.indices.insert(proxy.indices.end(), ids.begin(), ids.end());
+            }
+        }
+
+        proxy.vertices.resize(merged.size());
+        proxy.vertexMaterials.resize(merged.size());
+        for (std::size_t v = 0; v < merged.size(); v++)
+        {
+            const Accumulator &in = merged[v];
+            Vertex &out = proxy.vertices[v];
+            out.Position = in.position / static_cast<float>(in.count);
+            out.Normal = glm::dot(in.normal, in.normal) > 0.0f ? glm::normalize(in.normal) : glm::vec3(0.0f, 1.0f, 0.0f);
+            out.TexCoords = glm::vec2((static_cast<float>(in.material) + 0.5f) / static_cast<float>(materialCount), 0.5f);
+            out.LightmapUV = glm::vec2(0.0f);
+            proxy.vertexMaterials[v] = in.material;
+        }
+        // A vertex ends up at most one cell diagonal from where it was
+        proxy.error = cell * std::sqrt(3.0f);
+        return proxy;
+    }
+
+    ProxyMesh simplify(const std::vector<const ChunkGeometry *> &chunks, const Aabb &bounds, int triangleBudget,
+                       int materialCount)
+    {
+        // A surface of area A leaves about 2 A / cell^2 triangles on the grid;
+        // start a little below the cell that estimate gives for the budget
+        float area = 0.0f;
+        for (const ChunkGeometry *chunk : chunks)
+        {
+            for (std::size_t i = 0; i + 2 < chunk->positions.size(); i += 3)
+            {
+                const glm::vec3 *p = &chunk->positions[i];
+                area += 0.5f * glm::length(glm::cross(p[1] - p[0], p[2] - p[0]));
+            }
+        }
+        const glm::vec3 extent = bounds.max - bounds.min;
+        const float finest = std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-3f)) / kMaxResolution;
+        float cell = std::max(finest, 0.8f * std::sqrt(2.0f * area / static_cast<float>(triangleBudget)));
+        ProxyMesh proxy;
+        for (int attempt = 0; attempt < kMaxAttempts; attempt++)
+        {
+            proxy = clusterVertices(chunks, bounds.min, cell, materialCount);
+            if (proxy.indices.size() / 3 <= static_cast<std::size_t>(triangleBudget))
+                break;
+            cell *= kCellGrowth;
+        }
+        return proxy;
+    }
+}
+
+void HlodTree::build(const std::vector<StaticBatchSource> &sources, const StaticBatcher &batcher,
+                     const HlodSettings &settings)
+{
+    const auto start = std::chrono::steady_clock::now();
+    shutdown();
+    if (batcher.empty())
+        return;
+    const float chunkSize = batcher.chunkSize();
+    const int levels = std::clamp(settings.levels, 1, kMaxLevels);
+    const int triangleBudget = std::max(settings.triangleBudget, 1);
+
+    // World-space triangles per batch chunk, assigned by centroid like the batcher
+    std::map<std::pair<int, int>, ChunkGeometry> geometry;
+    std::vector<std::vector<Texture>> materials;
+    std::vector<glm::vec3> transformed;
+    std::vector<glm::vec3> transformedNormals;
+    for (const StaticBatchSource &source : sources)
+    {
+        if (!source.mesh || source.mesh->indices.empty())
+            continue;
+        const Mesh &mesh = *source.mesh;
+        int material = 0;
+        while (material < static_cast<int>(materials.size()) && !sameMaterial(materials[material], mesh.textures))
+            material++;
+        if (material == static_cast<int>(materials.size()))
+            materials.push_back(mesh.textures);
+
+        const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(source.world)));
+        transformed.resize(mesh.vertices.size());
+        transformedNormals.resize(mesh.vertices.size());
+        for (std::size_t v = 0; v < mesh.vertices.size(); v++)
+        {
+            transformed[v] = glm::vec3(source.world * glm::vec4(mesh.vertices[v].Position, 1.0f));
+            const glm::vec3 normal = normalMatrix * mesh.vertices[v].Normal;
+            transformedNormals[v] = glm::dot(normal, normal) > 0.0f ? glm::normalize(normal) : normal;
+        }
+        for (std::size_t t = 0; t + 2 < mesh.indices.size(); t += 3)
+        {
+            const glm::vec3 centroid = (transformed[mesh.indices[t]] + transformed[mesh.indices[t + 1]] +
+                                        transformed[mesh.indices[t + 2]]) / 3.0f;
+            const glm::ivec2 cell = StaticBatcher::cellOf(centroid, chunkSize);
+            ChunkGeometry &chunk = geometry[{cell.x, cell.y}];
+            for (std::size_t corner = 0; corner < 3; corner++)
+            {
+                const unsigned int v = mesh.indices[t + corner];
+                chunk.positions.push_back(transformed[v]);
+                chunk.normals.push_back(transformedNormals[v]);
+                chunk.bounds.expand(Aabb{transformed[v], transformed[v]});
+            }
+            chunk.materials.push_back(material);
+            buildStats.sourceTriangles++;
+        }
+    }
+
+    // Level 0: one cluster per batch chunk, simplified from its triangles.
+    // Each level above merges 2x2 clusters and simplifies their proxies, so
+    // its error adds to the largest of theirs.
+    const int materialCount = std::max(static_cast<int>(materials.size()), 1);
+    std::vector<ProxyMesh> proxies;
+    for (int chunk = 0; chunk < batcher.chunkCount(); chunk++)
+    {
+        Cluster cluster;
+        cluster.cell = batcher.chunkCell(chunk);
+        cluster.bounds = batcher.chunkBounds(chunk);
+        cluster.children.push_back(chunk);
+        std::vector<const ChunkGeometry *> chunkGeometry;
+        const auto found = geometry.find({cluster.cell.x, cluster.cell.y});
+        if (found != geometry.end())
+            chunkGeometry.push_back(&found->second);
+        proxies.push_back(simplify(chunkGeometry, cluster.bounds, triangleBudget, materialCount));
+        cluster.error = proxies.back().error;
+        clusters.push_back(std::move(cluster));
+    }
+    geometry.clear();
+    int levelBegin = 0;
+    int levelEnd = static_cast<int>(clusters.size());
+    buildStats.levels = 1;
+    for (int level = 1; level < levels && levelEnd - levelBegin > 1; level++)
+    {
+        std::map<std::pair<int, int>, std::vector<int>> parents;
+        for (int child = levelBegin; child < levelEnd; child++)
+            parents[{floorHalf(clusters[child].cell.x), floorHalf(clusters[child].cell.y)}].push_back(child);
+        for (auto &[cell, children] : parents)
+        {
+            Cluster cluster;
+            cluster.level = level;
+            cluster.cell = glm::ivec2(cell.first, cell.second);
+            cluster.bounds = Aabb::empty();
+            std::vector<ChunkGeometry> childGeometry;
+            float childError = 0.0f;
+            for (int child : children)
+            {
+                cluster.bounds.expand(clusters[child].bounds);
+                childGeometry.push_back(proxyGeometry(proxies[child]));
+                childError = std::max(childError, clusters[child].error);
+            }
+            std::vector<const ChunkGeometry *> parentGeometry;
+            for (const ChunkGeometry &child : childGeometry)
+                parentGeometry.push_back(&child);
+            proxies.push_back(simplify(parentGeometry, cluster.bounds, triangleBudget, materialCount));
+            cluster.error = proxies.back().error + childError;
+            cluster.children = std::move(children);
+            clusters.push_back(std::move(cluster));
+        }
+        levelBegin = levelEnd;
+        levelEnd = static_cast<int>(clusters.size());
+        buildStats.levels++;
+    }
+    for (int root = levelBegin; root < levelEnd; root++)
+        roots.push_back(root);
+
+    // All proxies in one vertex and one index buffer
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    for (std::size_t c = 0; c < clusters.size(); c++)
+    {
+        Cluster &cluster = clusters[c];
+        const ProxyMesh &proxy = proxies[c];
+        cluster.firstIndex = static_cast<GLuint>(indices.size());
+        cluster.indexCount = static_cast<GLsizei>(proxy.indices.size());
+        const auto baseVertex = static_cast<unsigned int>(vertices.size());
+        for (unsigned int index : proxy.indices)
+            indices.push_back(baseVertex + index);
+        vertices.insert(vertices.end(), proxy.vertices.begin(), proxy.vertices.end());
+
+        LevelStats &level = buildStats.level[cluster.level];
+        level.minError = level.clusters == 0 ? cluster.error : std::min(level.minError, cluster.error);
+        level.maxError = std::max(level.maxError, cluster.error);
+        level.clusters++;
+        level.triangles += proxy.indices.size() / 3;
+    }
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ebo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    // Same layout as Mesh, locations 0-3
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Normal));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, TexCoords));
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, LightmapUV));
+    glBindVertexArray(0);
+
+    // Palette: a texel per material, sampled at its center
+    std::vector<unsigned char> texels(static_cast<std::size_t>(materialCount) * 4, 255);
+    for (std::size_t m = 0; m < materials.size(); m++)
+    {
+        const glm::vec3 encoded = glm::pow(glm::clamp(meanColor(materials[m]), 0.0f, 1.0f), glm::vec3(1.0f / 2.2f));
+        for (int channel = 0; channel < 3; channel++)
+            texels[m * 4 + channel] = static_cast<unsigned char>(std::lround(encoded[channel] * 255.0f));
+    }
+    GLuint paletteTexture = 0;
+    glGenTextures(1, &paletteTexture);
+    glBindTexture(GL_TEXTURE_2D, paletteTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, materialCount, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    palette.push_back(Texture{paletteTexture, "texture_diffuse", ""});
+
+    mask.assign(static_cast<std::size_t>(batcher.chunkCount()), 1);
+    buildStats.clusters = static_cast<int>(clusters.size());
+    buildStats.materials = static_cast<int>(materials.size());
+    buildStats.proxyTriangles = indices.size() / 3;
+    buildStats.gpuBytes = vertices.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned int);
+    buildStats.paletteBytes = texels.size();
+    buildStats.buildMs = elapsedMs(start);
+    std::cout << "[HLOD] " << buildStats.clusters << " clusters on " << buildStats.levels << " levels over "
+              << batcher.chunkCount() << " chunks, " << buildStats.sourceTriangles << " source triangles -> "
+              << buildStats.proxyTriangles << " proxy triangles, " << buildStats.gpuBytes / 1024 << " KB + "
+              << buildStats.paletteBytes << " B palette, built in " << buildStats.buildMs << " ms" << std::endl;
+    for (int level = 0; level < buildStats.levels; level++)
+    {
+        const LevelStats &stats = buildStats.level[level];
+        std::cout << "[HLOD]   level " << level << ": " << stats.clusters << " clusters " << chunkSize * static_cast<float>(1 << level)
+                  << " units wide, " << stats.triangles / std::max(stats.clusters, 1) << " triangles each, error "
+                  << stats.minError << "-" << stats.maxError << " units" << std::endl;
+    }
+}
+
+void HlodTree::shutdown()
+{
+    if (vao)
+        glDeleteVertexArrays(1, &vao);
+    if (vbo)
+        glDeleteBuffers(1, &vbo);
+    if (ebo)
+        glDeleteBuffers(1, &ebo);
+    vao = vbo = ebo = 0;
+    for (const Texture &texture : palette)
+        glDeleteTextures(1, &texture.id);
+    palette.clear();
+    clusters.clear();
+    roots.clear();
+    selected.clear();
+    mask.clear();
+    buildStats = Stats{};
+    lastSelection = SelectionStats{};
+}
+
+void HlodTree::select(const glm::vec3 &cameraPosition, const glm::mat4 &projection, const HlodSettings &settings)
+{
+    std::fill(mask.begin(), mask.end(), 0);
+    selected.clear();
+    lastSelection = SelectionStats{};
+    const float pixelsPerUnit = projection[1][1] * settings.viewportHeight * 0.5f;
+    const float maxPixelError = std::max(settings.maxPixelError, 0.0f);
+    for (int root : roots)
+        visit(root, cameraPosition, pixelsPerUnit, maxPixelError);
+
+    // error * pixelsPerUnit / distance = maxPixelError
+    for (int level = 0; level < buildStats.levels && maxPixelError > 0.0f; level++)
+    {
+        lastSelection.switchNear[level] = buildStats.level[level].minError * pixelsPerUnit / maxPixelError;
+        lastSelection.switchFar[level] = buildStats.level[level].maxError * pixelsPerUnit / maxPixelError;
+    }
+}
+
+void HlodTree::visit(int cluster, const glm::vec3 &cameraPosition, float pixelsPerUnit, float maxPixelError)
+{
+    const Cluster &node = clusters[cluster];
+    const glm::vec3 nearest = glm::clamp(cameraPosition, node.bounds.min, node.bounds.max);
+    const float distance = glm::length(cameraPosition - nearest);
+    if (node.error * pixelsPerUnit <= maxPixelError * distance)
+    {
+        selected.push_back(cluster);
+        lastSelection.proxies++;
+        lastSelection.levelProxies[node.level]++;
+        lastSelection.proxyTriangles += static_cast<std::size_t>(node.indexCount / 3);
+        return;
+    }
+    if (node.level == 0)
+    {
+        for (int chunk : node.children)
+            mask[chunk] = 1;
+        lastSelection.chunks += static_cast<int>(node.children.size());
+        return;
+    }
+    for (int child : node.children)
+        visit(child, cameraPosition, pixelsPerUnit, maxPixelError);
+}
+
+int HlodTree::draw(Shader &shader, const Frustum *cullFrustum) const
+{
+    if (selected.empty())
+        return 0;
+    shader.setMat4("model", glm::mat4(1.0f));
+    shader.setBool("lightmapEnabled", false);
+    bindMeshTextures(shader, palette);
+    glBindVertexArray(vao);
+    int drawn = 0;
+    for (int cluster : selected)
+    {
+        const Cluster &node = clusters[cluster];
+        if (node.indexCount == 0 || (cullFrustum && !cullFrustum->intersects(node.bounds)))
+            continue;
+        glDrawElements(GL_TRIANGLES, node.indexCount, GL_UNSIGNED_INT,
+                       (void *)(static_cast<std::size_t>(node.firstIndex) * sizeof(unsigned int)));
+        drawn++;
+    }
+    glBindVertexArray(0);
+    return drawn;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+#include "shader.hpp"
+#include "render/frustum.hpp"
+#include "scene/static_batcher.hpp"
+
+struct HlodSettings
+{
+    bool enabled = true;
+    int levels = 3;             // cluster widths 1, 2, 4, ... batch chunks
+    int triangleBudget = 4000;  // per proxy
+    float maxPixelError = 2.0f; // a proxy stands in once its geometric error projects below this
+    float viewportHeight = 1080.0f; // pixels; main keeps it at the scene resolution
+};
+
+// Hierarchical LOD over the static batch grid. Level 0 clusters are single
+// batch chunks, each level above merges 2x2 clusters of the one below. Every
+// cluster gets one proxy: its triangles (by centroid, as the batcher assigns
+// them) simplified together by vertex clustering until they fit the
+// triangle budget, textured from a palette holding one texel per material
+// (the mean of its diffuse texture). Per frame, clusters are walked from the
+// top: a cluster whose error, projected at its distance, is below
+// maxPixelError draws as its proxy, one draw for the whole block; otherwise
+// its children are tested, and level 0 clusters that fail draw their batch
+// chunk. Proxies carry no lightmap UVs and are lit by the probes.
+class HlodTree
+{
+public:
+    static constexpr int kMaxLevels = 6;
+
+    struct LevelStats
+    {
+        int clusters = 0;
+        std::size_t triangles = 0;
+        float minError = 0.0f; // world units
+        float maxError = 0.0f;
+    };
+
+    struct Stats
+    {
+        int clusters = 0;
+        int levels = 0;
+        int materials = 0;
+        std::size_t sourceTriangles = 0;
+        std::size_t proxyTriangles = 0; // all levels
+        std::size_t gpuBytes = 0;       // proxy vertices and indices
+        std::size_t paletteBytes = 0;
+        float buildMs = 0.0f;
+        std::array<LevelStats, kMaxLevels> level{};
+    };
+
+    // Last select(): what drew, and the distances at which each level's
+    // proxies take over for that camera
+    struct SelectionStats
+    {
+        int proxies = 0;
+        int chunks = 0; // batch chunks left to draw themselves
+        std::size_t proxyTriangles = 0;
+        std::array<int, kMaxLevels> levelProxies{};
+        std::array<float, kMaxLevels> switchNear{};
+        std::array<float, kMaxLevels> switchFar{};
+    };
+
+    // Clusters the batcher's chunks; `sources` must be the ones it was built from
+    void build(const std::vector<StaticBatchSource> &sources, const StaticBatcher &batcher, const HlodSettings &settings);
+    void shutdown();
+    bool ready() const { return !clusters.empty(); }
+
+    // Picks proxies and chunks for the camera; once per frame, before the passes
+    void select(const glm::vec3 &cameraPosition, const glm::mat4 &projection, const HlodSettings &settings);
+    // Per batch chunk: 1 = drawn by the batcher, 0 = covered by a proxy
+    const std::vector<std::uint8_t> &chunkMask() const { return mask; }
+    // The selected proxies inside `cullFrustum` (all when null); leaves
+    // lightmapping off on the shader. Returns draws issued
+    int draw(Shader &shader, const Frustum *cullFrustum = nullptr) const;
+
+    const Stats &stats() const { return buildStats; }
+    const SelectionStats &selectionStats() const { return lastSelection; }
+
+private:
+    struct Cluster
+    {
+        int level = 0;
+        glm::ivec2 cell{0};
+        Aabb bounds;
+        float error = 0.0f; // max distance of a proxy vertex from the geometry it replaces
+        GLuint firstIndex = 0;
+        GLsizei indexCount = 0;
+        std::vector<int> children; // clusters one level down; batch chunks at level 0
+    };
+
+    void visit(int cluster, const glm::vec3 &cameraPosition, float pixelsPerUnit, float maxPixelError);
+
+    std::vector<Cluster> clusters;
+    std::vector<int> roots; // top level
+    std::vector<int> selected;
+    std::vector<std::uint8_t> mask;
+    std::vector<Texture> palette; // one texture_diffuse, a texel per material
+    GLuint vao = 0;
+    GLuint vbo = 0;
+    GLuint ebo = 0;
+    Stats buildStats;
+    SelectionStats lastSelection;
+};
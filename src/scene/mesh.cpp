@@ -1,16 +1,29 @@
 #include "mesh.hpp"
 
+#include <utility>
+
 Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures)
 {
-    this->vertices = vertices;
-    this->indices = indices;
-    this->textures = textures;
+    // Taken over, not copied: imports hand in arrays they no longer need
+    this->vertices = std::move(vertices);
+    this->indices = std::move(indices);
+    this->textures = std::move(textures);
 
     setupMesh();
 }
 
 void Mesh::setupMesh()
 {
+    if (!vertices.empty())
+    {
+        boundsMin = boundsMax = vertices[0].Position;
+        for (const Vertex &vertex : vertices)
+        {
+            boundsMin = glm::min(boundsMin, vertex.Position);
+            boundsMax = glm::max(boundsMax, vertex.Position);
+        }
+    }
+
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
     glGenBuffers(1, &EBO);
@@ -31,11 +44,53 @@ void Mesh::setupMesh()
     // vertex texture coords
     glEnableVertexAttribArray(2);
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, TexCoords));
+    // lightmap texture coords
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, LightmapUV));
 
     glBindVertexArray(0);
 }
 
-void Mesh::Draw(Shader &shader)
+void Mesh::refreshBuffers()
+{
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    glBindVertexArray(0);
+}
+
+void Mesh::setInstances(const std::vector<InstanceData> &instanceData)
+{
+    glBindVertexArray(VAO);
+    if (instanceVBO == 0)
+        glGenBuffers(1, &instanceVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, instanceData.size() * sizeof(InstanceData), instanceData.data(), GL_STATIC_DRAW);
+
+    // instance transform, one vec4 column per location
+    for (GLuint column = 0; column < 4; column++)
+    {
+        glEnableVertexAttribArray(4 + column);
+        glVertexAttribPointer(4 + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (void *)(offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(4 + column, 1);
+    }
+    // instance tint
+    glEnableVertexAttribArray(8);
+    glVertexAttribPointer(8, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void *)offsetof(InstanceData, color));
+    glVertexAttribDivisor(8, 1);
+    // instance lightmap scale/offset
+    glEnableVertexAttribArray(9);
+    glVertexAttribPointer(9, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void *)offsetof(InstanceData, lightmapScaleOffset));
+    glVertexAttribDivisor(9, 1);
+
+    glBindVertexArray(0);
+    instances = static_cast<GLsizei>(instanceData.size());
+}
+
+void bindMeshTextures(Shader &shader, const std::vector<Texture> &textures)
 {
     unsigned int diffuseNr = 1;
     unsigned int specularNr = 1;
@@ -63,10 +118,49 @@ void Mesh::Draw(Shader &shader)
         glBindTexture(GL_TEXTURE_2D, textures[i].id);
     }
     glActiveTexture(GL_TEXTURE0);
+}
+
+bool sameMaterial(const std::vector<Texture> &a, const std::vector<Texture> &b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (std::size_t i = 0; i < a.size(); i++)
+    {
+        if (a[i].id != b[i].id || a[i].type != b[i].type)
+            return false;
+    }
+    return true;
+}
+
+void Mesh::bindTextures(Shader &shader)
+{
+    bindMeshTextures(shader, textures);
+}
+
+void Mesh::Draw(Shader &shader)
+{
+    bindTextures(shader);
 
     glBindVertexArray(VAO);
     glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
     glBindVertexArray(0);
+}
 
-    glActiveTexture(GL_TEXTURE0);
+void Mesh::DrawRanges(Shader &shader, const MeshletDrawList &ranges)
+{
+    bindTextures(shader);
+
+    glBindVertexArray(VAO);
+    glMultiDrawElements(GL_TRIANGLES, ranges.counts.data(), GL_UNSIGNED_INT, ranges.offsets.data(),
+                        static_cast<GLsizei>(ranges.counts.size()));
+    glBindVertexArray(0);
+}
+
+void Mesh::DrawInstanced(Shader &shader, GLsizei instanceCount)
+{
+    bindTextures(shader);
+
+    glBindVertexArray(VAO);
+    glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0, instanceCount);
+    glBindVertexArray(0);
 }
@@ -3,7 +3,33 @@
 #include <iostream>
 #include "texture.hpp"
 
+namespace
+{
+    // Placeholder until the sky image arrives: about its average, sRGB
+    const unsigned char kPlaceholderSky[4] = {6, 8, 18, 255};
+}
+
 bool Skybox::init(const std::filesystem::path &texturePath)
+{
+    createGeometry();
+    textureId = loadSkyboxTexture(texturePath);
+    return textureId != 0;
+}
+
+void Skybox::initPlaceholder()
+{
+    createGeometry();
+    textureId = createTextureFromData(1, 1, kPlaceholderSky, true);
+}
+
+void Skybox::setTexture(const DecodedImage &image)
+{
+    if (textureId == 0)
+        glGenTextures(1, &textureId);
+    uploadSkyboxTexture(textureId, image);
+}
+
+void Skybox::createGeometry()
 {
     const std::array<float, 108> skyboxVertices = {
         // positions
@@ -57,9 +83,6 @@ bool Skybox::init(const std::filesystem::path &texturePath)
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
     glEnableVertexAttribArray(0);
     glBindVertexArray(0);
-
-    textureId = loadSkyboxTexture(texturePath);
-    return textureId != 0;
 }
 
 void Skybox::draw(Shader &skyboxShader, const glm::mat4 &view, const glm::mat4 &projection) const
@@ -0,0 +1,169 @@
+#include "scene/skyline.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+
+#include "core/random.hpp"
+
+namespace
+{
+    constexpr float kPi = 3.14159265358979f;
+    constexpr float kMinScale = 0.8f;
+    constexpr float kMaxScale = 1.5f;
+    // Coarsest mip keeps a view at least this many texels wide; below that the
+    // box filter blends neighbouring views of the atlas into each other
+    constexpr int kMinFrameTexels = 4;
+}
+
+bool Skyline::init(const std::filesystem::path &shaderRoot)
+{
+    shader = std::make_unique<Shader>((shaderRoot / "impostor.vert").string().c_str(),
+                                      (shaderRoot / "impostor.frag").string().c_str());
+
+    const float corners[] = {-1.0f, -1.0f, 1.0f, -1.0f, 1.0f, 1.0f, -1.0f, 1.0f};
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &quadVbo);
+    glGenBuffers(1, &instanceVbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, quadVbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void *)0);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void *)offsetof(Instance, positionYaw));
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void *)offsetof(Instance, scaleLayer));
+    glVertexAttribDivisor(2, 1);
+    glBindVertexArray(0);
+    return shader->ID != 0;
+}
+
+void Skyline::shutdown()
+{
+    if (vao)
+        glDeleteVertexArrays(1, &vao);
+    if (quadVbo)
+        glDeleteBuffers(1, &quadVbo);
+    if (instanceVbo)
+        glDeleteBuffers(1, &instanceVbo);
+    if (albedoTexture)
+        glDeleteTextures(1, &albedoTexture);
+    if (normalDepthTexture)
+        glDeleteTextures(1, &normalDepthTexture);
+    vao = quadVbo = instanceVbo = albedoTexture = normalDepthTexture = 0;
+    instances = 0;
+    spheres.clear();
+    skylineStats = Stats{};
+    shader.reset();
+}
+
+bool Skyline::upload(const ImpostorAtlasData &data, float bakeMs)
+{
+    const int layers = std::min(data.layers(), kMaxLayers);
+    if (layers <= 0 || data.albedo.empty())
+        return false;
+
+    const int size = data.atlasSize();
+    int maxLevel = 0;
+    while ((data.resolution >> (maxLevel + 1)) >= kMinFrameTexels)
+        maxLevel++;
+    GLuint *textures[2] = {&albedoTexture, &normalDepthTexture};
+    const GLenum formats[2] = {GL_SRGB8_ALPHA8, GL_RGBA8};
+    const std::uint8_t *pixels[2] = {data.albedo.data(), data.normalDepth.data()};
+    for (int i = 0; i < 2; i++)
+    {
+        if (*textures[i] == 0)
+            glGenTextures(1, textures[i]);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, *textures[i]);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, formats[i], size, size, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels[i]);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, maxLevel);
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    spheres.assign(data.spheres.begin(), data.spheres.begin() + layers);
+    skylineStats.layers = layers;
+    skylineStats.resolution = data.resolution;
+    skylineStats.frames = data.frames;
+    skylineStats.atlasBytes = impostorBytes(data.resolution, data.frames) * static_cast<std::size_t>(layers);
+    skylineStats.bakeMs = bakeMs;
+    return true;
+}
+
+void Skyline::place(const ImpostorSettings &settings, const glm::vec2 &center)
+{
+    std::vector<Instance> placed;
+    if (!spheres.empty())
+    {
+        std::mt19937 rng(settings.seed);
+        const float inner = std::max(settings.innerRadius, 0.0f);
+        const float outer = std::max(settings.outerRadius, inner);
+        placed.reserve(static_cast<std::size_t>(std::max(settings.skylineCount, 0)));
+        for (int i = 0; i < settings.skylineCount; i++)
+        {
+            // Uniform over the ring's area. One draw per statement fixes the order,
+            // and mt19937 bits alone keep the numbers the same on every standard library
+            const float angle = unitFloat(rng) * 2.0f * kPi;
+            const float radius = std::sqrt(glm::mix(inner * inner, outer * outer, unitFloat(rng)));
+            const float yaw = unitFloat(rng) * 2.0f * kPi;
+            const float scale = glm::mix(kMinScale, kMaxScale, unitFloat(rng));
+            const int building = uniformIndex(rng, static_cast<int>(spheres.size()));
+            Instance instance;
+            instance.positionYaw = glm::vec4(center.x + std::cos(angle) * radius, 0.0f,
+                                             center.y + std::sin(angle) * radius, yaw);
+            instance.scaleLayer = glm::vec4(scale, static_cast<float>(building), 0.0f, 0.0f);
+            placed.push_back(instance);
+        }
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(placed.size() * sizeof(Instance)), placed.data(),
+                 GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    instances = static_cast<GLsizei>(placed.size());
+    skylineStats.instances = instances;
+}
+
+int Skyline::draw(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &moonDirection,
+                  const glm::vec3 &moonColor, const glm::vec3 &ambient) const
+{
+    if (!ready())
+        return 0;
+
+    shader->use();
+    shader->setMat4("view", view);
+    shader->setMat4("projection", projection);
+    shader->setVec3("viewPos", glm::vec3(glm::inverse(view)[3]));
+    shader->setInt("frames", skylineStats.frames);
+    shader->setFloat("tileInset", 0.5f / static_cast<float>(skylineStats.resolution));
+    for (std::size_t i = 0; i < spheres.size(); i++)
+        shader->setVec2("spheres[" + std::to_string(i) + "]", spheres[i]);
+    shader->setVec3("moonDirection", moonDirection);
+    shader->setVec3("moonColor", moonColor);
+    shader->setVec3("ambientColor", ambient);
+    shader->setInt("albedoAtlas", 0);
+    shader->setInt("normalDepthAtlas", 1);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, albedoTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, normalDepthTexture);
+
+    glBindVertexArray(vao);
+    glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, instances);
+    glBindVertexArray(0);
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    return 1;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "shader.hpp"
+#include "bake/impostor_baker.hpp"
+
+// Far-field skyline from baked octahedral impostors: every instance is one
+// camera-facing quad over its building's bounding sphere, and all of them go
+// out in a single instanced draw over the atlas array. Per instance the
+// three grid views around the direction to the camera are blended by their
+// barycentric weights; each view's hit is corrected along the ray by the
+// baked depth (one parallax step) and written as the fragment depth.
+class Skyline
+{
+public:
+    static constexpr int kMaxLayers = 16;
+
+    struct Stats
+    {
+        int layers = 0;
+        int instances = 0;
+        int resolution = 0;
+        int frames = 0;
+        std::size_t atlasBytes = 0; // both atlases with mips
+        float bakeMs = 0.0f;        // 0 when the atlas came from the cache
+    };
+
+    bool init(const std::filesystem::path &shaderRoot);
+    void shutdown();
+    // Replaces the atlases (at most kMaxLayers layers)
+    bool upload(const ImpostorAtlasData &data, float bakeMs);
+    bool ready() const { return albedoTexture != 0 && instances > 0; }
+    // Scatters settings.skylineCount instances over the ring around `center` (xz), from settings.seed
+    void place(const ImpostorSettings &settings, const glm::vec2 &center);
+    // Moon-lit with a constant ambient; returns draws issued
+    int draw(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &moonDirection,
+             const glm::vec3 &moonColor, const glm::vec3 &ambient) const;
+
+    const Stats &stats() const { return skylineStats; }
+    // For per-frame uniforms the draw doesn't set (the fog lookup); null before init
+    Shader *program() const { return shader.get(); }
+
+private:
+    // Instance stream: base position on the ground and yaw, then scale and layer
+    struct Instance
+    {
+        glm::vec4 positionYaw{0.0f};
+        glm::vec4 scaleLayer{0.0f};
+    };
+
+    std::unique_ptr<Shader> shader;
+    GLuint vao = 0;
+    GLuint quadVbo = 0;
+    GLuint instanceVbo = 0;
+    GLuint albedoTexture = 0;
+    GLuint normalDepthTexture = 0;
+    std::vector<glm::vec2> spheres;
+    GLsizei instances = 0;
+    Stats skylineStats;
+};
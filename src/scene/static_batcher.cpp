@@ -0,0 +1,291 @@
+#include "scene/static_batcher.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <utility>
+
+namespace
+{
+    constexpr float kMinChunkSize = 0.5f;
+
+    float elapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::int64_t chunkKey(const glm::vec3 &position, float chunkSize)
+    {
+        const glm::ivec2 cell = StaticBatcher::cellOf(position, chunkSize);
+        return (static_cast<std::int64_t>(cell.x) << 32) | static_cast<std::uint32_t>(cell.y);
+    }
+}
+
+glm::ivec2 StaticBatcher::cellOf(const glm::vec3 &position, float chunkSize)
+{
+    return glm::ivec2(static_cast<std::int32_t>(std::floor(position.x / chunkSize)),
+                      static_cast<std::int32_t>(std::floor(position.z / chunkSize)));
+}
+
+float StaticBatcher::clampChunkSize(float chunkSize)
+{
+    return std::max(chunkSize, kMinChunkSize);
+}
+
+void StaticBatcher::build(const std::vector<StaticBatchSource> &sources, float chunkSize)
+{
+    const auto start = std::chrono::steady_clock::now();
+    shutdown();
+    chunkSize = clampChunkSize(chunkSize);
+    builtChunkSize = chunkSize;
+
+    // Ordered by chunk, then material, so each chunk's batches end up adjacent
+    struct Bucket
+    {
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        Aabb bounds = Aabb::empty();
+    };
+    std::map<std::pair<std::int64_t, int>, Bucket> buckets;
+
+    std::vector<Vertex> transformed;
+    std::vector<std::int64_t> triangleChunks;
+    std::vector<std::size_t> order;
+    std::vector<unsigned int> remap;
+    std::vector<unsigned int> touched;
+    constexpr unsigned int kUnmapped = ~0u;
+    for (const StaticBatchSource &source : sources)
+    {
+        if (!source.mesh || source.mesh->indices.empty())
+            continue;
+        const Mesh &mesh = *source.mesh;
+        buildStats.sources++;
+
+        int material = 0;
+        while (material < static_cast<int>(materials.size()) && !sameMaterial(materials[material], mesh.textures))
+            material++;
+        if (material == static_cast<int>(materials.size()))
+            materials.push_back(mesh.textures);
+
+        // Pre-transform into world space; the lightmap UVs land in the atlas
+        const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(source.world)));
+        transformed.resize(mesh.vertices.size());
+        for (std::size_t v = 0; v < transformed.size(); v++)
+        {
+            const Vertex &in = mesh.vertices[v];
+            Vertex &out = transformed[v];
+            out.Position = glm::vec3(source.world * glm::vec4(in.Position, 1.0f));
+            const glm::vec3 normal = normalMatrix * in.Normal;
+            out.Normal = glm::dot(normal, normal) > 0.0f ? glm::normalize(normal) : normal;
+            out.TexCoords = in.TexCoords;
+            out.LightmapUV = in.LightmapUV * glm::vec2(source.lightmapScaleOffset) +
+                             glm::vec2(source.lightmapScaleOffset.z, source.lightmapScaleOffset.w);
+        }
+
+        // Triangles go to the chunk of their centroid, grouped so each vertex
+        // is copied once per chunk it is used in
+        const std::size_t triangleCount = mesh.indices.size() / 3;
+        triangleChunks.resize(triangleCount);
+        for (std::size_t t = 0; t < triangleCount; t++)
+        {
+            const glm::vec3 centroid = (transformed[mesh.indices[t * 3]].Position +
+                                        transformed[mesh.indices[t * 3 + 1]].Position +
+                                        transformed[mesh.indices[t * 3 + 2]].Position) / 3.0f;
+            triangleChunks[t] = chunkKey(centroid, chunkSize);
+        }
+        order.resize(triangleCount);
+        std::iota(order.begin(), order.end(), std::size_t{0});
+        std::stable_sort(order.begin(), order.end(),
+                         [&](std::size_t a, std::size_t b) { return triangleChunks[a] < triangleChunks[b]; });
+
+        remap.assign(transformed.size(), kUnmapped);
+        Bucket *bucket = nullptr;
+        std::int64_t bucketChunk = 0;
+        touched.clear();
+        for (std::size_t t : order)
+        {
+            if (!bucket || triangleChunks[t] != bucketChunk)
+            {
+                for (unsigned int v : touched)
+                    remap[v] = kUnmapped;
+                touched.clear();
+                bucketChunk = triangleChunks[t];
+                bucket = &buckets[{bucketChunk, material}];
+            }
+            for (int corner = 0; corner < 3; corner++)
+            {
+                const unsigned int v = mesh.indices[t * 3 + corner];
+                if (remap[v] == kUnmapped)
+                {
+                    remap[v] = static_cast<unsigned int>(bucket->vertices.size());
+                    touched.push_back(v);
+                    bucket->vertices.push_back(transformed[v]);
+                    bucket->bounds.expand(Aabb{transformed[v].Position, transformed[v].Position});
+                }
+                bucket->indices.push_back(remap[v]);
+            }
+        }
+    }
+
+    // Concatenate the buckets into one vertex and one index buffer
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::int64_t currentChunk = 0;
+    for (auto &[key, bucket] : buckets)
+    {
+        if (chunks.empty() || key.first != currentChunk)
+        {
+            currentChunk = key.first;
+            Chunk chunk;
+            chunk.bounds = Aabb::empty();
+            chunk.cell = glm::ivec2(static_cast<std::int32_t>(key.first >> 32), static_cast<std::int32_t>(key.first));
+            chunk.firstBatch = static_cast<int>(batches.size());
+            chunks.push_back(chunk);
+        }
+        Chunk &chunk = chunks.back();
+        Batch batch;
+        batch.material = key.second;
+        batch.firstIndex = static_cast<GLuint>(indices.size());
+        batch.indexCount = static_cast<GLsizei>(bucket.indices.size());
+        batch.meshlets = buildMeshlets(bucket.vertices, bucket.indices);
+        for (unsigned int &first : batch.meshlets.firstIndex)
+            first += batch.firstIndex;
+        buildStats.meshlets += static_cast<int>(batch.meshlets.count);
+        const auto baseVertex = static_cast<unsigned int>(vertices.size());
+        for (unsigned int index : bucket.indices)
+            indices.push_back(baseVertex + index);
+        vertices.insert(vertices.end(), bucket.vertices.begin(), bucket.vertices.end());
+        chunk.bounds.expand(bucket.bounds);
+        chunk.batchCount++;
+        batches.push_back(batch);
+    }
+
+    if (!batches.empty())
+    {
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vbo);
+        glGenBuffers(1, &ebo);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+        // Same layout as Mesh, locations 0-3
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, TexCoords));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, LightmapUV));
+        glBindVertexArray(0);
+    }
+
+    buildStats.chunks = static_cast<int>(chunks.size());
+    buildStats.materials = static_cast<int>(materials.size());
+    buildStats.batches = static_cast<int>(batches.size());
+    buildStats.vertices = vertices.size();
+    buildStats.triangles = indices.size() / 3;
+    buildStats.gpuBytes = vertices.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned int);
+    buildStats.buildMs = elapsedMs(start);
+    std::cout << "[Batches] " << buildStats.sources << " placed meshes -> " << buildStats.chunks << " chunks of "
+              << chunkSize << " units x " << buildStats.materials << " materials = " << buildStats.batches
+              << " draws, " << buildStats.vertices << " vertices, " << buildStats.meshlets << " meshlets, built in "
+              << buildStats.buildMs << " ms" << std::endl;
+}
+
+void StaticBatcher::shutdown()
+{
+    if (vao)
+        glDeleteVertexArrays(1, &vao);
+    if (vbo)
+        glDeleteBuffers(1, &vbo);
+    if (ebo)
+        glDeleteBuffers(1, &ebo);
+    vao = vbo = ebo = 0;
+    materials.clear();
+    batches.clear();
+    chunks.clear();
+    buildStats = Stats{};
+}
+
+int StaticBatcher::draw(Shader &shader, const Frustum *cullFrustum, MeshletCuller *meshletCuller,
+                        const std::vector<std::uint8_t> *chunkMask) const
+{
+    if (batches.empty())
+        return 0;
+    shader.setMat4("model", glm::mat4(1.0f));
+    glBindVertexArray(vao);
+    int drawn = 0;
+    int boundMaterial = -1;
+    for (std::size_t c = 0; c < chunks.size(); c++)
+    {
+        const Chunk &chunk = chunks[c];
+        if (chunkMask && !(*chunkMask)[c])
+            continue;
+        if (cullFrustum && !cullFrustum->intersects(chunk.bounds))
+            continue;
+        drawn += drawBatches(shader, chunk, meshletCuller, boundMaterial);
+    }
+    glBindVertexArray(0);
+    return drawn;
+}
+
+int StaticBatcher::drawChunk(Shader &shader, int chunk, MeshletCuller *meshletCuller) const
+{
+    shader.setMat4("model", glm::mat4(1.0f));
+    glBindVertexArray(vao);
+    int boundMaterial = -1;
+    const int drawn = drawBatches(shader, chunks[chunk], meshletCuller, boundMaterial);
+    glBindVertexArray(0);
+    return drawn;
+}
+
+int StaticBatcher::drawBatches(Shader &shader, const Chunk &chunk, MeshletCuller *meshletCuller, int &boundMaterial) const
+{
+    int drawn = 0;
+    for (int b = chunk.firstBatch; b < chunk.firstBatch + chunk.batchCount; b++)
+    {
+        const Batch &batch = batches[b];
+        const MeshletDrawList *ranges = nullptr;
+        if (meshletCuller && !batch.meshlets.empty())
+        {
+            ranges = &meshletCuller->cull(batch.meshlets, glm::mat4(1.0f));
+            if (ranges->counts.empty())
+                continue;
+        }
+        if (batch.material != boundMaterial)
+        {
+            bindMeshTextures(shader, materials[batch.material]);
+            boundMaterial = batch.material;
+        }
+        if (ranges)
+            glMultiDrawElements(GL_TRIANGLES, ranges->counts.data(), GL_UNSIGNED_INT, ranges->offsets.data(),
+                                static_cast<GLsizei>(ranges->counts.size()));
+        else
+            glDrawElements(GL_TRIANGLES, batch.indexCount, GL_UNSIGNED_INT,
+                           (void *)(static_cast<std::size_t>(batch.firstIndex) * sizeof(unsigned int)));
+        drawn++;
+    }
+    return drawn;
+}
+
+StaticBatcher::Visibility StaticBatcher::visibility(const Frustum &frustum) const
+{
+    Visibility result;
+    for (const Chunk &chunk : chunks)
+    {
+        if (!frustum.intersects(chunk.bounds))
+            continue;
+        result.chunks++;
+        result.draws += chunk.batchCount;
+        for (int b = chunk.firstBatch; b < chunk.firstBatch + chunk.batchCount; b++)
+            result.triangles += static_cast<std::size_t>(batches[b].indexCount / 3);
+    }
+    return result;
+}
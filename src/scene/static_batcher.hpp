@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+#include "shader.hpp"
+#include "render/frustum.hpp"
+#include "render/meshlet.hpp"
+
+struct StaticBatchSettings
+{
+    bool enabled = true;
+    float chunkSize = 16.0f; // world units per grid cell on the ground plane
+};
+
+// One placed mesh fed to the batcher
+struct StaticBatchSource
+{
+    const Mesh *mesh = nullptr;
+    glm::mat4 world{1.0f};
+    glm::vec4 lightmapScaleOffset{1.0f, 1.0f, 0.0f, 0.0f}; // applied to the baked LightmapUV
+};
+
+// Import-time static batching. Every source triangle goes to the ground-plane
+// grid chunk holding its world-space centroid; inside a chunk, triangles that
+// share a material (texture set) are merged into one pre-transformed
+// vertex/index range. All ranges live in one vertex and one index buffer, so
+// a frame costs one draw per visible (chunk, material) pair and culling is a
+// bounds test per chunk. Each range is also split into meshlets, so a culler
+// can trim it further. Geometry is baked in world space: moving a node means
+// building again.
+class StaticBatcher
+{
+public:
+    struct Stats
+    {
+        int sources = 0;
+        int chunks = 0;
+        int materials = 0;
+        int batches = 0;         // draws without culling: chunks x materials present in them
+        int meshlets = 0;
+        std::size_t vertices = 0;
+        std::size_t triangles = 0;
+        std::size_t gpuBytes = 0;
+        float buildMs = 0.0f;
+    };
+
+    // Culling result for one view, without drawing
+    struct Visibility
+    {
+        int chunks = 0;
+        int draws = 0;
+        std::size_t triangles = 0;
+    };
+
+    // Replaces the current batches; meshes must be loaded (CPU vertices kept)
+    void build(const std::vector<StaticBatchSource> &sources, float chunkSize);
+    void shutdown();
+    bool empty() const { return batches.empty(); }
+
+    // Draws every batch of the chunks inside `cullFrustum` (all when null) with
+    // an identity model matrix, only their surviving meshlets when a culler is
+    // given; chunks with a zero in `chunkMask` are skipped. Returns draws issued
+    int draw(Shader &shader, const Frustum *cullFrustum = nullptr, MeshletCuller *meshletCuller = nullptr,
+             const std::vector<std::uint8_t> *chunkMask = nullptr) const;
+    Visibility visibility(const Frustum &frustum) const;
+
+    // Per-chunk access for callers that cull chunks themselves
+    int chunkCount() const { return static_cast<int>(chunks.size()); }
+    const Aabb &chunkBounds(int chunk) const { return chunks[chunk].bounds; }
+    // Grid cell (x, z) of a chunk; triangles belong to the cell of their centroid
+    const glm::ivec2 &chunkCell(int chunk) const { return chunks[chunk].cell; }
+    float chunkSize() const { return builtChunkSize; }
+    static glm::ivec2 cellOf(const glm::vec3 &position, float chunkSize);
+    static float clampChunkSize(float chunkSize);
+    int drawChunk(Shader &shader, int chunk, MeshletCuller *meshletCuller = nullptr) const;
+
+    const Stats &stats() const { return buildStats; }
+
+private:
+    struct Batch
+    {
+        int material = 0;
+        GLuint firstIndex = 0;
+        GLsizei indexCount = 0;
+        MeshletSet meshlets; // index ranges already offset into the shared buffer
+    };
+
+    struct Chunk
+    {
+        Aabb bounds;
+        glm::ivec2 cell{0};
+        int firstBatch = 0;
+        int batchCount = 0;
+    };
+
+    int drawBatches(Shader &shader, const Chunk &chunk, MeshletCuller *meshletCuller, int &boundMaterial) const;
+
+    std::vector<std::vector<Texture>> materials;
+    std::vector<Batch> batches;
+    std::vector<Chunk> chunks;
+    GLuint vao = 0;
+    GLuint vbo = 0;
+    GLuint ebo = 0;
+    float builtChunkSize = 0.0f;
+    Stats buildStats;
+};
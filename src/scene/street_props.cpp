@@ -0,0 +1,404 @@
+#include "scene/street_props.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "texture.hpp"
+
+namespace
+{
+    constexpr GLuint kInstanceModelAttrib = 4; // mat4 takes locations 4-7
+    constexpr GLuint kInstanceColorAttrib = 8;
+    constexpr std::size_t kInstanceStride = sizeof(glm::mat4) + sizeof(glm::vec4);
+    constexpr float kLampOffEmission = 0.04f; // unlit glass still catches a little light
+
+    float elapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    bool sameFrustum(const Frustum &a, const Frustum &b)
+    {
+        if (a.planeCount() != b.planeCount())
+            return false;
+        for (int i = 0; i < a.planeCount(); i++)
+        {
+            if (a.plane(i) != b.plane(i))
+                return false;
+        }
+        return true;
+    }
+}
+
+bool StreetProps::init(const std::filesystem::path &placementFile)
+{
+    std::ifstream file(placementFile);
+    if (!file)
+    {
+        std::cerr << "Failed to open street prop placements: " << placementFile << '\n';
+        return false;
+    }
+
+    const std::filesystem::path directory = placementFile.parent_path();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        const std::size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#')
+            continue;
+        if (!parseLine(line, directory))
+            std::cerr << placementFile.filename().string() << ':' << lineNumber << ": skipped \"" << line << "\"\n";
+    }
+
+    const unsigned char white[4] = {255, 255, 255, 255};
+    whiteTexture = createTextureFromData(1, 1, white);
+
+    frameStats = Stats{};
+    for (Prop &prop : props)
+    {
+        prop.fileInstances = prop.transforms.size();
+        finalizeProp(prop);
+        frameStats.props++;
+        frameStats.instances += static_cast<int>(prop.transforms.size());
+    }
+    std::cout << "[Props] " << frameStats.props << " props, " << frameStats.instances << " instances from "
+              << placementFile.filename().string() << std::endl;
+    return !props.empty();
+}
+
+bool StreetProps::parseLine(const std::string &line, const std::filesystem::path &directory)
+{
+    std::istringstream in(line);
+    std::string keyword;
+    in >> keyword;
+
+    if (keyword == "prop")
+    {
+        Prop prop;
+        if (!(in >> prop.name) || findProp(prop.name))
+            return false;
+        std::string modelName;
+        std::string kind;
+        while (in >> modelName >> kind)
+        {
+            if (kind != "lit" && kind != "emissive")
+                return false;
+            Part part;
+            part.model = std::make_unique<Model>((directory / modelName).string());
+            part.emissive = kind == "emissive";
+            if (part.model->meshes.empty())
+            {
+                std::cerr << "Street prop model has no meshes: " << (directory / modelName) << '\n';
+                return false;
+            }
+            for (const Mesh &mesh : part.model->meshes)
+                part.triangles += mesh.indices.size() / 3;
+            prop.parts.push_back(std::move(part));
+        }
+        if (prop.parts.empty())
+            return false;
+        props.push_back(std::move(prop));
+        return true;
+    }
+
+    if (keyword == "light")
+    {
+        std::string name;
+        glm::vec3 offset;
+        if (!(in >> name >> offset.x >> offset.y >> offset.z))
+            return false;
+        Prop *prop = findProp(name);
+        if (!prop)
+            return false;
+        prop->hasLight = true;
+        prop->lightOffset = offset;
+        return true;
+    }
+
+    if (keyword == "row")
+    {
+        std::string name;
+        int count = 0;
+        glm::vec3 position;
+        glm::vec3 step;
+        float yaw = 0.0f;
+        float scale = 1.0f;
+        glm::vec3 color;
+        if (!(in >> name >> count >> position.x >> position.y >> position.z >> step.x >> step.y >> step.z >> yaw >>
+              scale >> color.r >> color.g >> color.b))
+            return false;
+        Prop *prop = findProp(name);
+        if (!prop || count <= 0)
+            return false;
+        for (int i = 0; i < count; i++)
+            addInstance(*prop, position + step * static_cast<float>(i), yaw, scale, color, -1);
+        return true;
+    }
+
+    // Single instance of a declared prop
+    Prop *prop = findProp(keyword);
+    glm::vec3 position;
+    float yaw = 0.0f;
+    float scale = 1.0f;
+    glm::vec3 color;
+    if (!prop || !(in >> position.x >> position.y >> position.z >> yaw >> scale >> color.r >> color.g >> color.b))
+        return false;
+
+    int slot = -1;
+    std::string option;
+    if (in >> option)
+    {
+        if (option != "light" || !(in >> slot) || slot < 0 || slot >= kLightSlots || !prop->hasLight)
+            return false;
+    }
+    addInstance(*prop, position, yaw, scale, color, slot);
+    if (slot >= 0)
+        lightInstance[slot] = {static_cast<int>(prop - props.data()), prop->transforms.size() - 1};
+    return true;
+}
+
+StreetProps::Prop *StreetProps::findProp(const std::string &name)
+{
+    for (Prop &prop : props)
+        if (prop.name == name)
+            return &prop;
+    return nullptr;
+}
+
+void StreetProps::addInstance(Prop &prop, const glm::vec3 &position, float yawDegrees, float scale,
+                              const glm::vec3 &color, int lightSlot)
+{
+    glm::mat4 transform = glm::translate(glm::mat4(1.0f), position);
+    transform = glm::rotate(transform, glm::radians(yawDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
+    transform = glm::scale(transform, glm::vec3(scale));
+    prop.transforms.push_back(transform);
+    prop.colors.emplace_back(color, 1.0f);
+    prop.lightSlots.push_back(lightSlot);
+}
+
+void StreetProps::finalizeProp(Prop &prop)
+{
+    // Object-space sphere around the union of every part's mesh bounds
+    glm::vec3 boundsMin(0.0f);
+    glm::vec3 boundsMax(0.0f);
+    bool first = true;
+    for (const Part &part : prop.parts)
+    {
+        for (const Mesh &mesh : part.model->meshes)
+        {
+            boundsMin = first ? mesh.boundsMin : glm::min(boundsMin, mesh.boundsMin);
+            boundsMax = first ? mesh.boundsMax : glm::max(boundsMax, mesh.boundsMax);
+            first = false;
+        }
+    }
+    prop.boundsCenter = 0.5f * (boundsMin + boundsMax);
+    prop.boundsRadius = 0.5f * glm::length(boundsMax - boundsMin);
+
+    const std::size_t count = prop.transforms.size();
+    prop.centerX.resize(count);
+    prop.centerY.resize(count);
+    prop.centerZ.resize(count);
+    prop.radius.resize(count);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        const glm::mat4 &transform = prop.transforms[i];
+        const glm::vec3 center = glm::vec3(transform * glm::vec4(prop.boundsCenter, 1.0f));
+        const float scale = glm::length(glm::vec3(transform[0]));
+        prop.centerX[i] = center.x;
+        prop.centerY[i] = center.y;
+        prop.centerZ[i] = center.z;
+        prop.radius[i] = prop.boundsRadius * scale;
+    }
+
+    if (prop.instanceVbo == 0)
+        glGenBuffers(1, &prop.instanceVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, prop.instanceVbo);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(std::max<std::size_t>(count, 1) * kInstanceStride), nullptr,
+                 GL_STREAM_DRAW);
+
+    // Every mesh of the prop reads the same per-instance stream
+    for (Part &part : prop.parts)
+    {
+        for (Mesh &mesh : part.model->meshes)
+        {
+            glBindVertexArray(mesh.VAO);
+            glBindBuffer(GL_ARRAY_BUFFER, prop.instanceVbo);
+            for (GLuint column = 0; column < 4; column++)
+            {
+                glEnableVertexAttribArray(kInstanceModelAttrib + column);
+                glVertexAttribPointer(kInstanceModelAttrib + column, 4, GL_FLOAT, GL_FALSE, kInstanceStride,
+                                      reinterpret_cast<void *>(column * sizeof(glm::vec4)));
+                glVertexAttribDivisor(kInstanceModelAttrib + column, 1);
+            }
+            glEnableVertexAttribArray(kInstanceColorAttrib);
+            glVertexAttribPointer(kInstanceColorAttrib, 4, GL_FLOAT, GL_FALSE, kInstanceStride,
+                                  reinterpret_cast<void *>(sizeof(glm::mat4)));
+            glVertexAttribDivisor(kInstanceColorAttrib, 1);
+        }
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+bool StreetProps::setGeneratedInstances(const std::string &name, const std::vector<glm::vec4> &positionYaw,
+                                        const glm::vec3 &color)
+{
+    Prop *prop = findProp(name);
+    if (!prop)
+        return false;
+    frameStats.instances -= static_cast<int>(prop->transforms.size());
+    prop->transforms.resize(prop->fileInstances);
+    prop->colors.resize(prop->fileInstances);
+    prop->lightSlots.resize(prop->fileInstances);
+    for (const glm::vec4 &instance : positionYaw)
+        addInstance(*prop, glm::vec3(instance), instance.w, 1.0f, color, -1);
+    finalizeProp(*prop);
+    frameStats.instances += static_cast<int>(prop->transforms.size());
+    uploaded = false;
+    return true;
+}
+
+void StreetProps::shutdown()
+{
+    for (Prop &prop : props)
+    {
+        if (prop.instanceVbo)
+            glDeleteBuffers(1, &prop.instanceVbo);
+    }
+    props.clear();
+    lightInstance = {};
+    uploaded = false;
+    if (whiteTexture)
+    {
+        glDeleteTextures(1, &whiteTexture);
+        whiteTexture = 0;
+    }
+}
+
+void StreetProps::cull(const Frustum &frustum, const bool lampEnabled[kLightSlots])
+{
+    // Draw counts are per pass; the visible count and upload time stay those of the last real cull
+    frameStats.drawCalls = 0;
+    frameStats.triangles = 0;
+    const bool sameLamps = std::equal(uploadedLamps.begin(), uploadedLamps.end(), lampEnabled);
+    if (uploaded && uploadedCulling == settings.culling && sameLamps && sameFrustum(uploadedFrustum, frustum))
+        return;
+    uploaded = true;
+    uploadedCulling = settings.culling;
+    uploadedFrustum = frustum;
+    std::copy(lampEnabled, lampEnabled + kLightSlots, uploadedLamps.begin());
+
+    const auto start = std::chrono::steady_clock::now();
+    frameStats.visible = 0;
+    std::vector<unsigned int> &visible = visibleScratch;
+    for (Prop &prop : props)
+    {
+        // Test the SoA spheres first, then write only the survivors
+        const std::size_t count = prop.transforms.size();
+        visible.clear();
+        for (std::size_t i = 0; i < count; i++)
+        {
+            if (!settings.culling ||
+                frustum.intersectsSphere(glm::vec3(prop.centerX[i], prop.centerY[i], prop.centerZ[i]), prop.radius[i]))
+                visible.push_back(static_cast<unsigned int>(i));
+        }
+        prop.visibleCount = static_cast<int>(visible.size());
+        frameStats.visible += prop.visibleCount;
+        if (visible.empty())
+            continue;
+
+        // Orphan the previous frame's storage so the driver never stalls on it
+        const auto bytes = static_cast<GLsizeiptr>(visible.size() * kInstanceStride);
+        glBindBuffer(GL_ARRAY_BUFFER, prop.instanceVbo);
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(count * kInstanceStride), nullptr, GL_STREAM_DRAW);
+        auto *mapped = static_cast<unsigned char *>(glMapBufferRange(
+            GL_ARRAY_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+        if (!mapped)
+        {
+            prop.visibleCount = 0;
+            uploaded = false; // try again next pass
+            continue;
+        }
+        for (unsigned int index : visible)
+        {
+            glm::vec4 color = prop.colors[index];
+            const int slot = prop.lightSlots[index];
+            if (slot >= 0 && !lampEnabled[slot])
+                color.a = kLampOffEmission;
+            std::memcpy(mapped, &prop.transforms[index], sizeof(glm::mat4));
+            std::memcpy(mapped + sizeof(glm::mat4), &color, sizeof(glm::vec4));
+            mapped += kInstanceStride;
+        }
+        if (glUnmapBuffer(GL_ARRAY_BUFFER) != GL_TRUE)
+        {
+            prop.visibleCount = 0; // storage was lost; skip the prop this pass
+            uploaded = false;
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    frameStats.cullMs = elapsedMs(start);
+}
+
+void StreetProps::drawLit(Shader &shader)
+{
+    shader.setBool("instanced", true);
+    // The props have no textures: white albedo tinted per instance, no specular map
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, whiteTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    drawParts(shader, false, false);
+    shader.setBool("instanced", false);
+}
+
+void StreetProps::drawEmissive(Shader &lampShader)
+{
+    lampShader.setBool("instanced", true);
+    drawParts(lampShader, true, false);
+    lampShader.setBool("instanced", false);
+}
+
+void StreetProps::drawDepth(Shader &depthShader)
+{
+    depthShader.setBool("instanced", true);
+    drawParts(depthShader, false, true);
+    depthShader.setBool("instanced", false);
+}
+
+void StreetProps::drawParts(Shader &shader, bool emissive, bool depthOnly)
+{
+    for (Prop &prop : props)
+    {
+        if (prop.visibleCount == 0)
+            continue;
+        for (Part &part : prop.parts)
+        {
+            if (!depthOnly && part.emissive != emissive)
+                continue;
+            for (Mesh &mesh : part.model->meshes)
+            {
+                mesh.DrawInstanced(shader, prop.visibleCount);
+                frameStats.drawCalls++;
+            }
+            frameStats.triangles += part.triangles * static_cast<std::size_t>(prop.visibleCount);
+        }
+    }
+}
+
+glm::vec3 StreetProps::lightPosition(int slot) const
+{
+    if (!hasLight(slot))
+        return glm::vec3(0.0f);
+    const Prop &prop = props[lightInstance[slot].prop];
+    return glm::vec3(prop.transforms[lightInstance[slot].instance] * glm::vec4(prop.lightOffset, 1.0f));
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "model.hpp"
+#include "shader.hpp"
+#include "render/frustum.hpp"
+
+struct StreetPropSettings
+{
+    bool enabled = true;
+    bool culling = true; // per-instance frustum culling before the upload
+};
+
+// Data-driven street furniture (lamp posts, benches, signs, bollards). Each
+// prop is one or more models, loaded once; its instances come from a
+// placements file (see resource/props/placements.txt). Before a pass, every
+// prop's instances are tested against the frustum and the survivors are
+// compacted into that prop's orphaned instance buffer (transform + color),
+// which all of its meshes read as per-instance attributes 4-8, so each mesh
+// costs one glDrawElementsInstanced. Lit parts draw with shader.vert/frag,
+// emissive parts (lamp heads) with lampshader.vert/frag.
+class StreetProps
+{
+public:
+    static constexpr int kLightSlots = 8;
+
+    struct Stats
+    {
+        int props = 0;
+        int instances = 0;
+        int visible = 0;
+        int drawCalls = 0;
+        std::size_t triangles = 0;
+        float cullMs = 0.0f; // test, compaction and upload
+    };
+
+    StreetPropSettings settings;
+
+    bool init(const std::filesystem::path &placementFile);
+    void shutdown();
+
+    // Culls and uploads the instances for the next draws; lamp heads whose
+    // light slot is switched off are written dark. A call with the same
+    // frustum and lamps as the last one (the scene pass after the depth
+    // prepass) keeps the instances already uploaded.
+    void cull(const Frustum &frustum, const bool lampEnabled[kLightSlots]);
+    void drawLit(Shader &shader);
+    void drawEmissive(Shader &lampShader);
+    void drawDepth(Shader &depthShader);
+
+    // Instances after the placement file's own (a generated district's
+    // lamps, say), replacing any set before; false for an unknown prop
+    bool setGeneratedInstances(const std::string &name, const std::vector<glm::vec4> &positionYaw,
+                               const glm::vec3 &color);
+
+    // World position of the light carried by the instance bound to `slot`
+    bool hasLight(int slot) const { return slot >= 0 && slot < kLightSlots && lightInstance[slot].prop >= 0; }
+    glm::vec3 lightPosition(int slot) const;
+
+    const Stats &stats() const { return frameStats; }
+
+private:
+    struct Part
+    {
+        std::unique_ptr<Model> model;
+        bool emissive = false;
+        std::size_t triangles = 0;
+    };
+
+    struct Prop
+    {
+        std::string name;
+        std::vector<Part> parts;
+        bool hasLight = false;
+        glm::vec3 lightOffset{0.0f};
+        glm::vec3 boundsCenter{0.0f}; // object-space bounding sphere of all parts
+        float boundsRadius = 0.0f;
+
+        // Instances, with SoA world bounding spheres for the cull loop
+        std::vector<glm::mat4> transforms;
+        std::vector<glm::vec4> colors;
+        std::vector<int> lightSlots; // -1 = none
+        std::vector<float> centerX;
+        std::vector<float> centerY;
+        std::vector<float> centerZ;
+        std::vector<float> radius;
+        std::size_t fileInstances = 0; // from the placement file; generated ones follow
+
+        unsigned int instanceVbo = 0;
+        int visibleCount = 0;
+    };
+
+    struct LightInstance
+    {
+        int prop = -1;
+        std::size_t instance = 0;
+    };
+
+    bool parseLine(const std::string &line, const std::filesystem::path &directory);
+    Prop *findProp(const std::string &name);
+    void addInstance(Prop &prop, const glm::vec3 &position, float yawDegrees, float scale, const glm::vec3 &color, int lightSlot);
+    void finalizeProp(Prop &prop);
+    void drawParts(Shader &shader, bool emissive, bool depthOnly);
+
+    std::vector<Prop> props;
+    std::array<LightInstance, kLightSlots> lightInstance{};
+    unsigned int whiteTexture = 0; // albedo for parts without a diffuse map; the instance color tints it
+    Stats frameStats;
+
+    // What the instance buffers hold: the view and lamp states of the last cull
+    bool uploaded = false;
+    Frustum uploadedFrustum;
+    std::array<bool, kLightSlots> uploadedLamps{};
+    bool uploadedCulling = true;
+    std::vector<unsigned int> visibleScratch;
+};
@@ -0,0 +1,118 @@
+#include "scene/transform_hierarchy.hpp"
+
+#include <algorithm>
+
+int TransformHierarchy::add(int parent, const glm::mat4 &local)
+{
+    const int node = static_cast<int>(parents.size());
+    parents.push_back(parent < node ? parent : kNoParent);
+    locals.push_back(local);
+    worlds.push_back(local);
+    localBounds.push_back(Aabb::empty());
+    ownBounds.push_back(Aabb::empty());
+    treeBounds.push_back(Aabb::empty());
+    dirty.push_back(1);
+    updated.push_back(0);
+    boundsChanged.push_back(0);
+    firstDirty = std::min(firstDirty, static_cast<std::size_t>(node));
+    return node;
+}
+
+void TransformHierarchy::clear()
+{
+    parents.clear();
+    locals.clear();
+    worlds.clear();
+    localBounds.clear();
+    ownBounds.clear();
+    treeBounds.clear();
+    dirty.clear();
+    updated.clear();
+    boundsChanged.clear();
+    firstDirty = 0;
+}
+
+void TransformHierarchy::truncate(std::size_t count)
+{
+    if (count >= parents.size())
+        return;
+    // Surviving parents of dropped nodes (and so their ancestors) lose part of their subtree bounds
+    for (std::size_t i = count; i < parents.size(); i++)
+    {
+        const int parent = parents[i];
+        if (parent != kNoParent && static_cast<std::size_t>(parent) < count)
+        {
+            dirty[parent] = 1;
+            firstDirty = std::min(firstDirty, static_cast<std::size_t>(parent));
+        }
+    }
+    parents.resize(count);
+    locals.resize(count);
+    worlds.resize(count);
+    localBounds.resize(count);
+    ownBounds.resize(count);
+    treeBounds.resize(count);
+    dirty.resize(count);
+    updated.resize(count);
+    boundsChanged.resize(count);
+    firstDirty = std::min(firstDirty, count);
+}
+
+void TransformHierarchy::setLocal(int node, const glm::mat4 &local)
+{
+    locals[node] = local;
+    dirty[node] = 1;
+    firstDirty = std::min(firstDirty, static_cast<std::size_t>(node));
+}
+
+void TransformHierarchy::setLocalBounds(int node, const Aabb &bounds)
+{
+    localBounds[node] = bounds;
+    dirty[node] = 1;
+    firstDirty = std::min(firstDirty, static_cast<std::size_t>(node));
+}
+
+int TransformHierarchy::update()
+{
+    std::fill(updated.begin(), updated.end(), 0);
+    const std::size_t count = parents.size();
+    if (firstDirty >= count)
+        return 0;
+
+    // Parents precede children, so one forward pass sees every parent resolved
+    int recomputed = 0;
+    for (std::size_t i = firstDirty; i < count; i++)
+    {
+        const int parent = parents[i];
+        if (!dirty[i] && (parent == kNoParent || !updated[parent]))
+            continue;
+        worlds[i] = parent == kNoParent ? locals[i] : worlds[parent] * locals[i];
+        ownBounds[i] = localBounds[i].transformed(worlds[i]);
+        dirty[i] = 0;
+        updated[i] = 1;
+        recomputed++;
+    }
+    firstDirty = count;
+
+    // Subtree bounds change for the moved nodes and all their ancestors
+    std::fill(boundsChanged.begin(), boundsChanged.end(), 0);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        if (!updated[i])
+            continue;
+        for (int node = static_cast<int>(i); node != kNoParent && !boundsChanged[node]; node = parents[node])
+        {
+            boundsChanged[node] = 1;
+            treeBounds[node] = ownBounds[node];
+        }
+    }
+    // Children follow their parents, so walking backwards finishes every
+    // subtree before it is merged upwards
+    for (std::size_t i = count; i-- > 0;)
+    {
+        const int parent = parents[i];
+        if (parent != kNoParent && boundsChanged[parent])
+            treeBounds[parent].expand(treeBounds[i]);
+    }
+    return recomputed;
+}
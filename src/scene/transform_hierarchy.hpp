@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "render/frustum.hpp"
+
+// Scene-graph transforms stored flat in topological order: every parent comes
+// before its children, so world matrices resolve in one forward pass. setLocal
+// marks a node dirty; update() starts at the first dirty index, recomputes the
+// world matrix of every dirty node and of everything below one, and skips the
+// rest. Each node also carries the bounds of the geometry attached to it, kept
+// in world space for the node alone and for its whole subtree.
+class TransformHierarchy
+{
+public:
+    static constexpr int kNoParent = -1;
+
+    // Appends a node below `parent`, which must already exist; returns its index
+    int add(int parent, const glm::mat4 &local);
+    void clear();
+    // Drops every node from `count` on; parents come first, so no survivor loses its parent
+    void truncate(std::size_t count);
+    std::size_t size() const { return parents.size(); }
+
+    int parent(int node) const { return parents[node]; }
+    const glm::mat4 &local(int node) const { return locals[node]; }
+    const glm::mat4 &world(int node) const { return worlds[node]; }
+    void setLocal(int node, const glm::mat4 &local);
+
+    // Bounds of the geometry attached to the node, in the node's space
+    void setLocalBounds(int node, const Aabb &bounds);
+    const Aabb &localBoundsOf(int node) const { return localBounds[node]; }
+    // World bounds of the node's own geometry, and with all its descendants;
+    // empty when there is no geometry
+    const Aabb &worldBounds(int node) const { return ownBounds[node]; }
+    const Aabb &subtreeBounds(int node) const { return treeBounds[node]; }
+
+    // Resolves the dirty subtrees; returns the number of world matrices recomputed
+    int update();
+    // World matrix recomputed by the last update()
+    bool changed(int node) const { return updated[node] != 0; }
+
+private:
+    std::vector<int> parents;
+    std::vector<glm::mat4> locals;
+    std::vector<glm::mat4> worlds;
+    std::vector<Aabb> localBounds;
+    std::vector<Aabb> ownBounds;
+    std::vector<Aabb> treeBounds;
+    std::vector<std::uint8_t> dirty;
+    std::vector<std::uint8_t> updated;
+    std::vector<std::uint8_t> boundsChanged; // scratch for the subtree bounds pass
+    std::size_t firstDirty = 0; // size() when nothing is dirty
+};
@@ -0,0 +1,543 @@
+#include "scene/world_streamer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <utility>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace
+{
+    constexpr std::uint32_t kPackageMagic = 0x4c495454u; // "TTIL"
+    constexpr std::uint32_t kPackageVersion = 1;
+    constexpr std::size_t kUploadSliceBytes = 256 * 1024;
+
+    std::uint64_t fnv1a(std::uint64_t hash, const void *data, std::size_t bytes)
+    {
+        const auto *p = static_cast<const std::uint8_t *>(data);
+        for (std::size_t i = 0; i < bytes; i++)
+        {
+            hash ^= p[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    float elapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // On the ground plane: height does not bring a tile nearer
+    float groundDistance(const glm::vec3 &point, const Aabb &bounds)
+    {
+        const float dx = std::max({bounds.min.x - point.x, 0.0f, point.x - bounds.max.x});
+        const float dz = std::max({bounds.min.z - point.z, 0.0f, point.z - bounds.max.z});
+        return std::sqrt(dx * dx + dz * dz);
+    }
+}
+
+bool TilePackage::save(const std::filesystem::path &path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    const std::uint64_t counts[3] = {vertices.size(), indices.size(), ranges.size()};
+    file.write(reinterpret_cast<const char *>(&kPackageMagic), sizeof(kPackageMagic));
+    file.write(reinterpret_cast<const char *>(&kPackageVersion), sizeof(kPackageVersion));
+    file.write(reinterpret_cast<const char *>(&key), sizeof(key));
+    file.write(reinterpret_cast<const char *>(&bounds), sizeof(bounds));
+    file.write(reinterpret_cast<const char *>(counts), sizeof(counts));
+    file.write(reinterpret_cast<const char *>(ranges.data()), static_cast<std::streamsize>(ranges.size() * sizeof(Range)));
+    file.write(reinterpret_cast<const char *>(vertices.data()),
+               static_cast<std::streamsize>(vertices.size() * sizeof(Vertex)));
+    file.write(reinterpret_cast<const char *>(indices.data()),
+               static_cast<std::streamsize>(indices.size() * sizeof(unsigned int)));
+    return static_cast<bool>(file);
+}
+
+bool TilePackage::load(const std::filesystem::path &path, std::uint64_t expectedKey)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    std::uint32_t magic = 0;
+    std::uint32_t version = 0;
+    std::uint64_t fileKey = 0;
+    Aabb fileBounds;
+    std::uint64_t counts[3] = {0, 0, 0};
+    file.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+    file.read(reinterpret_cast<char *>(&version), sizeof(version));
+    file.read(reinterpret_cast<char *>(&fileKey), sizeof(fileKey));
+    file.read(reinterpret_cast<char *>(&fileBounds), sizeof(fileBounds));
+    file.read(reinterpret_cast<char *>(counts), sizeof(counts));
+    if (!file || magic != kPackageMagic || version != kPackageVersion || fileKey != expectedKey)
+        return false;
+
+    std::vector<Range> fileRanges(counts[2]);
+    std::vector<Vertex> fileVertices(counts[0]);
+    std::vector<unsigned int> fileIndices(counts[1]);
+    file.read(reinterpret_cast<char *>(fileRanges.data()), static_cast<std::streamsize>(fileRanges.size() * sizeof(Range)));
+    file.read(reinterpret_cast<char *>(fileVertices.data()),
+              static_cast<std::streamsize>(fileVertices.size() * sizeof(Vertex)));
+    file.read(reinterpret_cast<char *>(fileIndices.data()),
+              static_cast<std::streamsize>(fileIndices.size() * sizeof(unsigned int)));
+    if (!file)
+        return false;
+    for (const Range &range : fileRanges)
+    {
+        if (static_cast<std::uint64_t>(range.firstIndex) + range.indexCount > fileIndices.size())
+            return false;
+    }
+
+    key = fileKey;
+    bounds = fileBounds;
+    ranges = std::move(fileRanges);
+    vertices = std::move(fileVertices);
+    indices = std::move(fileIndices);
+    return true;
+}
+
+WorldStreamer::~WorldStreamer()
+{
+    stopLoader();
+}
+
+void WorldStreamer::setTiles(const std::vector<Mesh> *sourceMeshes, std::vector<StreamTileDesc> descs,
+                             const std::filesystem::path &directory)
+{
+    shutdown();
+    if (!sourceMeshes || descs.empty())
+        return;
+    meshes = sourceMeshes;
+    cacheDirectory = directory;
+    std::error_code error;
+    std::filesystem::create_directories(cacheDirectory, error);
+
+    // One material per distinct texture set, as the static batcher merges them
+    meshMaterials.assign(meshes->size(), 0);
+    for (std::size_t m = 0; m < meshes->size(); m++)
+    {
+        const std::vector<Texture> &textures = (*meshes)[m].textures;
+        int material = 0;
+        while (material < static_cast<int>(materials.size()) && !sameMaterial(materials[material], textures))
+            material++;
+        if (material == static_cast<int>(materials.size()))
+            materials.push_back(textures);
+        meshMaterials[m] = material;
+    }
+
+    // Packages outlive the run, so keys cover the geometry and textures themselves;
+    // each mesh is hashed once however many tiles use it
+    std::vector<std::uint64_t> meshKeys(meshes->size(), 0);
+    std::vector<bool> meshHashed(meshes->size(), false);
+    auto meshKey = [&](int m) {
+        if (!meshHashed[m])
+        {
+            const Mesh &mesh = (*meshes)[m];
+            std::uint64_t hash = 1469598103934665603ull;
+            hash = fnv1a(hash, mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+            hash = fnv1a(hash, mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+            for (const Texture &texture : mesh.textures)
+            {
+                hash = fnv1a(hash, texture.type.data(), texture.type.size());
+                hash = fnv1a(hash, texture.path.data(), texture.path.size());
+            }
+            meshKeys[m] = hash;
+            meshHashed[m] = true;
+        }
+        return meshKeys[m];
+    };
+
+    // Keys and sizes up front: the budget is checked before a package is read
+    tiles.resize(descs.size());
+    for (std::size_t t = 0; t < descs.size(); t++)
+    {
+        Tile &tile = tiles[t];
+        tile.desc = std::move(descs[t]);
+        tile.bounds = Aabb::empty();
+        std::uint64_t hash = 1469598103934665603ull;
+        hash = fnv1a(hash, &kPackageVersion, sizeof(kPackageVersion));
+        for (const StreamTilePart &part : tile.desc.parts)
+        {
+            const Mesh &mesh = (*meshes)[part.mesh];
+            const std::uint64_t content = meshKey(part.mesh);
+            hash = fnv1a(hash, &part.mesh, sizeof(part.mesh));
+            hash = fnv1a(hash, &content, sizeof(content));
+            hash = fnv1a(hash, &meshMaterials[part.mesh], sizeof(int));
+            hash = fnv1a(hash, &part.local, sizeof(part.local));
+            tile.bytes += mesh.vertices.size() * sizeof(Vertex) + mesh.indices.size() * sizeof(unsigned int);
+            const glm::mat4 world = glm::translate(glm::mat4(1.0f), tile.desc.origin) * part.local;
+            tile.bounds.expand(Aabb{mesh.boundsMin, mesh.boundsMax}.transformed(world));
+        }
+        tile.key = hash;
+    }
+    distances.assign(tiles.size(), 0.0f);
+    streamStats.tiles = static_cast<int>(tiles.size());
+
+    stopping = false;
+    loader = std::thread(&WorldStreamer::loaderLoop, this);
+    std::cout << "[Streaming] " << tiles.size() << " tiles, " << materials.size() << " materials, packages in "
+              << cacheDirectory.string() << std::endl;
+}
+
+void WorldStreamer::shutdown()
+{
+    stopLoader();
+    for (std::size_t t = 0; t < tiles.size(); t++)
+        evict(static_cast<int>(t));
+    tiles.clear();
+    uploads.clear();
+    requests.clear();
+    loaded.clear();
+    materials.clear();
+    meshMaterials.clear();
+    distances.clear();
+    meshes = nullptr;
+    latencySamples = 0;
+    streamStats = Stats{};
+}
+
+void WorldStreamer::stopLoader()
+{
+    if (!loader.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeLoader.notify_all();
+    loader.join();
+}
+
+void WorldStreamer::loaderLoop()
+{
+    for (;;)
+    {
+        int index = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeLoader.wait(lock, [this] { return stopping || !requests.empty(); });
+            if (stopping)
+                return;
+            index = requests.front();
+            requests.pop_front();
+        }
+
+        // Tiles are only replaced after this thread has stopped, so the
+        // descriptor and the meshes stay put while it works
+        const Tile &tile = tiles[index];
+        Loaded result;
+        result.tile = index;
+        const std::filesystem::path path = packagePath(tile.key);
+        if (!result.package.load(path, tile.key))
+        {
+            result.package = cook(tile);
+            result.cooked = true;
+            if (!result.package.save(path))
+                std::cerr << "Failed to write tile package: " << path << '\n';
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        loaded.push_back(std::move(result));
+    }
+}
+
+TilePackage WorldStreamer::cook(const Tile &tile) const
+{
+    // Parts sorted by material, so each material is one contiguous range
+    std::vector<std::size_t> order(tile.desc.parts.size());
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        return meshMaterials[tile.desc.parts[a].mesh] < meshMaterials[tile.desc.parts[b].mesh];
+    });
+
+    TilePackage package;
+    package.key = tile.key;
+    package.bounds = Aabb::empty();
+    package.vertices.reserve(tile.bytes / sizeof(Vertex));
+    for (std::size_t p : order)
+    {
+        const StreamTilePart &part = tile.desc.parts[p];
+        const Mesh &mesh = (*meshes)[part.mesh];
+        const int material = meshMaterials[part.mesh];
+        if (package.ranges.empty() || package.ranges.back().material != material)
+        {
+            TilePackage::Range range;
+            range.material = material;
+            range.firstIndex = static_cast<std::uint32_t>(package.indices.size());
+            package.ranges.push_back(range);
+        }
+
+        const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(part.local)));
+        const auto baseVertex = static_cast<unsigned int>(package.vertices.size());
+        for (const Vertex &in : mesh.vertices)
+        {
+            Vertex out;
+            out.Position = glm::vec3(part.local * glm::vec4(in.Position, 1.0f));
+            const glm::vec3 normal = normalMatrix * in.Normal;
+            out.Normal = glm::dot(normal, normal) > 0.0f ? glm::normalize(normal) : normal;
+            out.TexCoords = in.TexCoords;
+            out.LightmapUV = glm::vec2(0.0f); // tiles are outside the lightmap
+            package.bounds.expand(Aabb{out.Position, out.Position});
+            package.vertices.push_back(out);
+        }
+        for (unsigned int index : mesh.indices)
+            package.indices.push_back(baseVertex + index);
+        package.ranges.back().indexCount += static_cast<std::uint32_t>(mesh.indices.size());
+    }
+    return package;
+}
+
+std::filesystem::path WorldStreamer::packagePath(std::uint64_t key) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.tile", static_cast<unsigned long long>(key));
+    return cacheDirectory / name;
+}
+
+void WorldStreamer::evict(int index)
+{
+    Tile &tile = tiles[index];
+    if (tile.state == TileState::Unloaded)
+        return;
+    if (tile.state == TileState::Loading)
+    {
+        // Still queued: drop the request; held by the loader: its result is dropped on arrival
+        std::lock_guard<std::mutex> lock(mutex);
+        requests.erase(std::remove(requests.begin(), requests.end(), index), requests.end());
+    }
+    else if (tile.state == TileState::Uploading)
+    {
+        uploads.erase(std::remove_if(uploads.begin(), uploads.end(),
+                                     [index](const Upload &upload) { return upload.tile == index; }),
+                      uploads.end());
+    }
+    else
+    {
+        streamStats.residentBytes -= tile.bytes;
+        streamStats.resident--;
+        streamStats.evicted++;
+    }
+    if (tile.vao)
+        glDeleteVertexArrays(1, &tile.vao);
+    if (tile.vbo)
+        glDeleteBuffers(1, &tile.vbo);
+    if (tile.ebo)
+        glDeleteBuffers(1, &tile.ebo);
+    tile.vao = tile.vbo = tile.ebo = 0;
+    tile.ranges.clear();
+    tile.state = TileState::Unloaded;
+}
+
+void WorldStreamer::update(const WorldStreamingSettings &settings, const glm::vec3 &cameraPosition,
+                           const glm::vec3 &cameraVelocity)
+{
+    if (tiles.empty())
+        return;
+    const std::size_t budget = static_cast<std::size_t>(std::max(settings.budgetMB, 0)) * 1024 * 1024;
+    streamStats.budgetBytes = budget;
+
+    // Packages the loader finished; those evicted meanwhile are dropped
+    std::vector<Loaded> arrived;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        arrived.swap(loaded);
+    }
+    for (Loaded &result : arrived)
+    {
+        Tile &tile = tiles[result.tile];
+        if (result.cooked)
+            streamStats.cooked++;
+        if (tile.state != TileState::Loading)
+            continue;
+        tile.state = TileState::Uploading;
+        Upload upload;
+        upload.tile = result.tile;
+        upload.package = std::move(result.package);
+        uploads.push_back(std::move(upload));
+    }
+
+    // Nearest of now and where the camera is headed
+    const glm::vec3 ahead = cameraPosition + cameraVelocity * std::max(settings.prefetchSeconds, 0.0f);
+    const float evictRadius = std::max(settings.evictRadius, settings.loadRadius);
+    for (std::size_t t = 0; t < tiles.size(); t++)
+    {
+        distances[t] = std::min(groundDistance(cameraPosition, tiles[t].bounds), groundDistance(ahead, tiles[t].bounds));
+        if (distances[t] > evictRadius)
+            evict(static_cast<int>(t));
+    }
+
+    std::vector<int> wanted;
+    std::size_t committed = 0;
+    int inFlight = 0;
+    for (std::size_t t = 0; t < tiles.size(); t++)
+    {
+        const TileState state = tiles[t].state;
+        if (state == TileState::Unloaded && distances[t] < settings.loadRadius)
+            wanted.push_back(static_cast<int>(t));
+        if (state != TileState::Unloaded)
+            committed += tiles[t].bytes;
+        if (state == TileState::Loading || state == TileState::Uploading)
+            inFlight++;
+    }
+    std::sort(wanted.begin(), wanted.end(), [&](int a, int b) { return distances[a] < distances[b]; });
+
+    // Nearest first; over the budget, resident tiles farther than the
+    // candidate make room, farthest first
+    streamStats.budgetFull = false;
+    for (int index : wanted)
+    {
+        if (inFlight >= std::max(settings.maxInFlight, 1))
+            break;
+        Tile &tile = tiles[index];
+        while (committed + tile.bytes > budget)
+        {
+            int farthest = -1;
+            for (std::size_t t = 0; t < tiles.size(); t++)
+            {
+                if (tiles[t].state == TileState::Resident && distances[t] > distances[index] &&
+                    (farthest < 0 || distances[t] > distances[farthest]))
+                    farthest = static_cast<int>(t);
+            }
+            if (farthest < 0)
+                break;
+            committed -= tiles[farthest].bytes;
+            evict(farthest);
+        }
+        if (committed + tile.bytes > budget)
+        {
+            streamStats.budgetFull = true;
+            break;
+        }
+        committed += tile.bytes;
+        inFlight++;
+        tile.state = TileState::Loading;
+        tile.requested = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            requests.push_back(index);
+        }
+        wakeLoader.notify_one();
+    }
+
+    // Time-sliced uploads: at least one slice so streaming always progresses
+    const auto uploadStart = std::chrono::steady_clock::now();
+    streamStats.uploadSlices = 0;
+    while (!uploads.empty())
+    {
+        Upload &upload = uploads.front();
+        streamStats.uploadSlices++;
+        if (uploadSlice(upload))
+        {
+            Tile &tile = tiles[upload.tile];
+            tile.state = TileState::Resident;
+            streamStats.resident++;
+            streamStats.residentBytes += tile.bytes;
+            const float latency = elapsedMs(tile.requested);
+            latencySamples++;
+            streamStats.lastLatencyMs = latency;
+            streamStats.maxLatencyMs = std::max(streamStats.maxLatencyMs, latency);
+            streamStats.averageLatencyMs += (latency - streamStats.averageLatencyMs) / static_cast<float>(latencySamples);
+            uploads.pop_front();
+        }
+        if (elapsedMs(uploadStart) >= settings.uploadBudgetMs)
+            break;
+    }
+    streamStats.uploadMs = elapsedMs(uploadStart);
+
+    streamStats.loading = 0;
+    for (const Tile &tile : tiles)
+    {
+        if (tile.state == TileState::Loading || tile.state == TileState::Uploading)
+            streamStats.loading++;
+    }
+}
+
+bool WorldStreamer::uploadSlice(Upload &upload)
+{
+    Tile &tile = tiles[upload.tile];
+    const TilePackage &package = upload.package;
+    const std::size_t vertexBytes = package.vertices.size() * sizeof(Vertex);
+    const std::size_t indexBytes = package.indices.size() * sizeof(unsigned int);
+    if (tile.vbo == 0)
+    {
+        // Storage first, contents in slices through the copy target (no VAO needed)
+        glGenBuffers(1, &tile.vbo);
+        glGenBuffers(1, &tile.ebo);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, tile.vbo);
+        glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(vertexBytes), nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, tile.ebo);
+        glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(indexBytes), nullptr, GL_STATIC_DRAW);
+    }
+
+    std::size_t budget = kUploadSliceBytes;
+    if (upload.vertexBytesDone < vertexBytes)
+    {
+        const std::size_t size = std::min(budget, vertexBytes - upload.vertexBytesDone);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, tile.vbo);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(upload.vertexBytesDone), static_cast<GLsizeiptr>(size),
+                        reinterpret_cast<const std::uint8_t *>(package.vertices.data()) + upload.vertexBytesDone);
+        upload.vertexBytesDone += size;
+        budget -= size;
+    }
+    if (budget > 0 && upload.indexBytesDone < indexBytes)
+    {
+        const std::size_t size = std::min(budget, indexBytes - upload.indexBytesDone);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, tile.ebo);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(upload.indexBytesDone), static_cast<GLsizeiptr>(size),
+                        reinterpret_cast<const std::uint8_t *>(package.indices.data()) + upload.indexBytesDone);
+        upload.indexBytesDone += size;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    if (upload.vertexBytesDone < vertexBytes || upload.indexBytesDone < indexBytes)
+        return false;
+
+    glGenVertexArrays(1, &tile.vao);
+    glBindVertexArray(tile.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, tile.vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, tile.ebo);
+    // Same layout as Mesh, locations 0-3
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Normal));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, TexCoords));
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, LightmapUV));
+    glBindVertexArray(0);
+    tile.ranges = package.ranges;
+    tile.bounds = package.bounds.transformed(glm::translate(glm::mat4(1.0f), tile.desc.origin));
+    return true;
+}
+
+int WorldStreamer::draw(Shader &shader, const Frustum *cullFrustum) const
+{
+    int drawn = 0;
+    int boundMaterial = -1;
+    for (const Tile &tile : tiles)
+    {
+        if (tile.state != TileState::Resident || (cullFrustum && !cullFrustum->intersects(tile.bounds)))
+            continue;
+        shader.setMat4("model", glm::translate(glm::mat4(1.0f), tile.desc.origin));
+        glBindVertexArray(tile.vao);
+        for (const TilePackage::Range &range : tile.ranges)
+        {
+            if (range.material != boundMaterial)
+            {
+                bindMeshTextures(shader, materials[range.material]);
+                boundMaterial = range.material;
+            }
+            glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(range.indexCount), GL_UNSIGNED_INT,
+                           (void *)(static_cast<std::size_t>(range.firstIndex) * sizeof(unsigned int)));
+            drawn++;
+        }
+    }
+    glBindVertexArray(0);
+    return drawn;
+}
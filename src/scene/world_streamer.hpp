@@ -0,0 +1,182 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+#include "shader.hpp"
+#include "render/frustum.hpp"
+
+struct WorldStreamingSettings
+{
+    bool enabled = true;          // generated districts stream their blocks as tiles
+    float loadRadius = 110.0f;    // tiles nearer than this (ground distance to their bounds) are loaded
+    float evictRadius = 150.0f;   // resident tiles are dropped only past this (hysteresis)
+    int budgetMB = 512;           // resident tile geometry
+    float uploadBudgetMs = 1.5f;  // GL upload time per frame
+    float prefetchSeconds = 2.0f; // tiles this far ahead along the camera's velocity count as near
+    int maxInFlight = 4;          // tiles being read, cooked or uploaded at once
+};
+
+// One mesh of a tile, placed relative to the tile's origin
+struct StreamTilePart
+{
+    int mesh = -1; // into the streamer's meshes
+    glm::mat4 local{1.0f};
+};
+
+struct StreamTileDesc
+{
+    glm::ivec2 cell{0};
+    glm::vec3 origin{0.0f}; // tile space origin in the world
+    std::vector<StreamTilePart> parts;
+};
+
+// A tile's baked package: its parts pre-transformed into tile space and
+// merged into one index range per material. Saved as one file per distinct
+// content, so identical tiles share it on disk.
+struct TilePackage
+{
+    struct Range
+    {
+        std::int32_t material = 0; // into the streamer's material table
+        std::uint32_t firstIndex = 0;
+        std::uint32_t indexCount = 0;
+    };
+
+    std::uint64_t key = 0;
+    Aabb bounds; // tile space
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<Range> ranges;
+
+    std::size_t bytes() const { return vertices.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned int); }
+    bool save(const std::filesystem::path &path) const;
+    // Fails when the file is missing, truncated or baked from other content
+    bool load(const std::filesystem::path &path, std::uint64_t expectedKey);
+};
+
+// World partition for generated districts: every block is a tile with its
+// own baked package, cooked from the city meshes the first time it is needed
+// and read back from the cache after that. A loader thread reads or cooks
+// packages as the camera approaches; the main thread uploads them in slices
+// under a per-frame time budget and evicts tiles past the hysteresis radius
+// or, when the memory budget is full, the farthest ones. Distances are taken
+// from the camera and from its position a few seconds ahead, so tiles along
+// the direction of travel arrive early. Textures are the city's own and stay
+// resident; packages carry geometry and material ids.
+class WorldStreamer
+{
+public:
+    struct Stats
+    {
+        int tiles = 0;
+        int resident = 0;
+        int loading = 0;      // queued, being read or cooked, or uploading
+        int cooked = 0;       // packages built because the cache had none, since setTiles
+        int evicted = 0;      // since setTiles
+        bool budgetFull = false; // last frame left a wanted tile waiting for memory
+        std::size_t residentBytes = 0;
+        std::size_t budgetBytes = 0;
+        float uploadMs = 0.0f; // GL upload time of the last frame
+        int uploadSlices = 0;  // of the last frame
+        float lastLatencyMs = 0.0f; // request to drawable
+        float averageLatencyMs = 0.0f;
+        float maxLatencyMs = 0.0f;
+    };
+
+    WorldStreamer() = default;
+    ~WorldStreamer();
+    WorldStreamer(const WorldStreamer &) = delete;
+    WorldStreamer &operator=(const WorldStreamer &) = delete;
+
+    // Replaces the tiles and starts the loader; `meshes` are read by it
+    // (CPU vertices kept) until the next setTiles or shutdown
+    void setTiles(const std::vector<Mesh> *meshes, std::vector<StreamTileDesc> tiles,
+                  const std::filesystem::path &cacheDirectory);
+    void shutdown();
+    bool empty() const { return tiles.empty(); }
+
+    // Per frame: collects loaded packages, evicts, requests and uploads
+    void update(const WorldStreamingSettings &settings, const glm::vec3 &cameraPosition,
+                const glm::vec3 &cameraVelocity);
+    // Resident tiles inside `cullFrustum` (all when null); returns draws issued
+    int draw(Shader &shader, const Frustum *cullFrustum) const;
+
+    const Stats &stats() const { return streamStats; }
+
+private:
+    enum class TileState
+    {
+        Unloaded,
+        Loading,   // queued for or held by the loader
+        Uploading,
+        Resident,
+    };
+
+    struct Tile
+    {
+        StreamTileDesc desc;
+        std::uint64_t key = 0;
+        std::size_t bytes = 0; // package size, known before it is loaded
+        Aabb bounds;           // world
+        TileState state = TileState::Unloaded;
+        std::chrono::steady_clock::time_point requested;
+        std::vector<TilePackage::Range> ranges;
+        GLuint vao = 0;
+        GLuint vbo = 0;
+        GLuint ebo = 0;
+    };
+
+    // A package on its way to the GPU, a slice per step
+    struct Upload
+    {
+        int tile = 0;
+        TilePackage package;
+        std::size_t vertexBytesDone = 0;
+        std::size_t indexBytesDone = 0;
+    };
+
+    struct Loaded
+    {
+        int tile = 0;
+        bool cooked = false;
+        TilePackage package;
+    };
+
+    void loaderLoop();
+    void stopLoader();
+    TilePackage cook(const Tile &tile) const;
+    std::filesystem::path packagePath(std::uint64_t key) const;
+    // Returns true once the upload is complete
+    bool uploadSlice(Upload &upload);
+    void evict(int tile);
+
+    const std::vector<Mesh> *meshes = nullptr;
+    std::vector<std::vector<Texture>> materials;
+    std::vector<int> meshMaterials;
+    std::vector<Tile> tiles;
+    std::filesystem::path cacheDirectory;
+    std::deque<Upload> uploads;
+    std::vector<float> distances; // per tile, this frame
+    int latencySamples = 0;
+    Stats streamStats;
+
+    // Loader thread: tile ids in, packages out
+    std::thread loader;
+    std::mutex mutex;
+    std::condition_variable wakeLoader;
+    std::deque<int> requests;
+    std::vector<Loaded> loaded;
+    bool stopping = false;
+};